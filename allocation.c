@@ -1,23 +1,24 @@
 #include "allocation.h"
 #include <string.h>
-#include <math.h>
 #include <stdlib.h>
 #include "debug.h"
 #include "parsing.h"
 #include "superblock.h"
 #include "bitmap.h"
+#include "refcount.h"
+#include "extent.h"
 
 /**
  *
  * Přidělí danému i-uzlu data bloky ve VFS, počet přidělených bloků je vypočten podle
  * potřebné velikosti v byte.
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param bytes počet byte k alokaci
  * @param inode_ptr inode k alokaci
  * @return počet alokovaných data bloků (return < 0 - chyba | 0 to INT_32_MAX)
  */
-int32_t allocate_bytes(char *filename, int64_t bytes, struct inode *inode_ptr){
+int32_t allocate_bytes(struct vfs_mount *mount, int64_t bytes, struct inode *inode_ptr){
     // Kontrola ukazatele
     if(inode_ptr == NULL){
         log_debug("allocate_bytes: Nelze alokovat misto pro inodu NULL!\n");
@@ -30,42 +31,26 @@ int32_t allocate_bytes(char *filename, int64_t bytes, struct inode *inode_ptr){
         return -2;
     }
 
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        log_debug("allocate_bytes: Nelze pouzit prazdne jmeno souboru!\n");
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("allocate_bytes: VFS neni pripojen!\n");
         return -3;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        log_debug("allocate_bytes: Zadany soubor neexistuje!\n");
-        return -4;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        log_debug("allocate_bytes: Nepodarilo se precist superblok!\n");
-        return -5;
-    }
-
-    int32_t cluster_size = superblock_ptr->cluster_size;
-    int32_t clusters_needed = (int32_t)(ceil((double)(bytes)/(double)(cluster_size))) ;
-    free(superblock_ptr);
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int32_t clusters_needed = (int32_t)((bytes + cluster_size - 1) >> mount->cluster_shift);
 
     // Výsledek alokace data bloků
-    int32_t allocate_datablock_remaining = allocate_data_blocks(filename, clusters_needed, inode_ptr);
+    int32_t allocate_datablock_remaining = allocate_data_blocks(mount, clusters_needed, inode_ptr);
 
     // Alokovali všechny nebo část data bloků
     if(allocate_datablock_remaining >= 0){
         int32_t clusters_allocated = clusters_needed - allocate_datablock_remaining;
-        int32_t bytes_remaining = bytes - (clusters_allocated * cluster_size);
+        int64_t bytes_remaining = bytes - ((int64_t)clusters_allocated * cluster_size);
 
         if(bytes_remaining > 0){
             // Návrat - počet nealokovaných byte
-            return bytes_remaining;
+            return (int32_t)(bytes_remaining > INT32_MAX ? INT32_MAX : bytes_remaining);
         }
         // Všechny bytes alokovány
         return 0;
@@ -80,12 +65,12 @@ int32_t allocate_bytes(char *filename, int64_t bytes, struct inode *inode_ptr){
  * Přidělí danému i-uzlu data bloky ve VFS, počet přidělených bloků je přímo předán
  * hodnotou funkce
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param allocation_size počet byte k alokaci
  * @param inode_ptr inode k alokaci
  * @return počet alokovaných data bloků (return < 0 - chyba | 0 to INT_32_MAX)
  */
-int32_t allocate_data_blocks(char *filename, int32_t allocation_size, struct inode *inode_ptr){
+int32_t allocate_data_blocks(struct vfs_mount *mount, int32_t allocation_size, struct inode *inode_ptr){
     // Kontrola ukazatele
     if(inode_ptr == NULL){
         log_debug("allocate_data_blocks: Nelze alokovat misto pro inodu NULL!\n");
@@ -98,259 +83,385 @@ int32_t allocate_data_blocks(char *filename, int32_t allocation_size, struct ino
         return -2;
     }
 
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        log_debug("allocate_data_blocks: Nelze pouzit prazdne jmeno souboru!\n");
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("allocate_data_blocks: VFS neni pripojen!\n");
         return -3;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        log_debug("allocate_data_blocks: Zadany soubor neexistuje!\n");
-        return -4;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        log_debug("allocate_data_blocks: Nepodarilo se precist superblok!\n");
-        return -5;
-    }
-
-    //
+    // Alokace po souvislých úsecích clusterů
     int32_t allocation_count = allocation_size;
     while(allocation_count > 0){
-        int32_t free_cluster_index = bitmap_find_free_cluster_index(filename);
-        int32_t free_cluster_address = bitmap_index_to_cluster_address(filename, free_cluster_index);
+        int32_t run_start = -1;
+        int32_t run_length = allocate_cluster_run(mount, allocation_count, &run_start);
 
+        // Nedostatek volných clusterů
+        if(run_length < 1){
+            return allocation_count;
+        }
 
-        int32_t inode_datablock_add_result = -10;
-        if(free_cluster_address > 0){
-            inode_datablock_add_result = inode_add_data_address(filename, inode_ptr, free_cluster_address);
+        int32_t i;
+        for(i = 0; i < run_length; i++){
+            int64_t cluster_address = bitmap_index_to_cluster_address(mount, run_start + i);
 
-        }
+            if(inode_add_data_address(mount, inode_ptr, cluster_address) != 0){
+                // Vrácení nevyužité části úseku
+                bitmap_set(mount, run_start + i, run_length - i, FALSE);
+                return allocation_count;
+            }
 
-        if(inode_datablock_add_result == 0){
             // Data blok alokován (přidán do inode)
             allocation_count--;
         }
-        else{
-            // Počet nealokovaných data bloků
-            free(superblock_ptr);
-            return allocation_count;
-        }
-
     }
 
     // Všechny databloky alokovány - zbylo 0 data bloků
-    free(superblock_ptr);
     return 0;
 }
 
 /**
- * Nastaví data v clusteru, začínající adresou address na 0
+ * Vyhradí v bitmapě souvislý úsek volných clusterů
  *
- * @param filename soubor vfs
- * @param address pořátek clusteru
- * @return výsledek operace (return < 0 chyba | 1 = OK)
+ * Pokud nelze najít úsek požadované délky, vyhradí nejdelší dostupný úsek
+ *
+ * @param mount připojený VFS
+ * @param count požadovaný počet clusterů
+ * @param first_index výstup - index prvního vyhrazeného clusteru
+ * @return počet vyhrazených clusterů (return < 0 - chyba | 0 - není volný cluster)
  */
-bool allocation_clear_cluster(char *filename, int32_t address){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        log_debug("allocation_clear_cluster: Nelze pouzit prazdne jmeno souboru!\n");
+int32_t allocate_cluster_run(struct vfs_mount *mount, int32_t count, int32_t *first_index){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("allocate_cluster_run: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        log_debug("alllocation_clear_cluster: Zadany soubor neexistuje!\n");
+    // Kontrola počtu clusterů
+    if(count < 1 || first_index == NULL){
+        log_debug("allocate_cluster_run: Nelze alokovat 0 a mene clusteru!\n");
         return -2;
     }
 
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
+    int32_t run_length = 0;
+    int32_t run_start = bitmap_find_free_run(mount, count, &run_length);
 
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        log_debug("allocation_clear_cluster: Nepodarilo se precist superblok!\n");
-        return -3;
+    if(run_start < 0 || run_length < 1){
+        log_debug("allocate_cluster_run: Nedostatek volnych clusteru!\n");
+        return 0;
+    }
+
+    // Označení celého úseku jedním zápisem
+    bitmap_set(mount, run_start, run_length, TRUE);
+
+    log_trace("allocate_cluster_run: Vyhrazeno %d/%d clusteru od indexu %d\n", run_length, count, run_start);
+
+    *first_index = run_start;
+    return run_length;
+}
+
+/**
+ * Nastaví data v clusteru, začínající adresou address na 0
+ *
+ * Cluster se pouze označí jako neinicializovaný (viz mount_mark_uninit),
+ * na disk se nuly zapíší až při částečném zápisu do clusteru
+ *
+ * @param mount připojený VFS
+ * @param address pořátek clusteru
+ * @return výsledek operace (return < 0 chyba | 1 = OK)
+ */
+bool allocation_clear_cluster(struct vfs_mount *mount, int64_t address){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("allocation_clear_cluster: VFS neni pripojen!\n");
+        return -1;
     }
 
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+
     // Kontrola adresy - rozsah
     if(address < superblock_ptr->data_start_address || address > superblock_ptr->disk_size){
         log_debug("allocation_clear_cluster: Adresa k vymazani dat je mimo povoleny rozsah!\n");
-        free(superblock_ptr);
         return -4;
     }
 
-    int32_t cluster_index = inode_data_index_from_address(filename, address);
+    int32_t cluster_index = inode_data_index_from_address(mount, address);
 
     // Kontrola adresy - cluster
     if(cluster_index < 0){
         log_debug("allocation_clear_cluster: Adresa k vymazanim neukazuje na pocatek datoveho bloku!\n");
-        free(superblock_ptr);
         return -5;
     }
 
-    FILE *file = fopen(filename, "r+b");
-
-    if(file == NULL){
-        log_debug("allocation_clear_cluster: Nepodarilo se otevrit soubor k prepisu\n");
-        free(superblock_ptr);
+    // Cluster se na disk nezapisuje - čte se jako nuly až do prvního zápisu
+    if(mount_mark_uninit(mount, cluster_index) != TRUE){
+        log_debug("allocation_clear_cluster: Nepodarilo se oznacit cluster %d\n", cluster_index);
         return -6;
     }
 
-    fseek(file, address, SEEK_SET);
-    char *zero = malloc(superblock_ptr->cluster_size);
-    memset(zero, 0, superblock_ptr->cluster_size);
-    fwrite(zero, superblock_ptr->cluster_size, 1, file);
-    fflush(file);
-    fclose(file);
-
-    log_trace("allocation_clear_cluster: Vynulovana data v clusteru %d\n", cluster_index);
-    free(zero);
-    free(superblock_ptr);
+    log_trace("allocation_clear_cluster: Cluster %d oznacen jako neinicializovany\n", cluster_index);
     return TRUE;
 }
 
 /**
- * Dealokuje všechny alokované databloky v INODE
+ * Porovnání indexů clusterů pro qsort
  *
- * @param filename soubor vfs
- * @param inode_ptr ukazatel na strukturu inode
- * @return výsledek operace
+ * @param a první index
+ * @param b druhý index
+ * @return výsledek porovnání
  */
-int32_t deallocate(char *filename, struct inode *inode_ptr){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        log_debug("deallocate: Nelze pouzit prazdne jmeno souboru!\n");
-        return -1;
+static int deallocate_compare(const void *a, const void *b){
+    int32_t first = *(const int32_t *)a;
+    int32_t second = *(const int32_t *)b;
+
+    return (first > second) - (first < second);
+}
+
+/**
+ * Přidá cluster na dané adrese do seznamu uvolňovaných clusterů
+ *
+ * Sdílený cluster pouze ztratí jednoho vlastníka a do seznamu se nepřidá
+ *
+ * @param mount připojený VFS
+ * @param address adresa clusteru
+ * @param shared zda mohl být cluster sdílený (datablok)
+ * @param list seznam indexů
+ * @param count počet indexů v seznamu
+ */
+static void deallocate_collect(struct vfs_mount *mount, int64_t address, bool shared, int32_t *list, int32_t *count){
+    if(address == 0){
+        return;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        log_debug("deallocate: Zadany soubor neexistuje!\n");
-        return -2;
+    int32_t index = inode_data_index_from_address(mount, address);
+
+    if(index < 0 || (shared == TRUE && refcount_release(mount, index) == TRUE)){
+        return;
     }
 
-    // Ověření ukazatele na INODe
-    if(inode_ptr == NULL){
-        log_debug("deallocate: Ukazatel na inode nesmi byt NULL!\n");
-        return -3;
+    list[(*count)++] = index;
+}
+
+/**
+ * Seřadí seznam uvolňovaných clusterů a uvolní je v bitmapě jedním průchodem,
+ * jejich místo v datovém souboru se vrátí hostitelskému systému (díra)
+ *
+ * @param mount připojený VFS
+ * @param list seznam indexů (funkce jej uvolní)
+ * @param count počet indexů v seznamu
+ * @return výsledek operace
+ */
+static int32_t deallocate_release(struct vfs_mount *mount, int32_t *list, int32_t count){
+    qsort(list, count, sizeof(int32_t), deallocate_compare);
+
+    int32_t failed = bitmap_set_list(mount, list, count, FALSE);
+
+    // Souvislé úseky uvolněných clusterů se vrátí hostitelskému systému
+    int32_t run_start = 0;
+    int32_t i;
+    for(i = 1; i <= count; i++){
+        if(i == count || list[i] != list[i - 1] + 1){
+            mount_punch_clusters(mount, list[run_start], i - run_start);
+            run_start = i;
+        }
     }
+    free(list);
 
-    struct superblock *superblock_ptr = superblock_from_file(filename);
+    if(failed != 0){
+        log_debug("deallocate_release: Nepodarilo se uvolnit %d clusteru!\n", failed);
+        return -5;
+    }
+
+    log_trace("deallocate_release: Uvolneno %d clusteru\n", count);
+    return 0;
+}
 
-    if(superblock_ptr == NULL){
-        log_debug("deallocate: Nepodarilo se precist superblock!\n");
+/**
+ * Dealokuje databloky i-uzlu popsané extenty a bloky extentů
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr ukazatel na strukturu inode
+ * @return výsledek operace
+ */
+static int32_t deallocate_extents(struct vfs_mount *mount, struct inode *inode_ptr){
+    struct inode_extent *extents = NULL;
+    int32_t count = extent_load(mount, inode_ptr, &extents);
+
+    if(count < 0){
+        log_debug("deallocate_extents: Extenty inode ID=%d nelze nacist!\n", inode_ptr->id);
         return -4;
     }
 
-    /*
-     * 0 - 4: directX+1
-     * 5 - 1028: indirect1[X-5]
-     * 1029 - END: indirect2[(X-1028)/1024][(X-1030)%1024]
-     */
-    for(int i = 0; i < inode_ptr->allocated_clusters; i++){
-        int32_t *address = malloc(sizeof(int32_t));
+    int32_t *list = malloc(sizeof(int32_t) * ((int64_t)inode_ptr->allocated_clusters + 1));
+    int32_t listed = 0;
+    int32_t i;
 
-        if(i == 0){
-            *address = inode_ptr->direct1;
-        }
+    if(list == NULL){
+        free(extents);
+        return -4;
+    }
 
-        if(i == 1){
-            *address = inode_ptr->direct2;
+    for(i = 0; i < count; i++){
+        int32_t j;
+        for(j = 0; j < extents[i].length && listed < inode_ptr->allocated_clusters; j++){
+            int64_t address = extents[i].address + ((int64_t)j << mount->cluster_shift);
+            deallocate_collect(mount, address, TRUE, list, &listed);
         }
+    }
 
-        if(i == 2){
-            *address = inode_ptr->direct3;
-        }
+    free(extents);
+    extent_free_blocks(mount, inode_ptr);
 
-        if(i == 3){
-            *address = inode_ptr->direct4;
-        }
+    return deallocate_release(mount, list, listed);
+}
 
-        if(i == 4){
-            *address = inode_ptr->direct5;
-        }
+/**
+ * Dealokuje všechny alokované databloky v INODE
+ *
+ * Všechny uvolňované clustery (včetně bloků nepřímých ukazatelů) se nejprve
+ * posbírají do seznamu, který se po seřazení uvolní v bitmapě jedním průchodem
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr ukazatel na strukturu inode
+ * @return výsledek operace
+ */
+int32_t deallocate(struct vfs_mount *mount, struct inode *inode_ptr){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("deallocate: VFS neni pripojen!\n");
+        return -1;
+    }
 
-        if(inode_ptr->indirect1 != 0 && i > 4 && i < 1029){
-            int32_t indirect1_index = inode_ptr->allocated_clusters - 5;
-            int32_t indirect1_address = inode_ptr->indirect1 + (indirect1_index * sizeof(int32_t));
+    // Ověření ukazatele na INODe
+    if(inode_ptr == NULL){
+        log_debug("deallocate: Ukazatel na inode nesmi byt NULL!\n");
+        return -3;
+    }
 
-            // Přečtení adresy
-            FILE * file = fopen(filename, "r+b");
-            fseek(file, indirect1_address, SEEK_SET);
-            fread(address, sizeof(int32_t), 1, file);
+    if((inode_ptr->flags & INODE_FLAG_EXTENTS) != 0){
+        return deallocate_extents(mount, inode_ptr);
+    }
 
-            fclose(file);
-        }
+    int32_t count = inode_ptr->allocated_clusters;
+    int32_t entries = mount->pointers_per_block;
+    int32_t indirect1_end = INODE_DIRECT_COUNT + entries;
 
-        if(inode_ptr->indirect2 != 0 && i > 1028){
-            int32_t indirect2_level1_index = (int32_t)floor(((double)(inode_ptr->allocated_clusters-1029))/1024);
-            int32_t indirect2_level2_index = (inode_ptr->allocated_clusters - 1029) % 1024;
+    if(count < 0){
+        count = 0;
+    }
 
-            // Získání adresy ukazatele na datablok - úroven 1
-            int32_t indirect2_level1_address = inode_ptr->indirect2 + (indirect2_level1_index * sizeof(int32_t));
-            int32_t *indirect2_level2_base = malloc(sizeof(int32_t));
+    // Databloky + indirect1 + indirect2 + bloky level 2
+    int32_t level2_count = count > indirect1_end ? ((count - indirect1_end) + entries - 1) >> mount->pointer_shift : 0;
+    int32_t *list = malloc(sizeof(int32_t) * ((int64_t)count + level2_count + 2));
+    int64_t *map = malloc(sizeof(int64_t) * ((int64_t)count + 1));
+    int32_t listed = 0;
+    int32_t i;
+
+    if(list == NULL || map == NULL){
+        log_debug("deallocate: Nepodarilo se alokovat pamet!\n");
+        free(list);
+        free(map);
+        return -4;
+    }
 
-            // Přečtení level 2 adresy
-            FILE *file = fopen(filename, "r+b");
-            fseek(file, indirect2_level1_address, SEEK_SET);
-            fread(indirect2_level2_base, sizeof(int32_t), 1, file);
+    // Adresy všech databloků jedním průchodem bloky ukazatelů
+    int32_t loaded = inode_load_block_map(mount, inode_ptr, map, 0, count);
+    for(i = 0; i < loaded; i++){
+        deallocate_collect(mount, map[i], TRUE, list, &listed);
+    }
+    free(map);
 
-            // Výpočet level 2 adressy
-            *address = *indirect2_level2_base + (indirect2_level2_index * sizeof(int32_t));
+    // Bloky ukazatelů druhé úrovně
+    if(inode_ptr->indirect2 != 0 && level2_count > 0){
+        int32_t *level1 = malloc(mount->superblock_ptr->cluster_size);
+        memset(level1, 0, mount->superblock_ptr->cluster_size);
+        mount_read(mount, inode_ptr->indirect2, level1, mount->superblock_ptr->cluster_size);
 
-            free(indirect2_level2_base);
+        for(i = 0; i < level2_count && i < entries; i++){
+            deallocate_collect(mount, inode_pointer_to_address(mount, level1[i]), FALSE, list, &listed);
         }
 
-        // Smazání nalezené adresy
-        if(address != 0){
+        free(level1);
+    }
 
-            int32_t index = 0;
-            int32_t current = superblock_ptr->data_start_address;
+    // Bloky indirect1 a indirect2
+    deallocate_collect(mount, inode_ptr->indirect1, FALSE, list, &listed);
+    deallocate_collect(mount, inode_ptr->indirect2, FALSE, list, &listed);
 
-            // Zjištění indexu
-            while(current != *address){
-                index = index + 1;
-                current = current + superblock_ptr->cluster_size;
-            }
+    return deallocate_release(mount, list, listed);
+}
 
-            bitmap_set(filename, index, 1, FALSE);
-        }
+/**
+ * Uvolní databloky i-uzlu s indexy <from, from + count), na jejich místě zůstane díra
+ *
+ * Mapa databloků (allocated_clusters) se nezkracuje, bloky ukazatelů zůstávají
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr ukazatel na strukturu inode
+ * @param from první uvolňovaný index
+ * @param count počet uvolňovaných indexů
+ * @return výsledek operace (return < 0 - chyba | 0 - OK)
+ */
+int32_t deallocate_range(struct vfs_mount *mount, struct inode *inode_ptr, int32_t from, int32_t count){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("deallocate_range: VFS neni pripojen!\n");
+        return -1;
+    }
+
+    // Ověření ukazatele na INODe
+    if(inode_ptr == NULL){
+        log_debug("deallocate_range: Ukazatel na inode nesmi byt NULL!\n");
+        return -3;
+    }
 
-        free(address);
+    if(from < 0 || count < 1 || from >= inode_ptr->allocated_clusters){
+        return 0;
     }
 
-    // Dealokace indirect1
-    if(inode_ptr->indirect1 != 0) {
-        int32_t current = superblock_ptr->data_start_address;
-        int32_t index = 0;
-        while(current != inode_ptr->indirect1){
-            index = index + 1;
-            current = current + superblock_ptr->cluster_size;
-        }
+    if(count > inode_ptr->allocated_clusters - from){
+        count = inode_ptr->allocated_clusters - from;
+    }
 
-        bitmap_set(filename, index, 1, FALSE);
+    int32_t end = from + count;
+    int64_t *map = malloc(sizeof(int64_t) * end);
+    int32_t *list = malloc(sizeof(int32_t) * count);
+    int32_t listed = 0;
+    int32_t i;
+
+    if(map == NULL || list == NULL){
+        log_debug("deallocate_range: Nepodarilo se alokovat pamet!\n");
+        free(map);
+        free(list);
+        return -4;
     }
 
-    // Dealokace indirect2
-    if(inode_ptr->indirect2 != 0) {
-        int32_t current = superblock_ptr->data_start_address;
-        int32_t index = 0;
-        while(current != inode_ptr->indirect2){
-            index = index + 1;
-            current = current + superblock_ptr->cluster_size;
+    if(inode_load_block_map(mount, inode_ptr, map, from, end) < 0){
+        free(map);
+        free(list);
+        return -4;
+    }
+
+    // Odstranění odkazů - extenty se oříznou najednou
+    if((inode_ptr->flags & INODE_FLAG_EXTENTS) != 0){
+        if(extent_punch(mount, inode_ptr, from, count) != 0){
+            free(map);
+            free(list);
+            return -5;
+        }
+    } else {
+        for(i = from; i < end; i++){
+            if(map[i] != 0){
+                inode_set_datablock_index_value(mount, inode_ptr, i, 0);
+            }
         }
+    }
 
-        bitmap_set(filename, index, 1, FALSE);
+    for(i = from; i < end; i++){
+        deallocate_collect(mount, map[i], TRUE, list, &listed);
     }
 
-    free(superblock_ptr);
+    free(map);
+    inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
 
-    // OK
-    return 0;
-}
\ No newline at end of file
+    return deallocate_release(mount, list, listed);
+}
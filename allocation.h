@@ -6,6 +6,7 @@
  */
 #include <stdint.h>
 #include "inode.h"
+#include "mount.h"
 
 /*
  * Konstanty
@@ -19,40 +20,66 @@
  * Přidělí danému i-uzlu data bloky ve VFS, počet přidělených bloků je vypočten podle
  * potřebné velikosti v byte.
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param bytes počet byte k alokaci
  * @param inode_ptr inode k alokaci
  * @return počet alokovaných data bloků (return < 0 - chyba | 0 to INT_32_MAX)
  */
-int32_t allocate_bytes(char *filename, int64_t bytes, struct inode *inode_ptr);
+int32_t allocate_bytes(struct vfs_mount *mount, int64_t bytes, struct inode *inode_ptr);
 
 /**
  * Přidělí danému i-uzlu data bloky ve VFS, počet přidělených bloků je přímo předán
  * hodnotou funkce
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param allocation_size počet byte k alokaci
  * @param inode_ptr inode k alokaci
  * @return počet alokovaných data bloků (return < 0 - chyba | 0 to INT_32_MAX)
  */
-int32_t allocate_data_blocks(char *filename, int32_t allocation_size, struct inode *inode_ptr);
+int32_t allocate_data_blocks(struct vfs_mount *mount, int32_t allocation_size, struct inode *inode_ptr);
+
+/**
+ * Vyhradí v bitmapě souvislý úsek volných clusterů
+ *
+ * Pokud nelze najít úsek požadované délky, vyhradí nejdelší dostupný úsek
+ *
+ * @param mount připojený VFS
+ * @param count požadovaný počet clusterů
+ * @param first_index výstup - index prvního vyhrazeného clusteru
+ * @return počet vyhrazených clusterů (return < 0 - chyba | 0 - není volný cluster)
+ */
+int32_t allocate_cluster_run(struct vfs_mount *mount, int32_t count, int32_t *first_index);
 
 /**
  * Nastaví data v clusteru, začínající adresou address na 0
  *
- * @param filename soubor vfs
+ * Cluster se pouze označí jako neinicializovaný (viz mount_mark_uninit),
+ * na disk se nuly zapíší až při částečném zápisu do clusteru
+ *
+ * @param mount připojený VFS
  * @param address pořátek clusteru
  * @return výsledek operace (return < 0 chyba | 1 = OK)
  */
-bool allocation_clear_cluster(char *filename, int32_t address);
+bool allocation_clear_cluster(struct vfs_mount *mount, int64_t address);
 
 /**
  * Dealokuje všechny alokované databloky v INODE
  *
- * @param filename soubor vfs
+ * @param mount připojený VFS
  * @param inode_ptr ukazatel na strukturu inode
  * @return výsledek operace
  */
-int32_t deallocate(char *filename, struct inode *inode_ptr);
+int32_t deallocate(struct vfs_mount *mount, struct inode *inode_ptr);
+
+/**
+ * Uvolní databloky i-uzlu s indexy <from, from + count), na jejich místě zůstane díra
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr ukazatel na strukturu inode
+ * @param from první uvolňovaný index
+ * @param count počet uvolňovaných indexů
+ * @return výsledek operace (return < 0 - chyba | 0 - OK)
+ */
+int32_t deallocate_range(struct vfs_mount *mount, struct inode *inode_ptr, int32_t from, int32_t count);
 
 #endif //KIV_ZOS_ALLOCATION_H
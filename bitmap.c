@@ -1,69 +1,259 @@
 #include "bitmap.h"
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include "parsing.h"
 #include "superblock.h"
 #include "bool.h"
 
+// Nejvyšší vzdálenost indexů, které bitmap_set_list ještě zapíše jedním zápisem
+#define BITMAP_COALESCE_GAP 512
+
+// Index nejnižšího nastaveného bitu ve slově (slovo nesmí být 0)
+#if defined(__GNUC__) || defined(__clang__)
+    #define BITMAP_CTZ(word) __builtin_ctzll(word)
+#else
+    static int32_t bitmap_ctz(uint64_t word){
+        int32_t bit = 0;
+        while((word & 1) == 0){
+            word >>= 1;
+            bit++;
+        }
+        return bit;
+    }
+    #define BITMAP_CTZ(word) bitmap_ctz(word)
+#endif
+
+// Počet nastavených bitů ve slově
+#if defined(__GNUC__) || defined(__clang__)
+    #define BITMAP_POPCOUNT(word) __builtin_popcountll(word)
+#else
+    static int32_t bitmap_popcount(uint64_t word){
+        int32_t bits = 0;
+        while(word != 0){
+            word &= word - 1;
+            bits++;
+        }
+        return bits;
+    }
+    #define BITMAP_POPCOUNT(word) bitmap_popcount(word)
+#endif
+
 /**
- * Vypíše řádkovou reprezentaci bitmapy
+ * Vrátí masku bitů <from, to) v rámci jednoho 64bitového slova
  *
- * @param filename soubor VFS
+ * @param from první bit masky
+ * @param to bit za posledním bitem masky (max 64)
+ * @return maska
  */
-int32_t bitmap_print(char *filename){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        log_debug("bitmap_print: Nelze pouzit prazdne jmeno souboru!\n");
-        return -1;
+static uint64_t bitmap_word_mask(int32_t from, int32_t to){
+    uint64_t high = (to >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << to) - 1);
+    uint64_t low = ((uint64_t)1 << from) - 1;
+    return high & ~low;
+}
+
+/**
+ * Zapíše rozsah bitmapy z paměti zpět do VFS
+ *
+ * @param mount připojený VFS
+ * @param index první zapisovaný cluster
+ * @param count počet zapisovaných clusterů
+ * @return výsledek operace
+ */
+static bool bitmap_flush_range(struct vfs_mount *mount, int32_t index, int32_t count){
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+
+    // Starý formát - 1 byte na cluster
+    if(superblock_version(superblock_ptr) == VFS_VERSION_LEGACY){
+        int8_t *bytes = malloc(sizeof(int8_t) * count);
+
+        int32_t i;
+        for(i = 0; i < count; i++){
+            bytes[i] = (int8_t)bitmap_get(mount, index + i);
+        }
+
+        int64_t written = mount_write(mount, superblock_ptr->bitmap_start_address + index, bytes, sizeof(int8_t) * count);
+        free(bytes);
+
+        return written == count ? TRUE : FALSE;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        log_debug("bitmap_print: Zadny soubor neexistuje!\n");
-        return -2;
+    // Zapisují se pouze dotčená slova
+    int32_t first_word = index / 64;
+    int32_t last_word = (index + count - 1) / 64;
+    int32_t words = last_word - first_word + 1;
+    int64_t address = superblock_ptr->bitmap_start_address + (int64_t)first_word * sizeof(uint64_t);
+
+    int64_t written = mount_write(mount, address, mount->bitmap + first_word, words * sizeof(uint64_t));
+
+    return written == (int64_t)(words * sizeof(uint64_t)) ? TRUE : FALSE;
+}
+
+/**
+ * Zapíše počet volných clusterů do superbloku ve VFS (pouze formát, který jej ukládá)
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+static bool bitmap_flush_free_count(struct vfs_mount *mount){
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+
+    if(superblock_version(superblock_ptr) < VFS_VERSION_FREE_COUNT){
+        return TRUE;
     }
 
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
+    int64_t written = mount_write(mount, offsetof(struct superblock, free_cluster_count), &superblock_ptr->free_cluster_count, sizeof(int32_t));
+
+    return written == sizeof(int32_t) ? TRUE : FALSE;
+}
+
+/**
+ * Nastaví v paměti souvislý úsek bitmapy, do VFS nic nezapisuje
+ *
+ * Počet volných clusterů v superbloku se upraví o skutečně změněné bity,
+ * poslední cluster se nepřiděluje, a proto se do něj nezapočítává
+ *
+ * @param mount připojený VFS
+ * @param index počáteční index
+ * @param count počet clusterů (úsek musí ležet uvnitř bitmapy)
+ * @param value hodnota
+ */
+static void bitmap_update_range(struct vfs_mount *mount, int32_t index, int32_t count, bool value){
+    int32_t end = index + count;
+    int32_t word = index / 64;
+    int32_t last_word = (end - 1) / 64;
+    int32_t cluster_limit = mount->superblock_ptr->cluster_count - 1;
+
+    while(word <= last_word){
+        int32_t from = (word == index / 64) ? index % 64 : 0;
+        int32_t to = (word == last_word) ? end - word * 64 : 64;
+        uint64_t mask = bitmap_word_mask(from, to);
+        uint64_t counted = mask;
+
+        // Bity od posledního clusteru dál se do volných clusterů nepočítají
+        if(word == cluster_limit / 64){
+            counted &= bitmap_word_mask(0, cluster_limit % 64);
+        } else if(word > cluster_limit / 64){
+            counted = 0;
+        }
+
+        if(value == FALSE){
+            mount->superblock_ptr->free_cluster_count += BITMAP_POPCOUNT(mount->bitmap[word] & counted);
+            mount->bitmap[word] &= ~mask;
+        } else {
+            mount->superblock_ptr->free_cluster_count -= BITMAP_POPCOUNT(~mount->bitmap[word] & counted);
+            mount->bitmap[word] |= mask;
+        }
 
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        log_debug("bitmap_print: Nepodarilo se precist superblok!\n");
-        return -3;
+        word++;
     }
 
-    // Otevření souboru pro čtení
-    FILE *file = fopen(filename, "r");
+    // Uvolněné místo před rotorem bude nalezeno dříve
+    if(value == FALSE && index / 64 < mount->bitmap_rotor){
+        mount->bitmap_rotor = index / 64;
+    }
+}
 
-    // Ověření otevření souboru
-    if(file == NULL) {
-        log_debug("bitmap_print: Nepodarilo se otevrit soubor ke cteni!\n");
-        return -4;
+/**
+ * Načte bitmapu datových bloků z VFS do paměti
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool bitmap_load(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("bitmap_load: VFS neni pripojen!\n");
+        return FALSE;
     }
 
-    int32_t bitmap_address = superblock_ptr->bitmap_start_address;
-    int32_t inode_address = superblock_ptr->inode_start_address;
+    struct superblock *superblock_ptr = mount->superblock_ptr;
     int32_t clusters = superblock_ptr->cluster_count;
-    int32_t current_address = bitmap_address;
-    bool *bitmap_data = malloc(sizeof(bool));
 
-    printf("Bitmap: ");
-    while(clusters > 0){
-        fseek(file, current_address, SEEK_SET);
-        fread(bitmap_data, sizeof(bool), 1, file);
+    // Alokace vynulované paměti pro bitmapu - díry v souboru VFS jsou volné clustery
+    mount->bitmap_words = (int32_t)(((int64_t)clusters + 63) / 64);
+    mount->bitmap_rotor = 0;
+    mount->bitmap = calloc(mount->bitmap_words + 1, sizeof(uint64_t));
 
-        // Výpis
-        printf("%d", *bitmap_data);
+    if(mount->bitmap == NULL){
+        log_debug("bitmap_load: Nepodarilo se alokovat pamet!\n");
+        return FALSE;
+    }
+
+    if(superblock_version(superblock_ptr) == VFS_VERSION_LEGACY){
+        // Starý formát - převod 1 byte na cluster -> 1 bit na cluster
+        int8_t *bytes = calloc(clusters, sizeof(int8_t));
+        int64_t read = bytes == NULL ? -1 : mount_read_sparse(mount, superblock_ptr->bitmap_start_address, bytes, sizeof(int8_t) * clusters);
 
-        clusters--;
-        current_address = current_address + sizeof(bool);
+        if(read != clusters){
+            free(bytes);
+            return FALSE;
+        }
+
+        int32_t i;
+        for(i = 0; i < clusters; i++){
+            if(bytes[i] != FALSE){
+                mount->bitmap[i / 64] |= (uint64_t)1 << (i % 64);
+            }
+        }
+
+        free(bytes);
+    } else {
+        int64_t size = superblock_bitmap_size(superblock_ptr);
+        int64_t read = mount_read_sparse(mount, superblock_ptr->bitmap_start_address, mount->bitmap, size);
+
+        if(read != size){
+            return FALSE;
+        }
     }
-    printf("\n");
 
-    // Uvolnění zdrojů
-    fclose(file);
-    free(bitmap_data);
-    free(superblock_ptr);
+    // Bity za posledním clusterem jsou vždy obsazené, hledání je tak nikdy nevrátí
+    if(clusters % 64 != 0){
+        mount->bitmap[mount->bitmap_words - 1] |= ~bitmap_word_mask(0, clusters % 64);
+    }
+
+    // Starší formáty počet volných clusterů neukládají - dopočte se jednou při připojení
+    if(superblock_version(superblock_ptr) < VFS_VERSION_FREE_COUNT){
+        int64_t used = -((int64_t)mount->bitmap_words * 64 - clusters);
+        int32_t word;
+
+        for(word = 0; word < mount->bitmap_words; word++){
+            used += BITMAP_POPCOUNT(mount->bitmap[word]);
+        }
+
+        superblock_ptr->free_cluster_count = (int32_t)(clusters - used);
+
+        // Poslední cluster se nepřiděluje, volný se nepočítá
+        if(clusters > 0 && (mount->bitmap[(clusters - 1) / 64] & ((uint64_t)1 << ((clusters - 1) % 64))) == 0){
+            superblock_ptr->free_cluster_count--;
+        }
+    }
+
+    log_debug("bitmap_load: Nactena bitmapa %d clusteru (%d slov)\n", clusters, mount->bitmap_words);
+    return TRUE;
+}
+
+/**
+ * Vypíše řádkovou reprezentaci bitmapy
+ *
+ * @param mount připojený VFS
+ */
+int32_t bitmap_print(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("bitmap_print: VFS neni pripojen!\n");
+        return -1;
+    }
+
+    int32_t clusters = mount->superblock_ptr->cluster_count;
+    int32_t i;
+
+    printf("Bitmap: ");
+    for(i = 0; i < clusters; i++){
+        // Výpis
+        printf("%d", bitmap_get(mount, i));
+    }
+    printf("\n");
 
     return TRUE;
 }
@@ -72,157 +262,169 @@ int32_t bitmap_print(char *filename){
  * Nastaví souvislý blok hodnot v bitmapě na zvolenou hodnotu,
  * funkce neřeší kolizi již existujících dat.
  *
- * @param filename soubor vfs
+ * Mění celá 64bitová slova najednou a do VFS zapisuje pouze dotčená slova
+ *
+ * @param mount připojený VFS
  * @param index počáteční index zápisu
  * @param count počet členů v bloku
  * @param value hodnota
  * @return výsledek operace (return < 0 - chyby  | 0 - úspěch | return > 0 - kolik zápisů se nepodařilo)
  */
-int32_t bitmap_set(char *filename, int32_t index, int32_t count, bool value){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        log_debug("bitmap_set: Nelze pouzit prazdne jmeno souboru!\n");
+int32_t bitmap_set(struct vfs_mount *mount, int32_t index, int32_t count, bool value){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("bitmap_set: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        log_debug("bitmap_set: Zadany soubor neexistuje!\n");
-        return -2;
+    int32_t clusters = mount->superblock_ptr->cluster_count;
+
+    // Ověření validity zápisu
+    if(index < 0 || index >= clusters || count < 1){
+        log_debug("bitmap_set: Index je mimo povoleny rozsah!\n");
+        return -4;
     }
 
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
+    // Zápis za konec bitmapy se neprovede
+    int32_t to_write = count;
+    if(index + count > clusters){
+        count = clusters - index;
+    }
 
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        log_debug("bitmap_set: Nepodarilo se precist superblok!\n");
-        return -3;
+    bitmap_update_range(mount, index, count, value);
+
+    if(bitmap_flush_range(mount, index, count) != TRUE || bitmap_flush_free_count(mount) != TRUE){
+        log_debug("bitmap_set: Bitmapu se nepodarilo zapsat do VFS!\n");
+        return to_write;
     }
 
-    // Otevření souboru pro zápis - speciálně r+b kvůli přepisování dat
-    FILE *file = fopen(filename, "r+b");
+    return to_write - count;
+}
 
-    // Ověření otevření souboru
-    if(file == NULL) {
-        log_debug("bitmap_set: Nepodarilo se otevrit soubor ke cteni a zapisu!\n");
-        return -4;
+/**
+ * Nastaví na zvolenou hodnotu všechny clustery ze seznamu indexů
+ *
+ * Seznam musí být seřazený vzestupně (duplicity nevadí). Bitmapa se nejprve
+ * změní v paměti, do VFS se pak zapíší souvislé oblasti dotčených slov -
+ * indexy vzdálené nejvýše BITMAP_COALESCE_GAP clusterů se zapíší jedním zápisem
+ *
+ * @param mount připojený VFS
+ * @param indexes seřazené indexy clusterů
+ * @param count počet indexů
+ * @param value hodnota
+ * @return výsledek operace (return < 0 - chyby  | 0 - úspěch | return > 0 - kolik zápisů se nepodařilo)
+ */
+int32_t bitmap_set_list(struct vfs_mount *mount, const int32_t *indexes, int32_t count, bool value){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("bitmap_set_list: VFS neni pripojen!\n");
+        return -1;
     }
 
-    int32_t bitmap_address = superblock_ptr->bitmap_start_address;
-    int32_t to_write = count;
-    int32_t visit = 0;
-
-    while(visit < superblock_ptr->cluster_count){
-        if(visit == index){
-            int32_t current_address = bitmap_address + sizeof(bool) * index;
-            while(to_write && visit < superblock_ptr->cluster_count){
-                fseek(file, current_address, SEEK_SET);
-                fwrite(&value, sizeof(bool), 1, file);
-
-                to_write--;
-                visit++;
-                current_address = current_address + sizeof(bool);
+    if(indexes == NULL || count < 0){
+        return -2;
+    }
+
+    int32_t clusters = mount->superblock_ptr->cluster_count;
+    int32_t failed = 0;
+    int32_t writes = 0;
+    int32_t i = 0;
+
+    while(i < count){
+        // Neplatné indexy se přeskočí
+        if(indexes[i] < 0 || indexes[i] >= clusters){
+            log_debug("bitmap_set_list: Index %d je mimo povoleny rozsah!\n", indexes[i]);
+            failed++;
+            i++;
+            continue;
+        }
+
+        // Oblast končí před první dostatečně vzdálenou mezerou
+        int32_t first = indexes[i];
+        int32_t last = first;
+        int32_t members = 0;
+
+        while(i < count && indexes[i] >= last && indexes[i] < clusters && indexes[i] - last <= BITMAP_COALESCE_GAP){
+            // Souvislé indexy se nastaví najednou
+            int32_t run_start = indexes[i];
+            int32_t run_end = run_start + 1;
+            int32_t run_members = 1;
+
+            while(i + run_members < count && indexes[i + run_members] <= run_end && indexes[i + run_members] >= run_start){
+                if(indexes[i + run_members] == run_end){
+                    run_end++;
+                }
+
+                run_members++;
             }
+
+            if(run_end > clusters){
+                run_end = clusters;
+            }
+
+            bitmap_update_range(mount, run_start, run_end - run_start, value);
+
+            last = run_end - 1;
+            members += run_members;
+            i += run_members;
         }
 
+        if(bitmap_flush_range(mount, first, last - first + 1) != TRUE){
+            log_debug("bitmap_set_list: Bitmapu se nepodarilo zapsat do VFS!\n");
+            failed += members;
+        }
 
-        visit++;
+        writes++;
     }
 
-    // Uvolnění zdrojů
-    free(superblock_ptr);
-    fclose(file);
+    if(bitmap_flush_free_count(mount) != TRUE){
+        log_debug("bitmap_set_list: Pocet volnych clusteru se nepodarilo zapsat do VFS!\n");
+    }
 
-    return to_write;
+    log_trace("bitmap_set_list: Nastaveno %d clusteru na %d (%d zapisu)\n", count - failed, value, writes);
+    return failed;
 }
 
 /**
  * Vrátí hodnotu bitmapy na určeném indexu
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param index index dat
  * @return hodnota dat na indexu (return < 0 - chyba)
  */
-bool bitmap_get(char *filename, int32_t index) {
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        log_debug("bitmap_get: Nelze pouzit prazdne jmeno souboru!\n");
+bool bitmap_get(struct vfs_mount *mount, int32_t index) {
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("bitmap_get: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        log_debug("bitmap_get: Zadany soubor neexistuje!\n");
-        return -2;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        log_debug("bitmap_get: Nepodarilo se precist superblok!\n");
-        return -3;
-    }
+    struct superblock *superblock_ptr = mount->superblock_ptr;
 
     // Ověření validity čtení
     if(index < 0 || index > superblock_ptr->cluster_count){
-        free(superblock_ptr);
         log_debug("bitmap_get: Index je mimo povoleny rozsah!\n");
         return -4;
     }
 
-    // Otevření souboru pro zápis - speciálně r+b kvůli přepisování dat
-    FILE *file = fopen(filename, "r");
-
-    // Ověření otevření souboru
-    if(file == NULL) {
-        free(superblock_ptr);
-        log_debug("bitmap_get: Nepodarilo se otevrit soubor ke cteni!\n");
-        return -5;
-    }
-
-    bool value = -6;
-    int32_t read_address = superblock_ptr->bitmap_start_address + (index * sizeof(bool));
-    fseek(file, read_address, SEEK_SET);
-    fread(&value, sizeof(bool), 1, file);
-
-    // Uvolnění zdrojů
-    free(superblock_ptr);
-    fclose(file);
-
-    return value;
+    return (mount->bitmap[index / 64] >> (index % 64)) & 1 ? TRUE : FALSE;
 }
 
 /**
  * Na základě indexu vypočte počáteční adresu clusteru
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param index index clusteru
  * @return (return < 0 - chyba | return > 0 - adresa clusteru ve VFS)
  */
-int32_t bitmap_index_to_cluster_address(char *filename, int32_t index){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        log_debug("bitmap_index_to_cluster_address: Nelze pouzit prazdne jmeno souboru!\n");
+int64_t bitmap_index_to_cluster_address(struct vfs_mount *mount, int32_t index){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("bitmap_index_to_cluster_address: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        log_debug("bitmap_index_to_cluster_address: Zadany soubor neexistuje!\n");
-        return -2;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        log_debug("bitmap_index_to_cluster_address: Nepodarilo se precist superblok!\n");
-        return -3;
-    }
+    struct superblock *superblock_ptr = mount->superblock_ptr;
 
     // Ověření validity čtení
     if(index < 0 || index > superblock_ptr->cluster_count){
@@ -230,55 +432,164 @@ int32_t bitmap_index_to_cluster_address(char *filename, int32_t index){
         return -4;
     }
 
-    int32_t address = superblock_ptr->data_start_address + (index * superblock_ptr->cluster_size);
-
-    free(superblock_ptr);
-    return address;
-
+    return superblock_ptr->data_start_address + ((int64_t)index * superblock_ptr->cluster_size);
 }
 
 /**
  * Vrátí první volný cluster v bitmapě
  *
- * @param filename soubor vfs
+ * Prohledává po 64bitových slovech od rotoru (slovo posledního nálezu),
+ * volný bit ve slově najde pomocí count-trailing-zeros
+ *
+ * @param mount připojený VFS
  * @return  index volného clusteru
  */
-int32_t bitmap_find_free_cluster_index(char *filename){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        log_debug("bitmap_find_free_cluster_index: Nelze pouzit prazdne jmeno souboru!\n");
+int32_t bitmap_find_free_cluster_index(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("bitmap_find_free_cluster_index: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        log_debug("bitmap_find_free_cluster_index: Zadany soubor neexistuje!\n");
-        return -2;
+    // Počet volných clusterů je znám ze superbloku - plný VFS se neprohledává
+    if(mount->superblock_ptr->free_cluster_count < 1){
+        return -4;
     }
 
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
+    // Poslední cluster se nepřiděluje - může přesahovat konec VFS
+    int32_t cluster_limit = mount->superblock_ptr->cluster_count - 1;
+    int32_t words = mount->bitmap_words;
+    int32_t checked = 0;
+    int32_t word = mount->bitmap_rotor;
 
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        log_debug("bitmap_find_free_cluster_index: Nepodarilo se precist superblok!\n");
-        return -3;
-    }
+    while(checked < words){
+        if(word >= words){
+            word = 0;
+        }
 
-    int32_t current_index = 0;
-    int32_t cluster_count = superblock_ptr->cluster_count;
-    free(superblock_ptr);
+        // Slovo obsahuje alespoň jeden volný cluster
+        if(~mount->bitmap[word] != 0){
+            int32_t index = word * 64 + BITMAP_CTZ(~mount->bitmap[word]);
 
-    // Lineární prohledávání bitmapy
-    while(current_index < cluster_count - 1){
-        // Cluster je prázdný
-        if(bitmap_get(filename, current_index) == FALSE){
-            return current_index;
+            if(index < cluster_limit){
+                mount->bitmap_rotor = word;
+                return index;
+            }
         }
-        current_index++;
+
+        word++;
+        checked++;
     }
 
     // Neexistuje volný cluster
     return -4;
 
-}
\ No newline at end of file
+}
+
+/**
+ * Najde souvislý úsek volných clusterů
+ *
+ * Prohledává od rotoru a vrátí první úsek délky alespoň wanted, pokud takový
+ * neexistuje, vrátí nejdelší nalezený úsek (vždy nejvýše wanted clusterů)
+ *
+ * @param mount připojený VFS
+ * @param wanted požadovaný počet clusterů
+ * @param run_length výstup - délka nalezeného úseku
+ * @return (return < 0 - chyba | return >= 0 - index prvního clusteru úseku)
+ */
+int32_t bitmap_find_free_run(struct vfs_mount *mount, int32_t wanted, int32_t *run_length){
+    // Kontrola připojení
+    if(mount == NULL || run_length == NULL){
+        log_debug("bitmap_find_free_run: VFS neni pripojen!\n");
+        return -1;
+    }
+
+    if(wanted < 1){
+        return -2;
+    }
+
+    // Plný VFS se neprohledává
+    if(mount->superblock_ptr->free_cluster_count < 1){
+        *run_length = 0;
+        return -4;
+    }
+
+    // Poslední cluster se nepřiděluje - může přesahovat konec VFS
+    int32_t cluster_limit = mount->superblock_ptr->cluster_count - 1;
+    int32_t start = mount->bitmap_rotor * 64;
+    int32_t best_index = -4;
+    int32_t best_length = 0;
+    int32_t pass;
+
+    // Dva průchody: od rotoru do konce, poté od začátku k rotoru
+    for(pass = 0; pass < 2; pass++){
+        int32_t index = pass == 0 ? start : 0;
+        int32_t end = pass == 0 ? cluster_limit : start;
+
+        while(index < end){
+            uint64_t free_bits = ~mount->bitmap[index / 64] >> (index % 64);
+
+            // Zbytek slova je obsazený - skok na další slovo
+            if(free_bits == 0){
+                index = (index / 64 + 1) * 64;
+                continue;
+            }
+
+            // Přeskočení obsazených clusterů uvnitř slova
+            index += BITMAP_CTZ(free_bits);
+            if(index >= end){
+                break;
+            }
+
+            // Měření délky volného úseku - po slovech až k prvnímu obsazenému clusteru
+            int32_t length = 0;
+            while(index + length < end && length < wanted){
+                int32_t position = index + length;
+                uint64_t used_bits = mount->bitmap[position / 64] >> (position % 64);
+
+                // Celý zbytek slova je volný
+                if(used_bits == 0){
+                    length += 64 - position % 64;
+                    continue;
+                }
+
+                length += BITMAP_CTZ(used_bits);
+                break;
+            }
+
+            // Oříznutí na požadovanou délku a konec prohledávané oblasti
+            if(length > wanted){
+                length = wanted;
+            }
+            if(index + length > end){
+                length = end - index;
+            }
+
+            if(length > best_length){
+                best_index = index;
+                best_length = length;
+            }
+
+            if(best_length == wanted){
+                mount->bitmap_rotor = (index + length - 1) / 64;
+                *run_length = best_length;
+                return best_index;
+            }
+
+            index += length;
+        }
+    }
+
+    *run_length = best_length;
+    return best_index;
+}
+
+/**
+ * Vrátí index nejnižšího nulového bitu ve slově bitmapy
+ *
+ * @param word slovo bitmapy (nesmí mít nastaveny všechny bity)
+ * @return index bitu (0 - 63)
+ */
+int32_t bitmap_word_first_free(uint64_t word){
+    return BITMAP_CTZ(~word);
+}
@@ -6,6 +6,7 @@
  */
 #include <stdint.h>
 #include "bool.h"
+#include "mount.h"
 
 /*
  * Konstanty
@@ -15,50 +16,97 @@
  * Struktury
  */
 
+/**
+ * Načte bitmapu datových bloků z VFS do paměti
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool bitmap_load(struct vfs_mount *mount);
+
 /**
  * Vypíše řádkovou reprezentaci bitmapy
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  */
-int32_t bitmap_print(char *filename);
+int32_t bitmap_print(struct vfs_mount *mount);
 
 /**
  * Nastaví souvislý blok hodnot v bitmapě na zvolenou hodnotu,
  * funkce neřeší kolizi již existujících dat.
  *
- * @param filename soubor vfs
+ * Mění celá 64bitová slova najednou a do VFS zapisuje pouze dotčená slova
+ *
+ * @param mount připojený VFS
  * @param index počáteční index zápisu
  * @param count počet členů v bloku
  * @param value hodnota
  * @return výsledek operace (return < 0 - chyby  | 0 - úspěch | return > 0 - kolik zápisů se nepodařilo)
  */
-int32_t bitmap_set(char *filename, int32_t index, int32_t count, bool value);
+int32_t bitmap_set(struct vfs_mount *mount, int32_t index, int32_t count, bool value);
+
+/**
+ * Nastaví na zvolenou hodnotu všechny clustery ze seznamu indexů
+ *
+ * Seznam musí být seřazený vzestupně, blízké indexy se do VFS zapíší jedním zápisem
+ *
+ * @param mount připojený VFS
+ * @param indexes seřazené indexy clusterů
+ * @param count počet indexů
+ * @param value hodnota
+ * @return výsledek operace (return < 0 - chyby  | 0 - úspěch | return > 0 - kolik zápisů se nepodařilo)
+ */
+int32_t bitmap_set_list(struct vfs_mount *mount, const int32_t *indexes, int32_t count, bool value);
 
 /**
  * Vrátí hodnotu bitmapy na určeném indexu
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param index index dat
  * @return hodnota dat na indexu
  */
-bool bitmap_get(char *filename, int32_t index);
+bool bitmap_get(struct vfs_mount *mount, int32_t index);
 
 
 /**
  * Na základě indexu vypočte počáteční adresu clusteru
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param index index clusteru
  * @return (return < 0 - chyba | return > 0 - adresa clusteru ve VFS)
  */
-int32_t bitmap_index_to_cluster_address(char *filename, int32_t index);
+int64_t bitmap_index_to_cluster_address(struct vfs_mount *mount, int32_t index);
 
 /**
  * Vrátí první volný cluster v bitmapě
  *
- * @param filename soubor vfs
+ * Prohledává po 64bitových slovech od rotoru (slovo posledního nálezu),
+ * volný bit ve slově najde pomocí count-trailing-zeros
+ *
+ * @param mount připojený VFS
  * @return  index volného clusteru
  */
-int32_t bitmap_find_free_cluster_index(char *filename);
+int32_t bitmap_find_free_cluster_index(struct vfs_mount *mount);
+
+/**
+ * Najde souvislý úsek volných clusterů
+ *
+ * Prohledává od rotoru a vrátí první úsek délky alespoň wanted, pokud takový
+ * neexistuje, vrátí nejdelší nalezený úsek (vždy nejvýše wanted clusterů)
+ *
+ * @param mount připojený VFS
+ * @param wanted požadovaný počet clusterů
+ * @param run_length výstup - délka nalezeného úseku
+ * @return (return < 0 - chyba | return >= 0 - index prvního clusteru úseku)
+ */
+int32_t bitmap_find_free_run(struct vfs_mount *mount, int32_t wanted, int32_t *run_length);
+
+/**
+ * Vrátí index nejnižšího nulového bitu ve slově bitmapy
+ *
+ * @param word slovo bitmapy (nesmí mít nastaveny všechny bity)
+ * @return index bitu (0 - 63)
+ */
+int32_t bitmap_word_first_free(uint64_t word);
 
 #endif //KIV_ZOS_BITMAP_H
@@ -0,0 +1,546 @@
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "mount.h"
+
+/**
+ * Vrátí index řetězce hashovací tabulky pro danou adresu stránky
+ *
+ * @param cache ukazatel na vyrovnávací paměť
+ * @param address adresa počátku stránky
+ * @return index v tabulce buckets
+ */
+static int32_t cache_bucket(struct vfs_cache *cache, int64_t address){
+    uint64_t page_number = (uint64_t)(address / cache->page_size);
+    return (int32_t)((page_number * 2654435761u) & (cache->bucket_count - 1));
+}
+
+/**
+ * Vyjme stránku z LRU seznamu
+ *
+ * @param cache ukazatel na vyrovnávací paměť
+ * @param index index stránky
+ */
+static void cache_lru_unlink(struct vfs_cache *cache, int32_t index){
+    struct cache_page *page = &cache->pages[index];
+
+    if(page->lru_prev != CACHE_NONE){
+        cache->pages[page->lru_prev].lru_next = page->lru_next;
+    } else {
+        cache->lru_head = page->lru_next;
+    }
+
+    if(page->lru_next != CACHE_NONE){
+        cache->pages[page->lru_next].lru_prev = page->lru_prev;
+    } else {
+        cache->lru_tail = page->lru_prev;
+    }
+
+    page->lru_prev = CACHE_NONE;
+    page->lru_next = CACHE_NONE;
+}
+
+/**
+ * Vloží stránku na začátek LRU seznamu (naposledy použitá)
+ *
+ * @param cache ukazatel na vyrovnávací paměť
+ * @param index index stránky
+ */
+static void cache_lru_push(struct vfs_cache *cache, int32_t index){
+    struct cache_page *page = &cache->pages[index];
+
+    page->lru_prev = CACHE_NONE;
+    page->lru_next = cache->lru_head;
+
+    if(cache->lru_head != CACHE_NONE){
+        cache->pages[cache->lru_head].lru_prev = index;
+    }
+
+    cache->lru_head = index;
+
+    if(cache->lru_tail == CACHE_NONE){
+        cache->lru_tail = index;
+    }
+}
+
+/**
+ * Najde stránku s danou adresou
+ *
+ * @param cache ukazatel na vyrovnávací paměť
+ * @param address adresa počátku stránky
+ * @return (index stránky | CACHE_NONE)
+ */
+static int32_t cache_lookup(struct vfs_cache *cache, int64_t address){
+    int32_t index = cache->buckets[cache_bucket(cache, address)];
+
+    while(index != CACHE_NONE){
+        if(cache->pages[index].address == address){
+            return index;
+        }
+        index = cache->pages[index].hash_next;
+    }
+
+    return CACHE_NONE;
+}
+
+/**
+ * Odebere stránku z hashovací tabulky
+ *
+ * @param cache ukazatel na vyrovnávací paměť
+ * @param index index stránky
+ */
+static void cache_hash_remove(struct vfs_cache *cache, int32_t index){
+    int32_t *link = &cache->buckets[cache_bucket(cache, cache->pages[index].address)];
+
+    while(*link != CACHE_NONE){
+        if(*link == index){
+            *link = cache->pages[index].hash_next;
+            break;
+        }
+        link = &cache->pages[*link].hash_next;
+    }
+
+    cache->pages[index].hash_next = CACHE_NONE;
+}
+
+/**
+ * Zapíše změněnou stránku do VFS
+ *
+ * @param mount připojený VFS
+ * @param index index stránky
+ * @return výsledek operace
+ */
+static bool cache_write_back(struct vfs_mount *mount, int32_t index){
+    struct vfs_cache *cache = mount->cache;
+    struct cache_page *page = &cache->pages[index];
+
+    if(page->dirty == FALSE){
+        return TRUE;
+    }
+
+    // Stránka na konci souboru se zapisuje jen do konce souboru
+    int64_t length = cache->page_size;
+    if(page->address + length > mount->file_size){
+        length = mount->file_size - page->address;
+    }
+
+    if(length > 0 && mount_raw_write(mount, page->address, page->data, length) != length){
+        log_debug("cache_write_back: Stranku na adrese %ld se nepodarilo zapsat!\n", (long)page->address);
+        return FALSE;
+    }
+
+    page->dirty = FALSE;
+    cache->writebacks++;
+    return TRUE;
+}
+
+/**
+ * Vrátí stránku s danou adresou, při chybění ji načte z VFS
+ * (případně nahradí nejdéle nepoužitou stránku)
+ *
+ * @param mount připojený VFS
+ * @param address adresa počátku stránky
+ * @param load načíst obsah z VFS (FALSE pokud bude celá stránka přepsána)
+ * @return (index stránky | CACHE_NONE)
+ */
+static int32_t cache_get_page(struct vfs_mount *mount, int64_t address, bool load){
+    struct vfs_cache *cache = mount->cache;
+    int32_t index = cache_lookup(cache, address);
+
+    // Stránka je v paměti
+    if(index != CACHE_NONE){
+        cache->hits++;
+        cache_lru_unlink(cache, index);
+        cache_lru_push(cache, index);
+        return index;
+    }
+
+    cache->misses++;
+
+    if(cache->used < cache->capacity){
+        // Volná stránka
+        index = cache->used;
+        cache->used++;
+    } else {
+        // Náhrada nejdéle nepoužité stránky
+        index = cache->lru_tail;
+
+        if(cache_write_back(mount, index) != TRUE){
+            return CACHE_NONE;
+        }
+
+        cache_lru_unlink(cache, index);
+        cache_hash_remove(cache, index);
+        cache->evictions++;
+    }
+
+    struct cache_page *page = &cache->pages[index];
+    page->address = address;
+    page->dirty = FALSE;
+    memset(page->data, 0, cache->page_size);
+
+    if(load == TRUE && mount_raw_read(mount, address, page->data, cache->page_size) < 0){
+        log_debug("cache_get_page: Stranku na adrese %ld se nepodarilo nacist!\n", (long)address);
+        page->address = CACHE_NONE;
+        cache_lru_push(cache, index);
+        return CACHE_NONE;
+    }
+
+    // Vložení do hashovací tabulky a LRU
+    int32_t bucket = cache_bucket(cache, address);
+    page->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = index;
+    cache_lru_push(cache, index);
+
+    return index;
+}
+
+/**
+ * Vytvoří vyrovnávací paměť
+ *
+ * @param page_size velikost stránky v bytech
+ * @param capacity maximální počet stránek
+ * @return (struct vfs_cache * | NULL)
+ */
+struct vfs_cache *cache_create(int32_t page_size, int32_t capacity){
+    if(page_size < 1 || capacity < 1){
+        log_debug("cache_create: Velikost stranky i pocet stranek musi byt kladne!\n");
+        return NULL;
+    }
+
+    struct vfs_cache *cache = malloc(sizeof(struct vfs_cache));
+
+    if(cache == NULL){
+        log_debug("cache_create: Nepodarilo se alokovat pamet!\n");
+        return NULL;
+    }
+
+    memset(cache, 0, sizeof(struct vfs_cache));
+    cache->page_size = page_size;
+    cache->capacity = capacity;
+    cache->lru_head = CACHE_NONE;
+    cache->lru_tail = CACHE_NONE;
+
+    // Hashovací tabulka alespoň 2x větší než počet stránek
+    cache->bucket_count = 1;
+    while(cache->bucket_count < capacity * 2){
+        cache->bucket_count *= 2;
+    }
+
+    cache->buckets = malloc(sizeof(int32_t) * cache->bucket_count);
+    cache->pages = malloc(sizeof(struct cache_page) * capacity);
+
+    if(cache->buckets == NULL || cache->pages == NULL){
+        log_debug("cache_create: Nepodarilo se alokovat pamet!\n");
+        free(cache->buckets);
+        free(cache->pages);
+        free(cache);
+        return NULL;
+    }
+
+    int32_t i;
+    for(i = 0; i < cache->bucket_count; i++){
+        cache->buckets[i] = CACHE_NONE;
+    }
+
+    for(i = 0; i < capacity; i++){
+        cache->pages[i].address = CACHE_NONE;
+        cache->pages[i].data = malloc(page_size);
+        cache->pages[i].dirty = FALSE;
+        cache->pages[i].lru_prev = CACHE_NONE;
+        cache->pages[i].lru_next = CACHE_NONE;
+        cache->pages[i].hash_next = CACHE_NONE;
+    }
+
+    log_debug("cache_create: Vytvorena vyrovnavaci pamet %d x %d byte\n", capacity, page_size);
+    return cache;
+}
+
+/**
+ * Uvolní vyrovnávací paměť - neprovádí zápis změněných stránek
+ *
+ * @param cache ukazatel na vyrovnávací paměť
+ */
+void cache_free(struct vfs_cache *cache){
+    if(cache == NULL){
+        return;
+    }
+
+    int32_t i;
+    for(i = 0; i < cache->capacity; i++){
+        free(cache->pages[i].data);
+    }
+
+    free(cache->pages);
+    free(cache->buckets);
+    free(cache);
+}
+
+/**
+ * Přečte data připojeného VFS přes vyrovnávací paměť
+ *
+ * @param mount připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer cíl čtení
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet přečtených byte)
+ */
+int64_t cache_read(struct vfs_mount *mount, int64_t address, void *buffer, size_t size){
+    struct vfs_cache *cache = mount->cache;
+    int64_t page_size = cache->page_size;
+
+    // Konec souboru
+    if(address >= mount->file_size){
+        return 0;
+    }
+
+    if(address + (int64_t)size > mount->file_size){
+        size = mount->file_size - address;
+    }
+
+    // Velké čtení (celé datové bloky) jde přímo do VFS, aby nevytlačilo metadata
+    if((int64_t)size >= page_size){
+        int64_t result = mount_raw_read(mount, address, buffer, size);
+
+        if(result < 0){
+            return result;
+        }
+
+        // Překrytí daty ze změněných stránek, které ještě nebyly zapsány
+        int64_t page_address = address - (address % page_size);
+        for(; page_address < address + result; page_address += page_size){
+            int32_t index = cache_lookup(cache, page_address);
+
+            if(index == CACHE_NONE || cache->pages[index].dirty == FALSE){
+                continue;
+            }
+
+            int64_t from = page_address > address ? page_address : address;
+            int64_t to = page_address + page_size < address + result ? page_address + page_size : address + result;
+            memcpy((char *)buffer + (from - address), cache->pages[index].data + (from - page_address), to - from);
+        }
+
+        return result;
+    }
+
+    // Malé čtení po stránkách
+    size_t done = 0;
+    while(done < size){
+        int64_t current = address + done;
+        int64_t page_address = current - (current % page_size);
+        int64_t page_offset = current - page_address;
+        int64_t length = page_size - page_offset;
+
+        if(length > (int64_t)(size - done)){
+            length = size - done;
+        }
+
+        int32_t index = cache_get_page(mount, page_address, TRUE);
+
+        if(index == CACHE_NONE){
+            return -3;
+        }
+
+        memcpy((char *)buffer + done, cache->pages[index].data + page_offset, length);
+        done += length;
+    }
+
+    return done;
+}
+
+/**
+ * Zapíše data připojeného VFS do vyrovnávací paměti, do VFS se zapíší
+ * při cache_flush nebo při náhradě stránky
+ *
+ * @param mount připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer zdroj zápisu
+ * @param size počet byte k zápisu
+ * @return (return < 0: chyba | return >= 0: počet zapsaných byte)
+ */
+int64_t cache_write(struct vfs_mount *mount, int64_t address, const void *buffer, size_t size){
+    struct vfs_cache *cache = mount->cache;
+    int64_t page_size = cache->page_size;
+
+    // Velký zápis (celé datové bloky) jde přímo do VFS, stránky v paměti se jen aktualizují
+    if((int64_t)size >= page_size){
+        int64_t result = mount_raw_write(mount, address, buffer, size);
+
+        if(result < 0){
+            return result;
+        }
+
+        int64_t page_address = address - (address % page_size);
+        for(; page_address < address + result; page_address += page_size){
+            int32_t index = cache_lookup(cache, page_address);
+
+            if(index == CACHE_NONE){
+                continue;
+            }
+
+            int64_t from = page_address > address ? page_address : address;
+            int64_t to = page_address + page_size < address + result ? page_address + page_size : address + result;
+            memcpy(cache->pages[index].data + (from - page_address), (const char *)buffer + (from - address), to - from);
+        }
+
+        return result;
+    }
+
+    // Malý zápis po stránkách - pouze do paměti
+    size_t done = 0;
+    while(done < size){
+        int64_t current = address + done;
+        int64_t page_address = current - (current % page_size);
+        int64_t page_offset = current - page_address;
+        int64_t length = page_size - page_offset;
+
+        if(length > (int64_t)(size - done)){
+            length = size - done;
+        }
+
+        // Celou stránku není třeba načítat, pokud bude celá přepsána
+        int32_t index = cache_get_page(mount, page_address, length == page_size ? FALSE : TRUE);
+
+        if(index == CACHE_NONE){
+            return -3;
+        }
+
+        memcpy(cache->pages[index].data + page_offset, (const char *)buffer + done, length);
+        cache->pages[index].dirty = TRUE;
+        done += length;
+    }
+
+    // Zápis za konec souboru soubor zvětší
+    if(address + (int64_t)size > mount->file_size){
+        mount->file_size = address + size;
+    }
+
+    return done;
+}
+
+/**
+ * Zapíše všechny změněné stránky do VFS
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool cache_flush(struct vfs_mount *mount){
+    if(mount == NULL || mount->cache == NULL){
+        return FALSE;
+    }
+
+    bool result = TRUE;
+    int32_t i;
+    for(i = 0; i < mount->cache->used; i++){
+        if(mount->cache->pages[i].address != CACHE_NONE && cache_write_back(mount, i) != TRUE){
+            result = FALSE;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Zapíše změněné stránky, které zasahují do dané oblasti VFS, a podle
+ * potřeby je z vyrovnávací paměti vyřadí
+ *
+ * @param mount připojený VFS
+ * @param address adresa počátku oblasti
+ * @param size velikost oblasti v bytech
+ * @param drop vyřadit stránky (oblast bude přepsána mimo vyrovnávací paměť)
+ * @return výsledek operace
+ */
+static bool cache_sync_range(struct vfs_mount *mount, int64_t address, size_t size, bool drop){
+    struct vfs_cache *cache = mount->cache;
+    int64_t page_size = cache->page_size;
+    int64_t page_address = address - (address % page_size);
+
+    for(; page_address < address + (int64_t)size; page_address += page_size){
+        int32_t index = cache_lookup(cache, page_address);
+
+        if(index == CACHE_NONE){
+            continue;
+        }
+
+        if(cache_write_back(mount, index) != TRUE){
+            return FALSE;
+        }
+
+        if(drop == TRUE){
+            // Uvolněná stránka jde na konec LRU - bude nahrazena jako první
+            cache_hash_remove(cache, index);
+            cache_lru_unlink(cache, index);
+            cache->pages[index].address = CACHE_NONE;
+
+            cache->pages[index].lru_prev = cache->lru_tail;
+            if(cache->lru_tail != CACHE_NONE){
+                cache->pages[cache->lru_tail].lru_next = index;
+            } else {
+                cache->lru_head = index;
+            }
+            cache->lru_tail = index;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * Zapíše změněné stránky, které zasahují do dané oblasti VFS
+ * (před čtením oblasti mimo vyrovnávací paměť)
+ *
+ * @param mount připojený VFS
+ * @param address adresa počátku oblasti
+ * @param size velikost oblasti v bytech
+ * @return výsledek operace
+ */
+bool cache_flush_range(struct vfs_mount *mount, int64_t address, size_t size){
+    if(mount == NULL || mount->cache == NULL){
+        return TRUE;
+    }
+
+    return cache_sync_range(mount, address, size, FALSE);
+}
+
+/**
+ * Zapíše a vyřadí stránky, které zasahují do dané oblasti VFS
+ * (před zápisem oblasti mimo vyrovnávací paměť)
+ *
+ * @param mount připojený VFS
+ * @param address adresa počátku oblasti
+ * @param size velikost oblasti v bytech
+ * @return výsledek operace
+ */
+bool cache_invalidate(struct vfs_mount *mount, int64_t address, size_t size){
+    if(mount == NULL || mount->cache == NULL){
+        return TRUE;
+    }
+
+    return cache_sync_range(mount, address, size, TRUE);
+}
+
+/**
+ * Vypíše statistiky vyrovnávací paměti
+ *
+ * @param cache ukazatel na vyrovnávací paměť
+ */
+void cache_print_stats(struct vfs_cache *cache){
+    if(cache == NULL){
+        printf("CACHE: disabled\n");
+        return;
+    }
+
+    int32_t dirty = 0;
+    int32_t i;
+    for(i = 0; i < cache->used; i++){
+        if(cache->pages[i].dirty == TRUE){
+            dirty++;
+        }
+    }
+
+    printf("CACHE: pages %d/%d (%d B), dirty %d, hits %ld, misses %ld, evictions %ld, writebacks %ld\n",
+           cache->used, cache->capacity, cache->page_size, dirty, (long)cache->hits, (long)cache->misses,
+           (long)cache->evictions, (long)cache->writebacks);
+}
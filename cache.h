@@ -0,0 +1,124 @@
+#ifndef KIV_ZOS_CACHE_H
+#define KIV_ZOS_CACHE_H
+
+/*
+ * Nutné hlavičky
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "bool.h"
+
+/*
+ * Konstanty
+ */
+#define CACHE_DEFAULT_PAGES 256     // Implicitní počet stránek vyrovnávací paměti
+#define CACHE_NONE -1               // Index, který neukazuje na žádnou stránku
+
+/*
+ * Struktury
+ */
+struct vfs_mount;
+
+// Jedna stránka vyrovnávací paměti - obsah VFS od adresy address
+struct cache_page {
+    int64_t address;                // Adresa počátku stránky ve VFS (CACHE_NONE = volná stránka)
+    char *data;                     // Obsah stránky
+    bool dirty;                     // Stránka byla změněna a ještě nebyla zapsána do VFS
+    int32_t lru_prev;               // Předchozí (častěji použitá) stránka v LRU seznamu
+    int32_t lru_next;               // Následující (méně použitá) stránka v LRU seznamu
+    int32_t hash_next;              // Další stránka ve stejném řetězci hashovací tabulky
+};
+
+// Omezená vyrovnávací paměť s odloženým zápisem (write-back) a náhradou LRU
+struct vfs_cache {
+    int32_t page_size;              // Velikost stránky v bytech
+    int32_t capacity;               // Maximální počet stránek
+    int32_t used;                   // Počet obsazených stránek
+    struct cache_page *pages;       // Pole stránek
+    int32_t *buckets;               // Hashovací tabulka: číslo stránky -> index v pages
+    int32_t bucket_count;           // Velikost hashovací tabulky (mocnina 2)
+    int32_t lru_head;               // Naposledy použitá stránka
+    int32_t lru_tail;               // Nejdéle nepoužitá stránka (kandidát na náhradu)
+    int64_t hits;                   // Počet přístupů nalezených v paměti
+    int64_t misses;                 // Počet přístupů, které musely číst z VFS
+    int64_t evictions;              // Počet nahrazených stránek
+    int64_t writebacks;             // Počet stránek zapsaných do VFS
+};
+
+/**
+ * Vytvoří vyrovnávací paměť
+ *
+ * @param page_size velikost stránky v bytech
+ * @param capacity maximální počet stránek
+ * @return (struct vfs_cache * | NULL)
+ */
+struct vfs_cache *cache_create(int32_t page_size, int32_t capacity);
+
+/**
+ * Uvolní vyrovnávací paměť - neprovádí zápis změněných stránek
+ *
+ * @param cache ukazatel na vyrovnávací paměť
+ */
+void cache_free(struct vfs_cache *cache);
+
+/**
+ * Přečte data připojeného VFS přes vyrovnávací paměť
+ *
+ * @param mount připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer cíl čtení
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet přečtených byte)
+ */
+int64_t cache_read(struct vfs_mount *mount, int64_t address, void *buffer, size_t size);
+
+/**
+ * Zapíše data připojeného VFS do vyrovnávací paměti, do VFS se zapíší
+ * při cache_flush nebo při náhradě stránky
+ *
+ * @param mount připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer zdroj zápisu
+ * @param size počet byte k zápisu
+ * @return (return < 0: chyba | return >= 0: počet zapsaných byte)
+ */
+int64_t cache_write(struct vfs_mount *mount, int64_t address, const void *buffer, size_t size);
+
+/**
+ * Zapíše všechny změněné stránky do VFS
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool cache_flush(struct vfs_mount *mount);
+
+/**
+ * Zapíše změněné stránky, které zasahují do dané oblasti VFS
+ * (před čtením oblasti mimo vyrovnávací paměť)
+ *
+ * @param mount připojený VFS
+ * @param address adresa počátku oblasti
+ * @param size velikost oblasti v bytech
+ * @return výsledek operace
+ */
+bool cache_flush_range(struct vfs_mount *mount, int64_t address, size_t size);
+
+/**
+ * Zapíše a vyřadí stránky, které zasahují do dané oblasti VFS
+ * (před zápisem oblasti mimo vyrovnávací paměť)
+ *
+ * @param mount připojený VFS
+ * @param address adresa počátku oblasti
+ * @param size velikost oblasti v bytech
+ * @return výsledek operace
+ */
+bool cache_invalidate(struct vfs_mount *mount, int64_t address, size_t size);
+
+/**
+ * Vypíše statistiky vyrovnávací paměti
+ *
+ * @param cache ukazatel na vyrovnávací paměť
+ */
+void cache_print_stats(struct vfs_cache *cache);
+
+#endif //KIV_ZOS_CACHE_H
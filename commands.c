@@ -1,3 +1,8 @@
+// fileno je rozšíření POSIX
+#ifdef __linux__
+    #define _GNU_SOURCE
+#endif
+
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
@@ -9,6 +14,7 @@
 #include "directory.h"
 #include "file.h"
 #include "symlink.h"
+#include "extent.h"
 
 
 // Just because Windows is stupid
@@ -82,7 +88,7 @@ void cmd_pwd(struct shell *sh){
         return;
     }
 
-    char *path = directory_get_path(sh->vfs_filename, sh->cwd);
+    char *path = shell_get_cwd_path(sh);
     printf("%s\n", path);
     free(path);
 }
@@ -115,22 +121,82 @@ void cmd_format(struct shell *sh, char *command) {
     char *token = NULL;
     // Jméno příkazu
     token = strtok(command, " ");
-    // První parametr příkazu
-    token = strtok(NULL, " ");
+    // První parametr příkazu - velikost VFS
+    token = strtok(NULL, " \n");
 
     int64_t size = parse_filesize(token);
 
-    if(size != 0){
+    // Nepovinné parametry - velikost clusteru, -i <byte na i-uzel>, -N <počet i-uzlů>
+    int64_t cluster_size = IMPL_CLUSTER_SIZE;
+    int64_t bytes_per_inode = 0;
+    int64_t inode_count = 0;
+    token = strtok(NULL, " \n");
+    while(token != NULL){
+        if(strcmp(token, "-i") == 0){
+            token = strtok(NULL, " \n");
+            bytes_per_inode = parse_filesize(token);
+
+            if(bytes_per_inode < 1){
+                printf("format: Bytes per inode must be a positive size (e.g. 16KB)!\n");
+                printf("CANNOT CREATE FILE\n");
+                return;
+            }
+        } else if(strcmp(token, "-N") == 0){
+            token = strtok(NULL, " \n");
+            char *endptr = NULL;
+            inode_count = token != NULL ? strtoll(token, &endptr, 10) : 0;
+
+            if(token == NULL || *endptr != '\0' || inode_count < 2 || inode_count > MAX_INODE_COUNT){
+                printf("format: Inode count must be a number between 2 and %d!\n", MAX_INODE_COUNT);
+                printf("CANNOT CREATE FILE\n");
+                return;
+            }
+        } else {
+            cluster_size = parse_filesize(token);
+
+            if(cluster_size < MIN_CLUSTER_SIZE || cluster_size > MAX_CLUSTER_SIZE || is_two_power((int32_t)cluster_size) == FALSE){
+                printf("format: Cluster size must be a power of 2 between %dB and %dkB!\n", MIN_CLUSTER_SIZE, MAX_CLUSTER_SIZE / 1024);
+                printf("CANNOT CREATE FILE\n");
+                return;
+            }
+        }
+
+        token = strtok(NULL, " \n");
+    }
+
+    // Počet i-uzlů podle poměru k velikosti VFS (explicitní počet má přednost)
+    if(inode_count == 0 && bytes_per_inode > 0 && size > 0){
+        inode_count = size / bytes_per_inode;
+
+        if(inode_count < 2 || inode_count > MAX_INODE_COUNT){
+            printf("format: Bytes per inode gives %ld inodes, allowed are 2 to %d!\n", (long)inode_count, MAX_INODE_COUNT);
+            printf("CANNOT CREATE FILE\n");
+            return;
+        }
+    }
+
+    if(size > 0){
         // Vytvoření implicitního superbloku
         struct superblock *ptr = superblock_impl_alloc(size);
+        ptr->cluster_size = (int32_t)cluster_size;
         // Výpočet hodnot superbloku dle velikosti disku
-        structure_calculate(ptr);
+        if(structure_calculate(ptr, inode_count) == FALSE){
+            free(ptr);
+            printf("CANNOT CREATE FILE\n");
+            return;
+        }
+        // Odpojení původního VFS - po formátu se mění superblok i velikost souboru
+        int8_t backend = sh->mount != NULL ? sh->mount->backend : MOUNT_BACKEND_FILE;
+        int32_t cache_pages = (sh->mount != NULL && sh->mount->cache != NULL) ? sh->mount->cache->capacity : 0;
+        mount_close(sh->mount);
         // Vytvoření virtuálního FILESYSTEMU
         vfs_create(sh->vfs_filename, ptr);
+        // Opětovné připojení VFS
+        sh->mount = mount_open(sh->vfs_filename, backend, cache_pages);
         // Vytvoření kořenové složky
-        directory_create(sh->vfs_filename, "/");
+        directory_create(sh->mount, "/");
         // Nastavení kontextu terminálu na root
-        sh->cwd = 1;
+        shell_set_cwd(sh, 1, "/");
         // Uvolnění zdrojů
         free(ptr);
         // Povinný výpis
@@ -176,7 +242,7 @@ void cmd_cd(struct shell *sh, char *command) {
     }
 
     if(strcmp(token, "/") == 0){
-        sh->cwd = 1;
+        shell_set_cwd(sh, 1, "/");
         return;
     }
 
@@ -187,7 +253,7 @@ void cmd_cd(struct shell *sh, char *command) {
     if(starts_with("/", token)){
         path_absolute = path_parse_absolute(sh, token);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, token);
         path_absolute = path_parse_absolute(sh, mashed);
         free(mashed);
@@ -202,7 +268,7 @@ void cmd_cd(struct shell *sh, char *command) {
 
 
     // Pokus o otevření souboru
-    VFS_FILE *vfs_file = vfs_open(sh->vfs_filename, path_absolute);
+    VFS_FILE *vfs_file = vfs_open(sh->mount, path_absolute);
 
     if(vfs_file == NULL){
         printf("PATH NOT FOUND (neexistujici cesta)\n");
@@ -211,16 +277,43 @@ void cmd_cd(struct shell *sh, char *command) {
     }
 
     // Dereference symlinku
-    while(vfs_file->inode_ptr->type == VFS_SYMLINK){
-        vfs_file = symlink_dereference(sh->vfs_filename, vfs_file);
+    bool dereferenced = FALSE;
+    while(vfs_file != NULL && vfs_file->inode_ptr->type == VFS_SYMLINK){
+        vfs_file = symlink_dereference(sh->mount, vfs_file);
+        dereferenced = TRUE;
     }
 
     // Pokud se podařilo otevřít soubor a soubor je složka, změníme CWD na cíl. složku
     if(vfs_file != NULL && vfs_file->inode_ptr->type == VFS_DIRECTORY){
+        char *new_path = NULL;
+
+        // Jednoduchý přechod o úroveň - cesta se jen upraví, jinak se dopočítá
+        if(dereferenced == FALSE && strchr(token, '/') == NULL && sh->cwd_path != NULL){
+            if(strcmp(token, ".") == 0){
+                new_path = shell_get_cwd_path(sh);
+            } else if(strcmp(token, "..") == 0){
+                new_path = shell_get_cwd_path(sh);
+
+                // Zkrácení "/a/b/" na "/a/"
+                if(strlen(new_path) > 1){
+                    new_path[strlen(new_path) - 1] = '\0';
+                    strrchr(new_path, '/')[1] = '\0';
+                }
+            } else {
+                char *with_name = str_prepend(sh->cwd_path, token);
+                new_path = str_prepend(with_name, "/");
+                free(with_name);
+            }
+        }
+
         // Změna aktuální CWD
-        sh->cwd = vfs_file->inode_ptr->id;
+        shell_set_cwd(sh, vfs_file->inode_ptr->id, new_path);
         printf("OK\n");
 
+        if(new_path != NULL){
+            free(new_path);
+        }
+
     }else {
         // Cesta neexistuje
         printf("PATH NOT FOUND (neexistujici cesta)\n");
@@ -278,7 +371,7 @@ void cmd_mkdir(struct shell *sh, char *command) {
     if(starts_with("/", token)){
         path_absolute = path_parse_absolute(sh, token);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, token);
         path_absolute = path_parse_absolute(sh, mashed);
         free(mashed);
@@ -292,7 +385,7 @@ void cmd_mkdir(struct shell *sh, char *command) {
     }
 
     // Existuje soubor
-    VFS_FILE *vfs_exist = vfs_open(sh->vfs_filename, path_absolute);
+    VFS_FILE *vfs_exist = vfs_open(sh->mount, path_absolute);
 
     if(vfs_exist != NULL){
         vfs_close(vfs_exist);
@@ -300,7 +393,7 @@ void cmd_mkdir(struct shell *sh, char *command) {
         return;
     }
 
-    int create_result = directory_create(sh->vfs_filename, path_absolute);
+    int create_result = directory_create(sh->mount, path_absolute);
 
     if(create_result != 0){
         printf("mkdir error: code %d\n", create_result);
@@ -326,8 +419,8 @@ void cmd_ls(struct shell *sh, char *command){
     }
 
     if(command == NULL){
-        char *absolute_path = directory_get_path(sh->vfs_filename, sh->cwd);
-        directory_entries_print(sh->vfs_filename, absolute_path);
+        char *absolute_path = shell_get_cwd_path(sh);
+        directory_entries_print(sh->mount, absolute_path);
         free(absolute_path);
     }
     else{
@@ -353,7 +446,7 @@ void cmd_ls(struct shell *sh, char *command){
         if(starts_with("/", token)){
             path_absolute = path_parse_absolute(sh, token);
         }else {
-            char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+            char *cwd = shell_get_cwd_path(sh);
             char *mashed = str_prepend(cwd, token);
             path_absolute = path_parse_absolute(sh, mashed);
             free(mashed);
@@ -365,7 +458,7 @@ void cmd_ls(struct shell *sh, char *command){
             return;
         }
 
-        VFS_FILE *vfs_file = vfs_open(sh->vfs_filename, path_absolute);
+        VFS_FILE *vfs_file = vfs_open(sh->mount, path_absolute);
 
         if(vfs_file == NULL){
             printf("PATH NOT FOUND (neexistujici adresar)\n");
@@ -375,11 +468,11 @@ void cmd_ls(struct shell *sh, char *command){
 
         // Dereference symlinku
         while(vfs_file->inode_ptr->type == VFS_SYMLINK){
-            vfs_file = symlink_dereference(sh->vfs_filename, vfs_file);
+            vfs_file = symlink_dereference(sh->mount, vfs_file);
         }
 
         // Výpis obsahu složky
-        int print_result = directory_entries_print(sh->vfs_filename, path_absolute);
+        int print_result = directory_entries_print(sh->mount, path_absolute);
 
         if(print_result < 0){
             printf("PATH NOT FOUND (neexistujici adresar)\n");
@@ -454,7 +547,7 @@ void cmd_incp(struct shell *sh, char *command){
     if(starts_with("/", token)){
         path_absolute = path_parse_absolute(sh, token);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, token);
         path_absolute = path_parse_absolute(sh, mashed);
         free(mashed);
@@ -470,10 +563,10 @@ void cmd_incp(struct shell *sh, char *command){
 
 
     // Vytvoření souboru pokud je potřeba
-    int32_t id = file_create(sh->vfs_filename, path_absolute);
+    int32_t id = file_create(sh->mount, path_absolute);
 
     // Otevřeni ciloveho souboru
-    VFS_FILE *target = vfs_open(sh->vfs_filename, path_absolute);
+    VFS_FILE *target = vfs_open(sh->mount, path_absolute);
 
 
     if(target == NULL){
@@ -492,63 +585,43 @@ void cmd_incp(struct shell *sh, char *command){
         return;
     }
 
-    // Ziskani superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(sh->vfs_filename);
-
-    if(superblock_ptr == NULL) {
-        vfs_close(target);
-        fclose(external);
-        free(first);
-        printf("COULD NOT READ SUPERBLOCK");
-        return;
-    }
-
-
-    vfs_seek(target, 0, SEEK_SET);
+    // Velikost zdrojového souboru
+    fseek(external, 0, SEEK_END);
+    int64_t external_size = ftell(external);
     fseek(external, 0, SEEK_SET);
 
-    // Vytvoření bufferu o velikosti data bloku
-    ssize_t bytes_read = 0;
-    ssize_t bytes_written = 0;
-    int32_t datablock_size = sizeof(char) * superblock_ptr->cluster_size;
-    char *buffer = malloc(datablock_size);
-    memset(buffer, 0, datablock_size);
-
-    // Čteme soubor po clusterech VFS
-    while (TRUE){
-        memset(buffer, 0, datablock_size);
-        bytes_read = fread(buffer, sizeof(char), datablock_size, external);
+    // Původní obsah cílového souboru se zahodí
+    vfs_truncate(target, 0);
 
-        // Zastavení čtení souboru pokud nemáme data
-        if(bytes_read < 1) {
-            break;
-        }
+    // Celá velikost se vyhradí předem - soubor tak může ležet v jediném souvislém úseku,
+    // řídký zdroj se nevyhrazuje, jeho díry zůstanou dírami i ve VFS
+    int64_t external_data_end = 0;
+    if(mount_fd_next_data(fileno(external), 0, external_size, &external_data_end) == 0 && external_data_end == external_size
+       && vfs_preallocate(target, external_size) != 0){
+        log_debug("cmd_incp: Pro soubor nelze predem vyhradit %ld byte!\n", (long)external_size);
+    }
 
-        size_t write_result = vfs_write(buffer, bytes_read, 1, target);
-        if(write_result < 0) {
-            printf("PARTIAL WRITE (CODE %zu)\n", write_result);
-            vfs_close(target);
-            fclose(external);
-            free(first);
-            free(path_absolute);
-            free(superblock_ptr);
-            free(buffer);
-            return;
-        }
+    // Přenos celého souboru - po souvislých úsecích clusterů, na Linuxu bez kopírování přes buffer
+    vfs_seek(target, 0, SEEK_SET);
+    int64_t bytes_written = vfs_write_from_fd(target, fileno(external), 0, external_size);
 
-        bytes_written += bytes_read;
-        printf("Bytes written: %zd\n", bytes_written);
+    if(bytes_written < external_size) {
+        printf("PARTIAL WRITE (CODE %ld)\n", (long)bytes_written);
+        vfs_close(target);
+        fclose(external);
+        free(first);
+        free(path_absolute);
+        return;
     }
 
+    printf("Bytes written: %ld\n", (long)bytes_written);
     printf("OK\n");
 
     // Uvolnění zdrojů
-    free(buffer);
     free(path_absolute);
     fclose(external);
     vfs_close(target);
     free(first);
-    free(superblock_ptr);
 }
 
 /**
@@ -596,7 +669,7 @@ void cmd_cat(struct shell *sh, char *command){
     if(starts_with("/", token)){
         path_absolute = path_parse_absolute(sh, token);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, token);
         path_absolute = path_parse_absolute(sh, mashed);
         free(mashed);
@@ -609,7 +682,7 @@ void cmd_cat(struct shell *sh, char *command){
         return;
     }
 
-    VFS_FILE *source = vfs_open(sh->vfs_filename, path_absolute);
+    VFS_FILE *source = vfs_open(sh->mount, path_absolute);
 
     if(source == NULL){
         free(path_absolute);
@@ -620,7 +693,7 @@ void cmd_cat(struct shell *sh, char *command){
 
     // Dereference symlinku
     while(source->inode_ptr->type == VFS_SYMLINK){
-        source = symlink_dereference(sh->vfs_filename, source);
+        source = symlink_dereference(sh->mount, source);
     }
 
     if(source->inode_ptr->type != VFS_FILE_TYPE){
@@ -634,7 +707,7 @@ void cmd_cat(struct shell *sh, char *command){
     }
 
     int32_t read_size = sizeof(char) * 256;
-    int32_t read_done = 0;
+    int64_t read_done = 0;
     vfs_seek(source, 0, SEEK_SET);
 
     char *buffer = malloc(sizeof(char) * 256);
@@ -700,7 +773,7 @@ void cmd_rmdir(struct shell *sh, char *command){
     if(starts_with("/", token)){
         path_absolute = path_parse_absolute(sh, token);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, token);
         path_absolute = path_parse_absolute(sh, mashed);
         free(mashed);
@@ -714,7 +787,7 @@ void cmd_rmdir(struct shell *sh, char *command){
     }
 
     // Smazat složku
-    int32_t delete_result = directory_delete(sh->vfs_filename, path_absolute);
+    int32_t delete_result = directory_delete(sh->mount, path_absolute);
 
     if(delete_result < 0){
         printf("FILE NOT FOUND (neexistujici adresar)\n");
@@ -775,14 +848,14 @@ void cmd_rm(struct shell *sh, char *command){
     if(starts_with("/", token)){
         path_absolute = path_parse_absolute(sh, token);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, token);
         path_absolute = path_parse_absolute(sh, mashed);
         free(mashed);
         free(cwd);
     }
 
-    int32_t result = file_delete(sh->vfs_filename, path_absolute);
+    int32_t result = file_delete(sh->mount, path_absolute);
 
     if(result == 0){
         printf("OK\n");
@@ -849,7 +922,7 @@ void cmd_mv(struct shell *sh, char *command){
     if(starts_with("/", first)){
         path_absolute_source = path_parse_absolute(sh, first);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, first);
         path_absolute_source = path_parse_absolute(sh, mashed);
         free(mashed);
@@ -874,7 +947,7 @@ void cmd_mv(struct shell *sh, char *command){
         if (starts_with("/", token)) {
             path_absolute_target = path_parse_absolute(sh, token);
         } else {
-            char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+            char *cwd = shell_get_cwd_path(sh);
             char *mashed = str_prepend(cwd, token);
             path_absolute_target = path_parse_absolute(sh, mashed);
             free(mashed);
@@ -896,8 +969,8 @@ void cmd_mv(struct shell *sh, char *command){
     char *file_name = get_suffix_string_after_last_character(path_absolute_source, "/");
 
     // Otevření VFS souborů
-    VFS_FILE *source_folder = vfs_open(sh->vfs_filename, path_prefix);
-    VFS_FILE *target_folder = vfs_open(sh->vfs_filename, path_absolute_target);
+    VFS_FILE *source_folder = vfs_open(sh->mount, path_prefix);
+    VFS_FILE *target_folder = vfs_open(sh->mount, path_absolute_target);
 
 
     if(source_folder == NULL){
@@ -941,7 +1014,7 @@ void cmd_mv(struct shell *sh, char *command){
      * Máme zdroj složku a cíl složku, smažeme záznam ze zdroj složky
      * a umístíme ho do cíl složky
      */
-    if(directory_has_entry(sh->vfs_filename, source_folder->inode_ptr->id, file_name) < 1){
+    if(directory_has_entry(sh->mount, source_folder->inode_ptr->id, file_name) < 1){
         vfs_close(source_folder);
         vfs_close(target_folder);
         free(path_absolute_source);
@@ -955,72 +1028,25 @@ void cmd_mv(struct shell *sh, char *command){
     }
 
     // Vymazání záznamu v rodiči
-    // Alokace dat pro entry
     struct directory_entry *entry = malloc(sizeof(struct directory_entry));
+    memset(entry, 0, sizeof(struct directory_entry));
+    directory_remove_entry(source_folder, file_name, entry);
 
-    // Čtení directory entry do velikosti souboru
-    int32_t current_index = 0;
-    int32_t current = 0;
-    while(current + sizeof(struct directory_entry) <= source_folder->inode_ptr->file_size){
-        memset(entry, 0, sizeof(struct directory_entry));
-        vfs_read(entry, sizeof(struct directory_entry), 1, source_folder);
-
-        if(strcmp(entry->name, file_name) == 0){
-            break;
-        }
-
-        // Posun na další prvek - vlastně jen pro podmínku, SEEK se upravuje v VFS_READ
-        current += sizeof(struct directory_entry);
-        current_index = current_index + 1;
-    }
-
-    // Kolik má rodič záznamů
-    int32_t parent_count = (source_folder->inode_ptr->file_size / sizeof(struct directory_entry));
-    int32_t last_parent_entry_index = parent_count - 1;
-
-    /*
-     * Je potřeba posunout záznam
-     * Posouváme poslední záznam na místo mazaného
-     * Zmenšujeme velikost složky o 1 entry
-     */
-    if(last_parent_entry_index != current_index){
-        int64_t seek = sizeof(struct directory_entry) * last_parent_entry_index;
-        vfs_seek(source_folder, seek, SEEK_SET);
-
-        // Přečtení poslední entry
-        struct directory_entry *replace_entry = malloc(sizeof(struct directory_entry));
-        memset(replace_entry, 0, sizeof(struct directory_entry));
-        vfs_read(replace_entry, sizeof(struct directory_entry), 1, source_folder);
-
-        // Seek na zápis
-        int64_t seek_write = sizeof(struct directory_entry) * current_index;
-        vfs_seek(source_folder, seek_write, SEEK_SET);
-        vfs_write(replace_entry, sizeof(struct directory_entry), 1, source_folder);
-
-        // Smazání staré entry
-        vfs_seek(source_folder, seek, SEEK_SET);
-        memset(replace_entry, 0, sizeof(struct directory_entry));
-        vfs_write(replace_entry, sizeof(struct directory_entry), 1, source_folder);
-
-        log_debug("directory_delete: Zaznam ve slozce %d presunut na %d\n", last_parent_entry_index, current_index);
+    // Zápis smazaného záznamu do cílové složky
+    directory_add_entry(target_folder, entry);
 
-        // Zmensen velikosti slozky o smazany zaznam
-        source_folder->inode_ptr->file_size = source_folder->inode_ptr->file_size - sizeof(struct directory_entry);
-        inode_write_to_index(sh->vfs_filename, source_folder->inode_ptr->id - 1, source_folder->inode_ptr);
+    // Přesunutá složka musí odkazovat na nového rodiče, cesta CWD pod ní se mění
+    VFS_FILE *moved = vfs_open_inode(sh->mount, entry->inode_id);
 
-        free(replace_entry);
+    if(moved != NULL && moved->inode_ptr->type == VFS_DIRECTORY){
+        directory_set_parent(moved, target_folder->inode_ptr->id);
+        shell_set_cwd(sh, sh->cwd, NULL);
     }
 
-    // Smazani presunovaneho zaznamu pokud je posledni
-    if(last_parent_entry_index == current_index) {
-        // Zmensen velikosti slozky o smazany zaznam
-        source_folder->inode_ptr->file_size = source_folder->inode_ptr->file_size - sizeof(struct directory_entry);
-        inode_write_to_index(sh->vfs_filename, source_folder->inode_ptr->id - 1, source_folder->inode_ptr);
+    if(moved != NULL){
+        vfs_close(moved);
     }
 
-    // Zápis smazaného záznamu do cílové složky
-    directory_add_entry(target_folder, entry);
-
     printf("OK\n");
 
     // Uvolnění zdrojů
@@ -1063,6 +1089,14 @@ void cmd_cp(struct shell *sh, char *command){
 
     // První parametr příkazu
     token = strtok(NULL, " ");
+
+    // Přepínač --reflink: cíl bude sdílet databloky zdroje
+    bool reflink = FALSE;
+    if(token != NULL && strcmp(token, "--reflink") == 0){
+        reflink = TRUE;
+        token = strtok(NULL, " ");
+    }
+
     if(token == NULL){
         printf("cp: First parameter is missing!\n");
         return;
@@ -1090,7 +1124,7 @@ void cmd_cp(struct shell *sh, char *command){
     if(starts_with("/", first)){
         path_absolute_source = path_parse_absolute(sh, first);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, first);
         path_absolute_source = path_parse_absolute(sh, mashed);
         free(mashed);
@@ -1115,7 +1149,7 @@ void cmd_cp(struct shell *sh, char *command){
         if (starts_with("/", token)) {
             path_absolute_target = path_parse_absolute(sh, token);
         } else {
-            char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+            char *cwd = shell_get_cwd_path(sh);
             char *mashed = str_prepend(cwd, token);
             path_absolute_target = path_parse_absolute(sh, mashed);
             free(mashed);
@@ -1131,7 +1165,7 @@ void cmd_cp(struct shell *sh, char *command){
         return;
     }
 
-    VFS_FILE *source = vfs_open(sh->vfs_filename, path_absolute_source);
+    VFS_FILE *source = vfs_open(sh->mount, path_absolute_source);
 
     if(source == NULL){
         free(path_absolute_source);
@@ -1142,16 +1176,18 @@ void cmd_cp(struct shell *sh, char *command){
     }
 
     if(source->inode_ptr->type == VFS_DIRECTORY){
+        vfs_close(source);
         free(path_absolute_source);
         free(path_absolute_target);
         free(first);
         printf("FILE NOT FOUND (neni zdroj)\n");
+        return;
     }
 
     // Vytvoření souboru pokud je potřeba
-    int32_t id = file_create(sh->vfs_filename, path_absolute_target);
+    int32_t id = file_create(sh->mount, path_absolute_target);
 
-    VFS_FILE *target = vfs_open(sh->vfs_filename, path_absolute_target);
+    VFS_FILE *target = vfs_open(sh->mount, path_absolute_target);
 
     if(target == NULL){
         vfs_close(source);
@@ -1173,29 +1209,106 @@ void cmd_cp(struct shell *sh, char *command){
         return;
     }
 
+    // Sdílení databloků místo kopírování dat
+    if(reflink == TRUE){
+        if(sh->mount->refcounts == NULL){
+            printf("cp: --reflink is not supported by this VFS format (format it first)!\n");
+        } else if(file_reflink(source, target) != 0){
+            printf("cp: Reflink failed!\n");
+        } else {
+            printf("Reflinked %ld bytes\n", (long)target->inode_ptr->file_size);
+            printf("OK\n");
+        }
+
+        vfs_close(target);
+        vfs_close(source);
+        free(path_absolute_source);
+        free(path_absolute_target);
+        free(first);
+        return;
+    }
+
+    // Kopie souboru na sebe sama nic nemění - cíl se nesmí zkrátit ani přepsat dřív, než se přečte
+    if(source->inode_ptr->id == target->inode_ptr->id){
+        printf("OK\n");
+
+        vfs_close(target);
+        vfs_close(source);
+        free(path_absolute_source);
+        free(path_absolute_target);
+        free(first);
+        return;
+    }
+
+    // Původní obsah cílového souboru se zahodí
+    vfs_truncate(target, 0);
+
+    // Celá velikost zdroje se vyhradí předem, zápisy po 4096 byte pak alokátor nevolají
+    if(vfs_preallocate(target, source->inode_ptr->file_size) != 0){
+        log_debug("cmd_cp: Pro soubor nelze predem vyhradit %ld byte!\n", (long)source->inode_ptr->file_size);
+        printf("CANNOT CREATE FILE (nedostatek mista)\n");
+
+        // Částečně vyhrazené databloky se uvolní
+        vfs_truncate(target, 0);
+        vfs_close(target);
+        vfs_close(source);
+        free(path_absolute_source);
+        free(path_absolute_target);
+        free(first);
+        return;
+    }
+
     vfs_seek(target, 0, SEEK_SET);
     vfs_seek(source, 0, SEEK_SET);
 
     char *data_buffer = malloc(sizeof(char) * 4096);
-    int32_t written = 0;
-    while (written <= source->inode_ptr->file_size){
+    int64_t written = 0;
+    bool failed = FALSE;
+    while (written < source->inode_ptr->file_size){
         memset(data_buffer, 0, sizeof(char) * 4096);
         ssize_t read_count = vfs_read(data_buffer, sizeof(char), 4096, source);
 
+        // Dosažení konce souboru
+        if(read_count < 1) {
+            break;
+        }
+
         ssize_t write_count = vfs_write(data_buffer, sizeof(char), read_count, target);
 
+        if(write_count != 0) {
+            log_debug("cmd_cp: Zapis do ciloveho souboru selhal (kod %ld)!\n", (long)write_count);
+            failed = TRUE;
+            break;
+        }
+
         // Posun o počet přečtených byte
         written = written + read_count;
 
         if(written % 4096 == 0) {
-            printf("Copied 4096 bytes (total: %d/%d bytes)\n", written, source->inode_ptr->file_size);
+            printf("Copied 4096 bytes (total: %ld/%ld bytes)\n", (long)written, (long)source->inode_ptr->file_size);
         }
     }
 
-    printf("OK\n");
+    // Odložená data se musí zapsat, než se ohlásí úspěch
+    if(failed == FALSE && vfs_flush(target) < 0) {
+        failed = TRUE;
+    }
+
+    // Nevyužité předem vyhrazené databloky se uvolní
+    int64_t target_size = target->inode_ptr->file_size;
+    vfs_truncate(target, target_size);
+
+    if(vfs_close(target) == FALSE) {
+        failed = TRUE;
+    }
+
+    if(failed == TRUE) {
+        printf("PARTIAL WRITE (%ld/%ld bytes)\n", (long)target_size, (long)source->inode_ptr->file_size);
+    } else {
+        printf("OK\n");
+    }
 
     // Uvolnění zdrojů
-    vfs_close(target);
     vfs_close(source);
     free(path_absolute_source);
     free(path_absolute_target);
@@ -1259,7 +1372,7 @@ void cmd_outcp(struct shell *sh, char *command) {
     if(starts_with("/", first)){
         path_absolute_source = path_parse_absolute(sh, first);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, first);
         path_absolute_source = path_parse_absolute(sh, mashed);
         free(mashed);
@@ -1273,7 +1386,7 @@ void cmd_outcp(struct shell *sh, char *command) {
         return;
     }
 
-    VFS_FILE *source = vfs_open(sh->vfs_filename, path_absolute_source);
+    VFS_FILE *source = vfs_open(sh->mount, path_absolute_source);
 
     if(source == NULL){
         free(first);
@@ -1292,43 +1405,24 @@ void cmd_outcp(struct shell *sh, char *command) {
         return;
     }
 
+    // Přenos celého souboru - po souvislých úsecích clusterů, na Linuxu bez kopírování přes buffer
     vfs_seek(source, 0, SEEK_SET);
-    fseek(target, 0, SEEK_SET);
-
-    char *buffer = malloc(sizeof(char) * 4096);
-    int64_t written = 0;
-    while(written < source->inode_ptr->file_size){
-        memset(buffer, 0, sizeof(char) * 4096);
-        ssize_t vfs_read_count = vfs_read(buffer, sizeof(char), 4096, source);
-
-        if(vfs_read_count < 0){
-            printf("PARTIAL WRITE!\n");
-            vfs_close(source);
-            fclose(target);
-            free(buffer);
-            free(first);
-            free(path_absolute_source);
-            return;
-        }
+    int64_t written = vfs_read_to_fd(source, fileno(target), 0, source->inode_ptr->file_size);
 
-        size_t written_count = fwrite(buffer, sizeof(char), vfs_read_count, target);
-
-        // Dosažení konce souboru
-        if(vfs_read_count < 1) {
-            break;
-        }
-
-        written = written + written_count;
-        if(written_count % 4096 == 0) {
-            printf("Written out: 4096B (total: %d bytes)\n", written);
-        }
+    if(written < source->inode_ptr->file_size){
+        printf("PARTIAL WRITE!\n");
+        vfs_close(source);
+        fclose(target);
+        free(first);
+        free(path_absolute_source);
+        return;
     }
 
+    printf("Written out: %ld bytes\n", (long)written);
     printf("OK\n");
 
     vfs_close(source);
     fclose(target);
-    free(buffer);
     free(first);
     free(path_absolute_source);
 }
@@ -1465,7 +1559,7 @@ void cmd_info(struct shell *sh, char *command){
         if (starts_with("/", token)) {
             path_absolute_source = path_parse_absolute(sh, token);
         } else {
-            char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+            char *cwd = shell_get_cwd_path(sh);
             char *mashed = str_prepend(cwd, token);
             path_absolute_source = path_parse_absolute(sh, mashed);
             free(mashed);
@@ -1473,10 +1567,9 @@ void cmd_info(struct shell *sh, char *command){
         }
     }
 
-    VFS_FILE *source = vfs_open(sh->vfs_filename, path_absolute_source);
+    VFS_FILE *source = vfs_open(sh->mount, path_absolute_source);
 
     if(source == NULL){
-        free(token);
         free(path_absolute_source);
         printf("FILE NOT FOUND (neni zdroj)\n");
         return;
@@ -1501,109 +1594,109 @@ void cmd_info(struct shell *sh, char *command){
     printf("TYPE: %s\n", filetype);
     free(filetype);
     // Výpis velikosti souboru
-    printf("SIZE: %d (byte/s)\n", source->inode_ptr->file_size);
+    printf("SIZE: %ld (byte/s)\n", (long)source->inode_ptr->file_size);
+    // Výpis skutečně obsazeného místa (bez děr)
+    int32_t data_clusters = inode_count_data_clusters(sh->mount, source->inode_ptr);
+    printf("ALLOCATED: %ld (byte/s) in %d cluster/s\n",
+           (long)((int64_t)data_clusters * sh->mount->superblock_ptr->cluster_size), data_clusters);
 
     // Výpis datových odkazů
     printf("DATA POINTERS: \n");
 
     if(source->inode_ptr->direct1 != 0){
-        printf("\tdirect1: 0x%x\n", source->inode_ptr->direct1);
+        printf("\tdirect1: 0x%lx\n", (long)source->inode_ptr->direct1);
     }
 
     if(source->inode_ptr->direct2 != 0){
-        printf("\tdirect2: 0x%x\n", source->inode_ptr->direct2);
+        printf("\tdirect2: 0x%lx\n", (long)source->inode_ptr->direct2);
     }
 
     if(source->inode_ptr->direct3 != 0){
-        printf("\tdirect3: 0x%x\n", source->inode_ptr->direct3);
+        printf("\tdirect3: 0x%lx\n", (long)source->inode_ptr->direct3);
     }
 
     if(source->inode_ptr->direct4 != 0){
-        printf("\tdirect4: 0x%x\n", source->inode_ptr->direct4);
+        printf("\tdirect4: 0x%lx\n", (long)source->inode_ptr->direct4);
     }
 
     if(source->inode_ptr->direct5 != 0){
-        printf("\tdirect5: 0x%x\n", source->inode_ptr->direct5);
+        printf("\tdirect5: 0x%lx\n", (long)source->inode_ptr->direct5);
     }
 
-    struct superblock *superblock_ptr = superblock_from_file(sh->vfs_filename);
-
     // Indirect 1
     if(source->inode_ptr->indirect1 != 0){
-        printf("indirect1: 0x%x\n", source->inode_ptr->indirect1);
-
-        FILE *data = fopen(sh->vfs_filename, "r+b");
-        fseek(data, source->inode_ptr->indirect1, SEEK_SET);
-
-        int32_t *read_data = malloc(sizeof(int32_t));
+        printf("indirect1: 0x%lx\n", (long)source->inode_ptr->indirect1);
 
         int32_t indirect1_read = 0;
-        int32_t adress_per_cluster = superblock_ptr->cluster_size / sizeof(int32_t);
+        int32_t adress_per_cluster = sh->mount->pointers_per_block;
         while(indirect1_read < adress_per_cluster){
-            memset(read_data, 0, sizeof(int32_t));
-            fread(read_data, sizeof(int32_t), 1, data);
+            int64_t read_data = inode_read_pointer(sh->mount, source->inode_ptr->indirect1 + sizeof(int32_t) * indirect1_read);
 
-            if(*read_data == 0){
-                break;
+            // Díra v souboru
+            if(read_data == 0){
+                indirect1_read = indirect1_read + 1;
+                continue;
             }
 
-            printf("\t\tindirect1[%d]: 0x%x\n", indirect1_read, *read_data);
+            printf("\t\tindirect1[%d]: 0x%lx\n", indirect1_read, (long)read_data);
 
             indirect1_read = indirect1_read + 1;
         }
-
-        free(read_data);
-        fclose(data);
     }
 
     // Indirect 2
     if(source->inode_ptr->indirect2 != 0){
-        printf("indirect2: 0x%x\n", source->inode_ptr->indirect2);
-
-        FILE *data = fopen(sh->vfs_filename, "r+b");
-        fseek(data, source->inode_ptr->indirect2, SEEK_SET);
-
-        int32_t adress_per_cluster = superblock_ptr->cluster_size / sizeof(int32_t);
+        printf("indirect2: 0x%lx\n", (long)source->inode_ptr->indirect2);
 
-        int32_t *read_data = malloc(sizeof(int32_t));
+        int32_t adress_per_cluster = sh->mount->pointers_per_block;
 
         int32_t indirect2_level1_read = 0;
         while(indirect2_level1_read < adress_per_cluster){
-            fseek(data, source->inode_ptr->indirect2 + sizeof(int32_t) * indirect2_level1_read, SEEK_SET);
-            memset(read_data, 0, sizeof(int32_t));
-            fread(read_data, sizeof(int32_t), 1, data);
+            int64_t read_data = inode_read_pointer(sh->mount, source->inode_ptr->indirect2 + sizeof(int32_t) * indirect2_level1_read);
 
-            if(*read_data == 0){
-                break;
+            if(read_data == 0){
+                indirect2_level1_read++;
+                continue;
             }
 
-            printf("\tindirect2[%d]: 0x%x\n", indirect2_level1_read, *read_data);
-
-            int32_t *level2_read_data = malloc(sizeof(int32_t));
+            printf("\tindirect2[%d]: 0x%lx\n", indirect2_level1_read, (long)read_data);
 
             int32_t indirect2_level2_read = 0;
             while(indirect2_level2_read < adress_per_cluster){
-                fseek(data, *read_data + sizeof(int32_t) * indirect2_level2_read, SEEK_SET);
-                memset(level2_read_data, 0, sizeof(int32_t));
-                fread(level2_read_data, sizeof(int32_t), 1, data);
+                int64_t level2_read_data = inode_read_pointer(sh->mount, read_data + sizeof(int32_t) * indirect2_level2_read);
 
-                if(*level2_read_data == 0) {
-                    break;
+                if(level2_read_data == 0) {
+                    indirect2_level2_read = indirect2_level2_read + 1;
+                    continue;
                 }
 
-                printf("\t\tindirect2[%d][%d]: 0x%x\n", indirect2_level1_read, indirect2_level2_read, *level2_read_data);
+                printf("\t\tindirect2[%d][%d]: 0x%lx\n", indirect2_level1_read, indirect2_level2_read, (long)level2_read_data);
 
                 indirect2_level2_read = indirect2_level2_read + 1;
             }
 
-            free(level2_read_data);
+            indirect2_level1_read++;
+        }
+    }
+
+    // Extenty
+    if((source->inode_ptr->flags & INODE_FLAG_EXTENTS) != 0){
+        struct inode_extent *extents = NULL;
+        int32_t extent_count = extent_load(sh->mount, source->inode_ptr, &extents);
 
+        if(source->inode_ptr->extent_block != 0){
+            printf("extent block: 0x%lx\n", (long)source->inode_ptr->extent_block);
+        }
 
-            indirect2_level1_read++;
+        int32_t extent_read;
+        for(extent_read = 0; extent_read < extent_count; extent_read++){
+            printf("\textent[%d]: %d-%d -> 0x%lx\n", extent_read, extents[extent_read].logical,
+                   extents[extent_read].logical + extents[extent_read].length - 1, (long)extents[extent_read].address);
         }
 
-        free(read_data);
-        fclose(data);
+        if(extent_count >= 0){
+            free(extents);
+        }
     }
 
     vfs_close(source);
@@ -1667,7 +1760,7 @@ void cmd_lns(struct shell *sh, char *command){
     if(starts_with("/", first)){
         path_absolute_source = path_parse_absolute(sh, first);
     }else {
-        char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+        char *cwd = shell_get_cwd_path(sh);
         char *mashed = str_prepend(cwd, first);
         path_absolute_source = path_parse_absolute(sh, mashed);
         free(mashed);
@@ -1682,7 +1775,7 @@ void cmd_lns(struct shell *sh, char *command){
     }
 
     // Ověření existence zdrojového souboru
-    VFS_FILE *source = vfs_open(sh->vfs_filename, path_absolute_source);
+    VFS_FILE *source = vfs_open(sh->mount, path_absolute_source);
 
     if(source == NULL){
         free(first);
@@ -1702,7 +1795,7 @@ void cmd_lns(struct shell *sh, char *command){
         if (starts_with("/", token)) {
             path_absolute_target = path_parse_absolute(sh, token);
         } else {
-            char *cwd = directory_get_path(sh->vfs_filename, sh->cwd);
+            char *cwd = shell_get_cwd_path(sh);
             char *mashed = str_prepend(cwd, token);
             path_absolute_target = path_parse_absolute(sh, mashed);
             free(mashed);
@@ -1719,7 +1812,7 @@ void cmd_lns(struct shell *sh, char *command){
         return;
     }
 
-    int32_t symlink_result = symlink_create(sh->vfs_filename, path_absolute_target, path_absolute_source);
+    int32_t symlink_result = symlink_create(sh->mount, path_absolute_target, path_absolute_source);
 
     if(symlink_result != 0){
         vfs_close(source);
@@ -1730,4 +1823,161 @@ void cmd_lns(struct shell *sh, char *command){
     }
 
     printf("OK\n");
-}
\ No newline at end of file
+}
+/**
+ * Příkaz: zápis změněných dat (vyrovnávací paměť, mapa) do VFS a výpis statistik
+ *
+ * @param sh kontext virtuálního terminálu
+ */
+void cmd_sync(struct shell *sh){
+    if (sh == NULL) {
+        log_debug("cmd_sync: Nelze zpracovat prikaz. Kontext terminalu je NULL!\n");
+        return;
+    }
+
+    if(mount_sync(sh->mount) != TRUE){
+        printf("SYNC FAILED\n");
+        return;
+    }
+
+    if(sh->mount->backend == MOUNT_BACKEND_FILE){
+        cache_print_stats(sh->mount->cache);
+    }
+
+    printf("OK\n");
+}
+
+/**
+ * Příkaz: výpis obsazenosti VFS (clustery a i-uzly)
+ *
+ * @param sh kontext virtuálního terminálu
+ */
+void cmd_df(struct shell *sh){
+    if (sh == NULL) {
+        log_debug("cmd_df: Nelze zpracovat prikaz. Kontext terminalu je NULL!\n");
+        return;
+    }
+
+    // Počty volných clusterů a i-uzlů udržuje superblok - bitmapy se neprochází
+    struct vfs_statfs stat;
+    if(mount_statfs(sh->mount, &stat) != TRUE){
+        printf("STATFS FAILED\n");
+        return;
+    }
+
+    int32_t used_clusters = stat.cluster_count - stat.free_clusters;
+    int64_t used_bytes = (int64_t)used_clusters * stat.cluster_size;
+    int64_t free_bytes = (int64_t)stat.free_clusters * stat.cluster_size;
+    int32_t percent = stat.cluster_count > 0 ? (int32_t)((int64_t)used_clusters * 100 / stat.cluster_count) : 0;
+
+    printf("DISK SIZE: %ld (byte/s)\n", (long)stat.disk_size);
+    printf("CLUSTER SIZE: %d (byte/s)\n", stat.cluster_size);
+    printf("CLUSTERS: %d total, %d used, %d free\n", stat.cluster_count, used_clusters, stat.free_clusters);
+    printf("INODES: %d total, %d used, %d free\n", stat.inode_count, stat.inode_count - stat.free_inodes, stat.free_inodes);
+    printf("DATA: %ld (byte/s) used, %ld (byte/s) free (%d%% used)\n", (long)used_bytes, (long)free_bytes, percent);
+}
+
+/**
+ * Příkaz: nastavení velikosti souboru (zvětšení vytvoří díru)
+ *
+ * @param sh kontext virtuálního terminálu
+ * @param command příkaz ve tvaru truncate <soubor> <velikost>
+ */
+void cmd_truncate(struct shell *sh, char *command){
+    if (sh == NULL) {
+        log_debug("cmd_truncate: Nelze zpracovat prikaz. Kontext terminalu je NULL!\n");
+        return;
+    }
+
+    if (command == NULL) {
+        log_debug("cmd_truncate: Nelze zpracovat prikaz. Prikaz je NULL!\n");
+        return;
+    }
+
+    if (strlen(command) < 1) {
+        log_debug("cmd_truncate: Nelze zpracovat prikaz. Prikaz je prazdnym retezcem!\n");
+        return;
+    }
+
+    char *token = NULL;
+    // Jméno příkazu
+    token = strtok(command, " ");
+
+    // První parametr příkazu - soubor
+    char *path = strtok(NULL, " ");
+    // Druhý parametr příkazu - velikost
+    token = strtok(NULL, " ");
+
+    if(path == NULL || token == NULL){
+        printf("truncate: Parameter is missing!\n");
+        return;
+    }
+
+    // Uprava posledniho parametru - odstraneni \n
+    if(token[strlen(token)-1] == '\n'){
+        token[strlen(token)-1] = '\0';
+    }
+
+    // Velikost v byte, nebo s jednotkou (např. 10MB)
+    int64_t size = -1;
+    if(strlen(token) > 0 && strspn(token, "0123456789") == strlen(token)){
+        size = strtoll(token, NULL, 10);
+    } else if(strlen(token) > 0) {
+        size = parse_filesize(token);
+    }
+
+    if(size < 0){
+        printf("truncate: Invalid size!\n");
+        return;
+    }
+
+    char *path_absolute = NULL;
+
+    // Převod na absolutní cestu
+    if (starts_with("/", path)) {
+        path_absolute = path_parse_absolute(sh, path);
+    } else {
+        char *cwd = shell_get_cwd_path(sh);
+        char *mashed = str_prepend(cwd, path);
+        path_absolute = path_parse_absolute(sh, mashed);
+        free(mashed);
+        free(cwd);
+    }
+
+    VFS_FILE *target = vfs_open(sh->mount, path_absolute);
+
+    if(target == NULL){
+        free(path_absolute);
+        printf("FILE NOT FOUND (neni zdroj)\n");
+        return;
+    }
+
+    // Zkracuje se soubor, na který symlink odkazuje
+    int32_t depth = 0;
+    while(target->inode_ptr->type == VFS_SYMLINK && depth++ < SYMLINK_MAX_DEPTH){
+        target = symlink_dereference(sh->mount, target);
+    }
+
+    if(target->inode_ptr->type == VFS_SYMLINK){
+        vfs_close(target);
+        free(path_absolute);
+        printf("truncate: Cannot resolve the symlink!\n");
+        return;
+    }
+
+    if(target->inode_ptr->type == VFS_DIRECTORY){
+        vfs_close(target);
+        free(path_absolute);
+        printf("truncate: Cannot truncate a directory!\n");
+        return;
+    }
+
+    if(vfs_truncate(target, size) != 0){
+        printf("truncate: Size %ld is not supported by the file!\n", (long)size);
+    } else {
+        printf("OK\n");
+    }
+
+    vfs_close(target);
+    free(path_absolute);
+}
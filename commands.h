@@ -127,5 +127,26 @@ void cmd_info(struct shell *sh, char *command);
  * @param command
  */
 void cmd_lns(struct shell *sh, char *command);
+/**
+ * Příkaz: zápis změněných dat (vyrovnávací paměť, mapa) do VFS a výpis statistik
+ *
+ * @param sh kontext virtuálního terminálu
+ */
+void cmd_sync(struct shell *sh);
+
+/**
+ * Příkaz: výpis obsazenosti VFS (clustery a i-uzly)
+ *
+ * @param sh kontext virtuálního terminálu
+ */
+void cmd_df(struct shell *sh);
+
+/**
+ * Příkaz: nastavení velikosti souboru (zvětšení vytvoří díru)
+ *
+ * @param sh kontext virtuálního terminálu
+ * @param command příkaz ve tvaru truncate <soubor> <velikost>
+ */
+void cmd_truncate(struct shell *sh, char *command);
 
 #endif //KIV_ZOS_COMMANDS_H
@@ -1,9 +1,145 @@
 #include "debug.h"
 #include <string.h>
+#include <stdlib.h>
 #include <time.h>
 
+// Podmíněné vkládání hlavičkových souborů
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <sys/time.h>
+#endif
 
-void log_print_stdout(char *level, char *format, va_list args){
+// Level nastavený za běhu
+int log_level = DEBUG_LEVEL;
+
+/*
+ * Kruhový buffer zpráv, který vyprazdňuje zapisovací vlákno
+ *
+ * head a tail jsou celkové počty zapsaných a vypsaných byte, pozice
+ * v bufferu je jejich zbytek po dělení LOG_BUFFER_SIZE
+ */
+static struct {
+    bool started;               // Zapisovací vlákno běží
+    bool stopping;              // Zapisovací vlákno má skončit po vyprázdnění bufferu
+    char *data;                 // Obsah bufferu
+    uint64_t head;              // Počet byte zapsaných do bufferu
+    uint64_t tail;              // Počet byte vypsaných do souboru
+    FILE *file;                 // Otevřený logovací soubor
+    time_t stamp_time;          // Čas naformátované časové značky
+    char stamp[32];             // Naformátovaná časová značka
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE data_ready;
+    CONDITION_VARIABLE space_ready;
+    HANDLE thread;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t data_ready;
+    pthread_cond_t space_ready;
+    pthread_t thread;
+#endif
+} log_ring;
+
+static void log_lock(void){
+#ifdef _WIN32
+    EnterCriticalSection(&log_ring.lock);
+#else
+    pthread_mutex_lock(&log_ring.lock);
+#endif
+}
+
+static void log_unlock(void){
+#ifdef _WIN32
+    LeaveCriticalSection(&log_ring.lock);
+#else
+    pthread_mutex_unlock(&log_ring.lock);
+#endif
+}
+
+/**
+ * Probudí zapisovací vlákno
+ */
+static void log_signal_data(void){
+#ifdef _WIN32
+    WakeConditionVariable(&log_ring.data_ready);
+#else
+    pthread_cond_signal(&log_ring.data_ready);
+#endif
+}
+
+/**
+ * Probudí vlákna čekající na místo v bufferu (nebo na jeho vyprázdnění)
+ */
+static void log_signal_space(void){
+#ifdef _WIN32
+    WakeAllConditionVariable(&log_ring.space_ready);
+#else
+    pthread_cond_broadcast(&log_ring.space_ready);
+#endif
+}
+
+/**
+ * Počká na místo v bufferu, zámek musí být zamčen
+ */
+static void log_wait_space(void){
+#ifdef _WIN32
+    SleepConditionVariableCS(&log_ring.space_ready, &log_ring.lock, INFINITE);
+#else
+    pthread_cond_wait(&log_ring.space_ready, &log_ring.lock);
+#endif
+}
+
+/**
+ * Počká na nové zprávy nejdéle LOG_FLUSH_INTERVAL_MS, zámek musí být zamčen
+ */
+static void log_wait_data(void){
+#ifdef _WIN32
+    SleepConditionVariableCS(&log_ring.data_ready, &log_ring.lock, LOG_FLUSH_INTERVAL_MS);
+#else
+    struct timeval now;
+    struct timespec deadline;
+    gettimeofday(&now, NULL);
+
+    int64_t nanoseconds = (int64_t)now.tv_usec * 1000 + (int64_t)LOG_FLUSH_INTERVAL_MS * 1000000;
+    deadline.tv_sec = now.tv_sec + (time_t)(nanoseconds / 1000000000);
+    deadline.tv_nsec = (long)(nanoseconds % 1000000000);
+
+    pthread_cond_timedwait(&log_ring.data_ready, &log_ring.lock, &deadline);
+#endif
+}
+
+/**
+ * Vrátí název levelu pro hlavičku zprávy
+ *
+ * @param level level výpisu
+ * @return název levelu
+ */
+static const char *log_level_name(int level){
+    switch(level){
+        // TRACE
+        case LOG_TRACE:
+            return "TRACE";
+        // DEBUG
+        case LOG_DEBUG:
+            return "DEBUG";
+        // INFO
+        case LOG_INFO:
+            return "INFO";
+        // ERROR
+        case LOG_ERROR:
+            return "ERROR";
+        // FATAL
+        case LOG_FATAL:
+            return "FATAL";
+        // ALL
+        default:
+            return "";
+    }
+}
+
+static void log_print_stdout(const char *level, const char *format, va_list args){
     // Kontrola povolení výpisu do terminálu
     if(STDOUT_ENABLED != TRUE) {
         return;
@@ -25,11 +161,6 @@ void log_print_stdout(char *level, char *format, va_list args){
         printf("%s > ", buffer);
     }
 
-    // Zpráva je prázdná, nevypisujeme
-    if(strlen(format) < 1) {
-        return;
-    }
-
     // Výpis hlavičky
     if(strlen(level) > 1) {
         printf("%s >> ", level);
@@ -39,13 +170,13 @@ void log_print_stdout(char *level, char *format, va_list args){
     vprintf(format, args);
 }
 
-void log_print_file(char *level, char *format, va_list args){
-    // Kontrola povolení výpisu do souboru
-    if(LOG_FILE_ENABLED != TRUE) {
-        return;
-    }
-
-
+/**
+ * Synchronní zápis zprávy do souboru - používá se, pokud zapisovací vlákno neběží
+ *
+ * @param level název levelu
+ * @param message naformátovaná zpráva
+ */
+static void log_print_file(const char *level, const char *message){
     // Otevření souboru pro zápis
     FILE *log = fopen(LOG_FILE, LOG_MODE_CURRENT);
 
@@ -75,165 +206,293 @@ void log_print_file(char *level, char *format, va_list args){
         fprintf(log,"%s >> ", level);
     }
 
-    // Využití argumentů - výpis zprávy do souboru
-    vfprintf(log,format, args);
+    fputs(message, log);
 
     // Uzavření souboru
     fclose(log);
 }
 
 /**
- * Wrapper pro funkci printf, výpis při DEBUG=TRUE
- * a DEBUG_LEVEL >= level
+ * Zkopíruje data do kruhového bufferu, zámek musí být zamčen a v bufferu musí být místo
  *
- * @param level level výpisu
- * @param format formát textu
- * @param ... parametry formátování
+ * @param data kopírovaná data
+ * @param size počet byte
  */
-void log_print(int level, char *format, va_list args){
-    // Kontrola, zda je logování povoleno
-    if(DEBUG == FALSE) {
-        return;
-    }
+static void log_ring_put(const char *data, size_t size){
+    size_t position = (size_t)(log_ring.head % LOG_BUFFER_SIZE);
+    size_t first = LOG_BUFFER_SIZE - position;
 
-    // Kontrola aktuálního levelu
-    if(level < DEBUG_LEVEL){
-        return;
+    if(first > size){
+        first = size;
     }
 
-    // Zpráva je prázdná, nevypisujeme
-    if(strlen(format) < 1) {
-        return;
-    }
+    memcpy(log_ring.data + position, data, first);
+    memcpy(log_ring.data, data + first, size - first);
+    log_ring.head += size;
+}
 
-    // Výpis hlavičky (čas + level)
-    char *level_name;
-    switch(level){
-        // ALL
-        case 0:
-            level_name = "";
-            break;
-            // TRACE
-        case 1:
-            level_name = "TRACE";
-            break;
-            // DEBUG
-        case 2:
-            level_name = "DEBUG";
-            break;
-            // INFO
-        case 3:
-            level_name = "INFO";
-            break;
-            // ERROR
-        case 4:
-            level_name = "ERROR";
-            break;
-        case 5:
-            level_name = "FATAL";
-            break;
-        default:
-            level_name = "";
+/**
+ * Zapisovací vlákno - vypisuje obsah bufferu do otevřeného souboru
+ */
+#ifdef _WIN32
+static DWORD WINAPI log_writer(LPVOID arg){
+#else
+static void *log_writer(void *arg){
+#endif
+    (void)arg;
+
+    log_lock();
+    while(TRUE){
+        if(log_ring.head == log_ring.tail){
+            if(log_ring.stopping == TRUE){
+                break;
+            }
+
+            log_wait_data();
+            continue;
+        }
+
+        // Souvislý úsek od konce po okraj bufferu - zapisuje se bez zámku
+        size_t position = (size_t)(log_ring.tail % LOG_BUFFER_SIZE);
+        size_t size = (size_t)(log_ring.head - log_ring.tail);
+
+        if(size > LOG_BUFFER_SIZE - position){
+            size = LOG_BUFFER_SIZE - position;
+        }
+
+        log_unlock();
+        fwrite(log_ring.data + position, 1, size, log_ring.file);
+        fflush(log_ring.file);
+        log_lock();
+
+        log_ring.tail += size;
+        log_signal_space();
     }
+    log_unlock();
 
-    // Kopie argumentů - po prvním využití nejsou argumenty validní
-    va_list args_copy;
-    va_copy(args_copy, args);
-    log_print_file(level_name, format, args_copy);
-    va_copy(args_copy, args);
-    log_print_stdout(level_name, format, args_copy);
+    return 0;
 }
 
-
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 1
+ * Spustí zapisovací vlákno, které vyprazdňuje kruhový buffer do otevřeného
+ * logovacího souboru; před spuštěním (a po log_close) se zapisuje synchronně
  *
- * @param format formát textu
- * @param ... parametry formátování
+ * @return výsledek operace
  */
-void log_trace(char *format, ...){
-    // Deklarace argumentů
-    va_list args;
-    // Naplnění argumentů
-    va_start(args, format);
-    // Využití argumentů
-    log_print(LOG_TRACE, format, args);
-    // Ukončení argumentů
-    va_end(args);
-}
+bool log_open(void){
+    if(log_ring.started == TRUE){
+        return TRUE;
+    }
+
+    // Zápis do souboru je vypnutý - není co vyprazdňovat
+    if(LOG_FILE_ENABLED != TRUE || DEBUG != TRUE){
+        return FALSE;
+    }
+
+    log_ring.file = fopen(LOG_FILE, LOG_MODE_CURRENT);
+    log_ring.data = malloc(LOG_BUFFER_SIZE);
+
+    if(log_ring.file == NULL || log_ring.data == NULL){
+        if(log_ring.file != NULL){
+            fclose(log_ring.file);
+        }
+
+        free(log_ring.data);
+        log_ring.file = NULL;
+        log_ring.data = NULL;
+        return FALSE;
+    }
 
+    log_ring.head = 0;
+    log_ring.tail = 0;
+    log_ring.stopping = FALSE;
+    log_ring.stamp_time = 0;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&log_ring.lock);
+    InitializeConditionVariable(&log_ring.data_ready);
+    InitializeConditionVariable(&log_ring.space_ready);
+    log_ring.thread = CreateThread(NULL, 0, log_writer, NULL, 0, NULL);
+    bool created = log_ring.thread != NULL ? TRUE : FALSE;
+#else
+    pthread_mutex_init(&log_ring.lock, NULL);
+    pthread_cond_init(&log_ring.data_ready, NULL);
+    pthread_cond_init(&log_ring.space_ready, NULL);
+    bool created = pthread_create(&log_ring.thread, NULL, log_writer, NULL) == 0 ? TRUE : FALSE;
+#endif
+
+    if(created == FALSE){
+        fclose(log_ring.file);
+        free(log_ring.data);
+        log_ring.file = NULL;
+        log_ring.data = NULL;
+        return FALSE;
+    }
+
+    log_ring.started = TRUE;
+    atexit(log_close);
+
+    return TRUE;
+}
 
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 2
- *
- * @param format formát textu
- * @param ... parametry formátování
+ * Zapíše zbylé zprávy, ukončí zapisovací vlákno a zavře logovací soubor
  */
-void log_debug(char *format, ...){
-        // Deklarace argumentů
-        va_list args;
-        // Naplnění argumentů
-        va_start(args, format);
-        // Využití argumentů
-        log_print(LOG_DEBUG, format, args);
-        // Ukončení argumentů
-        va_end(args);
+void log_close(void){
+    if(log_ring.started == FALSE){
+        return;
+    }
+
+    log_lock();
+    log_ring.stopping = TRUE;
+    log_signal_data();
+    log_unlock();
+
+#ifdef _WIN32
+    WaitForSingleObject(log_ring.thread, INFINITE);
+    CloseHandle(log_ring.thread);
+    DeleteCriticalSection(&log_ring.lock);
+#else
+    pthread_join(log_ring.thread, NULL);
+    pthread_mutex_destroy(&log_ring.lock);
+    pthread_cond_destroy(&log_ring.data_ready);
+    pthread_cond_destroy(&log_ring.space_ready);
+#endif
+
+    // Další zprávy se zapisují synchronně
+    log_ring.started = FALSE;
+    fclose(log_ring.file);
+    free(log_ring.data);
+    log_ring.file = NULL;
+    log_ring.data = NULL;
 }
 
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 3
- *
- * @param format formát textu
- * @param ... parametry formátování
+ * Počká, až zapisovací vlákno zapíše všechny zprávy z bufferu
  */
-void log_info(char *format, ...){
-    // Deklarace argumentů
-    va_list args;
-    // Naplnění argumentů
-    va_start(args, format);
-    // Využití argumentů
-    log_print(LOG_INFO, format, args);
-    // Ukončení argumentů
-    va_end(args);
-}
+void log_flush(void){
+    if(log_ring.started == FALSE){
+        return;
+    }
 
+    log_lock();
+    log_signal_data();
+    while(log_ring.tail != log_ring.head){
+        log_wait_space();
+    }
+    log_unlock();
+}
 
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 4
+ * Naformátuje zprávu do kruhového bufferu (zprávy ERROR a FATAL se zapíší ihned)
+ *
+ * Používá se přes makra log_trace - log_fatal
  *
+ * @param level level výpisu
  * @param format formát textu
  * @param ... parametry formátování
  */
-void log_error(char *format, ...){
-    // Deklarace argumentů
+void log_write(int level, const char *format, ...){
+    // Zpráva je prázdná, nevypisujeme
+    if(format == NULL || format[0] == '\0') {
+        return;
+    }
+
+    const char *level_name = log_level_name(level);
     va_list args;
-    // Naplnění argumentů
+
+    if(STDOUT_ENABLED == TRUE){
+        va_start(args, format);
+        log_print_stdout(level_name, format, args);
+        va_end(args);
+    }
+
+    // Kontrola povolení výpisu do souboru
+    if(LOG_FILE_ENABLED != TRUE) {
+        return;
+    }
+
+    // Formátování zprávy probíhá mimo zámek
+    char message[LOG_LINE_MAX];
     va_start(args, format);
-    // Využití argumentů
-    log_print(LOG_ERROR, format, args);
-    // Ukončení argumentů
+    int length = vsnprintf(message, sizeof(message), format, args);
     va_end(args);
-}
 
+    if(length < 0){
+        return;
+    }
+
+    if(length >= (int)sizeof(message)){
+        length = sizeof(message) - 1;
+    }
+
+    if(log_ring.started == FALSE){
+        log_print_file(level_name, message);
+        return;
+    }
+
+    log_lock();
+
+    // Časová značka se formátuje nejvýše jednou za sekundu
+    char header[64];
+    int header_length = 0;
+    if(LOG_FILE_TIME_ENABLED == TRUE){
+        time_t now = time(NULL);
+
+        if(now != log_ring.stamp_time){
+            struct tm *tm_info = localtime(&now);
+            strftime(log_ring.stamp, sizeof(log_ring.stamp), "%Y-%m-%d %H:%M:%S", tm_info);
+            log_ring.stamp_time = now;
+        }
+
+        header_length = snprintf(header, sizeof(header), "%s > ", log_ring.stamp);
+    }
+
+    if(strlen(level_name) > 1){
+        header_length += snprintf(header + header_length, sizeof(header) - header_length, "%s >> ", level_name);
+    }
+
+    // Celá zpráva se do bufferu vloží najednou, aby se zprávy neprolínaly
+    size_t total = (size_t)header_length + (size_t)length;
+    while(LOG_BUFFER_SIZE - (log_ring.head - log_ring.tail) < total){
+        log_signal_data();
+        log_wait_space();
+    }
+
+    log_ring_put(header, (size_t)header_length);
+    log_ring_put(message, (size_t)length);
+
+    if(log_ring.head - log_ring.tail >= LOG_FLUSH_THRESHOLD){
+        log_signal_data();
+    }
+
+    log_unlock();
+
+    // Chyby se zapíší ihned, aby nezůstaly v bufferu při pádu aplikace
+    if(level >= LOG_ERROR){
+        log_flush();
+    }
+}
 
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 3
+ * Převede název levelu (all, trace, debug, info, error, fatal, off) na level
  *
- * @param format formát textu
- * @param ... parametry formátování
+ * @param name název levelu
+ * @return (return < 0: neznámý level | level)
  */
-void log_fatal(char *format, ...){
-    // Deklarace argumentů
-    va_list args;
-    // Naplnění argumentů
-    va_start(args, format);
-    // Využití argumentů
-    log_print(LOG_FATAL, format, args);
-    // Ukončení argumentů
-    va_end(args);
-}
\ No newline at end of file
+int log_parse_level(const char *name){
+    const char *names[] = {"all", "trace", "debug", "info", "error", "fatal", "off"};
+    int level;
+
+    if(name == NULL){
+        return -1;
+    }
+
+    for(level = LOG_ALL; level <= LOG_OFF; level++){
+        if(strcmp(name, names[level]) == 0){
+            return level;
+        }
+    }
+
+    return -1;
+}
@@ -29,59 +29,80 @@
 #define LOG_INFO 3
 #define LOG_ERROR 4
 #define LOG_FATAL 5
+#define LOG_OFF 6
 
 /*
  * Konstanty
  */
 #define DEBUG TRUE
-#define DEBUG_LEVEL LOG_ALL
+#define DEBUG_LEVEL LOG_ALL     // Nejnižší level, který se vůbec přeloží (nižší levely kompilátor vypustí)
 
 // Definice formátování
 #define LOG_TIME_FORMAT "%d.%m.%Y %H:%M:%S"
 
+// Asynchronní zápis do souboru
+#define LOG_BUFFER_SIZE (1024 * 1024)           // Velikost kruhového bufferu zpráv
+#define LOG_LINE_MAX 1024                       // Nejdelší zpráva (delší se zkrátí)
+#define LOG_FLUSH_THRESHOLD (LOG_BUFFER_SIZE / 8)  // Zaplnění bufferu, při kterém se probudí zapisovací vlákno
+#define LOG_FLUSH_INTERVAL_MS 200               // Nejdelší prodleva zápisu zprávy do souboru
+
+/*
+ * Globální proměnné
+ */
+extern int log_level;   // Level nastavený za běhu - zprávy s nižším levelem se nevypisují
+
+/*
+ * Zpráva daného levelu se vypíše - DEBUG i DEBUG_LEVEL jsou konstanty, takže
+ * zbývá jediné porovnání s levelem nastaveným za běhu
+ */
+#define LOG_ENABLED(level) (DEBUG == TRUE && (level) >= DEBUG_LEVEL && (level) >= log_level)
+
+/*
+ * Wrappery pro funkci printf - zpráva se vypíše, pokud je její level povolen
+ * při překladu (DEBUG_LEVEL) i za běhu (log_level). Vypnutý level stojí jedno
+ * porovnání a jeho parametry se vůbec nevyhodnotí.
+ */
+#define log_trace(...) do { if(LOG_ENABLED(LOG_TRACE)) { log_write(LOG_TRACE, __VA_ARGS__); } } while(0)
+#define log_debug(...) do { if(LOG_ENABLED(LOG_DEBUG)) { log_write(LOG_DEBUG, __VA_ARGS__); } } while(0)
+#define log_info(...) do { if(LOG_ENABLED(LOG_INFO)) { log_write(LOG_INFO, __VA_ARGS__); } } while(0)
+#define log_error(...) do { if(LOG_ENABLED(LOG_ERROR)) { log_write(LOG_ERROR, __VA_ARGS__); } } while(0)
+#define log_fatal(...) do { if(LOG_ENABLED(LOG_FATAL)) { log_write(LOG_FATAL, __VA_ARGS__); } } while(0)
+
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 1
+ * Spustí zapisovací vlákno, které vyprazdňuje kruhový buffer do otevřeného
+ * logovacího souboru; před spuštěním (a po log_close) se zapisuje synchronně
  *
- * @param format formát textu
- * @param ... parametry formátování
+ * @return výsledek operace
  */
-void log_trace(char *format, ...);
+bool log_open(void);
 
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 2
- *
- * @param format formát textu
- * @param ... parametry formátování
+ * Zapíše zbylé zprávy, ukončí zapisovací vlákno a zavře logovací soubor
  */
-void log_debug(char *format, ...);
+void log_close(void);
 
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 3
- *
- * @param format formát textu
- * @param ... parametry formátování
+ * Počká, až zapisovací vlákno zapíše všechny zprávy z bufferu
  */
-void log_info(char *format, ...);
+void log_flush(void);
 
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 4
+ * Naformátuje zprávu do kruhového bufferu (zprávy ERROR a FATAL se zapíší ihned)
+ *
+ * Používá se přes makra log_trace - log_fatal
  *
+ * @param level level výpisu
  * @param format formát textu
  * @param ... parametry formátování
  */
-void log_error(char *format, ...);
+void log_write(int level, const char *format, ...);
 
 /**
- * Wrapper pro funkci printf, výpis pouze při DEBUG=TRUE
- * a DEBUG_LEVEL >= 3
+ * Převede název levelu (all, trace, debug, info, error, fatal, off) na level
  *
- * @param format formát textu
- * @param ... parametry formátování
+ * @param name název levelu
+ * @return (return < 0: neznámý level | level)
  */
-void log_fatal(char *format, ... );
+int log_parse_level(const char *name);
 
 #endif //KIV_ZOS_DEBUG_H
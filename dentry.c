@@ -0,0 +1,210 @@
+#include "dentry.h"
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "mount.h"
+#include "dir_index.h"
+
+/**
+ * Vrátí položku mezipaměti, na kterou se mapuje dvojice (složka, jméno)
+ *
+ * @param cache mezipaměť
+ * @param parent_id ID i-uzlu složky
+ * @param name jméno záznamu
+ * @return ukazatel na položku
+ */
+static struct dentry *dentry_slot(struct dentry_cache *cache, int32_t parent_id, const char *name){
+    uint32_t hash = dir_index_hash(name) ^ ((uint32_t)parent_id * 2654435761u);
+    return &cache->slots[hash & (DENTRY_CACHE_SLOTS - 1)];
+}
+
+/**
+ * Vrátí mezipaměť připojeného VFS, při prvním použití ji vytvoří
+ *
+ * @param mount připojený VFS
+ * @return (struct dentry_cache * | NULL)
+ */
+static struct dentry_cache *dentry_cache_get(struct vfs_mount *mount){
+    if(mount->dentries == NULL){
+        mount->dentries = calloc(1, sizeof(struct dentry_cache));
+
+        if(mount->dentries == NULL){
+            log_debug("dentry_cache_get: Nepodarilo se alokovat pamet!\n");
+        }
+    }
+
+    return mount->dentries;
+}
+
+/**
+ * Vrátí položku zpětné mezipaměti pro daný i-uzel
+ *
+ * @param cache mezipaměť
+ * @param inode_id ID i-uzlu
+ * @return ukazatel na položku
+ */
+static struct dentry *dentry_reverse_slot(struct dentry_cache *cache, int32_t inode_id){
+    return &cache->reverse[((uint32_t)inode_id * 2654435761u) & (DENTRY_CACHE_SLOTS - 1)];
+}
+
+/**
+ * Ověří, zda se jméno vejde do položky mezipaměti
+ *
+ * @param name jméno záznamu
+ * @return lze uložit
+ */
+static bool dentry_name_fits(const char *name){
+    return (name != NULL && memchr(name, '\0', DENTRY_NAME_LENGTH) != NULL) ? TRUE : FALSE;
+}
+
+/**
+ * Vyhledá záznam složky v mezipaměti
+ *
+ * @param mount připojený VFS
+ * @param parent_id ID i-uzlu složky
+ * @param name jméno záznamu
+ * @return (DENTRY_UNKNOWN | DENTRY_NEGATIVE | return > 0: ID i-uzlu)
+ */
+int32_t dentry_lookup(struct vfs_mount *mount, int32_t parent_id, const char *name){
+    if(mount == NULL || mount->dentries == NULL || parent_id < 1 || dentry_name_fits(name) != TRUE){
+        return DENTRY_UNKNOWN;
+    }
+
+    struct dentry *slot = dentry_slot(mount->dentries, parent_id, name);
+
+    if(slot->parent_id != parent_id || strcmp(slot->name, name) != 0){
+        return DENTRY_UNKNOWN;
+    }
+
+    return slot->inode_id;
+}
+
+/**
+ * Uloží výsledek hledání záznamu složky do mezipaměti
+ *
+ * @param mount připojený VFS
+ * @param parent_id ID i-uzlu složky
+ * @param name jméno záznamu
+ * @param inode_id ID i-uzlu záznamu (DENTRY_NEGATIVE = jméno neexistuje)
+ */
+void dentry_insert(struct vfs_mount *mount, int32_t parent_id, const char *name, int32_t inode_id){
+    // Jméno, které se nevejde, se nekešuje ani nevyhledává
+    if(mount == NULL || parent_id < 1 || inode_id < 0 || dentry_name_fits(name) != TRUE){
+        return;
+    }
+
+    if(dentry_cache_get(mount) == NULL){
+        return;
+    }
+
+    struct dentry *slot = dentry_slot(mount->dentries, parent_id, name);
+    slot->parent_id = parent_id;
+    slot->inode_id = inode_id;
+    strcpy(slot->name, name);
+}
+
+/**
+ * Zahodí všechny záznamy, jejichž rodičem je daná složka (smazání složky)
+ *
+ * @param mount připojený VFS
+ * @param parent_id ID i-uzlu složky
+ */
+void dentry_invalidate_dir(struct vfs_mount *mount, int32_t parent_id){
+    if(mount == NULL || mount->dentries == NULL){
+        return;
+    }
+
+    int32_t i;
+    for(i = 0; i < DENTRY_CACHE_SLOTS; i++){
+        if(mount->dentries->slots[i].parent_id == parent_id){
+            memset(&mount->dentries->slots[i], 0, sizeof(struct dentry));
+        }
+
+        if(mount->dentries->reverse[i].parent_id == parent_id){
+            memset(&mount->dentries->reverse[i], 0, sizeof(struct dentry));
+        }
+    }
+
+    dentry_reverse_invalidate(mount, parent_id);
+}
+
+/**
+ * Vyhledá v mezipaměti rodičovskou složku a jméno, pod kterým je v ní i-uzel zapsán
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu
+ * @param parent_id výstup - ID i-uzlu rodičovské složky
+ * @param name výstup - jméno záznamu (alespoň DENTRY_NAME_LENGTH byte)
+ * @return nalezeno
+ */
+bool dentry_reverse_lookup(struct vfs_mount *mount, int32_t inode_id, int32_t *parent_id, char *name){
+    if(mount == NULL || mount->dentries == NULL || inode_id < 1){
+        return FALSE;
+    }
+
+    struct dentry *slot = dentry_reverse_slot(mount->dentries, inode_id);
+
+    if(slot->inode_id != inode_id || slot->parent_id < 1){
+        return FALSE;
+    }
+
+    *parent_id = slot->parent_id;
+    strcpy(name, slot->name);
+
+    return TRUE;
+}
+
+/**
+ * Uloží do mezipaměti rodičovskou složku a jméno i-uzlu
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu
+ * @param parent_id ID i-uzlu rodičovské složky
+ * @param name jméno záznamu
+ */
+void dentry_reverse_insert(struct vfs_mount *mount, int32_t inode_id, int32_t parent_id, const char *name){
+    if(mount == NULL || inode_id < 1 || parent_id < 1 || dentry_name_fits(name) != TRUE){
+        return;
+    }
+
+    if(dentry_cache_get(mount) == NULL){
+        return;
+    }
+
+    struct dentry *slot = dentry_reverse_slot(mount->dentries, inode_id);
+    slot->parent_id = parent_id;
+    slot->inode_id = inode_id;
+    strcpy(slot->name, name);
+}
+
+/**
+ * Zahodí rodičovskou složku a jméno i-uzlu z mezipaměti (přesun, smazání)
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu
+ */
+void dentry_reverse_invalidate(struct vfs_mount *mount, int32_t inode_id){
+    if(mount == NULL || mount->dentries == NULL || inode_id < 1){
+        return;
+    }
+
+    struct dentry *slot = dentry_reverse_slot(mount->dentries, inode_id);
+
+    if(slot->inode_id == inode_id){
+        memset(slot, 0, sizeof(struct dentry));
+    }
+}
+
+/**
+ * Uvolní mezipaměť připojeného VFS
+ *
+ * @param mount připojený VFS
+ */
+void dentry_cache_free(struct vfs_mount *mount){
+    if(mount == NULL || mount->dentries == NULL){
+        return;
+    }
+
+    free(mount->dentries);
+    mount->dentries = NULL;
+}
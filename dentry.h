@@ -0,0 +1,101 @@
+#ifndef KIV_ZOS_DENTRY_H
+#define KIV_ZOS_DENTRY_H
+
+/*
+ * Nutné hlavičky
+ */
+#include <stdint.h>
+#include "bool.h"
+
+/*
+ * Konstanty
+ */
+#define DENTRY_CACHE_SLOTS 1024     // Počet položek mezipaměti (mocnina 2)
+#define DENTRY_NAME_LENGTH 12       // Délka jména shodná s directory_entry
+#define DENTRY_UNKNOWN -1           // Záznam v mezipaměti není - je třeba číst složku
+#define DENTRY_NEGATIVE 0           // Záznam v mezipaměti je, jméno ve složce neexistuje
+
+/*
+ * Struktury
+ */
+struct vfs_mount;
+
+// Jedna položka mezipaměti: (rodičovská složka, jméno) -> i-uzel
+struct dentry {
+    int32_t parent_id;                  // ID i-uzlu složky (0 = volná položka)
+    int32_t inode_id;                   // ID i-uzlu záznamu (DENTRY_NEGATIVE = jméno neexistuje)
+    char name[DENTRY_NAME_LENGTH];      // Jméno záznamu
+};
+
+// Mezipaměť překladu cest s přímým mapováním (nová položka přepíše starou)
+struct dentry_cache {
+    struct dentry slots[DENTRY_CACHE_SLOTS];    // (složka, jméno) -> i-uzel
+    struct dentry reverse[DENTRY_CACHE_SLOTS];  // i-uzel -> (složka, jméno), pro skládání cest
+};
+
+/**
+ * Vyhledá záznam složky v mezipaměti
+ *
+ * @param mount připojený VFS
+ * @param parent_id ID i-uzlu složky
+ * @param name jméno záznamu
+ * @return (DENTRY_UNKNOWN | DENTRY_NEGATIVE | return > 0: ID i-uzlu)
+ */
+int32_t dentry_lookup(struct vfs_mount *mount, int32_t parent_id, const char *name);
+
+/**
+ * Uloží výsledek hledání záznamu složky do mezipaměti
+ *
+ * @param mount připojený VFS
+ * @param parent_id ID i-uzlu složky
+ * @param name jméno záznamu
+ * @param inode_id ID i-uzlu záznamu (DENTRY_NEGATIVE = jméno neexistuje)
+ */
+void dentry_insert(struct vfs_mount *mount, int32_t parent_id, const char *name, int32_t inode_id);
+
+/**
+ * Zahodí všechny záznamy, jejichž rodičem je daná složka, i záznam
+ * o jménu složky samotné (smazání složky)
+ *
+ * @param mount připojený VFS
+ * @param parent_id ID i-uzlu složky
+ */
+void dentry_invalidate_dir(struct vfs_mount *mount, int32_t parent_id);
+
+/**
+ * Vyhledá v mezipaměti rodičovskou složku a jméno, pod kterým je v ní i-uzel zapsán
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu
+ * @param parent_id výstup - ID i-uzlu rodičovské složky
+ * @param name výstup - jméno záznamu (alespoň DENTRY_NAME_LENGTH byte)
+ * @return nalezeno
+ */
+bool dentry_reverse_lookup(struct vfs_mount *mount, int32_t inode_id, int32_t *parent_id, char *name);
+
+/**
+ * Uloží do mezipaměti rodičovskou složku a jméno i-uzlu
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu
+ * @param parent_id ID i-uzlu rodičovské složky
+ * @param name jméno záznamu
+ */
+void dentry_reverse_insert(struct vfs_mount *mount, int32_t inode_id, int32_t parent_id, const char *name);
+
+/**
+ * Zahodí rodičovskou složku a jméno i-uzlu z mezipaměti (přesun, smazání)
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu
+ */
+void dentry_reverse_invalidate(struct vfs_mount *mount, int32_t inode_id);
+
+/**
+ * Uvolní mezipaměť připojeného VFS
+ *
+ * @param mount připojený VFS
+ */
+void dentry_cache_free(struct vfs_mount *mount);
+
+#endif //KIV_ZOS_DENTRY_H
@@ -0,0 +1,364 @@
+#include "dir_index.h"
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "mount.h"
+#include "directory.h"
+
+/**
+ * Spočítá hash jména záznamu složky (FNV-1a přes nejvýše 12 byte)
+ *
+ * @param name jméno záznamu
+ * @return hash jména
+ */
+uint32_t dir_index_hash(const char *name){
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for(i = 0; i < sizeof(((struct directory_entry *)0)->name) && name[i] != '\0'; i++){
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Porovná jméno uložené v záznamu s hledaným jménem
+ *
+ * @param entry_name jméno v záznamu (nejvýše 12 byte)
+ * @param name hledané jméno
+ * @return shoda jmen
+ */
+static bool dir_index_name_equals(const char *entry_name, const char *name){
+    size_t max = sizeof(((struct directory_entry *)0)->name);
+
+    if(strlen(name) > max){
+        return FALSE;
+    }
+
+    return strncmp(entry_name, name, max) == 0 ? TRUE : FALSE;
+}
+
+/**
+ * Zařadí záznam na dané pozici do řetězce hashovací tabulky
+ *
+ * @param index index složky
+ * @param position pozice záznamu
+ */
+static void dir_index_link(struct dir_index *index, int32_t position){
+    int32_t bucket = dir_index_hash(index->entries[position].name) & (index->bucket_count - 1);
+    index->next[position] = index->buckets[bucket];
+    index->buckets[bucket] = position;
+}
+
+/**
+ * Vyjme záznam na dané pozici z řetězce hashovací tabulky
+ *
+ * @param index index složky
+ * @param position pozice záznamu
+ */
+static void dir_index_unlink(struct dir_index *index, int32_t position){
+    int32_t bucket = dir_index_hash(index->entries[position].name) & (index->bucket_count - 1);
+    int32_t *link = &index->buckets[bucket];
+
+    while(*link != DIR_INDEX_NONE){
+        if(*link == position){
+            *link = index->next[position];
+            break;
+        }
+
+        link = &index->next[*link];
+    }
+
+    index->next[position] = DIR_INDEX_NONE;
+}
+
+/**
+ * Zvětší pole záznamů a podle potřeby přestaví hashovací tabulku,
+ * aby se do indexu vešlo alespoň wanted záznamů
+ *
+ * @param index index složky
+ * @param wanted požadovaný počet záznamů
+ * @return výsledek operace
+ */
+static bool dir_index_reserve(struct dir_index *index, int32_t wanted){
+    if(wanted > index->capacity){
+        int32_t capacity = index->capacity > 0 ? index->capacity : 16;
+
+        while(capacity < wanted){
+            capacity = capacity * 2;
+        }
+
+        struct directory_entry *entries = realloc(index->entries, sizeof(struct directory_entry) * capacity);
+
+        if(entries == NULL){
+            return FALSE;
+        }
+
+        index->entries = entries;
+
+        int32_t *next = realloc(index->next, sizeof(int32_t) * capacity);
+
+        if(next == NULL){
+            return FALSE;
+        }
+
+        index->next = next;
+        index->capacity = capacity;
+    }
+
+    // Průměrná délka řetězce nejvýše 1
+    if(wanted <= index->bucket_count){
+        return TRUE;
+    }
+
+    int32_t bucket_count = index->bucket_count > 0 ? index->bucket_count : 16;
+
+    while(bucket_count < wanted){
+        bucket_count = bucket_count * 2;
+    }
+
+    int32_t *buckets = malloc(sizeof(int32_t) * bucket_count);
+
+    if(buckets == NULL){
+        return FALSE;
+    }
+
+    free(index->buckets);
+    index->buckets = buckets;
+    index->bucket_count = bucket_count;
+
+    int32_t i;
+    for(i = 0; i < bucket_count; i++){
+        index->buckets[i] = DIR_INDEX_NONE;
+    }
+
+    for(i = 0; i < index->count; i++){
+        dir_index_link(index, i);
+    }
+
+    return TRUE;
+}
+
+/**
+ * Uvolní jeden index složky
+ *
+ * @param index index složky
+ */
+static void dir_index_free(struct dir_index *index){
+    free(index->entries);
+    free(index->next);
+    free(index->buckets);
+    free(index);
+}
+
+/**
+ * Vrátí index složky, pokud již byl v připojeném VFS vytvořen
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu složky
+ * @return (struct dir_index * | NULL)
+ */
+struct dir_index *dir_index_find(struct vfs_mount *mount, int32_t inode_id){
+    if(mount == NULL || mount->dir_indexes == NULL){
+        return NULL;
+    }
+
+    struct dir_index *index = mount->dir_indexes[inode_id & (DIR_INDEX_TABLE_SIZE - 1)];
+
+    while(index != NULL){
+        if(index->inode_id == inode_id){
+            return index;
+        }
+
+        index = index->table_next;
+    }
+
+    return NULL;
+}
+
+/**
+ * Vytvoří index složky z jejích záznamů a zaregistruje ho v připojeném VFS
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu složky
+ * @param entries všechny záznamy složky v pořadí jako ve VFS
+ * @param count počet záznamů
+ * @return (struct dir_index * | NULL)
+ */
+struct dir_index *dir_index_build(struct vfs_mount *mount, int32_t inode_id, struct directory_entry *entries, int32_t count){
+    if(mount == NULL || entries == NULL || count < 0){
+        log_debug("dir_index_build: Neplatne parametry!\n");
+        return NULL;
+    }
+
+    if(mount->dir_indexes == NULL){
+        mount->dir_indexes = calloc(DIR_INDEX_TABLE_SIZE, sizeof(struct dir_index *));
+
+        if(mount->dir_indexes == NULL){
+            log_debug("dir_index_build: Nepodarilo se alokovat pamet!\n");
+            return NULL;
+        }
+    }
+
+    // Případný starý index stejné složky nahradíme
+    dir_index_drop(mount, inode_id);
+
+    struct dir_index *index = malloc(sizeof(struct dir_index));
+
+    if(index == NULL){
+        log_debug("dir_index_build: Nepodarilo se alokovat pamet!\n");
+        return NULL;
+    }
+
+    memset(index, 0, sizeof(struct dir_index));
+    index->inode_id = inode_id;
+
+    if(dir_index_reserve(index, count) != TRUE){
+        log_debug("dir_index_build: Nepodarilo se alokovat pamet!\n");
+        dir_index_free(index);
+        return NULL;
+    }
+
+    memcpy(index->entries, entries, sizeof(struct directory_entry) * count);
+    index->count = count;
+
+    int32_t i;
+    for(i = 0; i < count; i++){
+        dir_index_link(index, i);
+    }
+
+    int32_t slot = inode_id & (DIR_INDEX_TABLE_SIZE - 1);
+    index->table_next = mount->dir_indexes[slot];
+    mount->dir_indexes[slot] = index;
+
+    log_debug("dir_index_build: Vytvoren index slozky %d (%d zaznamu)\n", inode_id, count);
+    return index;
+}
+
+/**
+ * Najde pozici záznamu s daným jménem
+ *
+ * @param index index složky
+ * @param name hledané jméno
+ * @return (pozice záznamu | DIR_INDEX_NONE)
+ */
+int32_t dir_index_lookup(struct dir_index *index, const char *name){
+    if(index == NULL || name == NULL || index->bucket_count < 1){
+        return DIR_INDEX_NONE;
+    }
+
+    int32_t position = index->buckets[dir_index_hash(name) & (index->bucket_count - 1)];
+
+    while(position != DIR_INDEX_NONE){
+        if(dir_index_name_equals(index->entries[position].name, name) == TRUE){
+            return position;
+        }
+
+        position = index->next[position];
+    }
+
+    return DIR_INDEX_NONE;
+}
+
+/**
+ * Přidá záznam na konec indexu (odpovídá zápisu na konec složky)
+ *
+ * @param index index složky
+ * @param entry přidaný záznam
+ * @return výsledek operace
+ */
+bool dir_index_append(struct dir_index *index, struct directory_entry *entry){
+    if(index == NULL || entry == NULL){
+        return FALSE;
+    }
+
+    if(dir_index_reserve(index, index->count + 1) != TRUE){
+        return FALSE;
+    }
+
+    index->entries[index->count] = *entry;
+    dir_index_link(index, index->count);
+    index->count = index->count + 1;
+
+    return TRUE;
+}
+
+/**
+ * Odebere záznam z indexu - poslední záznam se přesune na jeho pozici
+ * stejně jako ve VFS
+ *
+ * @param index index složky
+ * @param position pozice odebíraného záznamu
+ * @return výsledek operace
+ */
+bool dir_index_remove(struct dir_index *index, int32_t position){
+    if(index == NULL || position < 0 || position >= index->count){
+        return FALSE;
+    }
+
+    int32_t last = index->count - 1;
+
+    dir_index_unlink(index, position);
+
+    if(position != last){
+        dir_index_unlink(index, last);
+        index->entries[position] = index->entries[last];
+        dir_index_link(index, position);
+    }
+
+    index->count = last;
+
+    return TRUE;
+}
+
+/**
+ * Zahodí index složky (smazání složky, nekonzistence)
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu složky
+ */
+void dir_index_drop(struct vfs_mount *mount, int32_t inode_id){
+    if(mount == NULL || mount->dir_indexes == NULL){
+        return;
+    }
+
+    struct dir_index **link = &mount->dir_indexes[inode_id & (DIR_INDEX_TABLE_SIZE - 1)];
+
+    while(*link != NULL){
+        if((*link)->inode_id == inode_id){
+            struct dir_index *index = *link;
+            *link = index->table_next;
+            dir_index_free(index);
+            return;
+        }
+
+        link = &(*link)->table_next;
+    }
+}
+
+/**
+ * Uvolní všechny indexy připojeného VFS
+ *
+ * @param mount připojený VFS
+ */
+void dir_index_free_all(struct vfs_mount *mount){
+    if(mount == NULL || mount->dir_indexes == NULL){
+        return;
+    }
+
+    int32_t i;
+    for(i = 0; i < DIR_INDEX_TABLE_SIZE; i++){
+        struct dir_index *index = mount->dir_indexes[i];
+
+        while(index != NULL){
+            struct dir_index *next = index->table_next;
+            dir_index_free(index);
+            index = next;
+        }
+    }
+
+    free(mount->dir_indexes);
+    mount->dir_indexes = NULL;
+}
@@ -0,0 +1,105 @@
+#ifndef KIV_ZOS_DIR_INDEX_H
+#define KIV_ZOS_DIR_INDEX_H
+
+/*
+ * Nutné hlavičky
+ */
+#include <stdint.h>
+#include "bool.h"
+
+/*
+ * Konstanty
+ */
+#define DIR_INDEX_TABLE_SIZE 64     // Počet řetězců tabulky indexů připojeného VFS
+#define DIR_INDEX_NONE -1           // Pozice, která neodpovídá žádnému záznamu
+
+/*
+ * Struktury
+ */
+struct vfs_mount;
+struct directory_entry;
+
+// Hashovaný index jedné složky: jméno záznamu -> pozice záznamu ve složce
+struct dir_index {
+    int32_t inode_id;                   // ID i-uzlu indexované složky
+    int32_t count;                      // Počet záznamů ve složce
+    int32_t capacity;                   // Velikost polí entries a next
+    struct directory_entry *entries;    // Kopie záznamů ve stejném pořadí jako ve VFS
+    int32_t *next;                      // Další pozice ve stejném řetězci hashovací tabulky
+    int32_t *buckets;                   // Hashovací tabulka: hash jména -> první pozice řetězce
+    int32_t bucket_count;               // Velikost hashovací tabulky (mocnina 2)
+    struct dir_index *table_next;       // Další index ve stejném řetězci tabulky připojeného VFS
+};
+
+/**
+ * Spočítá hash jména záznamu složky (FNV-1a přes nejvýše 12 byte)
+ *
+ * @param name jméno záznamu
+ * @return hash jména
+ */
+uint32_t dir_index_hash(const char *name);
+
+/**
+ * Vrátí index složky, pokud již byl v připojeném VFS vytvořen
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu složky
+ * @return (struct dir_index * | NULL)
+ */
+struct dir_index *dir_index_find(struct vfs_mount *mount, int32_t inode_id);
+
+/**
+ * Vytvoří index složky z jejích záznamů a zaregistruje ho v připojeném VFS
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu složky
+ * @param entries všechny záznamy složky v pořadí jako ve VFS
+ * @param count počet záznamů
+ * @return (struct dir_index * | NULL)
+ */
+struct dir_index *dir_index_build(struct vfs_mount *mount, int32_t inode_id, struct directory_entry *entries, int32_t count);
+
+/**
+ * Najde pozici záznamu s daným jménem
+ *
+ * @param index index složky
+ * @param name hledané jméno
+ * @return (pozice záznamu | DIR_INDEX_NONE)
+ */
+int32_t dir_index_lookup(struct dir_index *index, const char *name);
+
+/**
+ * Přidá záznam na konec indexu (odpovídá zápisu na konec složky)
+ *
+ * @param index index složky
+ * @param entry přidaný záznam
+ * @return výsledek operace
+ */
+bool dir_index_append(struct dir_index *index, struct directory_entry *entry);
+
+/**
+ * Odebere záznam z indexu - poslední záznam se přesune na jeho pozici
+ * stejně jako ve VFS
+ *
+ * @param index index složky
+ * @param position pozice odebíraného záznamu
+ * @return výsledek operace
+ */
+bool dir_index_remove(struct dir_index *index, int32_t position);
+
+/**
+ * Zahodí index složky (smazání složky, nekonzistence)
+ *
+ * @param mount připojený VFS
+ * @param inode_id ID i-uzlu složky
+ */
+void dir_index_drop(struct vfs_mount *mount, int32_t inode_id);
+
+/**
+ * Uvolní všechny indexy připojeného VFS
+ *
+ * @param mount připojený VFS
+ */
+void dir_index_free_all(struct vfs_mount *mount);
+
+#endif //KIV_ZOS_DIR_INDEX_H
@@ -6,32 +6,152 @@
 #include "inode.h"
 #include "structure.h"
 #include "allocation.h"
+#include "dir_index.h"
+#include "dentry.h"
+#include "inode_cache.h"
+
+/**
+ * Načte všechny záznamy složky jedním čtením
+ *
+ * Složka v jediném clusteru namapovaného VFS se čte přímo z mapy bez kopie
+ *
+ * @param vfs_dir otevřená složka
+ * @param count výstup - počet načtených záznamů
+ * @param mapped výstup - TRUE: záznamy leží v mapě a neuvolňují se
+ * @return (struct directory_entry * | NULL)
+ */
+static struct directory_entry *directory_load_entries(VFS_FILE *vfs_dir, int32_t *count, bool *mapped){
+    *count = vfs_dir->inode_ptr->file_size / sizeof(struct directory_entry);
+    *mapped = FALSE;
+
+    // Záznamy celé složky leží v prvním clusteru
+    if(*count > 0 && vfs_dir->inode_ptr->file_size <= vfs_dir->mount->superblock_ptr->cluster_size){
+        int64_t address = vfs_get_datablock_address(vfs_dir, 0);
+        struct directory_entry *entries = address > 0 ? mount_ptr(vfs_dir->mount, address, sizeof(struct directory_entry) * (*count)) : NULL;
+
+        if(entries != NULL){
+            *mapped = TRUE;
+            return entries;
+        }
+    }
+
+    struct directory_entry *entries = malloc(sizeof(struct directory_entry) * (*count > 0 ? *count : 1));
+
+    if(entries == NULL){
+        log_debug("directory_load_entries: Nepodarilo se alokovat pamet!\n");
+        return NULL;
+    }
+
+    memset(entries, 0, sizeof(struct directory_entry) * (*count > 0 ? *count : 1));
+    vfs_seek(vfs_dir, 0, SEEK_SET);
+    vfs_read(entries, sizeof(struct directory_entry), *count, vfs_dir);
+
+    return entries;
+}
+
+/**
+ * Uvolní záznamy načtené directory_load_entries
+ *
+ * @param entries záznamy složky
+ * @param mapped záznamy leží v mapě (neuvolňují se)
+ */
+static void directory_free_entries(struct directory_entry *entries, bool mapped){
+    if(mapped == FALSE){
+        free(entries);
+    }
+}
+
+/**
+ * Vrátí hashovaný index složky - složky větší než jeden cluster se
+ * při prvním přístupu zaindexují, menší se dál prohledávají lineárně
+ *
+ * @param vfs_dir otevřená složka
+ * @return (struct dir_index * | NULL: složka se prohledává lineárně)
+ */
+static struct dir_index *directory_index(VFS_FILE *vfs_dir){
+    struct dir_index *index = dir_index_find(vfs_dir->mount, vfs_dir->inode_ptr->id);
+
+    if(index != NULL || vfs_dir->inode_ptr->file_size <= vfs_dir->mount->superblock_ptr->cluster_size){
+        return index;
+    }
+
+    int32_t count = 0;
+    bool mapped = FALSE;
+    struct directory_entry *entries = directory_load_entries(vfs_dir, &count, &mapped);
+
+    if(entries == NULL){
+        return NULL;
+    }
+
+    index = dir_index_build(vfs_dir->mount, vfs_dir->inode_ptr->id, entries, count);
+    directory_free_entries(entries, mapped);
+
+    return index;
+}
+
+/**
+ * Najde záznam s daným jménem v otevřené složce
+ *
+ * @param vfs_dir otevřená složka
+ * @param entry_name hledané jméno
+ * @param found výstup - nalezený záznam (může být NULL)
+ * @return (return < 0: nenalezeno | return >= 0: pozice záznamu ve složce)
+ */
+static int32_t directory_find_entry(VFS_FILE *vfs_dir, char *entry_name, struct directory_entry *found){
+    struct dir_index *index = directory_index(vfs_dir);
+
+    // Velká složka - hledání v indexu
+    if(index != NULL){
+        int32_t position = dir_index_lookup(index, entry_name);
+
+        if(position != DIR_INDEX_NONE && found != NULL){
+            *found = index->entries[position];
+        }
+
+        return position;
+    }
+
+    // Malá složka - lineární průchod záznamů načtených jedním čtením
+    int32_t count = 0;
+    bool mapped = FALSE;
+    struct directory_entry *entries = directory_load_entries(vfs_dir, &count, &mapped);
+
+    if(entries == NULL){
+        return -1;
+    }
+
+    int32_t position;
+    for(position = 0; position < count; position++){
+        if(strncmp(entries[position].name, entry_name, sizeof(entries[position].name)) == 0
+            && strlen(entry_name) <= sizeof(entries[position].name)){
+            if(found != NULL){
+                *found = entries[position];
+            }
+
+            directory_free_entries(entries, mapped);
+            return position;
+        }
+    }
+
+    directory_free_entries(entries, mapped);
+    return -1;
+}
 
 /**
  * Vytvoří ve VFS novou složku
  *
- * @param vfs_filename cesta k VFS souboru
+ * @param mount připojený VFS
  * @param path cesta uvnitř VFS
  * @return výsledek operace (return < 0: chyba | return >=0: OK)
  */
-int32_t directory_create(char *vfs_filename, char *path){
+int32_t directory_create(struct vfs_mount *mount, char *path){
     // Ověřování NULL
-    if(vfs_filename == NULL){
-        log_debug("directory_create: Argument vfs_filename nemuze byt NULL!\n");
+    if(mount == NULL){
+        log_debug("directory_create: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Kontrola délky názvu souboru
-    if(strlen(vfs_filename) < 1){
-        log_debug("directory_create: Argument vfs_filename nemuze byt prazdnym retezcem!\n");
-        return -2;
-    }
 
-    // Ověření existence souboru
-    if(file_exist(vfs_filename) != TRUE){
-        log_debug("directory_create: Cesta k souboru VFS neexistuje!\n");
-        return -3;
-    }
 
     // Ověřování NULL pro cestu
     if(path == NULL){
@@ -60,7 +180,16 @@ int32_t directory_create(char *vfs_filename, char *path){
 
     // Vytvoření inode
     // Zjištění volného indexu pro INODE -> index != 0 => máme již root
-    int32_t inode_free_index = inode_find_free_index(vfs_filename);
+    int32_t inode_free_index = inode_find_free_index(mount);
+
+    if(inode_free_index < 0){
+        log_info("directory_create: Nelze vytvorit slozku -> nedostatek volnych INODE!\n");
+
+        // Uvolnění zdrojů
+        free(parrent_name);
+        free(current_name);
+        return -9;
+    }
 
     // Vytvoření struktury INODE
     struct inode *inode_ptr = malloc(sizeof(struct inode));
@@ -71,7 +200,7 @@ int32_t directory_create(char *vfs_filename, char *path){
     // Nastavení typu INODE jako složka
     inode_ptr->type = VFS_DIRECTORY;
     // Zápis inode do VFS
-    inode_write_to_index(vfs_filename, inode_free_index, inode_ptr);
+    inode_write_to_index(mount, inode_free_index, inode_ptr);
     // Uvolnění paměti
     free(inode_ptr);
 
@@ -88,7 +217,7 @@ int32_t directory_create(char *vfs_filename, char *path){
         current_id = 1;
         strcpy(parrent_name, "..");
         strcpy(current_name, ".");
-        vfs_file = vfs_open_inode(vfs_filename, 1);
+        vfs_file = vfs_open_inode(mount, 1);
     }
     else{
         // Zjištění prefix cesty
@@ -104,7 +233,7 @@ int32_t directory_create(char *vfs_filename, char *path){
 
         // TODO: změnit zápis záznamu do rodiče na funkci, projít data složky a hledat volné místo
 
-        VFS_FILE *vfs_parrent = vfs_open_recursive(vfs_filename, path_prefix, 0);
+        VFS_FILE *vfs_parrent = vfs_open_recursive(mount, path_prefix, 0);
         int32_t add_result = directory_add_entry(vfs_parrent, parrent_entry);
         log_debug("directory_create: Entry add result -> %d\n", add_result);
 
@@ -128,7 +257,7 @@ int32_t directory_create(char *vfs_filename, char *path){
         free(dir_name);
         free(path_prefix);
 
-        vfs_file = vfs_open_inode(vfs_filename, current_id);
+        vfs_file = vfs_open_inode(mount, current_id);
     }
 
     if(vfs_file == NULL){
@@ -167,28 +296,18 @@ int32_t directory_create(char *vfs_filename, char *path){
 
 /**
  * Vypíše obsah složky ve VFS s danou cestou (příkaz LS)
- * @param vfs_filename cesta k VFS souboru
+ * @param mount připojený VFS
  * @param path cesta uvnitř VFS
  * @return výsledek operace (return < 0: chyba | return >=0: OK)
  */
-int32_t directory_entries_print(char *vfs_filename, char *path){
+int32_t directory_entries_print(struct vfs_mount *mount, char *path){
     // Ověřování NULL
-    if(vfs_filename == NULL){
-        log_debug("directory_entries_print: Argument vfs_filename nemuze byt NULL!\n");
+    if(mount == NULL){
+        log_debug("directory_entries_print: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Kontrola délky názvu souboru
-    if(strlen(vfs_filename) < 1){
-        log_debug("directory_entries_print: Argument vfs_filename nemuze byt prazdnym retezcem!\n");
-        return -2;
-    }
 
-    // Ověření existence souboru
-    if(file_exist(vfs_filename) != TRUE){
-        log_debug("directory_entries_print: Cesta k souboru VFS neexistuje!\n");
-        return -3;
-    }
 
     // Ověřování NULL pro cestu
     if(path == NULL){
@@ -206,9 +325,9 @@ int32_t directory_entries_print(char *vfs_filename, char *path){
 
     // Speciální případ /
     if(strcmp(path, "/") == 0){
-        vfs_file = vfs_open_inode(vfs_filename, 1);
+        vfs_file = vfs_open_inode(mount, 1);
     } else {
-        vfs_file = vfs_open_recursive(vfs_filename, path, 0);
+        vfs_file = vfs_open_recursive(mount, path, 0);
     }
 
     if(vfs_file == NULL){
@@ -216,20 +335,21 @@ int32_t directory_entries_print(char *vfs_filename, char *path){
         return -6;
     }
 
-    // Nastavení ukazatele
-    vfs_seek(vfs_file, 0, SEEK_SET);
+    // Všechny záznamy jedním čtením (malá složka namapovaného VFS bez kopie)
+    int32_t count = 0;
+    bool mapped = FALSE;
+    struct directory_entry *entries = directory_load_entries(vfs_file, &count, &mapped);
 
-    // Alokace dat pro entry
-    struct directory_entry *entry = malloc(sizeof(struct directory_entry));
+    if(entries == NULL){
+        vfs_close(vfs_file);
+        return -7;
+    }
 
     printf("+DIRECTORY\n");
 
-    // Čtení directory entry do velikosti souboru
-    int32_t current = 0;
-    while(current + sizeof(struct directory_entry) <= vfs_file->inode_ptr->file_size){
-        memset(entry, 0, sizeof(struct directory_entry));
-        vfs_read(entry, sizeof(struct directory_entry), 1, vfs_file);
-
+    int32_t i;
+    for(i = 0; i < count; i++){
+        struct directory_entry *entry = &entries[i];
 
         if(strcmp(entry->name, "..") == 0 || strcmp(entry->name, ".") == 0){
             // Výpis
@@ -237,7 +357,7 @@ int32_t directory_entries_print(char *vfs_filename, char *path){
         }
         else {
             // Char type
-            VFS_FILE *entry_file = vfs_open_inode(vfs_filename, entry->inode_id);
+            VFS_FILE *entry_file = vfs_open_inode(mount, entry->inode_id);
 
             if(entry_file != NULL){
                 char *type = filetype_to_short(entry_file->inode_ptr->type);
@@ -252,13 +372,10 @@ int32_t directory_entries_print(char *vfs_filename, char *path){
             }
 
         }
-
-        // Posun na další prvek - vlastně jen pro podmínku, SEEK se upravuje v VFS_READ
-        current += sizeof(struct directory_entry);
     }
 
     // Uvolnění dat
-    free(entry);
+    directory_free_entries(entries, mapped);
     vfs_close(vfs_file);
 
     // OK
@@ -269,23 +386,18 @@ int32_t directory_entries_print(char *vfs_filename, char *path){
  * Při nalezení záznamu ve složce vrátí INODE ID záznamu, v opačném případě vrátí
  * hodnotu menší než 1
  *
- * @param vfs_filename cesta k VFS souboru
+ * @param mount připojený VFS
  * @param inode_id aktualně prohledávaná složka (její inode ID(
  * @param entry_name hledané jméno
  * @return výsledek operace (return < 0: chyba | return==0: Nenalezeno | return >0: Nalezeno)
  */
-int32_t directory_has_entry(char *vfs_filename, int32_t inode_id ,char *entry_name){
+int32_t directory_has_entry(struct vfs_mount *mount, int32_t inode_id ,char *entry_name){
     // Ověřování NULL
-    if(vfs_filename == NULL){
-        log_debug("directory_has_entry: Argument vfs_filename nemuze byt NULL!\n");
+    if(mount == NULL){
+        log_debug("directory_has_entry: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Kontrola délky názvu souboru
-    if(strlen(vfs_filename) < 1){
-        log_debug("directory_has_entry: Argument vfs_filename nemuze byt prazdnym retezcem!\n");
-        return -2;
-    }
 
     if(inode_id < 1){
         log_debug("directory_has_entry: Soubor s INODE ID=%d nemuze existovat!\n", inode_id);
@@ -302,8 +414,15 @@ int32_t directory_has_entry(char *vfs_filename, int32_t inode_id ,char *entry_na
         return -5;
     }
 
+    // Výsledek už je v mezipaměti (i negativní)
+    int32_t cached_id = dentry_lookup(mount, inode_id, entry_name);
+
+    if(cached_id != DENTRY_UNKNOWN){
+        return cached_id;
+    }
+
     // Ziskani INODE podle ID
-    struct inode *inode_ptr = inode_read_by_index(vfs_filename, inode_id - 1);
+    struct inode *inode_ptr = inode_cache_get(mount, inode_id - 1);
 
     // Ověření ziskani ukazatele na inode
     if(inode_ptr == NULL){
@@ -313,7 +432,7 @@ int32_t directory_has_entry(char *vfs_filename, int32_t inode_id ,char *entry_na
 
     // Pokud jde o soubor nelze číst
     if(inode_ptr->type == VFS_FILE_TYPE){
-        free(inode_ptr);
+        inode_cache_put(mount, inode_ptr);
         log_debug("directory_has_entry: Ocekavana slozka, INODE ID=%d je soubor!\n", inode_id);
         return -7;
     }
@@ -322,41 +441,32 @@ int32_t directory_has_entry(char *vfs_filename, int32_t inode_id ,char *entry_na
     // TODO: symlinkovaná složka
 
     // Můžeme číst složku - otevřeme
-    VFS_FILE *vfs_file = vfs_open_inode(vfs_filename, inode_id);
-    // Nastavíme offset na začátek
-    vfs_seek(vfs_file, 0, SEEK_SET);
+    VFS_FILE *vfs_file = vfs_open_inode(mount, inode_id);
 
-    struct directory_entry *entry = malloc(sizeof(struct directory_entry));
-    int32_t curr = 0;
-    while(curr + sizeof(struct directory_entry) <= vfs_file->inode_ptr->file_size){
-        memset(entry, 0, sizeof(struct directory_entry));
-        vfs_read(entry, sizeof(struct directory_entry), 1, vfs_file);
-
-        // Nalezeni retezce
-        if(strcmp(entry->name, entry_name) == 0) {
-            int32_t entry_id = entry->inode_id;
-            free(entry);
-            free(inode_ptr);
-            vfs_close(vfs_file);
-            return entry_id;
-        }
+    if(vfs_file == NULL){
+        inode_cache_put(mount, inode_ptr);
+        log_debug("directory_has_entry: Nelze otevrit slozku INODE ID=%d!\n", inode_id);
+        return -8;
+    }
 
-        curr += sizeof(struct directory_entry);
+    struct directory_entry entry;
+    int32_t entry_id = 0;
+
+    if(directory_find_entry(vfs_file, entry_name, &entry) >= 0){
+        entry_id = entry.inode_id;
     }
 
-    // Nepodařilo se nalézt entry s daným jménem;
-    vfs_close(vfs_file);
-    free(inode_ptr);
-    free(entry);
-    return 0;
+    dentry_insert(mount, inode_id, entry_name, entry_id);
 
+    vfs_close(vfs_file);
+    inode_cache_put(mount, inode_ptr);
+    return entry_id;
 }
 
 /**
  * Přidá záznam directory_entry do souboru
  *
- * @param vfs_filename cesta k VFS souboru
- * @param path cesta uvnitř VFS
+ * @param vfs_parrent otevřená rodičovská složka
  * @param entry zapisovaný záznam
  * @return výsledek operace (return < 0: chyba | return >= 0: OK)
  */
@@ -366,28 +476,160 @@ int32_t directory_add_entry(VFS_FILE *vfs_parrent, struct directory_entry *entry
         return -1;
     }
 
-    struct directory_entry *read_entry = malloc(sizeof(struct directory_entry));
-    int32_t curr = 0;
-    while(curr + sizeof(struct directory_entry) <= vfs_parrent->inode_ptr->file_size){
-        memset(read_entry, 0, sizeof(struct directory_entry));
-        vfs_read(read_entry, sizeof(struct directory_entry), 1, vfs_parrent);
+    if(entry == NULL){
+        log_debug("directory_add_entry: parametr entry nemuze byt NULL!\n");
+        return -2;
+    }
+
+    // Záznamy jsou ve složce vždy souvislé (mazání přesouvá poslední záznam) - přidává se na konec
+    int32_t position = vfs_parrent->inode_ptr->file_size / sizeof(struct directory_entry);
+    struct dir_index *index = dir_index_find(vfs_parrent->mount, vfs_parrent->inode_ptr->id);
+
+    // Nastavení ukazatele
+    vfs_seek(vfs_parrent, (int64_t)position * sizeof(struct directory_entry), SEEK_SET);
+    // Zápis záznamu
+    if((int64_t)vfs_write(entry, sizeof(struct directory_entry), 1, vfs_parrent) < 0){
+        log_debug("directory_add_entry: Zaznam se nepodarilo zapsat!\n");
+        dir_index_drop(vfs_parrent->mount, vfs_parrent->inode_ptr->id);
+        return -3;
+    }
+
+    // Aktualizace indexu - při nesouladu se index zahodí a příště sestaví znovu
+    if(index != NULL && (index->count != position || dir_index_append(index, entry) != TRUE)){
+        dir_index_drop(vfs_parrent->mount, vfs_parrent->inode_ptr->id);
+    }
+
+    // Případný negativní záznam v mezipaměti přestal platit
+    dentry_insert(vfs_parrent->mount, vfs_parrent->inode_ptr->id, entry->name, entry->inode_id);
+    dentry_reverse_insert(vfs_parrent->mount, entry->inode_id, vfs_parrent->inode_ptr->id, entry->name);
+
+    // OK
+    return 0;
+}
+
+/**
+ * Odebere záznam s daným jménem z otevřené složky, na jeho místo
+ * se přesune poslední záznam a složka se zmenší o jeden záznam
+ *
+ * @param vfs_parrent otevřená rodičovská složka
+ * @param entry_name jméno odebíraného záznamu
+ * @param removed výstup - odebraný záznam (může být NULL)
+ * @return výsledek operace (return < 0: chyba | return == 0: nenalezeno | return > 0: OK)
+ */
+int32_t directory_remove_entry(VFS_FILE *vfs_parrent, char *entry_name, struct directory_entry *removed){
+    if(vfs_parrent == NULL){
+        log_debug("directory_remove_entry: parametr VFS soubor nemuze byt NULL!\n");
+        return -1;
+    }
+
+    if(entry_name == NULL){
+        log_debug("directory_remove_entry: parametr entry_name nemuze byt NULL!\n");
+        return -2;
+    }
+
+    struct vfs_mount *mount = vfs_parrent->mount;
+    struct directory_entry found;
+    int32_t current_index = directory_find_entry(vfs_parrent, entry_name, &found);
 
-        // Nalezeni retezce
-        if(entry->inode_id == 0) {
-            // Máme prázdný inode
-            break;
+    if(current_index < 0){
+        return 0;
+    }
+
+    if(removed != NULL){
+        *removed = found;
+    }
+
+    // Kolik má rodič záznamů
+    int32_t parent_count = (vfs_parrent->inode_ptr->file_size / sizeof(struct directory_entry));
+    int32_t last_parent_entry_index = parent_count - 1;
+    struct dir_index *index = dir_index_find(mount, vfs_parrent->inode_ptr->id);
+
+    /*
+     * Je potřeba posunout záznam
+     * Posouváme poslední záznam na místo mazaného
+     */
+    if(last_parent_entry_index != current_index){
+        int64_t seek = sizeof(struct directory_entry) * last_parent_entry_index;
+        struct directory_entry replace_entry;
+        memset(&replace_entry, 0, sizeof(struct directory_entry));
+
+        // Přečtení poslední entry - z indexu, pokud existuje
+        if(index != NULL && index->count == parent_count){
+            replace_entry = index->entries[last_parent_entry_index];
+        } else {
+            vfs_seek(vfs_parrent, seek, SEEK_SET);
+            vfs_read(&replace_entry, sizeof(struct directory_entry), 1, vfs_parrent);
         }
 
-        curr += sizeof(struct directory_entry);
+        // Seek na zápis
+        int64_t seek_write = sizeof(struct directory_entry) * current_index;
+        vfs_seek(vfs_parrent, seek_write, SEEK_SET);
+        vfs_write(&replace_entry, sizeof(struct directory_entry), 1, vfs_parrent);
+
+        log_debug("directory_remove_entry: Zaznam ve slozce %d presunut na %d\n", last_parent_entry_index, current_index);
     }
 
-    // Nastavení ukazatele
-    vfs_seek(vfs_parrent, curr, SEEK_SET);
-    // Zápis záznamu
-    vfs_write(entry, sizeof(struct directory_entry), 1, vfs_parrent);
+    // Smazání posledního záznamu
+    struct directory_entry empty_entry;
+    memset(&empty_entry, 0, sizeof(struct directory_entry));
+    vfs_seek(vfs_parrent, sizeof(struct directory_entry) * last_parent_entry_index, SEEK_SET);
+    vfs_write(&empty_entry, sizeof(struct directory_entry), 1, vfs_parrent);
 
-    // Uvolnění zdrojů
-    free(read_entry);
+    // Zmenšení velikosti složky o smazaný záznam
+    vfs_parrent->inode_ptr->file_size = vfs_parrent->inode_ptr->file_size - sizeof(struct directory_entry);
+    inode_write_to_index(mount, vfs_parrent->inode_ptr->id - 1, vfs_parrent->inode_ptr);
+
+    // Aktualizace indexu
+    if(index != NULL && (index->count != parent_count || dir_index_remove(index, current_index) != TRUE)){
+        dir_index_drop(mount, vfs_parrent->inode_ptr->id);
+    }
+
+    // Jméno ve složce už neexistuje
+    dentry_insert(mount, vfs_parrent->inode_ptr->id, entry_name, DENTRY_NEGATIVE);
+    dentry_reverse_invalidate(mount, found.inode_id);
+
+    // OK
+    return 1;
+}
+
+/**
+ * Přepíše záznam ".." otevřené složky (přesun složky do jiného rodiče)
+ *
+ * @param vfs_dir otevřená složka
+ * @param parent_id ID inode nové rodičovské složky
+ * @return výsledek operace (return < 0: chyba | return >= 0: OK)
+ */
+int32_t directory_set_parent(VFS_FILE *vfs_dir, int32_t parent_id){
+    if(vfs_dir == NULL){
+        log_debug("directory_set_parent: parametr VFS soubor nemuze byt NULL!\n");
+        return -1;
+    }
+
+    if(vfs_dir->inode_ptr->type != VFS_DIRECTORY){
+        log_debug("directory_set_parent: INODE ID=%d neni slozka!\n", vfs_dir->inode_ptr->id);
+        return -2;
+    }
+
+    struct directory_entry entry;
+    memset(&entry, 0, sizeof(struct directory_entry));
+    strcpy(entry.name, "..");
+    entry.inode_id = parent_id;
+
+    // Záznam rodiče je vždy druhý
+    vfs_seek(vfs_dir, sizeof(struct directory_entry), SEEK_SET);
+
+    if((int64_t)vfs_write(&entry, sizeof(struct directory_entry), 1, vfs_dir) < 0){
+        log_debug("directory_set_parent: Zaznam se nepodarilo zapsat!\n");
+        return -3;
+    }
+
+    struct dir_index *index = dir_index_find(vfs_dir->mount, vfs_dir->inode_ptr->id);
+
+    if(index != NULL && index->count > 1){
+        index->entries[1].inode_id = parent_id;
+    }
+
+    dentry_insert(vfs_dir->mount, vfs_dir->inode_ptr->id, "..", parent_id);
 
     // OK
     return 0;
@@ -397,23 +639,19 @@ int32_t directory_add_entry(VFS_FILE *vfs_parrent, struct directory_entry *entry
  * Od aktuální inode provede přesun přes záznamy rodičů do root složky
  * a po cestě vytvoří cestu
  *
- * @param vfs_filename
+ * @param mount připojený VFS
  * @param inode_id
  * @param entry_name
  * @return
  */
-char *directory_get_path(char *vfs_filename, int32_t inode_id) {
-    if(vfs_filename == NULL){
-        log_debug("directory_get_path: Parametr vfs_filename nemuze byt NULL!\n");
+char *directory_get_path(struct vfs_mount *mount, int32_t inode_id) {
+    if(mount == NULL){
+        log_debug("directory_get_path: VFS neni pripojen!\n");
         return NULL;
     }
 
-    if(strlen(vfs_filename) < 1){
-        log_debug("directory_get_path: Parametr vfs_filename nemuze byt prazdny retezec!\n");
-        return NULL;
-    }
 
-    struct inode *inode_ptr = inode_read_by_index(vfs_filename, inode_id - 1);
+    struct inode *inode_ptr = inode_cache_get(mount, inode_id - 1);
 
     if(inode_ptr == NULL) {
         log_debug("directory_get_path: Inode neexistuje!\n");
@@ -425,89 +663,77 @@ char *directory_get_path(char *vfs_filename, int32_t inode_id) {
     memset(path, 0, sizeof(char) * 1 + 1);
     strcpy(path, "/");
     int32_t curr_inode = inode_id;
-    int32_t prev_inode = inode_id;
-
-    while(1){
-        VFS_FILE *vfs_file = vfs_open_inode(vfs_filename, curr_inode);
-
-        if(vfs_file == NULL){
-            free(inode_ptr);
+    int32_t depth = 0;
+    int32_t max_depth = (int32_t)((mount->superblock_ptr->data_start_address - mount->superblock_ptr->inode_start_address) / inode_record_size(mount));
+
+    // Průchod přes rodiče až do root složky - jméno a rodiče složky bere
+    // ze zpětné mezipaměti, rodiče prohledává jen při jejím výpadku
+    while(curr_inode != 1){
+        char name[sizeof(((struct directory_entry *)0)->name) + 1];
+        int32_t parent_inode = 0;
+        memset(name, 0, sizeof(name));
+
+        // Ochrana proti zacyklení poškozené struktury složek
+        if(depth++ > max_depth){
+            log_debug("directory_get_path: Slozka %d neni dosazitelna z korenove slozky!\n", inode_id);
+            free(path);
+            inode_cache_put(mount, inode_ptr);
             return NULL;
         }
 
-        struct directory_entry *current = malloc(sizeof(struct directory_entry));
-        struct directory_entry *parent = malloc(sizeof(struct directory_entry));
-        memset(current, 0, sizeof(struct directory_entry));
-        memset(parent, 0, sizeof(struct directory_entry));
+        if(dentry_reverse_lookup(mount, curr_inode, &parent_inode, name) != TRUE){
+            parent_inode = directory_get_parent_id(mount, curr_inode);
 
-        vfs_seek(vfs_file, 0, SEEK_SET);
-        vfs_read(current, sizeof(struct directory_entry), 1, vfs_file);
-        vfs_read(parent, sizeof(struct directory_entry), 1, vfs_file);
+            VFS_FILE *vfs_parent = vfs_open_inode(mount, parent_inode);
 
-        // Otevření rodiče a zjištění jména
-        VFS_FILE *vfs_parent = vfs_open_inode(vfs_filename, parent->inode_id);
+            if(vfs_parent == NULL){
+                free(path);
+                inode_cache_put(mount, inode_ptr);
+                return NULL;
+            }
 
-        if(vfs_parent == NULL){
-            free(current);
-            free(parent);
-            vfs_close(vfs_file);
-            free(inode_ptr);
-            return NULL;
-        }
+            // Nalezení jména podle ID - z indexu, nebo z jednoho přečtení celé složky
+            struct dir_index *index = directory_index(vfs_parent);
+            struct directory_entry *entries = NULL;
+            int32_t count = 0;
+            bool mapped = FALSE;
 
-        // Jsme na root složce
-        if(prev_inode == curr_inode && prev_inode == 1) {
-            free(current);
-            free(parent);
-            vfs_close(vfs_file);
-            vfs_close(vfs_parent);
-            break;
-        }
-
-        struct directory_entry *entry = malloc(sizeof(struct directory_entry));
-        int32_t curr = 0;
-        while(curr + sizeof(struct directory_entry) <= vfs_parent->inode_ptr->file_size){
-            memset(entry, 0, sizeof(struct directory_entry));
-            vfs_read(entry, sizeof(struct directory_entry), 1, vfs_parent);
-
-
-            // Nalezeni retezce
-            if(entry->inode_id == curr_inode && curr_inode != 1) {
-                old_ptr = path;
-                path = str_prepend(entry->name, path);
-                free(old_ptr);
-                old_ptr = path;
-                path = str_prepend("/", path);
-                free(old_ptr);
+            if(index != NULL){
+                count = index->count;
+            } else {
+                entries = directory_load_entries(vfs_parent, &count, &mapped);
             }
 
-            // Jsme na root složce
-            if(prev_inode == curr_inode && prev_inode == 1) {
-                old_ptr = path;
-                path = str_prepend("/", path);
-                free(old_ptr);
-                break;
+            int32_t i;
+            for(i = 2; i < count; i++){
+                struct directory_entry *entry = index != NULL ? &index->entries[i] : &entries[i];
+
+                if(entry->inode_id == curr_inode){
+                    memcpy(name, entry->name, sizeof(entry->name));
+                    dentry_reverse_insert(mount, curr_inode, parent_inode, name);
+                    break;
+                }
             }
 
-            curr += sizeof(struct directory_entry);
+            directory_free_entries(entries, mapped);
+            vfs_close(vfs_parent);
         }
-        free(entry);
-
-        // Posun dál
-        prev_inode = curr_inode;
-        curr_inode = parent->inode_id;
-
-
-        free(current);
-        free(parent);
-        vfs_close(vfs_file);
-        vfs_close(vfs_parent);
 
+        if(strlen(name) > 0){
+            old_ptr = path;
+            path = str_prepend(name, path);
+            free(old_ptr);
+            old_ptr = path;
+            path = str_prepend("/", path);
+            free(old_ptr);
+        }
 
+        // Posun dál
+        curr_inode = parent_inode;
     }
 
     // Uvolnění zdrojů
-    free(inode_ptr);
+    inode_cache_put(mount, inode_ptr);
 
     return path;
 }
@@ -515,23 +741,26 @@ char *directory_get_path(char *vfs_filename, int32_t inode_id) {
 /**
  * Zjistí inode rodičovské složky
  *
- * @param vfs_filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_id aktuální složka k získání rodiče
  * @return (return < 1: ERR | return > 0: ID)
  */
-int32_t directory_get_parent_id(char *vfs_filename, int32_t inode_id){
-    if(vfs_filename == NULL){
-        log_debug("directory_get_parent_id(: Parametr vfs_filename nemuze byt NULL!\n");
+int32_t directory_get_parent_id(struct vfs_mount *mount, int32_t inode_id){
+    if(mount == NULL){
+        log_debug("directory_get_parent_id(: VFS neni pripojen!\n");
         return -1;
     }
 
-    if(strlen(vfs_filename) < 1){
-        log_debug("directory_get_parent_id(: Parametr vfs_filename nemuze byt prazdny retezec!\n");
-        return -2;
+    // Rodič je záznam ".." - může být v mezipaměti
+    int32_t cached_id = dentry_lookup(mount, inode_id, "..");
+
+    if(cached_id > 0){
+        return cached_id;
     }
 
+
     // Pokus o otevření souboru
-    VFS_FILE *vfs_file = vfs_open_inode(vfs_filename, inode_id);
+    VFS_FILE *vfs_file = vfs_open_inode(mount, inode_id);
 
     // Nepodařilo se otevřít INODE - pravděpodobně neexistuje
     if(vfs_file == NULL){
@@ -553,6 +782,7 @@ int32_t directory_get_parent_id(char *vfs_filename, int32_t inode_id){
     vfs_read(entry, sizeof(struct directory_entry), 1, vfs_file);
 
     int32_t entry_id = entry->inode_id;
+    dentry_insert(mount, inode_id, "..", entry_id);
 
     // Uvolnění zdrojů
     vfs_close(vfs_file);
@@ -565,23 +795,18 @@ int32_t directory_get_parent_id(char *vfs_filename, int32_t inode_id){
 /**
  * Při nalezení záznamu ve složce vrátí záznam, v opačném případě vrátí NULL
  *
- * @param vfs_filename cesta k VFS souboru
+ * @param mount připojený VFS
  * @param inode_id aktualně prohledávaná složka (její inode ID(
  * @param entry_name hledané jméno
  * @return výsledek operace (struct directory_entry * | NULL)
  */
-struct directory_entry *directory_get_entry(char *vfs_filename, int32_t inode_id ,char *entry_name){
+struct directory_entry *directory_get_entry(struct vfs_mount *mount, int32_t inode_id ,char *entry_name){
     // Ověřování NULL
-    if(vfs_filename == NULL){
-        log_debug("directory_get_entry: Argument vfs_filename nemuze byt NULL!\n");
+    if(mount == NULL){
+        log_debug("directory_get_entry: VFS neni pripojen!\n");
         return NULL;
     }
 
-    // Kontrola délky názvu souboru
-    if(strlen(vfs_filename) < 1){
-        log_debug("directory_get_entry: Argument vfs_filename nemuze byt prazdnym retezcem!\n");
-        return NULL;
-    }
 
     if(inode_id < 1){
         log_debug("directory_get_entry: Soubor s INODE ID=%d nemuze existovat!\n", inode_id);
@@ -598,8 +823,23 @@ struct directory_entry *directory_get_entry(char *vfs_filename, int32_t inode_id
         return NULL;
     }
 
+    // Výsledek už je v mezipaměti (i negativní)
+    int32_t cached_id = dentry_lookup(mount, inode_id, entry_name);
+
+    if(cached_id == DENTRY_NEGATIVE){
+        return NULL;
+    }
+
+    if(cached_id != DENTRY_UNKNOWN){
+        struct directory_entry *cached = malloc(sizeof(struct directory_entry));
+        memset(cached, 0, sizeof(struct directory_entry));
+        strcpy(cached->name, entry_name);
+        cached->inode_id = cached_id;
+        return cached;
+    }
+
     // Ziskani INODE podle ID
-    struct inode *inode_ptr = inode_read_by_index(vfs_filename, inode_id - 1);
+    struct inode *inode_ptr = inode_cache_get(mount, inode_id - 1);
 
     // Ověření ziskani ukazatele na inode
     if(inode_ptr == NULL){
@@ -609,7 +849,7 @@ struct directory_entry *directory_get_entry(char *vfs_filename, int32_t inode_id
 
     // Pokud jde o soubor nelze číst
     if(inode_ptr->type == VFS_FILE_TYPE){
-        free(inode_ptr);
+        inode_cache_put(mount, inode_ptr);
         log_debug("directory_get_entry: Ocekavana slozka, INODE ID=%d je soubor!\n", inode_id);
         return NULL;
     }
@@ -618,32 +858,28 @@ struct directory_entry *directory_get_entry(char *vfs_filename, int32_t inode_id
     // TODO: symlinkovaná složka
 
     // Můžeme číst složku - otevřeme
-    VFS_FILE *vfs_file = vfs_open_inode(vfs_filename, inode_id);
-    // Nastavíme offset na začátek
-    vfs_seek(vfs_file, 0, SEEK_SET);
+    VFS_FILE *vfs_file = vfs_open_inode(mount, inode_id);
+
+    if(vfs_file == NULL){
+        inode_cache_put(mount, inode_ptr);
+        log_debug("directory_get_entry: Nelze otevrit slozku INODE ID=%d!\n", inode_id);
+        return NULL;
+    }
 
     struct directory_entry *entry = malloc(sizeof(struct directory_entry));
-    int32_t curr = 0;
-    while(curr + sizeof(struct directory_entry) <= vfs_file->inode_ptr->file_size){
-        memset(entry, 0, sizeof(struct directory_entry));
-        vfs_read(entry, sizeof(struct directory_entry), 1, vfs_file);
-
-        // Nalezeni retezce
-        if(strcmp(entry->name, entry_name) == 0) {
-            free(inode_ptr);
-            vfs_close(vfs_file);
-            return entry;
-        }
+    memset(entry, 0, sizeof(struct directory_entry));
 
-        curr += sizeof(struct directory_entry);
+    if(directory_find_entry(vfs_file, entry_name, entry) < 0){
+        // Nepodařilo se nalézt entry s daným jménem;
+        free(entry);
+        entry = NULL;
     }
 
-    // Nepodařilo se nalézt entry s daným jménem;
-    vfs_close(vfs_file);
-    free(inode_ptr);
-    free(entry);
-    return NULL;
+    dentry_insert(mount, inode_id, entry_name, entry != NULL ? entry->inode_id : DENTRY_NEGATIVE);
 
+    vfs_close(vfs_file);
+    inode_cache_put(mount, inode_ptr);
+    return entry;
 }
 
 /**
@@ -652,28 +888,18 @@ struct directory_entry *directory_get_entry(char *vfs_filename, int32_t inode_id
  * Pokud složka je prázdná, dealokují se databloky (včetně
  * uvolnění bitmapy a inode index se označí jako volný
  *
- * @param vfs_filename CESTA k VFS souboru
+ * @param mount připojený VFS
  * @param path cesta uvnitř VFS souboru
  * @return (return < 0: chyba | return = 0: OK | return >0: Message)
  */
-int32_t directory_delete(char *vfs_filename, char *path){
+int32_t directory_delete(struct vfs_mount *mount, char *path){
     // Ověřování NULL
-    if(vfs_filename == NULL){
-        log_debug("directory_delete: Argument vfs_filename nemuze byt NULL!\n");
+    if(mount == NULL){
+        log_debug("directory_delete: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Kontrola délky názvu souboru
-    if(strlen(vfs_filename) < 1){
-        log_debug("directory_delete: Argument vfs_filename nemuze byt prazdnym retezcem!\n");
-        return -2;
-    }
 
-    // Ověření existence souboru
-    if(file_exist(vfs_filename) != TRUE){
-        log_debug("directory_delete: Cesta k souboru VFS neexistuje!\n");
-        return -3;
-    }
 
     // Ověřování NULL pro cestu
     if(path == NULL){
@@ -688,7 +914,7 @@ int32_t directory_delete(char *vfs_filename, char *path){
     }
 
     // Pokus o otevření souboru
-    VFS_FILE *vfs_file = vfs_open(vfs_filename, path);
+    VFS_FILE *vfs_file = vfs_open(mount, path);
 
     // Soubor se nepodařilo otevřít
     if(vfs_file == NULL){
@@ -705,10 +931,10 @@ int32_t directory_delete(char *vfs_filename, char *path){
 
 
     // ID rodičovské složky
-    int32_t parent_id = directory_get_parent_id(vfs_filename, vfs_file->inode_ptr->id);
+    int32_t parent_id = directory_get_parent_id(mount, vfs_file->inode_ptr->id);
 
     // Otevření rodičovské složky
-    VFS_FILE *vfs_parent = vfs_open_inode(vfs_filename, parent_id);
+    VFS_FILE *vfs_parent = vfs_open_inode(mount, parent_id);
 
     // Počet podsložek a souborů ve složce
     int32_t count = (vfs_file->inode_ptr->file_size / sizeof(struct directory_entry)) - 2;
@@ -721,73 +947,22 @@ int32_t directory_delete(char *vfs_filename, char *path){
         return 3;
     }
 
-    // Zjištění kolikátý entry je slozka v rodiči
+    // Odebrání záznamu složky z rodiče
     char *folder_name = get_suffix_string_after_last_character(path, "/");
+    directory_remove_entry(vfs_parent, folder_name, NULL);
 
-    // Alokace dat pro entry
-    struct directory_entry *entry = malloc(sizeof(struct directory_entry));
-
-    // Čtení directory entry do velikosti souboru
-    int32_t current_index = 0;
-    int32_t current = 0;
-    while(current + sizeof(struct directory_entry) <= vfs_parent->inode_ptr->file_size){
-        memset(entry, 0, sizeof(struct directory_entry));
-        vfs_read(entry, sizeof(struct directory_entry), 1, vfs_parent);
-
-       if(entry->inode_id == vfs_file->inode_ptr->id){
-            break;
-        }
-
-        // Posun na další prvek - vlastně jen pro podmínku, SEEK se upravuje v VFS_READ
-        current += sizeof(struct directory_entry);
-        current_index = current_index + 1;
-    }
-    free(entry);
-
-    // Kolik má rodič záznamů
-    int32_t parent_count = (vfs_parent->inode_ptr->file_size / sizeof(struct directory_entry));
-    int32_t last_parent_entry_index = parent_count - 1;
-
-    /*
-     * Je potřeba posunout záznam
-     * Posouváme poslední záznam na místo mazaného
-     * Zmenšujeme velikost složky o 1 entry
-     */
-    if(last_parent_entry_index != current_index){
-        int64_t seek = sizeof(struct directory_entry) * last_parent_entry_index;
-        vfs_seek(vfs_parent, seek, SEEK_SET);
-
-        // Přečtení poslední entry
-        struct directory_entry *replace_entry = malloc(sizeof(struct directory_entry));
-        memset(replace_entry, 0, sizeof(struct directory_entry));
-        vfs_read(replace_entry, sizeof(struct directory_entry), 1, vfs_parent);
-
-        // Seek na zápis
-        int64_t seek_write = sizeof(struct directory_entry) * current_index;
-        vfs_seek(vfs_parent, seek_write, SEEK_SET);
-        vfs_write(replace_entry, sizeof(struct directory_entry), 1, vfs_parent);
-
-        // Smazání staré entry
-        vfs_seek(vfs_parent, seek, SEEK_SET);
-        memset(replace_entry, 0, sizeof(struct directory_entry));
-        vfs_write(replace_entry, sizeof(struct directory_entry), 1, vfs_parent);
-
-        log_debug("directory_delete: Zaznam ve slozce %d presunut na %d\n", last_parent_entry_index, current_index);
-
-        // Zmensen velikosti slozky o smazany zaznam
-        vfs_parent->inode_ptr->file_size = vfs_parent->inode_ptr->file_size - sizeof(struct directory_entry);
-        inode_write_to_index(vfs_filename, vfs_parent->inode_ptr->id - 1, vfs_parent->inode_ptr);
-
-        free(replace_entry);
-    }
+    // Index a záznamy mezipaměti mazané složky už nebudou platné
+    dir_index_drop(mount, vfs_file->inode_ptr->id);
+    dentry_invalidate_dir(mount, vfs_file->inode_ptr->id);
 
     // Dealokování všech dat v INODE
-    int32_t  dealloc_result = deallocate(vfs_filename, vfs_file->inode_ptr);
+    int32_t  dealloc_result = deallocate(mount, vfs_file->inode_ptr);
+    vfs_block_map_invalidate(vfs_file);
 
     // Smazat inode
     struct inode *empty_inode = malloc(sizeof(struct inode));
     memset(empty_inode, 0, sizeof(struct inode));
-    inode_write_to_index(vfs_filename, vfs_file->inode_ptr->id - 1, empty_inode);
+    inode_write_to_index(mount, vfs_file->inode_ptr->id - 1, empty_inode);
 
     // Uvolnění zdrojů
     vfs_close(vfs_file);
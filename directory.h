@@ -12,6 +12,9 @@
  *          .   aktuální soubor
  *         ..   rodič (u root - . a .. stejné)
  *         [254 dalších záznamů]
+ *
+ *      záznamy jsou souvislé, velké složky (více než 1 cluster) mají
+ *      v připojeném VFS hashovaný index jméno -> pozice (dir_index.h)
  */
 
 // Strukturovaný záznam souboru ve složce
@@ -23,11 +26,11 @@ struct directory_entry {
 /**
  * Vytvoří ve VFS novou složku
  *
- * @param vfs_filename cesta k VFS souboru
+ * @param mount připojený VFS
  * @param path cesta uvnitř VFS
  * @return výsledek operace (return < 0: chyba | return >=0: OK)
  */
-int32_t directory_create(char *vfs_filename, char *path);
+int32_t directory_create(struct vfs_mount *mount, char *path);
 
 /**
  * Ověří zda cesta ke složkce existuje, pokud existuje
@@ -35,72 +38,91 @@ int32_t directory_create(char *vfs_filename, char *path);
  * Pokud složka je prázdná, dealokují se databloky (včetně
  * uvolnění bitmapy a inode index se označí jako volný
  *
- * @param vfs_filename CESTA k VFS souboru
+ * @param mount připojený VFS
  * @param path cesta uvnitř VFS souboru
  * @return (return < 0: chyba | return = 0: OK | return >0: Message)
  */
-int32_t directory_delete(char *vfs_filename, char *path);
+int32_t directory_delete(struct vfs_mount *mount, char *path);
 
 
 /**
  * Vypíše obsah složky ve VFS s danou cestou (příkaz LS)
- * @param vfs_filename cesta k VFS souboru
+ * @param mount připojený VFS
  * @param path cesta uvnitř VFS
  * @return výsledek operace (return < 0: chyba | return >=0: OK)
  */
-int32_t directory_entries_print(char *vfs_filename, char *path);
+int32_t directory_entries_print(struct vfs_mount *mount, char *path);
 
 /**
  * Při nalezení záznamu ve složce vrátí INODE ID záznamu, v opačném případě vrátí
  * hodnotu menší než 1
  *
- * @param vfs_filename cesta k VFS souboru
+ * @param mount připojený VFS
  * @param inode_id aktualně prohledávaná složka (její inode ID(
  * @param entry_name hledané jméno
  * @return výsledek operace (return < 0: chyba | return==0: Nenalezeno | return >0: Nalezeno)
  */
-int32_t directory_has_entry(char *vfs_filename, int32_t inode_id ,char *entry_name);
+int32_t directory_has_entry(struct vfs_mount *mount, int32_t inode_id ,char *entry_name);
 
 /**
  * Přidá záznam directory_entry do souboru
  *
- * @param vfs_filename cesta k VFS souboru
- * @param path cesta uvnitř VFS
+ * @param vfs_parrent otevřená rodičovská složka
  * @param entry zapisovaný záznam
  * @return výsledek operace (return < 0: chyba | return >= 0: OK)
  */
 int32_t directory_add_entry(VFS_FILE *vfs_parrent, struct directory_entry *entry);
 
+/**
+ * Odebere záznam s daným jménem z otevřené složky, na jeho místo
+ * se přesune poslední záznam a složka se zmenší o jeden záznam
+ *
+ * @param vfs_parrent otevřená rodičovská složka
+ * @param entry_name jméno odebíraného záznamu
+ * @param removed výstup - odebraný záznam (může být NULL)
+ * @return výsledek operace (return < 0: chyba | return == 0: nenalezeno | return > 0: OK)
+ */
+int32_t directory_remove_entry(VFS_FILE *vfs_parrent, char *entry_name, struct directory_entry *removed);
+
+
+/**
+ * Přepíše záznam ".." otevřené složky (přesun složky do jiného rodiče)
+ *
+ * @param vfs_dir otevřená složka
+ * @param parent_id ID inode nové rodičovské složky
+ * @return výsledek operace (return < 0: chyba | return >= 0: OK)
+ */
+int32_t directory_set_parent(VFS_FILE *vfs_dir, int32_t parent_id);
 
 /**
  * Od aktuální inode provede přesun přes záznamy rodičů do root složky
  * a po cestě vytvoří cestu
  *
- * @param vfs_filename
+ * @param mount připojený VFS
  * @param inode_id
  * @param entry_name
  * @return
  */
-char *directory_get_path(char *vfs_filename, int32_t inode_id);
+char *directory_get_path(struct vfs_mount *mount, int32_t inode_id);
 
 /**
  * Zjistí inode rodičovské složky
  *
- * @param vfs_filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_id aktuální složka k získání rodiče
  * @return (return < 1: ERR | return > 0: ID)
  */
-int32_t directory_get_parent_id(char *vfs_filename, int32_t inode_id);
+int32_t directory_get_parent_id(struct vfs_mount *mount, int32_t inode_id);
 
 /**
  * Při nalezení záznamu ve složce vrátí záznam, v opačném případě vrátí NULL
  *
- * @param vfs_filename cesta k VFS souboru
+ * @param mount připojený VFS
  * @param inode_id aktualně prohledávaná složka (její inode ID(
  * @param entry_name hledané jméno
  * @return výsledek operace (struct directory_entry * | NULL)
  */
-struct directory_entry *directory_get_entry(char *vfs_filename, int32_t inode_id ,char *entry_name);
+struct directory_entry *directory_get_entry(struct vfs_mount *mount, int32_t inode_id ,char *entry_name);
 
 
 
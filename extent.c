@@ -0,0 +1,858 @@
+#include "extent.h"
+#include <string.h>
+#include <stdlib.h>
+#include "debug.h"
+#include "superblock.h"
+#include "bitmap.h"
+#include "allocation.h"
+
+/**
+ * Vrátí počet extentů, které se vejdou do jednoho listu
+ *
+ * @param mount připojený VFS
+ * @return počet extentů v listu
+ */
+static int32_t extent_per_leaf(struct vfs_mount *mount){
+    return mount->superblock_ptr->cluster_size / (int32_t)sizeof(struct inode_extent_disk);
+}
+
+/**
+ * Vrátí počet extentů uložených přímo v i-uzlu
+ *
+ * @param inode_ptr struktura inode
+ * @return počet extentů v i-uzlu
+ */
+static int32_t extent_inline_count(struct inode *inode_ptr){
+    int32_t count = 0;
+
+    while(count < INODE_INLINE_EXTENTS && inode_ptr->extents[count].length > 0){
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Převede extent uložený ve VFS na strukturu inode_extent
+ *
+ * @param mount připojený VFS
+ * @param disk extent uložený ve VFS
+ * @param extent cílová struktura
+ */
+static void extent_decode(struct vfs_mount *mount, struct inode_extent_disk *disk, struct inode_extent *extent){
+    extent->logical = disk->logical;
+    extent->length = disk->length;
+    extent->address = inode_pointer_to_address(mount, disk->cluster);
+}
+
+/**
+ * Převede strukturu inode_extent na extent ukládaný do VFS
+ *
+ * @param mount připojený VFS
+ * @param extent převáděná struktura
+ * @param disk cílový extent
+ */
+static void extent_encode(struct vfs_mount *mount, struct inode_extent *extent, struct inode_extent_disk *disk){
+    disk->logical = extent->logical;
+    disk->length = extent->length;
+    disk->cluster = inode_address_to_pointer(mount, extent->address);
+}
+
+/**
+ * Alokuje a vynuluje cluster pro blok indexu nebo list extentů
+ *
+ * @param mount připojený VFS
+ * @return (return < 0: chyba | return > 0: adresa clusteru)
+ */
+static int64_t extent_alloc_block(struct vfs_mount *mount){
+    int32_t index = bitmap_find_free_cluster_index(mount);
+
+    if(index < 0){
+        log_debug("extent_alloc_block: Nedostatek volnych clusteru!\n");
+        return -1;
+    }
+
+    int64_t address = bitmap_index_to_cluster_address(mount, index);
+    bitmap_set(mount, index, 1, TRUE);
+    allocation_clear_cluster(mount, address);
+
+    return address;
+}
+
+/**
+ * Uvolní cluster bloku indexu nebo listu extentů
+ *
+ * @param mount připojený VFS
+ * @param address adresa clusteru
+ */
+static void extent_release_block(struct vfs_mount *mount, int64_t address){
+    int32_t index = inode_data_index_from_address(mount, address);
+
+    if(index >= 0){
+        bitmap_set(mount, index, 1, FALSE);
+    }
+}
+
+/**
+ * Najde extent, který obsahuje daný index databloku
+ *
+ * @param extents pole extentů seřazené podle logického indexu
+ * @param count počet extentů
+ * @param index index databloku v souboru
+ * @return (return < 0: index není v žádném extentu | return >= 0: pozice extentu)
+ */
+static int32_t extent_find(struct inode_extent *extents, int32_t count, int32_t index){
+    int32_t low = 0;
+    int32_t high = count - 1;
+
+    while(low <= high){
+        int32_t middle = low + (high - low) / 2;
+
+        if(index < extents[middle].logical){
+            high = middle - 1;
+        } else if(index - extents[middle].logical >= extents[middle].length){
+            low = middle + 1;
+        } else {
+            return middle;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Spojí sousední extenty, které na sebe navazují logicky i fyzicky
+ *
+ * @param mount připojený VFS
+ * @param extents pole extentů seřazené podle logického indexu
+ * @param count počet extentů
+ * @return počet extentů po spojení
+ */
+static int32_t extent_merge(struct vfs_mount *mount, struct inode_extent *extents, int32_t count){
+    int32_t merged = 0;
+    int32_t i;
+
+    for(i = 0; i < count; i++){
+        if(extents[i].length < 1){
+            continue;
+        }
+
+        if(merged > 0){
+            struct inode_extent *last = &extents[merged - 1];
+
+            if(last->logical + last->length == extents[i].logical
+               && last->address + ((int64_t)last->length << mount->cluster_shift) == extents[i].address
+               && last->length <= INT32_MAX - extents[i].length){
+                last->length += extents[i].length;
+                continue;
+            }
+        }
+
+        extents[merged++] = extents[i];
+    }
+
+    return merged;
+}
+
+/**
+ * Uloží všechny extenty i-uzlu - alokuje chybějící listy a uvolní přebytečné
+ *
+ * Pokud nelze alokovat potřebné listy, nezmění se nic
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param extents pole extentů seřazené podle logického indexu
+ * @param count počet extentů
+ * @return (return < 0: chyba | 0: OK)
+ */
+static int32_t extent_store(struct vfs_mount *mount, struct inode *inode_ptr, struct inode_extent *extents, int32_t count){
+    if(count > extent_max_count(mount)){
+        log_debug("extent_store: Inode ID=%d by mel prilis mnoho extentu (%d)!\n", inode_ptr->id, count);
+        return -1;
+    }
+
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int32_t per_leaf = extent_per_leaf(mount);
+    int32_t leaves = count > INODE_INLINE_EXTENTS ? (count - INODE_INLINE_EXTENTS + per_leaf - 1) / per_leaf : 0;
+
+    int32_t *index_block = malloc(cluster_size);
+    bool *fresh = malloc(sizeof(bool) * (leaves > 0 ? leaves : 1));
+    memset(index_block, 0, cluster_size);
+    memset(fresh, 0, sizeof(bool) * (leaves > 0 ? leaves : 1));
+
+    int64_t index_address = inode_ptr->extent_block;
+    bool index_fresh = FALSE;
+
+    if(index_address != 0){
+        mount_read(mount, index_address, index_block, cluster_size);
+    } else if(leaves > 0){
+        index_address = extent_alloc_block(mount);
+        index_fresh = TRUE;
+
+        if(index_address < 0){
+            free(fresh);
+            free(index_block);
+            return -2;
+        }
+    }
+
+    // Alokace chybějících listů
+    int32_t i;
+    for(i = 0; i < leaves; i++){
+        if(index_block[1 + i] != 0){
+            continue;
+        }
+
+        int64_t leaf_address = extent_alloc_block(mount);
+
+        if(leaf_address < 0){
+            // Vrácení nově alokovaných bloků
+            int32_t j;
+            for(j = 0; j < i; j++){
+                if(fresh[j] == TRUE){
+                    extent_release_block(mount, inode_pointer_to_address(mount, index_block[1 + j]));
+                }
+            }
+
+            if(index_fresh == TRUE){
+                extent_release_block(mount, index_address);
+            }
+
+            free(fresh);
+            free(index_block);
+            return -2;
+        }
+
+        index_block[1 + i] = inode_address_to_pointer(mount, leaf_address);
+        fresh[i] = TRUE;
+    }
+
+    // Zápis listů
+    struct inode_extent_disk *leaf = malloc(cluster_size);
+    for(i = 0; i < leaves; i++){
+        memset(leaf, 0, cluster_size);
+
+        int32_t slot;
+        for(slot = 0; slot < per_leaf; slot++){
+            int32_t position = INODE_INLINE_EXTENTS + i * per_leaf + slot;
+
+            if(position >= count){
+                break;
+            }
+
+            extent_encode(mount, &extents[position], &leaf[slot]);
+        }
+
+        mount_write(mount, inode_pointer_to_address(mount, index_block[1 + i]), leaf, cluster_size);
+    }
+
+    // Uvolnění přebytečných listů
+    for(i = leaves; i < mount->pointers_per_block - 1; i++){
+        if(index_block[1 + i] != 0){
+            extent_release_block(mount, inode_pointer_to_address(mount, index_block[1 + i]));
+            index_block[1 + i] = 0;
+        }
+    }
+
+    if(leaves > 0){
+        index_block[0] = count;
+        mount_write(mount, index_address, index_block, cluster_size);
+        inode_ptr->extent_block = index_address;
+    } else {
+        if(index_address != 0){
+            extent_release_block(mount, index_address);
+        }
+
+        inode_ptr->extent_block = 0;
+    }
+
+    // Extenty uložené přímo v i-uzlu
+    memset(inode_ptr->extents, 0, sizeof(inode_ptr->extents));
+    for(i = 0; i < count && i < INODE_INLINE_EXTENTS; i++){
+        inode_ptr->extents[i] = extents[i];
+    }
+
+    inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
+
+    free(leaf);
+    free(fresh);
+    free(index_block);
+    return 0;
+}
+
+/**
+ * Vrátí počet extentů, které lze uložit do jednoho i-uzlu
+ *
+ * @param mount připojený VFS
+ * @return maximální počet extentů i-uzlu
+ */
+int32_t extent_max_count(struct vfs_mount *mount){
+    int64_t count = INODE_INLINE_EXTENTS + (int64_t)(mount->pointers_per_block - 1) * extent_per_leaf(mount);
+
+    return count > INT32_MAX ? INT32_MAX : (int32_t)count;
+}
+
+/**
+ * Načte všechny extenty i-uzlu do nově alokovaného pole
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param extents výstup - pole extentů (uvolní volající)
+ * @return (return < 0: chyba | return >= 0: počet extentů)
+ */
+int32_t extent_load(struct vfs_mount *mount, struct inode *inode_ptr, struct inode_extent **extents){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatelů
+    if(inode_ptr == NULL || extents == NULL){
+        return -2;
+    }
+
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int32_t count = extent_inline_count(inode_ptr);
+    int32_t *index_block = NULL;
+
+    // Další extenty jsou v listech bloku indexu
+    if(inode_ptr->extent_block != 0){
+        index_block = malloc(cluster_size);
+        memset(index_block, 0, cluster_size);
+        mount_read(mount, inode_ptr->extent_block, index_block, cluster_size);
+        count = index_block[0];
+
+        if(count < INODE_INLINE_EXTENTS || count > extent_max_count(mount)){
+            log_debug("extent_load: Inode ID=%d ma neplatny pocet extentu %d!\n", inode_ptr->id, count);
+            free(index_block);
+            return -3;
+        }
+    }
+
+    *extents = malloc(sizeof(struct inode_extent) * (count > 0 ? count : 1));
+
+    if(*extents == NULL){
+        free(index_block);
+        return -4;
+    }
+
+    int32_t i;
+    for(i = 0; i < count && i < INODE_INLINE_EXTENTS; i++){
+        (*extents)[i] = inode_ptr->extents[i];
+    }
+
+    if(index_block != NULL){
+        int32_t per_leaf = extent_per_leaf(mount);
+        struct inode_extent_disk *leaf = malloc(cluster_size);
+
+        for(i = INODE_INLINE_EXTENTS; i < count; i++){
+            int32_t position = i - INODE_INLINE_EXTENTS;
+            int32_t slot = position % per_leaf;
+
+            // Každý list se čte celý jedním čtením
+            if(slot == 0){
+                int64_t leaf_address = inode_pointer_to_address(mount, index_block[1 + position / per_leaf]);
+                memset(leaf, 0, cluster_size);
+
+                if(leaf_address != 0){
+                    mount_read(mount, leaf_address, leaf, cluster_size);
+                }
+            }
+
+            extent_decode(mount, &leaf[slot], &(*extents)[i]);
+        }
+
+        free(leaf);
+        free(index_block);
+    }
+
+    return count;
+}
+
+/**
+ * Připojí datablok na konec souboru - prodlouží poslední extent, nebo založí nový
+ *
+ * Nemění allocated_clusters ani bitmapu databloku (viz inode_add_data_address)
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param address adresa databloku
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t extent_append(struct vfs_mount *mount, struct inode *inode_ptr, int64_t address){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatele na inode
+    if(inode_ptr == NULL){
+        return -2;
+    }
+
+    int32_t logical = inode_ptr->allocated_clusters;
+    int32_t per_leaf = extent_per_leaf(mount);
+    int32_t count = extent_inline_count(inode_ptr);
+
+    if(inode_ptr->extent_block != 0){
+        mount_read(mount, inode_ptr->extent_block, &count, sizeof(int32_t));
+    }
+
+    // Poslední extent souboru
+    struct inode_extent last;
+    int64_t last_address = 0;
+    memset(&last, 0, sizeof(struct inode_extent));
+
+    if(count > 0 && count <= INODE_INLINE_EXTENTS){
+        last = inode_ptr->extents[count - 1];
+    } else if(count > INODE_INLINE_EXTENTS){
+        int32_t position = count - 1 - INODE_INLINE_EXTENTS;
+        int64_t leaf_address = inode_read_pointer(mount, inode_ptr->extent_block + sizeof(int32_t) * (1 + position / per_leaf));
+
+        if(leaf_address == 0){
+            log_debug("extent_append: Inode ID=%d nema list posledniho extentu!\n", inode_ptr->id);
+            return -3;
+        }
+
+        struct inode_extent_disk disk;
+        last_address = leaf_address + (int64_t)(position % per_leaf) * sizeof(struct inode_extent_disk);
+        mount_read(mount, last_address, &disk, sizeof(struct inode_extent_disk));
+        extent_decode(mount, &disk, &last);
+    }
+
+    // Datablok navazuje na poslední extent - ten se pouze prodlouží
+    if(count > 0 && last.logical + last.length == logical && last.length < INT32_MAX
+       && last.address + ((int64_t)last.length << mount->cluster_shift) == address){
+        last.length++;
+
+        if(last_address == 0){
+            inode_ptr->extents[count - 1] = last;
+        } else {
+            struct inode_extent_disk disk;
+            extent_encode(mount, &last, &disk);
+            mount_write(mount, last_address, &disk, sizeof(struct inode_extent_disk));
+        }
+
+        return 0;
+    }
+
+    struct inode_extent extent;
+    extent.logical = logical;
+    extent.length = 1;
+    extent.address = address;
+
+    // Volné místo v i-uzlu
+    if(count < INODE_INLINE_EXTENTS){
+        inode_ptr->extents[count] = extent;
+        return 0;
+    }
+
+    if(count >= extent_max_count(mount)){
+        log_debug("extent_append: Inode ID=%d nema misto pro dalsi extent!\n", inode_ptr->id);
+        return -8;
+    }
+
+    // Blok indexu se alokuje s prvním extentem mimo i-uzel
+    bool index_fresh = FALSE;
+    if(inode_ptr->extent_block == 0){
+        int64_t index_address = extent_alloc_block(mount);
+
+        if(index_address < 0){
+            return -5;
+        }
+
+        inode_ptr->extent_block = index_address;
+        index_fresh = TRUE;
+    }
+
+    int32_t position = count - INODE_INLINE_EXTENTS;
+    int64_t leaf_pointer = inode_ptr->extent_block + sizeof(int32_t) * (1 + position / per_leaf);
+    int64_t leaf_address = inode_read_pointer(mount, leaf_pointer);
+
+    if(leaf_address == 0){
+        leaf_address = extent_alloc_block(mount);
+
+        if(leaf_address < 0){
+            if(index_fresh == TRUE){
+                extent_release_block(mount, inode_ptr->extent_block);
+                inode_ptr->extent_block = 0;
+            }
+
+            return -6;
+        }
+
+        inode_write_pointer(mount, leaf_pointer, leaf_address);
+    }
+
+    struct inode_extent_disk disk;
+    extent_encode(mount, &extent, &disk);
+    mount_write(mount, leaf_address + (int64_t)(position % per_leaf) * sizeof(struct inode_extent_disk), &disk, sizeof(struct inode_extent_disk));
+
+    count++;
+    mount_write(mount, inode_ptr->extent_block, &count, sizeof(int32_t));
+
+    log_trace("extent_append: Inode ID=%d ma novy extent %d (index %d, adresa %ld)\n", inode_ptr->id, count - 1, logical, (long)address);
+    return 0;
+}
+
+/**
+ * Získá adresu databloku na daném indexu souboru
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param index index databloku v souboru
+ * @return (return < 0: chyba | 0: datablok není | return > 0: adresa databloku)
+ */
+int64_t extent_get(struct vfs_mount *mount, struct inode *inode_ptr, int32_t index){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatele na inode
+    if(inode_ptr == NULL){
+        return -2;
+    }
+
+    // Extenty v i-uzlu - bez čtení z VFS
+    int32_t position = extent_find(inode_ptr->extents, extent_inline_count(inode_ptr), index);
+    if(position >= 0){
+        struct inode_extent *extent = &inode_ptr->extents[position];
+        return extent->address + ((int64_t)(index - extent->logical) << mount->cluster_shift);
+    }
+
+    if(inode_ptr->extent_block == 0){
+        return 0;
+    }
+
+    struct inode_extent *extents = NULL;
+    int32_t count = extent_load(mount, inode_ptr, &extents);
+
+    if(count < 0){
+        return count;
+    }
+
+    int64_t address = 0;
+    position = extent_find(extents, count, index);
+
+    if(position >= 0){
+        address = extents[position].address + ((int64_t)(index - extents[position].logical) << mount->cluster_shift);
+    }
+
+    free(extents);
+    return address;
+}
+
+/**
+ * Načte adresy databloků s indexy <from, count) do pole map
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param map cílové pole adres (alespoň count položek)
+ * @param from první načítaný index
+ * @param count index za posledním načítaným indexem
+ * @return (return < 0: chyba | return >= 0: počet načtených adres)
+ */
+int32_t extent_load_block_map(struct vfs_mount *mount, struct inode *inode_ptr, int64_t *map, int32_t from, int32_t count){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatelů
+    if(inode_ptr == NULL || map == NULL){
+        return -2;
+    }
+
+    if(count > inode_ptr->allocated_clusters){
+        count = inode_ptr->allocated_clusters;
+    }
+
+    if(from >= count){
+        return 0;
+    }
+
+    struct inode_extent *extents = NULL;
+    int32_t extent_count = extent_load(mount, inode_ptr, &extents);
+
+    if(extent_count < 0){
+        return extent_count;
+    }
+
+    memset(map + from, 0, sizeof(int64_t) * (count - from));
+
+    int32_t i;
+    for(i = 0; i < extent_count; i++){
+        int32_t start = extents[i].logical > from ? extents[i].logical : from;
+        int32_t end = extents[i].logical + extents[i].length;
+
+        if(end > count){
+            end = count;
+        }
+
+        int32_t index;
+        for(index = start; index < end; index++){
+            map[index] = extents[i].address + ((int64_t)(index - extents[i].logical) << mount->cluster_shift);
+        }
+    }
+
+    free(extents);
+    return count - from;
+}
+
+/**
+ * Přepíše adresu databloku na daném indexu souboru, extent se případně rozdělí
+ *
+ * Index v díře dostane nový extent, adresa 0 z indexu udělá díru
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param index index databloku v souboru
+ * @param address nová adresa databloku (0 = díra)
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t extent_set(struct vfs_mount *mount, struct inode *inode_ptr, int32_t index, int64_t address){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatele na inode
+    if(inode_ptr == NULL){
+        return -2;
+    }
+
+    if(address == 0){
+        return extent_punch(mount, inode_ptr, index, 1);
+    }
+
+    struct inode_extent *extents = NULL;
+    int32_t count = extent_load(mount, inode_ptr, &extents);
+
+    if(count < 0){
+        return count;
+    }
+
+    int32_t position = extent_find(extents, count, index);
+    struct inode_extent *split = malloc(sizeof(struct inode_extent) * (count + 2));
+    int32_t split_count = 0;
+
+    // Zápis do díry - nový extent se vloží podle logického indexu
+    if(position < 0){
+        int32_t insert = 0;
+        while(insert < count && extents[insert].logical < index){
+            insert++;
+        }
+
+        memcpy(split, extents, sizeof(struct inode_extent) * insert);
+        split[insert].logical = index;
+        split[insert].length = 1;
+        split[insert].address = address;
+        memcpy(split + insert + 1, extents + insert, sizeof(struct inode_extent) * (count - insert));
+        split_count = extent_merge(mount, split, count + 1);
+
+        int32_t result = extent_store(mount, inode_ptr, split, split_count);
+
+        if(result == 0){
+            log_trace("extent_set: Dira %d inode ID=%d zaplnena adresou %ld (%d extentu)\n", index, inode_ptr->id, (long)address, split_count);
+        }
+
+        free(split);
+        free(extents);
+        return result;
+    }
+
+    // Extent se rozdělí až na tři části: před indexem, index, za indexem
+    struct inode_extent extent = extents[position];
+
+    memcpy(split, extents, sizeof(struct inode_extent) * position);
+    split_count = position;
+
+    if(index > extent.logical){
+        split[split_count].logical = extent.logical;
+        split[split_count].length = index - extent.logical;
+        split[split_count].address = extent.address;
+        split_count++;
+    }
+
+    split[split_count].logical = index;
+    split[split_count].length = 1;
+    split[split_count].address = address;
+    split_count++;
+
+    if(index < extent.logical + extent.length - 1){
+        split[split_count].logical = index + 1;
+        split[split_count].length = extent.logical + extent.length - index - 1;
+        split[split_count].address = extent.address + ((int64_t)(index + 1 - extent.logical) << mount->cluster_shift);
+        split_count++;
+    }
+
+    memcpy(split + split_count, extents + position + 1, sizeof(struct inode_extent) * (count - position - 1));
+    split_count += count - position - 1;
+
+    // Nový datablok může navázat na sousední extent
+    split_count = extent_merge(mount, split, split_count);
+
+    int32_t result = extent_store(mount, inode_ptr, split, split_count);
+
+    if(result == 0){
+        log_trace("extent_set: Odkaz %d inode ID=%d prepsan na %ld (%d extentu)\n", index, inode_ptr->id, (long)address, split_count);
+    }
+
+    free(split);
+    free(extents);
+    return result;
+}
+
+/**
+ * Vyjme databloky s indexy <from, from + count) z extentů - vznikne díra
+ *
+ * Databloky zůstanou alokovány, uvolní je volající
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param from první index díry
+ * @param count počet databloků
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t extent_punch(struct vfs_mount *mount, struct inode *inode_ptr, int32_t from, int32_t count){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatele na inode
+    if(inode_ptr == NULL){
+        return -2;
+    }
+
+    if(from < 0 || count < 1){
+        return 0;
+    }
+
+    struct inode_extent *extents = NULL;
+    int32_t extent_count = extent_load(mount, inode_ptr, &extents);
+
+    if(extent_count < 0){
+        return extent_count;
+    }
+
+    // Rozdělením jednoho extentu může přibýt nejvýše jeden extent
+    struct inode_extent *trimmed = malloc(sizeof(struct inode_extent) * (extent_count + 1));
+    int64_t end = (int64_t)from + count;
+    int32_t trimmed_count = 0;
+    int32_t i;
+
+    for(i = 0; i < extent_count; i++){
+        struct inode_extent extent = extents[i];
+        int64_t extent_end = (int64_t)extent.logical + extent.length;
+
+        // Extent mimo díru zůstává
+        if(extent_end <= from || extent.logical >= end){
+            trimmed[trimmed_count++] = extent;
+            continue;
+        }
+
+        // Část před dírou
+        if(extent.logical < from){
+            trimmed[trimmed_count].logical = extent.logical;
+            trimmed[trimmed_count].length = from - extent.logical;
+            trimmed[trimmed_count].address = extent.address;
+            trimmed_count++;
+        }
+
+        // Část za dírou
+        if(extent_end > end){
+            trimmed[trimmed_count].logical = (int32_t)end;
+            trimmed[trimmed_count].length = (int32_t)(extent_end - end);
+            trimmed[trimmed_count].address = extent.address + ((end - extent.logical) << mount->cluster_shift);
+            trimmed_count++;
+        }
+    }
+
+    int32_t result = extent_store(mount, inode_ptr, trimmed, trimmed_count);
+
+    if(result == 0){
+        log_trace("extent_punch: Inode ID=%d ma diru %d+%d (%d extentu)\n", inode_ptr->id, from, count, trimmed_count);
+    }
+
+    free(trimmed);
+    free(extents);
+    return result;
+}
+
+/**
+ * Uloží do i-uzlu extenty sestavené z mapy adres databloků (např. cp --reflink)
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode bez alokovaných databloků
+ * @param map adresy databloků souboru
+ * @param count počet databloků
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t extent_build(struct vfs_mount *mount, struct inode *inode_ptr, int64_t *map, int32_t count){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatelů
+    if(inode_ptr == NULL || map == NULL){
+        return -2;
+    }
+
+    struct inode_extent *extents = malloc(sizeof(struct inode_extent) * (count > 0 ? count : 1));
+
+    if(extents == NULL){
+        return -3;
+    }
+
+    // Díry (adresa 0) do extentů nepatří
+    int32_t mapped = 0;
+    int32_t i;
+    for(i = 0; i < count; i++){
+        if(map[i] == 0){
+            continue;
+        }
+
+        extents[mapped].logical = i;
+        extents[mapped].length = 1;
+        extents[mapped].address = map[i];
+        mapped++;
+    }
+
+    int32_t extent_count = extent_merge(mount, extents, mapped);
+    int32_t result = extent_store(mount, inode_ptr, extents, extent_count);
+
+    free(extents);
+    return result;
+}
+
+/**
+ * Uvolní bloky indexu a listů extentů, databloky zůstanou alokovány
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ */
+void extent_free_blocks(struct vfs_mount *mount, struct inode *inode_ptr){
+    if(mount == NULL || inode_ptr == NULL || inode_ptr->extent_block == 0){
+        return;
+    }
+
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int32_t *index_block = malloc(cluster_size);
+    memset(index_block, 0, cluster_size);
+    mount_read(mount, inode_ptr->extent_block, index_block, cluster_size);
+
+    int32_t i;
+    for(i = 1; i < mount->pointers_per_block; i++){
+        if(index_block[i] != 0){
+            extent_release_block(mount, inode_pointer_to_address(mount, index_block[i]));
+        }
+    }
+
+    extent_release_block(mount, inode_ptr->extent_block);
+    inode_ptr->extent_block = 0;
+
+    free(index_block);
+}
@@ -0,0 +1,124 @@
+#ifndef KIV_ZOS_EXTENT_H
+#define KIV_ZOS_EXTENT_H
+
+/*
+ * Extenty - popis databloků i-uzlu s příznakem INODE_FLAG_EXTENTS
+ *
+ * Každý extent je souvislý úsek (logický index, adresa, délka). První
+ * INODE_INLINE_EXTENTS extentů je uloženo přímo v i-uzlu, další v listech
+ * na které odkazuje blok indexu extentů:
+ *
+ * blok indexu: [0] = celkový počet extentů, [1..] = čísla clusterů listů
+ * list:        pole struct inode_extent_disk (extent N je v listu
+ *              (N - INODE_INLINE_EXTENTS) / počet extentů v listu)
+ *
+ * Souvisle alokovaný soubor tak potřebuje jediný extent místo odkazu
+ * na každý datablok. Logické indexy mezi extenty jsou díry (čtou se jako nuly)
+ */
+
+/*
+ * Nutné hlavičky
+ */
+#include <stdint.h>
+#include "bool.h"
+#include "mount.h"
+#include "inode.h"
+
+/**
+ * Vrátí počet extentů, které lze uložit do jednoho i-uzlu
+ *
+ * @param mount připojený VFS
+ * @return maximální počet extentů i-uzlu
+ */
+int32_t extent_max_count(struct vfs_mount *mount);
+
+/**
+ * Načte všechny extenty i-uzlu do nově alokovaného pole
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param extents výstup - pole extentů (uvolní volající)
+ * @return (return < 0: chyba | return >= 0: počet extentů)
+ */
+int32_t extent_load(struct vfs_mount *mount, struct inode *inode_ptr, struct inode_extent **extents);
+
+/**
+ * Připojí datablok na konec souboru - prodlouží poslední extent, nebo založí nový
+ *
+ * Nemění allocated_clusters ani bitmapu databloku (viz inode_add_data_address)
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param address adresa databloku
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t extent_append(struct vfs_mount *mount, struct inode *inode_ptr, int64_t address);
+
+/**
+ * Získá adresu databloku na daném indexu souboru
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param index index databloku v souboru
+ * @return (return < 0: chyba | 0: datablok není | return > 0: adresa databloku)
+ */
+int64_t extent_get(struct vfs_mount *mount, struct inode *inode_ptr, int32_t index);
+
+/**
+ * Načte adresy databloků s indexy <from, count) do pole map
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param map cílové pole adres (alespoň count položek)
+ * @param from první načítaný index
+ * @param count index za posledním načítaným indexem
+ * @return (return < 0: chyba | return >= 0: počet načtených adres)
+ */
+int32_t extent_load_block_map(struct vfs_mount *mount, struct inode *inode_ptr, int64_t *map, int32_t from, int32_t count);
+
+/**
+ * Přepíše adresu databloku na daném indexu souboru, extent se případně rozdělí
+ *
+ * Index v díře dostane nový extent, adresa 0 z indexu udělá díru
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param index index databloku v souboru
+ * @param address nová adresa databloku (0 = díra)
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t extent_set(struct vfs_mount *mount, struct inode *inode_ptr, int32_t index, int64_t address);
+
+/**
+ * Vyjme databloky s indexy <from, from + count) z extentů - vznikne díra
+ *
+ * Databloky zůstanou alokovány, uvolní je volající
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param from první index díry
+ * @param count počet databloků
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t extent_punch(struct vfs_mount *mount, struct inode *inode_ptr, int32_t from, int32_t count);
+
+/**
+ * Uloží do i-uzlu extenty sestavené z mapy adres databloků (např. cp --reflink)
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode bez alokovaných databloků
+ * @param map adresy databloků souboru
+ * @param count počet databloků
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t extent_build(struct vfs_mount *mount, struct inode *inode_ptr, int64_t *map, int32_t count);
+
+/**
+ * Uvolní bloky indexu a listů extentů, databloky zůstanou alokovány
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ */
+void extent_free_blocks(struct vfs_mount *mount, struct inode *inode_ptr);
+
+#endif //KIV_ZOS_EXTENT_H
@@ -4,32 +4,23 @@
 #include "directory.h"
 #include "structure.h"
 #include "allocation.h"
+#include "dentry.h"
 
 /**
  * Vytvoří soubor ve VFS
  *
- * @param vfs_filename cesta k VFS
+ * @param mount připojený VFS
  * @param path cesta k souboru
  * @return
  */
-int32_t file_create(char *vfs_filename, char *path){
+int32_t file_create(struct vfs_mount *mount, char *path){
     // Ověřování NULL
-    if(vfs_filename == NULL){
-        log_debug("file_create: Argument vfs_filename nemuze byt NULL!\n");
+    if(mount == NULL){
+        log_debug("file_create: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Kontrola délky názvu souboru
-    if(strlen(vfs_filename) < 1){
-        log_debug("file_create: Argument vfs_filename nemuze byt prazdnym retezcem!\n");
-        return -2;
-    }
 
-    // Ověření existence souboru
-    if(file_exist(vfs_filename) != TRUE){
-        log_debug("file_create: Cesta k souboru VFS neexistuje!\n");
-        return -3;
-    }
 
     // Ověřování NULL pro cestu
     if(path == NULL){
@@ -48,7 +39,7 @@ int32_t file_create(char *vfs_filename, char *path){
     // Zjištění suffix cesty - název složky
     char *file_name = get_suffix_string_after_last_character(path, "/");
 
-    VFS_FILE *dir = vfs_open(vfs_filename, path_prefix);
+    VFS_FILE *dir = vfs_open(mount, path_prefix);
 
     // Rodičovská složka neexistuje
     if(dir == NULL){
@@ -68,13 +59,13 @@ int32_t file_create(char *vfs_filename, char *path){
         return -7;
     }
 
-    int32_t exist = directory_has_entry(vfs_filename, dir->inode_ptr->id, file_name);
+    int32_t exist = directory_has_entry(mount, dir->inode_ptr->id, file_name);
 
     // Soubor ve slozce neexistuje, je treba vytvorit zaznam
     if(exist < 1){
         // Vytvoření inode
         // Zjištění volného indexu pro INODE -> index != 0 => máme již root
-        int32_t inode_free_index = inode_find_free_index(vfs_filename);
+        int32_t inode_free_index = inode_find_free_index(mount);
 
         if(inode_free_index < 0){
             log_info("file_create: Nelze vytvorit soubor -> nedostatek volnych INODE!\n");
@@ -94,8 +85,10 @@ int32_t file_create(char *vfs_filename, char *path){
         inode_ptr->id = inode_free_index + 1;
         // Nastavení typu INODE jako složka
         inode_ptr->type = VFS_FILE_TYPE;
+        // Nové soubory popisují databloky extenty, pokud je formát VFS umí
+        inode_ptr->flags = inode_default_flags(mount);
         // Zápis inode do VFS
-        inode_write_to_index(vfs_filename, inode_free_index, inode_ptr);
+        inode_write_to_index(mount, inode_free_index, inode_ptr);
 
         // Zápis záznamu do rodič složky
         struct directory_entry *entry = malloc(sizeof(struct directory_entry));
@@ -134,28 +127,18 @@ int32_t file_create(char *vfs_filename, char *path){
 /**
  * Vymaže soubor z VFS
  *
- * @param vfs_filename cesta k VFS
+ * @param mount připojený VFS
  * @param path cesta uvnitř VFS
  * @return (return < 0: chyba | return == 0: OK)
  */
-int32_t file_delete(char *vfs_filename, char *path){
+int32_t file_delete(struct vfs_mount *mount, char *path){
     // Ověřování NULL
-    if(vfs_filename == NULL){
-        log_debug("file_delete: Argument vfs_filename nemuze byt NULL!\n");
+    if(mount == NULL){
+        log_debug("file_delete: VFS neni pripojen!\n");
         return -1;
     }
 
-    // Kontrola délky názvu souboru
-    if(strlen(vfs_filename) < 1){
-        log_debug("file_delete: Argument vfs_filename nemuze byt prazdnym retezcem!\n");
-        return -2;
-    }
 
-    // Ověření existence souboru
-    if(file_exist(vfs_filename) != TRUE){
-        log_debug("file_delete: Cesta k souboru VFS neexistuje!\n");
-        return -3;
-    }
 
     // Ověřování NULL pro cestu
     if(path == NULL){
@@ -175,7 +158,7 @@ int32_t file_delete(char *vfs_filename, char *path){
     char *file_name = get_suffix_string_after_last_character(path, "/");
 
     // Otevření souboru
-    VFS_FILE *vfs_file = vfs_open(vfs_filename, path);
+    VFS_FILE *vfs_file = vfs_open(mount, path);
 
     if(vfs_file == NULL){
         free(path_prefix);
@@ -194,7 +177,7 @@ int32_t file_delete(char *vfs_filename, char *path){
     }
 
     // Otevření rodiče
-    VFS_FILE *vfs_parent = vfs_open(vfs_filename, path_prefix);
+    VFS_FILE *vfs_parent = vfs_open(mount, path_prefix);
 
     if(vfs_parent == NULL){
         free(path_prefix);
@@ -205,72 +188,76 @@ int32_t file_delete(char *vfs_filename, char *path){
     }
 
     // Vymazání záznamu v rodiči
-    // Alokace dat pro entry
-    struct directory_entry *entry = malloc(sizeof(struct directory_entry));
-
-    // Čtení directory entry do velikosti souboru
-    int32_t current_index = 0;
-    int32_t current = 0;
-    while(current + sizeof(struct directory_entry) <= vfs_parent->inode_ptr->file_size){
-        memset(entry, 0, sizeof(struct directory_entry));
-        vfs_read(entry, sizeof(struct directory_entry), 1, vfs_parent);
-
-        if(entry->inode_id == vfs_file->inode_ptr->id){
-            break;
-        }
-
-        // Posun na další prvek - vlastně jen pro podmínku, SEEK se upravuje v VFS_READ
-        current += sizeof(struct directory_entry);
-        current_index = current_index + 1;
-    }
-    free(entry);
-
-    // Kolik má rodič záznamů
-    int32_t parent_count = (vfs_parent->inode_ptr->file_size / sizeof(struct directory_entry));
-    int32_t last_parent_entry_index = parent_count - 1;
-
-    /*
-     * Je potřeba posunout záznam
-     * Posouváme poslední záznam na místo mazaného
-     * Zmenšujeme velikost složky o 1 entry
-     */
-    if(last_parent_entry_index != current_index){
-        int64_t seek = sizeof(struct directory_entry) * last_parent_entry_index;
-        vfs_seek(vfs_parent, seek, SEEK_SET);
-
-        // Přečtení poslední entry
-        struct directory_entry *replace_entry = malloc(sizeof(struct directory_entry));
-        memset(replace_entry, 0, sizeof(struct directory_entry));
-        vfs_read(replace_entry, sizeof(struct directory_entry), 1, vfs_parent);
-
-        // Seek na zápis
-        int64_t seek_write = sizeof(struct directory_entry) * current_index;
-        vfs_seek(vfs_parent, seek_write, SEEK_SET);
-        vfs_write(replace_entry, sizeof(struct directory_entry), 1, vfs_parent);
-
-        // Smazání staré entry
-        vfs_seek(vfs_parent, seek, SEEK_SET);
-        memset(replace_entry, 0, sizeof(struct directory_entry));
-        vfs_write(replace_entry, sizeof(struct directory_entry), 1, vfs_parent);
-
-        log_debug("directory_delete: Zaznam ve slozce %d presunut na %d\n", last_parent_entry_index, current_index);
-
-        // Zmensen velikosti slozky o smazany zaznam
-        vfs_parent->inode_ptr->file_size = vfs_parent->inode_ptr->file_size - sizeof(struct directory_entry);
-        inode_write_to_index(vfs_filename, vfs_parent->inode_ptr->id - 1, vfs_parent->inode_ptr);
-
-        free(replace_entry);
+    if(directory_remove_entry(vfs_parent, file_name, NULL) < 1){
+        log_debug("file_delete: Zaznam %s se v rodicovske slozce nepodarilo odebrat!\n", file_name);
     }
 
     // Dealokování všech dat v INODE
-    int32_t  dealloc_result = deallocate(vfs_filename, vfs_file->inode_ptr);
+    int32_t  dealloc_result = deallocate(mount, vfs_file->inode_ptr);
+    vfs_block_map_invalidate(vfs_file);
 
     // Smazat inode
     struct inode *empty_inode = malloc(sizeof(struct inode));
     memset(empty_inode, 0, sizeof(struct inode));
-    inode_write_to_index(vfs_filename, vfs_file->inode_ptr->id - 1, empty_inode);
+    inode_write_to_index(mount, vfs_file->inode_ptr->id - 1, empty_inode);
+
+    // Symlink mohl být prohledáván jako složka - jeho záznamy v mezipaměti zahodíme
+    dentry_invalidate_dir(mount, vfs_file->inode_ptr->id);
 
+    // Uvolnění zdrojů
+    vfs_close(vfs_file);
+    vfs_close(vfs_parent);
+    free(empty_inode);
     free(path_prefix);
     free(file_name);
+
+    // OK
+    return 0;
 }
 
+
+/**
+ * Nahradí obsah souboru target sdílenou kopií dat souboru source (cp --reflink)
+ *
+ * Data se nekopírují, oba soubory sdílí databloky až do prvního zápisu
+ *
+ * @param source otevřený zdrojový soubor
+ * @param target otevřený cílový soubor
+ * @return (return < 0: chyba | return == 0: OK)
+ */
+int32_t file_reflink(VFS_FILE *source, VFS_FILE *target){
+    // Ověřování NULL
+    if(source == NULL || target == NULL){
+        log_debug("file_reflink: Soubor nemuze byt NULL!\n");
+        return -1;
+    }
+
+    struct vfs_mount *mount = target->mount;
+
+    // Formát bez tabulky sdílení
+    if(mount->refcounts == NULL){
+        log_debug("file_reflink: Format VFS nepodporuje sdileni clusteru!\n");
+        return -2;
+    }
+
+    // Kopie souboru na sebe sama nic nemění
+    if(source->inode_ptr->id == target->inode_ptr->id){
+        return 0;
+    }
+
+    // Původní data cíle se zahodí
+    if(target->inode_ptr->allocated_clusters > 0){
+        deallocate(mount, target->inode_ptr);
+        vfs_block_map_invalidate(target);
+
+        inode_reset_mapping(target->inode_ptr);
+        inode_write_to_index(mount, target->inode_ptr->id - 1, target->inode_ptr);
+    }
+
+    if(inode_clone_data(mount, source->inode_ptr, target->inode_ptr) != 0){
+        log_debug("file_reflink: Data inode ID=%d nelze sdilet!\n", source->inode_ptr->id);
+        return -3;
+    }
+
+    return 0;
+}
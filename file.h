@@ -3,23 +3,35 @@
 
 #include <stdint.h>
 #include "parsing.h"
+#include "vfs_io.h"
 
 /**
  * Vytvoří soubor ve VFS
  *
- * @param vfs_filename cesta k VFS
+ * @param mount připojený VFS
  * @param path cesta k souboru
  * @return
  */
-int32_t file_create(char *vfs_filename, char *path);
+int32_t file_create(struct vfs_mount *mount, char *path);
 
 /**
  * Vymaže soubor z VFS
  *
- * @param vfs_filename cesta k VFS
+ * @param mount připojený VFS
  * @param path cesta uvnitř VFS
  * @return (return < 0: chyba | return == 0: OK)
  */
-int32_t file_delete(char *vfs_filename, char *path);
+int32_t file_delete(struct vfs_mount *mount, char *path);
+
+/**
+ * Nahradí obsah souboru target sdílenou kopií dat souboru source (cp --reflink)
+ *
+ * Data se nekopírují, oba soubory sdílí databloky až do prvního zápisu
+ *
+ * @param source otevřený zdrojový soubor
+ * @param target otevřený cílový soubor
+ * @return (return < 0: chyba | return == 0: OK)
+ */
+int32_t file_reflink(VFS_FILE *source, VFS_FILE *target);
 
 #endif //KIV_ZOS_FILE_H
@@ -6,7 +6,10 @@
 #include "parsing.h"
 #include "bitmap.h"
 #include "allocation.h"
-#include <math.h>
+#include "refcount.h"
+#include "extent.h"
+#include "inode_bitmap.h"
+#include "inode_cache.h"
 
 /**
  * Vypíše obsah struktury inode
@@ -23,90 +26,311 @@ void inode_print(struct inode *ptr){
     log_info("ID: %d\n", ptr->id);
     log_info("Type: %d\n", ptr->type);
     log_info("References: %d\n", ptr->references);
-    log_info("File size: %d\n", ptr->file_size);
+    log_info("File size: %ld\n", (long)ptr->file_size);
     log_info("Pointer count: %d\n", ptr->allocated_clusters);
-    log_info("Direct pointer 1: %ď\n", ptr->direct1);
-    log_info("Direct pointer 2: %ď\n", ptr->direct2);
-    log_info("Direct pointer 3: %ď\n", ptr->direct3);
-    log_info("Direct pointer 4: %ď\n", ptr->direct4);
-    log_info("Direct pointer 5: %ď\n", ptr->direct5);
-    log_info("Single indirect pointer: %d\n", ptr->indirect1);
-    log_info("Double indirect pointer: %d\n", ptr->indirect2);
+    log_info("Direct pointer 1: %ld\n", (long)ptr->direct1);
+    log_info("Direct pointer 2: %ld\n", (long)ptr->direct2);
+    log_info("Direct pointer 3: %ld\n", (long)ptr->direct3);
+    log_info("Direct pointer 4: %ld\n", (long)ptr->direct4);
+    log_info("Direct pointer 5: %ld\n", (long)ptr->direct5);
+    log_info("Single indirect pointer: %ld\n", (long)ptr->indirect1);
+    log_info("Double indirect pointer: %ld\n", (long)ptr->indirect2);
+    log_info("Flags: %d\n", ptr->flags);
+
+    if((ptr->flags & INODE_FLAG_EXTENTS) != 0){
+        int32_t i;
+        for(i = 0; i < INODE_INLINE_EXTENTS; i++){
+            log_info("Extent %d: %d +%d -> %ld\n", i, ptr->extents[i].logical, ptr->extents[i].length, (long)ptr->extents[i].address);
+        }
+
+        log_info("Extent block: %ld\n", (long)ptr->extent_block);
+    }
     log_info("*** INODE END\n");
 }
 
+/**
+ * Vrátí velikost záznamu i-uzlu uloženého ve VFS
+ *
+ * @param mount připojený VFS
+ * @return velikost záznamu v byte
+ */
+int32_t inode_record_size(struct vfs_mount *mount){
+    if(superblock_version(mount->superblock_ptr) >= VFS_VERSION_64BIT){
+        return sizeof(struct inode_disk);
+    }
+
+    return sizeof(struct inode_legacy);
+}
+
+/**
+ * Převede odkaz uložený ve VFS (i-uzel, nepřímý blok) na adresu clusteru
+ *
+ * Starší formáty ukládají přímo byte adresu, od verze VFS_VERSION_64BIT
+ * je uloženo číslo clusteru (index + 1)
+ *
+ * @param mount připojený VFS
+ * @param pointer uložený odkaz
+ * @return adresa clusteru ve VFS (0 - žádný odkaz)
+ */
+int64_t inode_pointer_to_address(struct vfs_mount *mount, int32_t pointer){
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+
+    if(pointer <= 0 || superblock_version(superblock_ptr) < VFS_VERSION_64BIT){
+        return pointer;
+    }
+
+    return superblock_ptr->data_start_address + ((int64_t)(pointer - 1) << mount->cluster_shift);
+}
+
+/**
+ * Převede adresu clusteru na odkaz ukládaný do VFS (i-uzel, nepřímý blok)
+ *
+ * @param mount připojený VFS
+ * @param address adresa clusteru ve VFS (0 - žádný odkaz)
+ * @return uložený odkaz
+ */
+int32_t inode_address_to_pointer(struct vfs_mount *mount, int64_t address){
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+
+    if(address <= 0 || superblock_version(superblock_ptr) < VFS_VERSION_64BIT){
+        return (int32_t)address;
+    }
+
+    return (int32_t)((address - superblock_ptr->data_start_address) >> mount->cluster_shift) + 1;
+}
+
+/**
+ * Převede záznam i-uzlu přečtený z VFS do struktury inode
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr cílová struktura
+ * @param raw záznam i-uzlu (inode_record_size byte)
+ */
+void inode_decode(struct vfs_mount *mount, struct inode *inode_ptr, const void *raw){
+    memset(inode_ptr, 0, sizeof(struct inode));
+
+    if(superblock_version(mount->superblock_ptr) >= VFS_VERSION_64BIT){
+        struct inode_disk disk;
+        memcpy(&disk, raw, sizeof(struct inode_disk));
+
+        inode_ptr->id = disk.id;
+        inode_ptr->type = disk.type;
+        inode_ptr->references = disk.references;
+        inode_ptr->allocated_clusters = disk.allocated_clusters;
+        inode_ptr->file_size = disk.file_size;
+        inode_ptr->flags = disk.flags;
+
+        // Odkazy direct1 - indirect2 obsahují extenty
+        if((disk.flags & INODE_FLAG_EXTENTS) != 0){
+            struct inode_extent_root root;
+            memcpy(&root, (const char *)raw + offsetof(struct inode_disk, direct1), sizeof(struct inode_extent_root));
+
+            inode_ptr->extent_block = inode_pointer_to_address(mount, root.extent_block);
+
+            int32_t i;
+            for(i = 0; i < INODE_INLINE_EXTENTS; i++){
+                inode_ptr->extents[i].logical = root.extents[i].logical;
+                inode_ptr->extents[i].length = root.extents[i].length;
+                inode_ptr->extents[i].address = inode_pointer_to_address(mount, root.extents[i].cluster);
+            }
+            return;
+        }
+
+        inode_ptr->direct1 = inode_pointer_to_address(mount, disk.direct1);
+        inode_ptr->direct2 = inode_pointer_to_address(mount, disk.direct2);
+        inode_ptr->direct3 = inode_pointer_to_address(mount, disk.direct3);
+        inode_ptr->direct4 = inode_pointer_to_address(mount, disk.direct4);
+        inode_ptr->direct5 = inode_pointer_to_address(mount, disk.direct5);
+        inode_ptr->indirect1 = inode_pointer_to_address(mount, disk.indirect1);
+        inode_ptr->indirect2 = inode_pointer_to_address(mount, disk.indirect2);
+        return;
+    }
+
+    struct inode_legacy legacy;
+    memcpy(&legacy, raw, sizeof(struct inode_legacy));
+
+    inode_ptr->id = legacy.id;
+    inode_ptr->type = legacy.type;
+    inode_ptr->references = legacy.references;
+    inode_ptr->allocated_clusters = legacy.allocated_clusters;
+    inode_ptr->file_size = legacy.file_size;
+    inode_ptr->direct1 = legacy.direct1;
+    inode_ptr->direct2 = legacy.direct2;
+    inode_ptr->direct3 = legacy.direct3;
+    inode_ptr->direct4 = legacy.direct4;
+    inode_ptr->direct5 = legacy.direct5;
+    inode_ptr->indirect1 = legacy.indirect1;
+    inode_ptr->indirect2 = legacy.indirect2;
+}
+
+/**
+ * Převede strukturu inode na záznam ukládaný do VFS
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr převáděná struktura
+ * @param raw cílový záznam (inode_record_size byte)
+ */
+static void inode_encode(struct vfs_mount *mount, struct inode *inode_ptr, void *raw){
+    if(superblock_version(mount->superblock_ptr) >= VFS_VERSION_64BIT){
+        struct inode_disk disk;
+        memset(&disk, 0, sizeof(struct inode_disk));
+
+        disk.id = inode_ptr->id;
+        disk.type = inode_ptr->type;
+        disk.references = inode_ptr->references;
+        disk.allocated_clusters = inode_ptr->allocated_clusters;
+        disk.file_size = inode_ptr->file_size;
+        disk.flags = inode_ptr->flags;
+        disk.direct1 = inode_address_to_pointer(mount, inode_ptr->direct1);
+        disk.direct2 = inode_address_to_pointer(mount, inode_ptr->direct2);
+        disk.direct3 = inode_address_to_pointer(mount, inode_ptr->direct3);
+        disk.direct4 = inode_address_to_pointer(mount, inode_ptr->direct4);
+        disk.direct5 = inode_address_to_pointer(mount, inode_ptr->direct5);
+        disk.indirect1 = inode_address_to_pointer(mount, inode_ptr->indirect1);
+        disk.indirect2 = inode_address_to_pointer(mount, inode_ptr->indirect2);
+
+        memcpy(raw, &disk, sizeof(struct inode_disk));
+
+        // Odkazy direct1 - indirect2 obsahují extenty
+        if((inode_ptr->flags & INODE_FLAG_EXTENTS) != 0){
+            struct inode_extent_root root;
+            memset(&root, 0, sizeof(struct inode_extent_root));
+
+            root.extent_block = inode_address_to_pointer(mount, inode_ptr->extent_block);
+
+            int32_t i;
+            for(i = 0; i < INODE_INLINE_EXTENTS; i++){
+                root.extents[i].logical = inode_ptr->extents[i].logical;
+                root.extents[i].length = inode_ptr->extents[i].length;
+                root.extents[i].cluster = inode_address_to_pointer(mount, inode_ptr->extents[i].address);
+            }
+
+            memcpy((char *)raw + offsetof(struct inode_disk, direct1), &root, sizeof(struct inode_extent_root));
+        }
+        return;
+    }
+
+    struct inode_legacy legacy;
+    memset(&legacy, 0, sizeof(struct inode_legacy));
+
+    legacy.id = inode_ptr->id;
+    legacy.type = inode_ptr->type;
+    legacy.references = inode_ptr->references;
+    legacy.allocated_clusters = inode_ptr->allocated_clusters;
+    legacy.file_size = (int32_t)inode_ptr->file_size;
+    legacy.direct1 = (int32_t)inode_ptr->direct1;
+    legacy.direct2 = (int32_t)inode_ptr->direct2;
+    legacy.direct3 = (int32_t)inode_ptr->direct3;
+    legacy.direct4 = (int32_t)inode_ptr->direct4;
+    legacy.direct5 = (int32_t)inode_ptr->direct5;
+    legacy.indirect1 = (int32_t)inode_ptr->indirect1;
+    legacy.indirect2 = (int32_t)inode_ptr->indirect2;
+
+    memcpy(raw, &legacy, sizeof(struct inode_legacy));
+}
+
+/**
+ * Přečte a převede záznam i-uzlu přímo z VFS (obchází mezipaměť i-uzlů)
+ *
+ * @param mount připojený VFS
+ * @param inode_address adresa záznamu ve VFS
+ * @param inode_ptr cílová struktura
+ * @return výsledek operace
+ */
+bool inode_read_record(struct vfs_mount *mount, int64_t inode_address, struct inode *inode_ptr){
+    int32_t record_size = inode_record_size(mount);
+
+    // Namapovaný VFS - převod přímo z mapy bez kopie záznamu
+    const void *mapped = mount_ptr(mount, inode_address, record_size);
+    if(mapped != NULL){
+        inode_decode(mount, inode_ptr, mapped);
+        return TRUE;
+    }
+
+    char record[sizeof(struct inode_disk)];
+
+    if(mount_read(mount, inode_address, record, record_size) != record_size){
+        return FALSE;
+    }
+
+    inode_decode(mount, inode_ptr, record);
+    return TRUE;
+}
+
+/**
+ * Převede a zapíše záznam i-uzlu přímo do VFS (obchází mezipaměť i-uzlů)
+ *
+ * @param mount připojený VFS
+ * @param inode_address adresa záznamu ve VFS
+ * @param inode_ptr zapisovaná struktura
+ * @return výsledek operace
+ */
+bool inode_write_record(struct vfs_mount *mount, int64_t inode_address, struct inode *inode_ptr){
+    int32_t record_size = inode_record_size(mount);
+    char record[sizeof(struct inode_disk)];
+    inode_encode(mount, inode_ptr, record);
+
+    return mount_write(mount, inode_address, record, record_size) == record_size ? TRUE : FALSE;
+}
+
 /**
  * Zapíše obsah struktury inode na adresu ve VFS určenou indexem
  *
- * @param filename soubor vfs
+ * @param mount připojený VFS
  * @param inode_index index inode ve VFS
  * @param inode_ptr struktura k zapsání
  * @return výsledek operace
  */
-int32_t inode_write_to_index(char *filename, int32_t inode_index, struct inode *inode_ptr){
+int32_t inode_write_to_index(struct vfs_mount *mount, int32_t inode_index, struct inode *inode_ptr){
     // Nalezení adresy podle indexu
-    int32_t inode_address = inode_index_to_adress(filename, inode_index);
+    int64_t inode_address = inode_index_to_adress(mount, inode_index);
 
     // Ověření existence adresy
     if(inode_address < 0){
-        return inode_address;
+        return (int32_t)inode_address;
     }
 
     // Zápis na adresu
-    return inode_write_to_address(filename, inode_address, inode_ptr);
+    return inode_write_to_address(mount, inode_address, inode_ptr);
 }
 
 /**
  * Zapíše obsah struktury inode na adresu ve VFS
  *
- * @param filename soubor vfs
+ * @param mount připojený VFS
  * @param inode_address adresa inode ve VFS
  * @param inode_ptr struktura k zapsání
  * @return výsledek operace
  */
-int32_t inode_write_to_address(char *filename, int32_t inode_address, struct inode *inode_ptr){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
+int32_t inode_write_to_address(struct vfs_mount *mount, int64_t inode_address, struct inode *inode_ptr){
+    // Kontrola připojení
+    if(mount == NULL){
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        return -2;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        return -3;
-    }
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+    int32_t record_size = inode_record_size(mount);
 
     // Ověření adresy k zápisu
-    if(inode_address > superblock_ptr->data_start_address - sizeof(struct inode)){
-        free(superblock_ptr);
+    if(inode_address > superblock_ptr->data_start_address - record_size){
         return -4;
     }
 
-    // Otevření souboru pro čtení
-    FILE *file = fopen(filename, "r+b");
+    int64_t inode_index = (inode_address - superblock_ptr->inode_start_address) / record_size;
 
-    // Ověření otevření souboru
-    if(file == NULL){
-        free(superblock_ptr);
-        return -5;
+    // Zápis do mezipaměti i-uzlů (na disk až při synchronizaci), jinak přímo na adresu
+    if(inode_cache_store(mount, (int32_t)inode_index, inode_ptr) != TRUE){
+        if(inode_write_record(mount, inode_address, inode_ptr) != TRUE){
+            return -5;
+        }
     }
 
-
-    // Nastavení ukazatele zápisu
-    fseek(file, inode_address, SEEK_SET);
-    fflush(file);
-    fwrite(inode_ptr, sizeof(struct inode), 1, file);
-    fclose(file);
+    // Bitmapa i-uzlů sleduje obsazenost tabulky - mění se pouze zde
+    if(mount->inode_bitmap != NULL){
+        inode_bitmap_set(mount, (int32_t)inode_index, inode_ptr->id != ID_ITEM_FREE ? TRUE : FALSE);
+    }
 
     // Akce se podařila
-    free(superblock_ptr);
     return TRUE;
 }
 
@@ -114,98 +338,66 @@ int32_t inode_write_to_address(char *filename, int32_t inode_address, struct ino
 /**
  * Na základě indexu vrátí adresu inode
  *
- * @param filename soubor vfs
+ * @param mount připojený VFS
  * @param inode_index index inode
  * @return
  */
-int32_t inode_index_to_adress(char *filename, int32_t inode_index){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
+int64_t inode_index_to_adress(struct vfs_mount *mount, int32_t inode_index){
+    // Kontrola připojení
+    if(mount == NULL){
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        return -2;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        return -3;
-    }
+    struct superblock *superblock_ptr = mount->superblock_ptr;
 
-    int inode_size = sizeof(struct inode);
-    int inode_adress_start = superblock_ptr->inode_start_address;
-    free(superblock_ptr);
+    int64_t inode_size = inode_record_size(mount);
+    int64_t inode_adress_start = superblock_ptr->inode_start_address;
     return inode_adress_start + (inode_index * inode_size);
 }
 
 /**
- * Vrátí první volný index pro inode
+ * Vrátí volný index pro inode
  *
- * @param filename
+ * Formát s bitmapou i-uzlů hledá v bitmapě, starší formáty čtou tabulku i-uzlů od začátku
+ *
+ * @param mount připojený VFS
  * @return
  */
-int32_t inode_find_free_index(char *filename){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
+int32_t inode_find_free_index(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL){
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        return -2;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        return -3;
-    }
-
-    // Otevření souboru pro čtení
-    FILE *file = fopen(filename, "r");
-
-    // Ověření otevření souboru
-    if(file == NULL){
-        free(superblock_ptr);
-        return -4;
+    if(mount->inode_bitmap != NULL){
+        return inode_bitmap_find_free(mount);
     }
 
-    int32_t inode_start = superblock_ptr->inode_start_address;
-    fseek(file, inode_start ,SEEK_SET);
-    struct inode *inode_ptr = malloc(sizeof(struct inode));
-    int index = 0;
+    // Tabulka se čte přímo z VFS - odložené zápisy i-uzlů musí být na disku
+    inode_cache_flush(mount);
 
-    // Lineární čtení dat, kde jsou uložené inode
-    while(ftell(file) < superblock_ptr->data_start_address){
-        fread(inode_ptr, sizeof(struct inode), 1, file);
+    struct superblock *superblock_ptr = mount->superblock_ptr;
 
+    int64_t current_address = superblock_ptr->inode_start_address;
+    int32_t record_size = inode_record_size(mount);
+    int32_t index = 0;
 
-        // Pokud jsme přečetli všechny inode, nenašli jsme žádný volný
-        if(ftell(file) >= superblock_ptr->data_start_address){
-            return -5;
-        }
+    // Lineární čtení dat, kde jsou uložené inode - ID je v obou formátech na začátku záznamu
+    while(current_address + record_size <= superblock_ptr->data_start_address && index < INT32_MAX){
+        int32_t id = ID_ITEM_FREE;
+        mount_read(mount, current_address, &id, sizeof(int32_t));
 
-        if(inode_ptr->id == ID_ITEM_FREE){
-            break;
+        if(id == ID_ITEM_FREE){
+            // Návrat indexu
+            return index;
         }
 
+        current_address += record_size;
         index++;
     }
 
-    // Uvolnění superbloku
-    free(superblock_ptr);
-    free(inode_ptr);
-    fclose(file);
-
-    // Návrat indexu
-    return index;
+    // Přečetli jsme všechny inode, nenašli jsme žádný volný
+    return -5;
 
 }
 
@@ -213,20 +405,20 @@ int32_t inode_find_free_index(char *filename){
  * Pokusí se o přečtení struktury inode z VFS a vrátí ukazatel
  * hledá inode dle indexu
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_index index inode
  * @return výsledek operace (PTR | NULL)
  */
-struct inode *inode_read_by_index(char *filename, int32_t inode_index){
+struct inode *inode_read_by_index(struct vfs_mount *mount, int32_t inode_index){
     // Nalezení adresy podle indexu
-    int32_t inode_address = inode_index_to_adress(filename, inode_index);
+    int64_t inode_address = inode_index_to_adress(mount, inode_index);
 
     // Ověření existence adresy
     if(inode_address < 0){
         return NULL;
     }
 
-    return inode_read_by_address(filename, inode_address);
+    return inode_read_by_address(mount, inode_address);
 }
 
 
@@ -234,57 +426,41 @@ struct inode *inode_read_by_index(char *filename, int32_t inode_index){
  * Pokusí se o přečtení struktury inode z VFS a vrátí ukazatel
  * hledá inode dle indexu
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_address adresa inode ve VFS
  * @return výsledek operace (PTR | NULL)
  */
-struct inode *inode_read_by_address(char *filename, int32_t inode_address){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        return NULL;
-    }
-
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
+struct inode *inode_read_by_address(struct vfs_mount *mount, int64_t inode_address){
+    // Kontrola připojení
+    if(mount == NULL){
         return NULL;
     }
 
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        return NULL;
-    }
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+    int32_t record_size = inode_record_size(mount);
 
     // Ověření adresy ke čtení
-    if(inode_address > superblock_ptr->data_start_address - sizeof(struct inode)){
-        free(superblock_ptr);
+    if(inode_address > superblock_ptr->data_start_address - record_size){
         return NULL;
     }
 
-    // Otevření souboru pro čtení
-    FILE *file = fopen(filename, "rb");
+    struct inode *inode_ptr = malloc(sizeof(struct inode));
+    int64_t inode_index = (inode_address - superblock_ptr->inode_start_address) / record_size;
 
-    // Ověření otevření souboru
-    if(file == NULL){
-        free(superblock_ptr);
-        return NULL;
+    // Kopie z mezipaměti i-uzlů, jinak čtení z otevřeného VFS
+    if(inode_cache_read(mount, (int32_t)inode_index, inode_ptr) != TRUE){
+        if(inode_read_record(mount, inode_address, inode_ptr) != TRUE){
+            free(inode_ptr);
+            return NULL;
+        }
     }
 
-    struct inode *inode_ptr = malloc(sizeof(struct inode));
-    fseek(file, inode_address, SEEK_SET);
-    fread(inode_ptr, sizeof(struct inode), 1, file);
-    fclose(file);
-
     //Inode je prázdná
     if(inode_ptr->id == 0){
-        free(superblock_ptr);
         free(inode_ptr);
         return NULL;
     }
 
-    free(superblock_ptr);
     return inode_ptr;
 }
 
@@ -292,481 +468,253 @@ struct inode *inode_read_by_address(char *filename, int32_t inode_address){
  *
  * Kontrolní funkce, která ověří, zda lze převést adresu na index data bloku
  *
- * @param filename soubor vfs
+ * @param mount připojený VFS
  * @param address adresa ve VFS
  * @return výsledek operace (return < 0 - chyba | return >= 0 - validní index)
  */
-int32_t inode_data_index_from_address(char *filename, int32_t address){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
+int32_t inode_data_index_from_address(struct vfs_mount *mount, int64_t address){
+    // Kontrola připojení
+    if(mount == NULL){
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        return -2;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+    int64_t offset = address - superblock_ptr->data_start_address;
 
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        return -3;
+    // Adresa musí ležet v datové oblasti na začátku clusteru
+    if(offset < 0 || (offset & (superblock_ptr->cluster_size - 1)) != 0){
+        return -4;
     }
 
-    int32_t current_address = superblock_ptr->data_start_address;
-    int32_t cluster_size = superblock_ptr->cluster_size;
-    int32_t index = 0;
-
-    while(current_address < superblock_ptr->disk_size){
-        if(current_address == address){
-            break;
-        }
-
-        current_address = current_address + cluster_size;
-        index++;
-    }
+    int64_t index = offset >> mount->cluster_shift;
 
-    if(index > superblock_ptr->cluster_count){
-        free(superblock_ptr);
+    if(index >= superblock_ptr->cluster_count){
         return -4;
     }
 
-    free(superblock_ptr);
-    return index;
+    return (int32_t)index;
 }
 
 /**
- * Přidá nový ukazatel na datový blok pro strukturu
+ * Přečte jeden odkaz na datový blok uložený na dané adrese VFS
  *
- * @deprecated Prochází lineárně všechny existující odkazy a hledá volný odkaz - pomalé
+ * Při MOUNT_BACKEND_MMAP čte přímo z mapy bez kopírování a bez systémového volání
  *
- * @param filename soubor VFS
- * @param inode_ptr ukazatel na pozměňovaný inode
- * @return výsledek operace
+ * @param mount připojený VFS
+ * @param address adresa odkazu ve VFS
+ * @return adresa databloku (0 pokud odkaz není nebo jej nelze přečíst)
  */
-bool inode_add_data_address_slow(char *filename, struct inode *inode_ptr, int32_t address){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
-        return -1;
-    }
-
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        return -2;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        return -3;
-    }
-
-    // Kontrola zda adresa je validní adresou začátku clusteru
-    if(inode_data_index_from_address(filename, address) < 0){
-        return -4;
-    }
-
-    bool address_writen = FALSE;
-    int32_t index_written = -50;
-
-    /*
-     * Kontrola možnosti zapsání přímých adres
-     */
-
-    if(inode_ptr->direct1 == 0 && address_writen == FALSE){
-        inode_ptr->direct1 = address;
-        index_written = 1;
-        address_writen = TRUE;
-        log_trace("inode_add_data_address_slow: Adresa databloku ulozena do direct1 (index 1)\n");
-    }
-
-    if(inode_ptr->direct2 == 0 && address_writen == FALSE){
-        inode_ptr->direct2 = address;
-        index_written = 2;
-        address_writen = TRUE;
-        log_trace("inode_add_data_address_slow: Adresa databloku ulozena do direct2 (index 2)\n");
-    }
-
-    if(inode_ptr->direct3 == 0 && address_writen == FALSE){
-        inode_ptr->direct3 = address;
-        index_written = 3;
-        address_writen = TRUE;
-        log_trace("inode_add_data_address_slow: Adresa databloku ulozena do direct3 (index 3)\n");
-    }
-
-    if(inode_ptr->direct4 == 0 && address_writen == FALSE){
-        inode_ptr->direct4 = address;
-        index_written = 4;
-        address_writen = TRUE;
-        log_trace("inode_add_data_address_slow: Adresa databloku ulozena do direct4 (index 4)\n");
-    }
+int64_t inode_read_pointer(struct vfs_mount *mount, int64_t address){
+    int32_t *mapped = mount_ptr(mount, address, sizeof(int32_t));
 
-    if(inode_ptr->direct5 == 0 && address_writen == FALSE){
-        inode_ptr->direct5 = address;
-        index_written = 5;
-        address_writen = TRUE;
-        log_trace("inode_add_data_address_slow: Adresa databloku ulozena do direct5 (index 5)\n");
+    if(mapped != NULL){
+        return inode_pointer_to_address(mount, *mapped);
     }
 
-    /*
-     * 1. nepřímý odkaz na clustery
-     */
-
-    // Alokace pro nepřímý odkaz v případě, že je potřeba
-    if(inode_ptr->indirect1 == 0 && address_writen == FALSE){
-        int32_t indirect1_allocation_index = bitmap_find_free_cluster_index(filename);
+    int32_t value = 0;
+    mount_read(mount, address, &value, sizeof(int32_t));
+    return inode_pointer_to_address(mount, value);
+}
 
-        if(indirect1_allocation_index < 0){
-            log_debug("inode_add_data_address_slow: Nelze alokovat 1. neprimou adresu, nedostatek volnych clusteru!\n");
-            return -5;
-        }
+/**
+ * Zapíše jeden odkaz na datový blok na danou adresu VFS
+ *
+ * @param mount připojený VFS
+ * @param address adresa odkazu ve VFS
+ * @param value adresa databloku (0 - žádný odkaz)
+ * @return výsledek operace
+ */
+bool inode_write_pointer(struct vfs_mount *mount, int64_t address, int64_t value){
+    int32_t pointer = inode_address_to_pointer(mount, value);
 
-        int32_t indirect1_allocation_address = bitmap_index_to_cluster_address(filename, indirect1_allocation_index);
-        bitmap_set(filename, indirect1_allocation_index, 1, TRUE);
+    return mount_write(mount, address, &pointer, sizeof(int32_t)) == sizeof(int32_t) ? TRUE : FALSE;
+}
 
-        // Nulování datového bloku
-        allocation_clear_cluster(filename, indirect1_allocation_address);
-        // Zápis do inode
-        inode_ptr->indirect1 = indirect1_allocation_address;
-        // Zápis na VFS
-        inode_write_to_index(filename, inode_ptr->id - 1, inode_ptr);
-        log_trace("inode_add_data_address_slow: Hodnota nepřímého odkazu pro ID=%d nastavena na %d\n", inode_ptr->id, inode_ptr->indirect1);
+/**
+ * Vrátí největší velikost souboru, kterou lze do i-uzlu uložit
+ *
+ * Starší formáty ukládají velikost souboru do 32 bitů, jinak je velikost
+ * omezena počtem databloků i-uzlu
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @return maximální velikost souboru v byte
+ */
+int64_t inode_max_file_size(struct vfs_mount *mount, struct inode *inode_ptr){
+    if(superblock_version(mount->superblock_ptr) < VFS_VERSION_64BIT){
+        return INT32_MAX;
     }
 
-    if(address_writen == FALSE) {
-        index_written = 6;
-
-        // Procházení 1. nepřímého odkazu a zápis
-        int32_t *indirect1_iter_data = malloc(sizeof(int32_t));
-        int32_t indirect1_iter_current = inode_ptr->indirect1;
-        int32_t indirect1_iter_end = inode_ptr->indirect1 + superblock_ptr->cluster_size;
-
-        FILE *file_read = fopen(filename, "r+b");
-
-        while (indirect1_iter_current < indirect1_iter_end) {
-
-            fseek(file_read, indirect1_iter_current, SEEK_SET);
-            memset(indirect1_iter_data, 0, sizeof(int32_t));
-            fread(indirect1_iter_data, sizeof(int32_t), 1, file_read);
-
-            // Našli jsme místo kam zapsat
-            if (*indirect1_iter_data == 0) {
-                fseek(file_read, indirect1_iter_current, SEEK_SET);
-                fwrite(&address, sizeof(int32_t), 1, file_read);
-                fflush(file_read);
-
-                address_writen = TRUE;
-                log_trace("inode_add_data_address_slow: Adresa databloku ulozena do indirect1 (index %d)\n", index_written);
-                break;
-            }
-
-            // Posun na další adresu
-            indirect1_iter_current += sizeof(int32_t);
-            index_written++;
-        }
+    return (int64_t)inode_max_clusters(mount, inode_ptr) << mount->cluster_shift;
+}
 
-        fclose(file_read);
-        free(indirect1_iter_data);
+/**
+ * Vrátí počet odkazů na databloky, které lze uložit do i-uzlu
+ *
+ * Přímé odkazy, celý 1. nepřímý blok a celý 2. nepřímý blok, omezeno
+ * rozsahem počítadla allocated_clusters; i-uzel s extenty je omezen pouze
+ * počítadlem (a počtem extentů při zápisu)
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @return maximální počet databloků i-uzlu
+ */
+int32_t inode_max_clusters(struct vfs_mount *mount, struct inode *inode_ptr){
+    if(inode_ptr != NULL && (inode_ptr->flags & INODE_FLAG_EXTENTS) != 0){
+        return INT32_MAX;
     }
 
-    // Alokace pro nepřímý odkaz
-    if(address_writen == FALSE) {
-
-        // Alokace pro inode->indirect2 pokud je ukazatel NULL
-        if (inode_ptr->indirect2 == 0) {
-            int32_t indirect2_allocation_index = bitmap_find_free_cluster_index(filename);
-
-            if (indirect2_allocation_index < 0) {
-                log_debug("inode_add_data_address_slow: Nelze alokovat 2. neprimou adresu, nedostatek volnych clusteru!\n");
-                return -6;
-            }
-
-            int32_t indirect2_allocation_address = bitmap_index_to_cluster_address(filename,
-                                                                                   indirect2_allocation_index);
-            bitmap_set(filename, indirect2_allocation_index, 1, TRUE);
-
-            // Nulování datového bloku
-            allocation_clear_cluster(filename, indirect2_allocation_address);
-            // Zápis do inode
-            inode_ptr->indirect2 = indirect2_allocation_address;
-            // Zápis na VFS
-            inode_write_to_index(filename, inode_ptr->id - 1, inode_ptr);
-            log_trace("inode_add_data_address_slow: Hodnota 2. nepřímého odkazu pro ID=%d nastavena na %d\n", inode_ptr->id,
-                      inode_ptr->indirect2);
-        }
-
-        // Nepřímá adresa typu 2 -> nepřímá adresa typu 1
-        int32_t *indirect2_level1_iter_data = malloc(sizeof(int32_t));
-        int32_t indirect2_level1_iter_current = inode_ptr->indirect2;
-        int32_t indirect2_level1_iter_end = inode_ptr->indirect2 + superblock_ptr->cluster_size;
-
-        FILE *indirect2_file_read = fopen(filename, "r+b");
-        int32_t level1_debug_iter = 0;
-
-        // Nepřímá adresa - iterace level 1
-        while(indirect2_level1_iter_current < indirect2_level1_iter_end && address_writen == FALSE){
-            memset(indirect2_level1_iter_data, 0, sizeof(int32_t));
-            fseek(indirect2_file_read, indirect2_level1_iter_current, SEEK_SET);
-            fread(indirect2_level1_iter_data, sizeof(int32_t), 1, indirect2_file_read);
-
-            // Pokud je ukazatel NULL, alokuj nový cluster a vrat na něj adresu
-            if(*indirect2_level1_iter_data == 0){
-                int32_t indirect2_level1_allocation_index = bitmap_find_free_cluster_index(filename);
-
-                if (indirect2_level1_allocation_index < 0) {
-                    log_debug("inode_add_data_address_slow: Nelze alokovat 2. neprimou adresu úrovně 1, nedostatek volnych clusteru!\n");
-                    return -6;
-                }
-
-                int32_t indirect2_level1_allocation_address = bitmap_index_to_cluster_address(filename,
-                                                                                       indirect2_level1_allocation_index);
-                bitmap_set(filename, indirect2_level1_allocation_index, 1, TRUE);
-
-                // Nulování datového bloku
-                allocation_clear_cluster(filename, indirect2_level1_allocation_address);
-
-                // Zápis do inode
-                fseek(indirect2_file_read, indirect2_level1_iter_current, SEEK_SET);
-                fwrite(&indirect2_level1_allocation_address, sizeof(indirect2_level1_allocation_address), 1, indirect2_file_read);
-                fflush(indirect2_file_read);
-
-                // Zápis na VFS
-                inode_write_to_index(filename, inode_ptr->id - 1, inode_ptr);
-                log_trace("inode_add_data_address_slow: Hodnota 2. nepřímého odkazu level 1, iterace %d pro inode ID=%d nastavena na %d\n", level1_debug_iter,inode_ptr->id,
-                          indirect2_level1_allocation_address);
-            }
-
-            // Nepřímá adresa - iterace level 2
-            int32_t *indirect2_level2_iter_data = malloc(sizeof(int32_t));
-            int32_t indirect2_level2_iter_current = *indirect2_level1_iter_data;
-            int32_t indirect2_level2_iter_end = indirect2_level2_iter_current + superblock_ptr->cluster_size;
-
-            int32_t level2_debug_iter = 0;
-
-            while(indirect2_level2_iter_current < indirect2_level2_iter_end && address_writen == FALSE){
-                // Prečtení adresy levelu 2
-                memset(indirect2_level2_iter_data, 0, sizeof(int32_t));
-                fseek(indirect2_file_read, indirect2_level2_iter_current, SEEK_SET);
-                fread(indirect2_level2_iter_data, sizeof(int32_t), 1, indirect2_file_read);
-
-                // Pokud je adresa NULL - alokuj a zapiš
-                if(*indirect2_level2_iter_data == 0){
-                    int32_t indirect2_level2_allocation_index = bitmap_find_free_cluster_index(filename);
-
-                    if (indirect2_level2_allocation_index < 0) {
-                        log_debug("inode_add_data_address_slow: Nelze alokovat 2. neprimou adresu úrovně 1, nedostatek volnych clusteru!\n");
-                        return -6;
-                    }
+    int64_t per_block = mount->pointers_per_block;
+    int64_t count = INODE_DIRECT_COUNT + per_block + (per_block << mount->pointer_shift);
 
-                    int32_t indirect2_level2_allocation_address = bitmap_index_to_cluster_address(filename,
-                                                                                                  indirect2_level2_allocation_index);
-                    bitmap_set(filename, indirect2_level2_allocation_index, 1, TRUE);
-
-                    // Nulování datového bloku
-                    allocation_clear_cluster(filename, indirect2_level2_allocation_address);
-
-                    // Zápis do inode
-                    fseek(indirect2_file_read, indirect2_level2_iter_current, SEEK_SET);
-                    fwrite(&indirect2_level2_allocation_address, sizeof(indirect2_level2_allocation_address), 1, indirect2_file_read);
-                    fflush(indirect2_file_read);
-
-                    // Zápis na VFS
-                    inode_write_to_index(filename, inode_ptr->id - 1, inode_ptr);
-                    log_trace("inode_add_data_address_slow: Hodnota 2. nepřímého odkazu level 2, iterace %d pro inode ID=%d nastavena na %d\n", level2_debug_iter,inode_ptr->id,
-                              indirect2_level2_allocation_address);
-
-                    // Označení zápisu
-                    address_writen = TRUE;
-                    log_trace("inode_add_data_address_slow: Adresa databloku ulozena do indirect2 [level1=%d, level2=%d] (index %d)\n", level1_debug_iter, level2_debug_iter,index_written);
-                }
-
-                // Posun na další adresu v levelu 2
-                indirect2_level2_iter_current += sizeof(int32_t);
-                level2_debug_iter++;
-                index_written++;
-            }
-
-
-            // Posun na další položku levelu 2
-            indirect2_level1_iter_current += sizeof(int32_t);
-            level1_debug_iter++;
-            free(indirect2_level2_iter_data);
-        }
+    return count > INT32_MAX ? INT32_MAX : (int32_t)count;
+}
 
-        free(indirect2_level1_iter_data);
-        fclose(indirect2_file_read);
+/**
+ * Vrátí příznaky, se kterými se ve VFS zakládá nový soubor
+ *
+ * Od verze VFS_VERSION_EXTENTS dostanou soubory extenty, starší formáty
+ * příznaky nemají
+ *
+ * @param mount připojený VFS
+ * @return příznaky i-uzlu (INODE_FLAG_*)
+ */
+int16_t inode_default_flags(struct vfs_mount *mount){
+    if(mount == NULL || superblock_version(mount->superblock_ptr) < VFS_VERSION_EXTENTS){
+        return 0;
     }
 
+    return INODE_FLAG_EXTENTS;
+}
 
-    // Zabrání data bloku v bitmapě
-    if(address_writen == TRUE){
-        int32_t data_index_claimed = inode_data_index_from_address(filename, address);
-        bitmap_set(filename, data_index_claimed, 1, TRUE);
-    }
-    else{
-        return -7;
+/**
+ * Vynuluje všechny odkazy i-uzlu na databloky, příznaky zůstanou zachovány
+ *
+ * Databloky se neuvolňují (viz deallocate)
+ *
+ * @param inode_ptr struktura inode
+ */
+void inode_reset_mapping(struct inode *inode_ptr){
+    if(inode_ptr == NULL){
+        return;
     }
 
-    // Návrat indexu odkazu v INODE na data blok
-    // 1-5 = direct
-    // 6-1030 = indirect1
-    // zbytek = indirect2 - 1024 per level
-    /*
-     * INDIRECT2
-     *      I2L1 - 1024
-     *      I2L2 - 1024
-     */
-    return address_writen;
+    inode_ptr->allocated_clusters = 0;
+    inode_ptr->file_size = 0;
+    inode_ptr->direct1 = 0;
+    inode_ptr->direct2 = 0;
+    inode_ptr->direct3 = 0;
+    inode_ptr->direct4 = 0;
+    inode_ptr->direct5 = 0;
+    inode_ptr->indirect1 = 0;
+    inode_ptr->indirect2 = 0;
+    inode_ptr->extent_block = 0;
+    memset(inode_ptr->extents, 0, sizeof(inode_ptr->extents));
 }
 
 /**
  * Získá adresu uloženou na daném indexu uložených databloků
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_ptr struktura inode
  * @param index index odkazu v inode
  * @return (return <= 0: chyba | return > 0: adresa databloku ve VFS)
  */
-int32_t inode_get_datablock_index_value(char *filename, struct inode *inode_ptr, int32_t index){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
+int64_t inode_get_datablock_index_value(struct vfs_mount *mount, struct inode *inode_ptr, int32_t index){
+    // Kontrola připojení
+    if(mount == NULL){
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        return -2;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        return -3;
-    }
-
     // Kontrola ukazatele na inode
     if(inode_ptr == NULL) {
-        free(superblock_ptr);
         return -4;
     }
 
     // Pokud se pokusíme přistoupit k indexu, který není alokován -> chyba
     if(index > inode_ptr->allocated_clusters){
-        free(superblock_ptr);
         return -5;
     }
 
+    if((inode_ptr->flags & INODE_FLAG_EXTENTS) != 0){
+        return extent_get(mount, inode_ptr, index);
+    }
+
     // Přímé ukazatele 0-4
     if(index == 0){
-        free(superblock_ptr);
-        log_trace("inode_get_datablock_index_value: 0 -> direct1 -> %d\n", inode_ptr->direct1);
+        log_trace("inode_get_datablock_index_value: 0 -> direct1 -> %ld\n", (long)inode_ptr->direct1);
         return inode_ptr->direct1;
     }
 
     if(index == 1){
-        free(superblock_ptr);
-        log_trace("inode_get_datablock_index_value: 1 -> direct2 -> %d\n", inode_ptr->direct2);
+        log_trace("inode_get_datablock_index_value: 1 -> direct2 -> %ld\n", (long)inode_ptr->direct2);
         return inode_ptr->direct2;
     }
 
     if(index == 2){
-        free(superblock_ptr);
-        log_trace("inode_get_datablock_index_value: 2 -> direct3 -> %d\n", inode_ptr->direct3);
+        log_trace("inode_get_datablock_index_value: 2 -> direct3 -> %ld\n", (long)inode_ptr->direct3);
         return inode_ptr->direct3;
     }
 
     if(index == 3){
-        free(superblock_ptr);
-        log_trace("inode_get_datablock_index_value: 3 -> direct4 -> %d\n", inode_ptr->direct4);
+        log_trace("inode_get_datablock_index_value: 3 -> direct4 -> %ld\n", (long)inode_ptr->direct4);
         return inode_ptr->direct4;
     }
 
     if(index == 4){
-        free(superblock_ptr);
-        log_trace("inode_get_datablock_index_value: 4 -> direct5 -> %d\n", inode_ptr->direct5);
+        log_trace("inode_get_datablock_index_value: 4 -> direct5 -> %ld\n", (long)inode_ptr->direct5);
         return inode_ptr->direct5;
     }
 
-    // 1. Nepřímý ukazatel: 5-1028
-    if(index > 4 && index < 1029) {
-        int32_t indirect1_index = index - 5;
-        int32_t indirect1_address = inode_ptr->indirect1 + (indirect1_index * sizeof(int32_t));
-
-        // Alokace paměti pro čtení
-        int32_t *indirect_address_read = malloc(sizeof(int32_t));
-        // Nulování obsahu paměti
-        (*indirect_address_read) = 0;
-        // Otevření souboru ke čtení
-        FILE *file = fopen(filename, "r+b");
-        // Nastavení ukazatele
-        fseek(file, indirect1_address, SEEK_SET);
-        // Přečtení data
-        fread(indirect_address_read, sizeof(int32_t), 1, file);
-
-        // Přesun dat na heap
-        int32_t data_rtn = (*indirect_address_read);
-        // Uvolnění zdrojů
-        fclose(file);
-        free(indirect_address_read);
+    int32_t indirect1_end = INODE_DIRECT_COUNT + mount->pointers_per_block;
+
+    // 1. Nepřímý ukazatel: 5 až 5 + počet odkazů v bloku
+    if(index >= INODE_DIRECT_COUNT && index < indirect1_end) {
+        // Blok ukazatelů neexistuje - celý rozsah je díra
+        if(inode_ptr->indirect1 == 0){
+            return 0;
+        }
+
+        int32_t indirect1_index = index - INODE_DIRECT_COUNT;
+        int64_t indirect1_address = inode_ptr->indirect1 + (indirect1_index * sizeof(int32_t));
+
+        // Přečtení ukazatele (přímo z mapy, pokud je VFS namapován)
+        int64_t data_rtn = inode_read_pointer(mount, indirect1_address);
 
         // Návrat hodnoty
-        log_trace("inode_get_datablock_index_value: %d -> indirect1[%d] -> %d\n", index, indirect1_index, inode_ptr->direct1);
-        free(superblock_ptr);
+        log_trace("inode_get_datablock_index_value: %d -> indirect1[%d] -> %ld\n", index, indirect1_index, (long)data_rtn);
         return data_rtn;
     }
 
-    if(index > 1028){
-        int32_t indirect2_level1_index = (int32_t)floor(((double)(index-1029))/1024);
-        int32_t indirect2_level2_index = (index - 1029) % 1024;
+    if(index >= indirect1_end){
+        if(inode_ptr->indirect2 == 0){
+            return 0;
+        }
 
-        // Otevření souboru ke čtení a zápisu
-        FILE *indirect2_file = fopen(filename, "r+b");
+        int32_t indirect2_level1_index = (index - indirect1_end) >> mount->pointer_shift;
+        int32_t indirect2_level2_index = (index - indirect1_end) & (mount->pointers_per_block - 1);
 
-        // Získání adresy ukazatele na datablok - úroven 1
-        int32_t indirect2_level1_address = inode_ptr->indirect2 + (indirect2_level1_index * sizeof(int32_t));
 
-        // Alokace paměti pro čtení
-        int32_t *indirect2_level1_data = malloc(sizeof(int32_t));
-        int32_t *indirect2_level2_data = malloc(sizeof(int32_t));
+        // Získání adresy ukazatele na datablok - úroven 1
+        int64_t indirect2_level1_address = inode_ptr->indirect2 + (indirect2_level1_index * sizeof(int32_t));
 
-        // Nulování paměti
-        memset(indirect2_level1_data, 0, sizeof(int32_t));
-        // Nastavení místa čtení v souboru
-        fseek(indirect2_file, indirect2_level1_address, SEEK_SET);
-        // Čtení dat
-        fread(indirect2_level1_data, sizeof(int32_t), 1, indirect2_file);
+        // Čtení adresy level1
+        int64_t indirect2_level1_data = inode_read_pointer(mount, indirect2_level1_address);
+        int64_t rtn_data = 0;
 
         // Čtení adresy level2
-        if(*indirect2_level1_data != 0){
-            // Adresa kam zapsat
-            int32_t indirect2_level2_address = *indirect2_level1_data + (indirect2_level2_index * sizeof(int32_t));
-
-            // Zápis adresy na level 2
-            fseek(indirect2_file, indirect2_level2_address, SEEK_SET);
-            fread(indirect2_level2_data, sizeof(int32_t), 1, indirect2_file);
+        if(indirect2_level1_data != 0){
+            int64_t indirect2_level2_address = indirect2_level1_data + (indirect2_level2_index * sizeof(int32_t));
+            rtn_data = inode_read_pointer(mount, indirect2_level2_address);
         }
 
-        // Uvolnění zdrojů a přesun na heap
-        free(indirect2_level1_data);
-        int32_t rtn_data = (*indirect2_level2_data);
-
         // Logging
-        log_trace("inode_get_datablock_index_value: %d -> indirect2[%d][%d] -> %d\n", index, indirect2_level1_index, indirect2_level2_index, rtn_data);
+        log_trace("inode_get_datablock_index_value: %d -> indirect2[%d][%d] -> %ld\n", index, indirect2_level1_index, indirect2_level2_index, (long)rtn_data);
 
-        free(indirect2_level2_data);
-        free(superblock_ptr);
-        fclose(indirect2_file);
         return rtn_data;
 
     }
 
-    free(superblock_ptr);
     return 0;
 
 
@@ -777,46 +725,49 @@ int32_t inode_get_datablock_index_value(char *filename, struct inode *inode_ptr,
 /**
  * Přidá nový ukazatel na datový blok pro strukturu - rychlejší verze
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_ptr ukazatel na pozměňovaný inode
  * @return výsledek operace
  */
-bool inode_add_data_address(char *filename, struct inode *inode_ptr, int32_t address){
-    // Kontrola délky názvu souboru
-    if(strlen(filename) < 1){
+bool inode_add_data_address(struct vfs_mount *mount, struct inode *inode_ptr, int64_t address){
+    // Kontrola připojení
+    if(mount == NULL){
         return -1;
     }
 
-    // Ověření existence souboru
-    if(file_exist(filename) != TRUE){
-        return -2;
-    }
-
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(filename);
-
-    // Ověření ziskání superbloku
-    if(superblock_ptr == NULL){
-        return -3;
-    }
-
     // Kontrola zda adresa je validní adresou začátku clusteru
-    if(inode_data_index_from_address(filename, address) < 0){
-        free(superblock_ptr);
+    if(inode_data_index_from_address(mount, address) < 0){
         return -4;
     }
 
     // Kontrola ukazatele na inode
     if(inode_ptr == NULL) {
-        free(superblock_ptr);
         return -5;
     }
 
+    // Všechny odkazy i-uzlu jsou obsazené
+    if(inode_ptr->allocated_clusters >= inode_max_clusters(mount, inode_ptr)){
+        log_debug("inode_add_data_address: Inode ID=%d nema volny odkaz na datablok!\n", inode_ptr->id);
+        return -8;
+    }
+
     // Zda je adresa zapsaná
     bool address_writen = FALSE;
+    int32_t indirect1_end = INODE_DIRECT_COUNT + mount->pointers_per_block;
+
+    // Připojení k extentům
+    if((inode_ptr->flags & INODE_FLAG_EXTENTS) != 0){
+        int32_t appended = extent_append(mount, inode_ptr, address);
+
+        if(appended != 0){
+            return (bool)appended;
+        }
+
+        address_writen = TRUE;
+    }
 
     // Zápis pro direct1 - direct5
-    if(inode_ptr->allocated_clusters == 0){
+    if(address_writen == FALSE && inode_ptr->allocated_clusters == 0){
         inode_ptr->direct1 = address;
         address_writen = TRUE;
         log_trace("inode_add_data_address: Adresa databloku ulozena do direct1 (pointer_index: 0)\n");
@@ -847,173 +798,640 @@ bool inode_add_data_address(char *filename, struct inode *inode_ptr, int32_t add
     }
 
     // Alokace pro 1. nepřímý odkaz v případě, že je potřeba
-    if(address_writen == FALSE && inode_ptr->allocated_clusters > 4 && inode_ptr->allocated_clusters < 1029 && inode_ptr->indirect1 == 0){
-        int32_t indirect1_allocation_index = bitmap_find_free_cluster_index(filename);
+    if(address_writen == FALSE && inode_ptr->allocated_clusters >= INODE_DIRECT_COUNT && inode_ptr->allocated_clusters < indirect1_end && inode_ptr->indirect1 == 0){
+        int32_t indirect1_allocation_index = bitmap_find_free_cluster_index(mount);
 
         if(indirect1_allocation_index < 0){
             log_debug("inode_add_data_address: Nelze alokovat 1. neprimou adresu, nedostatek volnych clusteru!\n");
-            free(superblock_ptr);
             return -5;
         }
 
-        int32_t indirect1_allocation_address = bitmap_index_to_cluster_address(filename, indirect1_allocation_index);
-        bitmap_set(filename, indirect1_allocation_index, 1, TRUE);
+        int64_t indirect1_allocation_address = bitmap_index_to_cluster_address(mount, indirect1_allocation_index);
+        bitmap_set(mount, indirect1_allocation_index, 1, TRUE);
 
         // Nulování datového bloku
-        allocation_clear_cluster(filename, indirect1_allocation_address);
+        allocation_clear_cluster(mount, indirect1_allocation_address);
         // Zápis do inode
         inode_ptr->indirect1 = indirect1_allocation_address;
         // Zápis na VFS
-        inode_write_to_index(filename, inode_ptr->id - 1, inode_ptr);
-        log_trace("inode_add_data_address: Hodnota nepřímého odkazu pro ID=%d nastavena na %d\n", inode_ptr->id, inode_ptr->indirect1);
+        inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
+        log_trace("inode_add_data_address: Hodnota nepřímého odkazu pro ID=%d nastavena na %ld\n", inode_ptr->id, (long)inode_ptr->indirect1);
     }
 
-    // Zápis do indexů 5-1028
-    if(address_writen == FALSE && inode_ptr->allocated_clusters > 4 && inode_ptr->allocated_clusters < 1029){
-        // -5 = OFFSET PRO LINEÁRNÍ POSUN POČÁTKU INDEXACE -> vytvoří 0-1023
-        int32_t indirect1_write_index = inode_ptr->allocated_clusters - 5;
-        int32_t indirect1_write_address = inode_ptr->indirect1 + (indirect1_write_index * sizeof(int32_t));
+    // Zápis do indexů 1. nepřímého bloku
+    if(address_writen == FALSE && inode_ptr->allocated_clusters >= INODE_DIRECT_COUNT && inode_ptr->allocated_clusters < indirect1_end){
+        // Posun počátku indexace za přímé odkazy -> vytvoří 0 až (počet odkazů v bloku - 1)
+        int32_t indirect1_write_index = inode_ptr->allocated_clusters - INODE_DIRECT_COUNT;
+        int64_t indirect1_write_address = inode_ptr->indirect1 + (indirect1_write_index * sizeof(int32_t));
 
         //log_trace("inode_add_data_address: Indirect2 Transformation %d->indirect2[%d]\n", inode_ptr->allocated_clusters, indirect1_write_index);
 
-        FILE *indirect1_file_write = fopen(filename, "r+b");
-        fseek(indirect1_file_write, indirect1_write_address, SEEK_SET);
-        fwrite(&address, sizeof(address), 1, indirect1_file_write);
-        fflush(indirect1_file_write);
-        fclose(indirect1_file_write);
+        inode_write_pointer(mount, indirect1_write_address, address);
 
-        log_trace("inode_add_data_address: Adresa databloku ulozena do indirect1[%d] (addr: %d, value: %d, pointer_index: %d)\n", indirect1_write_index, indirect1_write_address, address, inode_ptr->allocated_clusters);
+        log_trace("inode_add_data_address: Adresa databloku ulozena do indirect1[%d] (addr: %ld, value: %ld, pointer_index: %d)\n", indirect1_write_index, (long)indirect1_write_address, (long)address, inode_ptr->allocated_clusters);
         address_writen = TRUE;
 
     }
 
     // Alokace pro inode->indirect2 pokud je ukazatel NULL
-    if (address_writen == FALSE && inode_ptr->allocated_clusters > 1028 && inode_ptr->indirect2 == 0) {
-        int32_t indirect2_allocation_index = bitmap_find_free_cluster_index(filename);
+    if (address_writen == FALSE && inode_ptr->allocated_clusters >= indirect1_end && inode_ptr->indirect2 == 0) {
+        int32_t indirect2_allocation_index = bitmap_find_free_cluster_index(mount);
 
         if (indirect2_allocation_index < 0) {
             log_debug("inode_add_data_address: Nelze alokovat 2. neprimou adresu, nedostatek volnych clusteru!\n");
-            free(superblock_ptr);
             return -6;
         }
 
-        int32_t indirect2_allocation_address = bitmap_index_to_cluster_address(filename,
+        int64_t indirect2_allocation_address = bitmap_index_to_cluster_address(mount,
                                                                                indirect2_allocation_index);
-        bitmap_set(filename, indirect2_allocation_index, 1, TRUE);
+        bitmap_set(mount, indirect2_allocation_index, 1, TRUE);
 
         // Zápis do inode
         inode_ptr->indirect2 = indirect2_allocation_address;
         // Nulování datového bloku
-        allocation_clear_cluster(filename, inode_ptr->indirect2);
+        allocation_clear_cluster(mount, inode_ptr->indirect2);
         // Zápis na VFS
-        inode_write_to_index(filename, inode_ptr->id - 1, inode_ptr);
-        log_trace("inode_add_data_address: Hodnota 2. nepřímého odkazu pro ID=%d nastavena na %d\n", inode_ptr->id,
-                  inode_ptr->indirect2);
+        inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
+        log_trace("inode_add_data_address: Hodnota 2. nepřímého odkazu pro ID=%d nastavena na %ld\n", inode_ptr->id,
+                  (long)inode_ptr->indirect2);
     }
 
     // Zápis databloků pro indirect2
-    if(address_writen == FALSE && inode_ptr->allocated_clusters > 1028 && inode_ptr->indirect2 != 0){
-        int32_t indirect2_level1_write_index = (int32_t)floor(((double)(inode_ptr->allocated_clusters-1029))/1024);
-        int32_t indirect2_level2_write_index = (inode_ptr->allocated_clusters - 1029) % 1024;
+    if(address_writen == FALSE && inode_ptr->allocated_clusters >= indirect1_end && inode_ptr->indirect2 != 0){
+        int32_t indirect2_level1_write_index = (inode_ptr->allocated_clusters - indirect1_end) >> mount->pointer_shift;
+        int32_t indirect2_level2_write_index = (inode_ptr->allocated_clusters - indirect1_end) & (mount->pointers_per_block - 1);
 
-        // Otevření souboru ke čtení a zápisu
-        FILE *indirect2_file = fopen(filename, "r+b");
-        fflush(indirect2_file);
 
         // Získání adresy ukazatele na datablok - úroven 1
-        int32_t indirect2_level1_address = inode_ptr->indirect2 + (indirect2_level1_write_index * sizeof(int32_t));
-
-        // Alokace paměti pro čtení
-        int32_t *indirect2_level1_data = malloc(sizeof(int32_t));
-        // Nulování paměti
-        memset(indirect2_level1_data, 0, sizeof(int32_t));
-        // Nastavení místa čtení v souboru
-        fflush(indirect2_file);
-        fseek(indirect2_file, indirect2_level1_address, SEEK_SET);
+        int64_t indirect2_level1_address = inode_ptr->indirect2 + (indirect2_level1_write_index * sizeof(int32_t));
+
         // Čtení dat
-        fread(indirect2_level1_data, sizeof(int32_t), 1, indirect2_file);
-        fflush(indirect2_file);
+        int64_t indirect2_level1_data = inode_read_pointer(mount, indirect2_level1_address);
 
 
         // Alokace clusteru pokud je odkaz NULL
-        if(*indirect2_level1_data == 0){
-            int32_t indirect2_level1_allocation_index = bitmap_find_free_cluster_index(filename);
+        if(indirect2_level1_data == 0){
+            int32_t indirect2_level1_allocation_index = bitmap_find_free_cluster_index(mount);
 
             if (indirect2_level1_allocation_index < 0) {
                 log_debug("inode_add_data_address: Nelze alokovat 2. neprimou adresu úrovně 1, nedostatek volnych clusteru!\n");
                 return -6;
             }
 
-            int32_t indirect2_level1_allocation_address = bitmap_index_to_cluster_address(filename,
+            int64_t indirect2_level1_allocation_address = bitmap_index_to_cluster_address(mount,
                                                                                           indirect2_level1_allocation_index);
-            bitmap_set(filename, indirect2_level1_allocation_index, 1, TRUE);
+            bitmap_set(mount, indirect2_level1_allocation_index, 1, TRUE);
 
             // Nulování datového bloku
-            allocation_clear_cluster(filename, indirect2_level1_allocation_address);
+            allocation_clear_cluster(mount, indirect2_level1_allocation_address);
 
             // Zápis do inode
-            fflush(indirect2_file);
-            fseek(indirect2_file, indirect2_level1_address, SEEK_SET);
-            fwrite(&indirect2_level1_allocation_address, sizeof(int32_t), 1, indirect2_file);
-            fflush(indirect2_file);
+            inode_write_pointer(mount, indirect2_level1_address, indirect2_level1_allocation_address);
 
-            log_trace("inode_add_data_address: Hodnota odkazu inode ID=%d indirect2[%d] nastavena na %d \n", inode_ptr->id, indirect2_level1_write_index,
-                      indirect2_level1_allocation_address);
+            log_trace("inode_add_data_address: Hodnota odkazu inode ID=%d indirect2[%d] nastavena na %ld \n", inode_ptr->id, indirect2_level1_write_index,
+                      (long)indirect2_level1_allocation_address);
         }
 
-        // Uvolnění bufferu pro čtení
-        fflush(indirect2_file);
-
         // Přečtení znovu jako pojistka
-        // Nulování paměti
-        memset(indirect2_level1_data, 0, sizeof(int32_t));
-        // Nastavení místa čtení v souboru
-        fflush(indirect2_file);
-        fseek(indirect2_file, indirect2_level1_address, SEEK_SET);
-        // Čtení dat
-        fread(indirect2_level1_data, sizeof(int32_t), 1, indirect2_file);
-        fflush(indirect2_file);
+        indirect2_level1_data = inode_read_pointer(mount, indirect2_level1_address);
 
 
         // Povedlo se zapsat
-        if(*indirect2_level1_data != 0){
+        if(indirect2_level1_data != 0){
             // Adresa kam zapsat
-            int32_t indirect2_level2_address = *indirect2_level1_data + (indirect2_level2_write_index * sizeof(int32_t));
+            int64_t indirect2_level2_address = indirect2_level1_data + (indirect2_level2_write_index * sizeof(int32_t));
 
             // Zápis adresy na level 2
-            fflush(indirect2_file);
-            fseek(indirect2_file, indirect2_level2_address, SEEK_SET);
-            fwrite(&address, sizeof(int32_t), 1, indirect2_file);
-            fflush(indirect2_file);
+            inode_write_pointer(mount, indirect2_level2_address, address);
 
             // Logování
-            log_trace("inode_add_data_address: Adresa databloku ulozena do indirect2[%d][%d] (addr: %d, value: %d, pointer_index: %d)\n", indirect2_level1_write_index, indirect2_level2_write_index, indirect2_level2_address, address, inode_ptr->allocated_clusters);
+            log_trace("inode_add_data_address: Adresa databloku ulozena do indirect2[%d][%d] (addr: %ld, value: %ld, pointer_index: %d)\n", indirect2_level1_write_index, indirect2_level2_write_index, (long)indirect2_level2_address, (long)address, inode_ptr->allocated_clusters);
             address_writen = TRUE;
 
         }
-
-
-        fclose(indirect2_file);
-        free(indirect2_level1_data);
     }
 
     // Zabrání data bloku v bitmapě
     if(address_writen == TRUE){
-        int32_t data_index_claimed = inode_data_index_from_address(filename, address);
-        bitmap_set(filename, data_index_claimed, 1, TRUE);
+        int32_t data_index_claimed = inode_data_index_from_address(mount, address);
+        bitmap_set(mount, data_index_claimed, 1, TRUE);
         inode_ptr->allocated_clusters++;
-        inode_write_to_index(filename, inode_ptr->id - 1, inode_ptr);
-        free(superblock_ptr);
+        inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
         return 0;
     }
     else{
-        free(superblock_ptr);
         return -7;
     }
 
     /*
+     * N = počet odkazů v nepřímém bloku (cluster_size / 4)
      * 0 - 4: directX+1
-     * 5 - 1028: indirect1[X-5]
-     * 1029 - END: indirect2[(X-1028)/1024][(X-1030)%1024]
+     * 5 - 5+N-1: indirect1[X-5]
+     * 5+N - END: indirect2[(X-5-N) >> log2(N)][(X-5-N) & (N-1)]
      */
-}
\ No newline at end of file
+}
+/**
+ * Načte adresy databloků i-uzlu s indexy <from, count) do pole map
+ *
+ * Nepřímé bloky ukazatelů čte vždy celé jedním čtením, místo čtení
+ * jednotlivých 4bytových ukazatelů
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param map cílové pole adres (alespoň count položek)
+ * @param from první načítaný index
+ * @param count index za posledním načítaným indexem
+ * @return (return < 0: chyba | return >= 0: počet načtených adres)
+ */
+int32_t inode_load_block_map(struct vfs_mount *mount, struct inode *inode_ptr, int64_t *map, int32_t from, int32_t count){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatelů
+    if(inode_ptr == NULL || map == NULL){
+        return -2;
+    }
+
+    if((inode_ptr->flags & INODE_FLAG_EXTENTS) != 0){
+        return extent_load_block_map(mount, inode_ptr, map, from, count);
+    }
+
+    if(count > inode_ptr->allocated_clusters){
+        count = inode_ptr->allocated_clusters;
+    }
+
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int32_t indirect1_end = INODE_DIRECT_COUNT + mount->pointers_per_block;
+    int64_t direct[INODE_DIRECT_COUNT] = {inode_ptr->direct1, inode_ptr->direct2, inode_ptr->direct3, inode_ptr->direct4, inode_ptr->direct5};
+
+    // Buffery pro celé bloky ukazatelů
+    int32_t *indirect1_block = NULL;
+    int32_t *indirect2_level1_block = NULL;
+    int32_t *indirect2_level2_block = NULL;
+    int32_t indirect2_level2_loaded = -1;
+
+    int32_t index;
+    for(index = from; index < count; index++){
+        // Přímé ukazatele 0-4
+        if(index < INODE_DIRECT_COUNT){
+            map[index] = direct[index];
+            continue;
+        }
+
+        // 1. Nepřímý ukazatel
+        if(index < indirect1_end){
+            if(indirect1_block == NULL){
+                indirect1_block = malloc(cluster_size);
+                memset(indirect1_block, 0, cluster_size);
+
+                // Chybějící blok ukazatelů - samé díry
+                if(inode_ptr->indirect1 != 0){
+                    mount_read(mount, inode_ptr->indirect1, indirect1_block, cluster_size);
+                }
+            }
+
+            map[index] = inode_pointer_to_address(mount, indirect1_block[index - INODE_DIRECT_COUNT]);
+            continue;
+        }
+
+        // 2. Nepřímý ukazatel
+        int32_t indirect2_level1_index = (index - indirect1_end) >> mount->pointer_shift;
+        int32_t indirect2_level2_index = (index - indirect1_end) & (mount->pointers_per_block - 1);
+
+        if(indirect2_level1_block == NULL){
+            indirect2_level1_block = malloc(cluster_size);
+            indirect2_level2_block = malloc(cluster_size);
+            memset(indirect2_level1_block, 0, cluster_size);
+
+            if(inode_ptr->indirect2 != 0){
+                mount_read(mount, inode_ptr->indirect2, indirect2_level1_block, cluster_size);
+            }
+        }
+
+        if(indirect2_level2_loaded != indirect2_level1_index){
+            memset(indirect2_level2_block, 0, cluster_size);
+
+            if(indirect2_level1_block[indirect2_level1_index] != 0){
+                mount_read(mount, inode_pointer_to_address(mount, indirect2_level1_block[indirect2_level1_index]), indirect2_level2_block, cluster_size);
+            }
+
+            indirect2_level2_loaded = indirect2_level1_index;
+        }
+
+        map[index] = inode_pointer_to_address(mount, indirect2_level2_block[indirect2_level2_index]);
+    }
+
+    // Uvolnění zdrojů
+    free(indirect1_block);
+    free(indirect2_level1_block);
+    free(indirect2_level2_block);
+
+    return count > from ? count - from : 0;
+}
+
+/**
+ * Prodlouží mapu databloků i-uzlu o díry - nic se nealokuje, díra se čte jako nuly
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param count počet přidaných děr
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t inode_add_holes(struct vfs_mount *mount, struct inode *inode_ptr, int32_t count){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatele na inode
+    if(inode_ptr == NULL || count < 0){
+        return -2;
+    }
+
+    if(count > inode_max_clusters(mount, inode_ptr) - inode_ptr->allocated_clusters){
+        log_debug("inode_add_holes: Inode ID=%d by prekrocil maximalni pocet databloku!\n", inode_ptr->id);
+        return -3;
+    }
+
+    if(count == 0){
+        return 0;
+    }
+
+    inode_ptr->allocated_clusters += count;
+    inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
+
+    log_trace("inode_add_holes: Inode ID=%d ma %d novych der (celkem %d odkazu)\n", inode_ptr->id, count, inode_ptr->allocated_clusters);
+    return 0;
+}
+
+/**
+ * Spočítá databloky, které i-uzel skutečně zabírá (bez děr)
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @return (return < 0: chyba | return >= 0: počet databloků)
+ */
+int32_t inode_count_data_clusters(struct vfs_mount *mount, struct inode *inode_ptr){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatele na inode
+    if(inode_ptr == NULL){
+        return -2;
+    }
+
+    int32_t count = inode_ptr->allocated_clusters;
+    int64_t *map = malloc(sizeof(int64_t) * (count > 0 ? count : 1));
+
+    if(map == NULL){
+        return -3;
+    }
+
+    int32_t loaded = inode_load_block_map(mount, inode_ptr, map, 0, count);
+    int32_t used = 0;
+    int32_t i;
+
+    for(i = 0; i < loaded; i++){
+        if(map[i] != 0){
+            used++;
+        }
+    }
+
+    free(map);
+    return used;
+}
+
+/**
+ * Alokuje a vynuluje cluster pro blok ukazatelů na databloky
+ *
+ * @param mount připojený VFS
+ * @return (0: nedostatek volných clusterů | return > 0: adresa bloku)
+ */
+static int64_t inode_alloc_pointer_block(struct vfs_mount *mount){
+    int32_t index = bitmap_find_free_cluster_index(mount);
+
+    if(index < 0){
+        log_debug("inode_alloc_pointer_block: Nedostatek volnych clusteru pro blok ukazatelu!\n");
+        return 0;
+    }
+
+    int64_t address = bitmap_index_to_cluster_address(mount, index);
+    bitmap_set(mount, index, 1, TRUE);
+    allocation_clear_cluster(mount, address);
+
+    return address;
+}
+
+/**
+ * Přepíše adresu databloku uloženou na daném indexu i-uzlu (např. při kopírování při zápisu)
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param index index odkazu v inode (musí ležet v rozsahu allocated_clusters)
+ * @param address nová adresa databloku (0 = díra, datablok uvolní volající)
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t inode_set_datablock_index_value(struct vfs_mount *mount, struct inode *inode_ptr, int32_t index, int64_t address){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatele na inode
+    if(inode_ptr == NULL){
+        return -4;
+    }
+
+    // Lze přepsat pouze alokovaný odkaz
+    if(index < 0 || index >= inode_ptr->allocated_clusters){
+        return -5;
+    }
+
+    if((inode_ptr->flags & INODE_FLAG_EXTENTS) != 0){
+        return extent_set(mount, inode_ptr, index, address);
+    }
+
+    // Přímé ukazatele 0-4 jsou součástí i-uzlu
+    if(index < INODE_DIRECT_COUNT){
+        int64_t *direct[INODE_DIRECT_COUNT] = {&inode_ptr->direct1, &inode_ptr->direct2, &inode_ptr->direct3, &inode_ptr->direct4, &inode_ptr->direct5};
+        *direct[index] = address;
+        inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
+        return 0;
+    }
+
+    int64_t pointer_address;
+
+    int32_t indirect1_end = INODE_DIRECT_COUNT + mount->pointers_per_block;
+
+    // 1. Nepřímý ukazatel
+    if(index < indirect1_end){
+        // Díra v rozsahu bez bloku ukazatelů - blok vznikne až se zápisem databloku
+        if(inode_ptr->indirect1 == 0){
+            if(address == 0){
+                return 0;
+            }
+
+            inode_ptr->indirect1 = inode_alloc_pointer_block(mount);
+            if(inode_ptr->indirect1 == 0){
+                return -6;
+            }
+            inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
+        }
+
+        pointer_address = inode_ptr->indirect1 + (index - INODE_DIRECT_COUNT) * sizeof(int32_t);
+    } else {
+        // 2. Nepřímý ukazatel
+        int32_t indirect2_level1_index = (index - indirect1_end) >> mount->pointer_shift;
+        int32_t indirect2_level2_index = (index - indirect1_end) & (mount->pointers_per_block - 1);
+
+        if(inode_ptr->indirect2 == 0){
+            if(address == 0){
+                return 0;
+            }
+
+            inode_ptr->indirect2 = inode_alloc_pointer_block(mount);
+            if(inode_ptr->indirect2 == 0){
+                return -6;
+            }
+            inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
+        }
+
+        int64_t indirect2_level1_address = inode_ptr->indirect2 + indirect2_level1_index * sizeof(int32_t);
+        int64_t indirect2_level1_data = inode_read_pointer(mount, indirect2_level1_address);
+
+        if(indirect2_level1_data == 0){
+            if(address == 0){
+                return 0;
+            }
+
+            indirect2_level1_data = inode_alloc_pointer_block(mount);
+            if(indirect2_level1_data == 0){
+                return -6;
+            }
+            inode_write_pointer(mount, indirect2_level1_address, indirect2_level1_data);
+        }
+
+        pointer_address = indirect2_level1_data + indirect2_level2_index * sizeof(int32_t);
+    }
+
+    if(inode_write_pointer(mount, pointer_address, address) != TRUE){
+        return -7;
+    }
+
+    log_trace("inode_set_datablock_index_value: Odkaz %d inode ID=%d prepsan na %ld\n", index, inode_ptr->id, (long)address);
+    return 0;
+}
+
+/**
+ * Zkopíruje blok ukazatelů na databloky do nově alokovaného clusteru
+ *
+ * @param mount připojený VFS
+ * @param source adresa kopírovaného bloku ukazatelů
+ * @param buffer pomocný buffer o velikosti clusteru
+ * @return (return <= 0: chyba | return > 0: adresa kopie)
+ */
+static int64_t inode_copy_pointer_block(struct vfs_mount *mount, int64_t source, int32_t *buffer){
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int32_t copy_index = bitmap_find_free_cluster_index(mount);
+
+    if(copy_index < 0){
+        log_debug("inode_copy_pointer_block: Nedostatek volnych clusteru!\n");
+        return -1;
+    }
+
+    int64_t copy_address = bitmap_index_to_cluster_address(mount, copy_index);
+    bitmap_set(mount, copy_index, 1, TRUE);
+
+    memset(buffer, 0, cluster_size);
+    mount_read(mount, source, buffer, cluster_size);
+    mount_write(mount, copy_address, buffer, cluster_size);
+
+    return copy_address;
+}
+
+/**
+ * Nasdílí datové bloky i-uzlu source i-uzlu target (cp --reflink)
+ *
+ * Data se nekopírují - target dostane vlastní kopie bloků ukazatelů a datovým
+ * blokům se v tabulce sdílení přičte vlastník, zápis do sdíleného bloku
+ * později provede kopii (viz vfs_write)
+ *
+ * @param mount připojený VFS
+ * @param source i-uzel, jehož data se sdílí
+ * @param target cílový i-uzel bez alokovaných databloků
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t inode_clone_data(struct vfs_mount *mount, struct inode *source, struct inode *target){
+    // Kontrola připojení
+    if(mount == NULL){
+        return -1;
+    }
+
+    // Kontrola ukazatelů
+    if(source == NULL || target == NULL){
+        return -2;
+    }
+
+    // Cíl nesmí mít vlastní data - ta by se ztratila
+    if(target->allocated_clusters != 0){
+        log_debug("inode_clone_data: Cilovy inode ID=%d ma alokovane databloky!\n", target->id);
+        return -3;
+    }
+
+    int32_t count = source->allocated_clusters;
+
+    // Převod adres databloků na indexy clusterů
+    int64_t *addresses = malloc(sizeof(int64_t) * (count > 0 ? count : 1));
+    int32_t *indexes = malloc(sizeof(int32_t) * (count > 0 ? count : 1));
+
+    if(addresses == NULL || indexes == NULL){
+        free(addresses);
+        free(indexes);
+        return -4;
+    }
+
+    inode_load_block_map(mount, source, addresses, 0, count);
+
+    // Díry se nesdílí - v cíli zůstanou dírami
+    int32_t shared = 0;
+    int32_t i;
+    for(i = 0; i < count; i++){
+        if(addresses[i] == 0){
+            continue;
+        }
+
+        indexes[shared] = inode_data_index_from_address(mount, addresses[i]);
+
+        if(indexes[shared] < 0){
+            log_debug("inode_clone_data: Inode ID=%d odkazuje na neplatny datablok!\n", source->id);
+            free(addresses);
+            free(indexes);
+            return -5;
+        }
+
+        shared++;
+    }
+
+    // Sdílení všech databloků najednou - při chybě se nezmění nic
+    if(shared > 0 && refcount_share(mount, indexes, shared) != TRUE){
+        free(addresses);
+        free(indexes);
+        return -6;
+    }
+
+    // Extenty cíle se sestaví přímo z adres databloků
+    if(((source->flags | target->flags) & INODE_FLAG_EXTENTS) != 0){
+        int16_t flags = target->flags;
+        target->flags |= INODE_FLAG_EXTENTS;
+        target->allocated_clusters = count;
+        target->file_size = source->file_size;
+
+        int32_t built = extent_build(mount, target, addresses, count);
+
+        if(built != 0){
+            log_debug("inode_clone_data: Nedostatek volnych clusteru pro extenty!\n");
+            inode_reset_mapping(target);
+            target->flags = flags;
+
+            for(i = 0; i < shared; i++){
+                refcount_release(mount, indexes[i]);
+            }
+        }
+
+        free(addresses);
+        free(indexes);
+        return built != 0 ? -7 : 0;
+    }
+
+    free(addresses);
+
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int32_t entries = mount->pointers_per_block;
+    int32_t *buffer = malloc(cluster_size);
+    int32_t *level1 = malloc(cluster_size);
+    // Zkopírované bloky ukazatelů - pro případné zrušení klonu
+    int64_t *copies = malloc(sizeof(int64_t) * (entries + 2));
+    int32_t copied = 0;
+    int32_t result = 0;
+
+    // Vlastní kopie 1. nepřímého bloku
+    int64_t indirect1 = 0;
+    if(source->indirect1 != 0){
+        indirect1 = inode_copy_pointer_block(mount, source->indirect1, buffer);
+
+        if(indirect1 > 0){
+            copies[copied++] = indirect1;
+        } else {
+            result = -7;
+        }
+    }
+
+    // Vlastní kopie 2. nepřímého bloku i všech jeho bloků úrovně 2
+    int64_t indirect2 = 0;
+    if(result == 0 && source->indirect2 != 0){
+        memset(level1, 0, cluster_size);
+        mount_read(mount, source->indirect2, level1, cluster_size);
+
+        for(i = 0; i < entries && result == 0; i++){
+            if(level1[i] == 0){
+                continue;
+            }
+
+            int64_t level2 = inode_copy_pointer_block(mount, inode_pointer_to_address(mount, level1[i]), buffer);
+
+            if(level2 > 0){
+                level1[i] = inode_address_to_pointer(mount, level2);
+                copies[copied++] = level2;
+            } else {
+                result = -8;
+            }
+        }
+
+        if(result == 0){
+            int32_t level1_index = bitmap_find_free_cluster_index(mount);
+
+            if(level1_index >= 0){
+                indirect2 = bitmap_index_to_cluster_address(mount, level1_index);
+                bitmap_set(mount, level1_index, 1, TRUE);
+                mount_write(mount, indirect2, level1, cluster_size);
+            } else {
+                result = -8;
+            }
+        }
+    }
+
+    if(result == 0){
+        target->direct1 = source->direct1;
+        target->direct2 = source->direct2;
+        target->direct3 = source->direct3;
+        target->direct4 = source->direct4;
+        target->direct5 = source->direct5;
+        target->indirect1 = indirect1;
+        target->indirect2 = indirect2;
+        target->allocated_clusters = count;
+        target->file_size = source->file_size;
+        inode_write_to_index(mount, target->id - 1, target);
+    } else {
+        // Zrušení klonu - vrácení sdílení a uvolnění zkopírovaných bloků ukazatelů
+        log_debug("inode_clone_data: Nedostatek volnych clusteru pro bloky ukazatelu!\n");
+
+        for(i = 0; i < copied; i++){
+            bitmap_set(mount, inode_data_index_from_address(mount, copies[i]), 1, FALSE);
+        }
+
+        for(i = 0; i < shared; i++){
+            refcount_release(mount, indexes[i]);
+        }
+    }
+
+    free(copies);
+    free(level1);
+    free(buffer);
+    free(indexes);
+
+    return result;
+}
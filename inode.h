@@ -6,17 +6,101 @@
  */
 #include <stdint.h>
 #include "bool.h"
+#include "mount.h"
 
 
 /*
  * Konstanty
  */
 #define ID_ITEM_FREE 0
+#define INODE_DIRECT_COUNT 5    // Počet přímých odkazů na datové bloky v i-uzlu
+#define INODE_INLINE_EXTENTS 2  // Počet extentů uložených přímo v i-uzlu (INODE_FLAG_EXTENTS)
+
+/*
+ * Příznaky i-uzlu (od verze VFS_VERSION_EXTENTS)
+ */
+#define INODE_FLAG_EXTENTS 0x1  // Databloky jsou popsány extenty místo přímých a nepřímých odkazů
 
 /*
  * Struktury
  */
+
+/*
+ * Extent - souvislý úsek databloků souboru
+ */
+struct inode_extent {
+    int32_t logical;            // Index prvního databloku v souboru
+    int32_t length;             // Počet databloků úseku
+    int64_t address;            // Adresa prvního databloku ve VFS
+};
+
+/*
+ * I-uzel v paměti - adresy databloků jsou vždy byte adresy ve VFS
+ *
+ * I-uzel s příznakem INODE_FLAG_EXTENTS místo odkazů direct/indirect
+ * používá extenty (viz extent.h)
+ */
 struct inode {
+    int32_t id;                 // ID i-uzlu; pokud ID == ID_ITEM_FREE, je položka volná
+    int8_t type;                // Typ i-uzlu; 0 = soubor; 1 = složka; 2 = symlink
+    int8_t references;          // Počet odkazů na i-uzel; používá se pro hardlinky
+    int32_t allocated_clusters; // Počet odkazů na datové bloky včetně děr (odkaz 0 = díra, čte se jako nuly)
+    int64_t file_size;          // Velikost souboru v bytech
+    int64_t direct1;            // 1. přímý odkaz na datové bloky
+    int64_t direct2;            // 2. přímý odkaz na datové bloky
+    int64_t direct3;            // 3. přímý odkaz na datové bloky
+    int64_t direct4;            // 4. přímý odkaz na datové bloky
+    int64_t direct5;            // 5. přímý odkaz na datové bloky
+    int64_t indirect1;          // 1. nepřímý odkaz (odkaz - datové bloky)
+    int64_t indirect2;          // 2. nepřímý odkaz (odkaz - odkaz - datové bloky)
+    int16_t flags;              // Příznaky i-uzlu (INODE_FLAG_*)
+    int64_t extent_block;       // Blok indexu extentů za extenty v i-uzlu (0 - žádný)
+    struct inode_extent extents[INODE_INLINE_EXTENTS];  // Extenty uložené přímo v i-uzlu
+};
+
+/*
+ * I-uzel uložený ve VFS od verze VFS_VERSION_64BIT
+ *
+ * Odkazy jsou čísla clusterů (index + 1, 0 = žádný odkaz), stejně jsou
+ * uloženy i odkazy v nepřímých blocích
+ */
+struct inode_disk {
+    int32_t id;                 // ID i-uzlu; pokud ID == ID_ITEM_FREE, je položka volná
+    int8_t type;                // Typ i-uzlu; 0 = soubor; 1 = složka; 2 = symlink
+    int8_t references;          // Počet odkazů na i-uzel; používá se pro hardlinky
+    int16_t flags;              // Příznaky i-uzlu (INODE_FLAG_*), do verze VFS_VERSION_EXTENTS vždy 0
+    int32_t allocated_clusters; // Počet alokovavaných clusterů (počet odkazů na datové bloky)
+    int32_t direct1;            // 1. přímý odkaz na datové bloky
+    int32_t direct2;            // 2. přímý odkaz na datové bloky
+    int32_t direct3;            // 3. přímý odkaz na datové bloky
+    int32_t direct4;            // 4. přímý odkaz na datové bloky
+    int32_t direct5;            // 5. přímý odkaz na datové bloky
+    int32_t indirect1;          // 1. nepřímý odkaz (odkaz - datové bloky)
+    int32_t indirect2;          // 2. nepřímý odkaz (odkaz - odkaz - datové bloky)
+    int64_t file_size;          // Velikost souboru v bytech
+};
+
+/*
+ * Extent uložený ve VFS
+ */
+struct inode_extent_disk {
+    int32_t logical;            // Index prvního databloku v souboru
+    int32_t cluster;            // Číslo prvního clusteru (index + 1)
+    int32_t length;             // Počet databloků úseku
+};
+
+/*
+ * Obsah odkazů direct1 - indirect2 v i-uzlu s příznakem INODE_FLAG_EXTENTS
+ */
+struct inode_extent_root {
+    int32_t extent_block;       // Číslo clusteru bloku indexu extentů (0 - žádný)
+    struct inode_extent_disk extents[INODE_INLINE_EXTENTS];    // Extenty uložené přímo v i-uzlu
+};
+
+/*
+ * I-uzel uložený ve VFS starších verzí - odkazy jsou 32bitové byte adresy
+ */
+struct inode_legacy {
     int32_t id;                 // ID i-uzlu; pokud ID == ID_ITEM_FREE, je položka volná
     int8_t type;                // Typ i-uzlu; 0 = soubor; 1 = složka; 2 = symlink
     int8_t references;          // Počet odkazů na i-uzel; používá se pro hardlinky
@@ -31,6 +115,115 @@ struct inode {
     int32_t indirect2;          // 2. nepřímý odkaz (odkaz - odkaz - datové bloky)
 };
 
+/**
+ * Vrátí velikost záznamu i-uzlu uloženého ve VFS
+ *
+ * @param mount připojený VFS
+ * @return velikost záznamu v byte
+ */
+int32_t inode_record_size(struct vfs_mount *mount);
+
+/**
+ * Převede záznam i-uzlu přečtený z VFS do struktury inode
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr cílová struktura
+ * @param raw záznam i-uzlu (inode_record_size byte)
+ */
+void inode_decode(struct vfs_mount *mount, struct inode *inode_ptr, const void *raw);
+
+/**
+ * Přečte a převede záznam i-uzlu přímo z VFS (obchází mezipaměť i-uzlů)
+ *
+ * @param mount připojený VFS
+ * @param inode_address adresa záznamu ve VFS
+ * @param inode_ptr cílová struktura
+ * @return výsledek operace
+ */
+bool inode_read_record(struct vfs_mount *mount, int64_t inode_address, struct inode *inode_ptr);
+
+/**
+ * Převede a zapíše záznam i-uzlu přímo do VFS (obchází mezipaměť i-uzlů)
+ *
+ * @param mount připojený VFS
+ * @param inode_address adresa záznamu ve VFS
+ * @param inode_ptr zapisovaná struktura
+ * @return výsledek operace
+ */
+bool inode_write_record(struct vfs_mount *mount, int64_t inode_address, struct inode *inode_ptr);
+
+/**
+ * Převede odkaz uložený ve VFS (i-uzel, nepřímý blok) na adresu clusteru
+ *
+ * @param mount připojený VFS
+ * @param pointer uložený odkaz
+ * @return adresa clusteru ve VFS (0 - žádný odkaz)
+ */
+int64_t inode_pointer_to_address(struct vfs_mount *mount, int32_t pointer);
+
+/**
+ * Převede adresu clusteru na odkaz ukládaný do VFS (i-uzel, nepřímý blok)
+ *
+ * @param mount připojený VFS
+ * @param address adresa clusteru ve VFS (0 - žádný odkaz)
+ * @return uložený odkaz
+ */
+int32_t inode_address_to_pointer(struct vfs_mount *mount, int64_t address);
+
+/**
+ * Přečte jeden odkaz na datový blok uložený na dané adrese VFS
+ *
+ * @param mount připojený VFS
+ * @param address adresa odkazu ve VFS
+ * @return adresa databloku (0 pokud odkaz není nebo jej nelze přečíst)
+ */
+int64_t inode_read_pointer(struct vfs_mount *mount, int64_t address);
+
+/**
+ * Zapíše jeden odkaz na datový blok na danou adresu VFS
+ *
+ * @param mount připojený VFS
+ * @param address adresa odkazu ve VFS
+ * @param value adresa databloku (0 - žádný odkaz)
+ * @return výsledek operace
+ */
+bool inode_write_pointer(struct vfs_mount *mount, int64_t address, int64_t value);
+
+/**
+ * Vrátí největší velikost souboru, kterou lze do i-uzlu uložit
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @return maximální velikost souboru v byte
+ */
+int64_t inode_max_file_size(struct vfs_mount *mount, struct inode *inode_ptr);
+
+/**
+ * Vrátí počet odkazů na databloky, které lze uložit do i-uzlu
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @return maximální počet databloků i-uzlu
+ */
+int32_t inode_max_clusters(struct vfs_mount *mount, struct inode *inode_ptr);
+
+/**
+ * Vrátí příznaky, se kterými se ve VFS zakládá nový soubor
+ *
+ * @param mount připojený VFS
+ * @return příznaky i-uzlu (INODE_FLAG_*)
+ */
+int16_t inode_default_flags(struct vfs_mount *mount);
+
+/**
+ * Vynuluje všechny odkazy i-uzlu na databloky, příznaky zůstanou zachovány
+ *
+ * Databloky se neuvolňují (viz deallocate)
+ *
+ * @param inode_ptr struktura inode
+ */
+void inode_reset_mapping(struct inode *inode_ptr);
+
 /**
  * Vypíše obsah struktury inode
  *
@@ -40,101 +233,150 @@ void inode_print(struct inode *ptr);
 
 
 /**
- * Vrátí první volný index pro inode
+ * Vrátí volný index pro inode
  *
- * @param filename
+ * Formát s bitmapou i-uzlů hledá v bitmapě, starší formáty čtou tabulku i-uzlů od začátku
+ *
+ * @param mount připojený VFS
  * @return
  */
-int32_t inode_find_free_index(char *filename);
+int32_t inode_find_free_index(struct vfs_mount *mount);
 
 /**
  * Na základě indexu vrátí adresu inode
  *
- * @param filename soubor vfs
+ * @param mount připojený VFS
  * @param inode_index index inode
  * @return
  */
-int32_t inode_index_to_adress(char *filename, int32_t inode_index);
+int64_t inode_index_to_adress(struct vfs_mount *mount, int32_t inode_index);
 
 /**
  * Zapíše obsah struktury inode na adresu ve VFS určenou indexem
  *
- * @param filename soubor vfs
+ * @param mount připojený VFS
  * @param inode_index index inode ve VFS
  * @param inode_ptr struktura k zapsání
  * @return výsledek operace
  */
-int32_t inode_write_to_index(char *filename, int32_t inode_index, struct inode *inode_ptr);
+int32_t inode_write_to_index(struct vfs_mount *mount, int32_t inode_index, struct inode *inode_ptr);
 
 /**
  * Zapíše obsah struktury inode na adresu ve VFS
  *
- * @param filename soubor vfs
+ * @param mount připojený VFS
  * @param inode_address adresa inode ve VFS
  * @param inode_ptr struktura k zapsání
  * @return výsledek operace
  */
-int32_t inode_write_to_address(char *filename, int32_t inode_address, struct inode *inode_ptr);
+int32_t inode_write_to_address(struct vfs_mount *mount, int64_t inode_address, struct inode *inode_ptr);
 
 /**
  * Pokusí se o přečtení struktury inode z VFS a vrátí ukazatel
  * hledá inode dle indexu
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_index index inode
  * @return výsledek operace (PTR | NULL)
  */
-struct inode *inode_read_by_index(char *filename, int32_t inode_index);
+struct inode *inode_read_by_index(struct vfs_mount *mount, int32_t inode_index);
 
 
 /**
  * Pokusí se o přečtení struktury inode z VFS a vrátí ukazatel
  * hledá inode dle indexu
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_address adresa inode ve VFS
  * @return výsledek operace (PTR | NULL)
  */
-struct inode *inode_read_by_address(char *filename, int32_t inode_address);
+struct inode *inode_read_by_address(struct vfs_mount *mount, int64_t inode_address);
 
 /**
  * Kontrolní funkce, která ověří, zda lze převést adresu na index data bloku
  *
- * @param filename soubor vfs
+ * @param mount připojený VFS
  * @param address adresa ve VFS
  * @return výsledek operace (return < 0 - chyba | return >= 0 - validní index)
  */
-int32_t inode_data_index_from_address(char *filename, int32_t address);
+int32_t inode_data_index_from_address(struct vfs_mount *mount, int64_t address);
 
 /**
- * Přidá nový ukazatel na datový blok pro strukturu
- *
- * @deprecated Prochází lineárně všechny existující odkazy a hledá volný odkaz - pomalé
+ * Přidá nový ukazatel na datový blok pro strukturu - rychlejší verze
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_ptr ukazatel na pozměňovaný inode
  * @return výsledek operace
  */
-bool inode_add_data_address_slow(char *filename, struct inode *inode_ptr, int32_t address);
+bool inode_add_data_address(struct vfs_mount *mount, struct inode *inode_ptr, int64_t address);
 
+/**
+ * Prodlouží mapu databloků i-uzlu o díry - nic se nealokuje, díra se čte jako nuly
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param count počet přidaných děr
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t inode_add_holes(struct vfs_mount *mount, struct inode *inode_ptr, int32_t count);
 
 /**
- * Přidá nový ukazatel na datový blok pro strukturu - rychlejší verze
+ * Spočítá databloky, které i-uzel skutečně zabírá (bez děr)
  *
- * @param filename soubor VFS
- * @param inode_ptr ukazatel na pozměňovaný inode
- * @return výsledek operace
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @return (return < 0: chyba | return >= 0: počet databloků)
  */
-bool inode_add_data_address(char *filename, struct inode *inode_ptr, int32_t address);
+int32_t inode_count_data_clusters(struct vfs_mount *mount, struct inode *inode_ptr);
 
 /**
  * Získá adresu uloženou na daném indexu uložených databloků
  *
- * @param filename soubor VFS
+ * @param mount připojený VFS
  * @param inode_ptr struktura inode
  * @param index index odkazu v inode
- * @return (return <= 0: chyba | return > 0: adresa databloku ve VFS)
+ * @return (return < 0: chyba | 0: díra | return > 0: adresa databloku ve VFS)
+ */
+int64_t inode_get_datablock_index_value(struct vfs_mount *mount, struct inode *inode_ptr, int32_t index);
+
+/**
+ * Načte adresy databloků i-uzlu s indexy <from, count) do pole map
+ *
+ * Nepřímé bloky ukazatelů čte vždy celé jedním čtením, místo čtení
+ * jednotlivých 4bytových ukazatelů
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param map cílové pole adres (alespoň count položek)
+ * @param from první načítaný index
+ * @param count index za posledním načítaným indexem
+ * @return (return < 0: chyba | return >= 0: počet načtených adres)
+ */
+int32_t inode_load_block_map(struct vfs_mount *mount, struct inode *inode_ptr, int64_t *map, int32_t from, int32_t count);
+
+/**
+ * Přepíše adresu databloku uloženou na daném indexu i-uzlu (např. při kopírování při zápisu)
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr struktura inode
+ * @param index index odkazu v inode (musí ležet v rozsahu allocated_clusters)
+ * @param address nová adresa databloku (0 = díra, datablok uvolní volající)
+ * @return (return < 0: chyba | 0: OK)
+ */
+int32_t inode_set_datablock_index_value(struct vfs_mount *mount, struct inode *inode_ptr, int32_t index, int64_t address);
+
+/**
+ * Nasdílí datové bloky i-uzlu source i-uzlu target (cp --reflink)
+ *
+ * Data se nekopírují - target dostane vlastní kopie bloků ukazatelů a datovým
+ * blokům se v tabulce sdílení přičte vlastník, zápis do sdíleného bloku
+ * později provede kopii (viz vfs_write)
+ *
+ * @param mount připojený VFS
+ * @param source i-uzel, jehož data se sdílí
+ * @param target cílový i-uzel bez alokovaných databloků
+ * @return (return < 0: chyba | 0: OK)
  */
-int32_t inode_get_datablock_index_value(char *filename, struct inode *inode_ptr, int32_t index);
+int32_t inode_clone_data(struct vfs_mount *mount, struct inode *source, struct inode *target);
 
 #endif //KIV_ZOS_INODE_H
@@ -0,0 +1,233 @@
+#include "inode_bitmap.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include "debug.h"
+#include "superblock.h"
+#include "bitmap.h"
+#include "inode_cache.h"
+
+/**
+ * Načte bitmapu i-uzlů z VFS do paměti
+ *
+ * U starších formátů bez bitmapy zůstane mount->inode_bitmap NULL
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool inode_bitmap_load(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("inode_bitmap_load: VFS neni pripojen!\n");
+        return FALSE;
+    }
+
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+    int32_t inodes = superblock_ptr->inode_count;
+
+    mount->inode_bitmap = NULL;
+    mount->inode_bitmap_words = 0;
+    mount->inode_rotor = 0;
+
+    // Starší formát - volný i-uzel se hledá čtením tabulky
+    int64_t size = superblock_inode_bitmap_size(superblock_ptr);
+    if(size < 1){
+        log_debug("inode_bitmap_load: Format VFS nema bitmapu i-uzlu\n");
+        return TRUE;
+    }
+
+    // Díry v souboru VFS jsou volné i-uzly - čte se pouze zapsaná část bitmapy
+    mount->inode_bitmap_words = (int32_t)(size / sizeof(uint64_t));
+    mount->inode_bitmap = calloc(mount->inode_bitmap_words, sizeof(uint64_t));
+
+    if(mount->inode_bitmap == NULL){
+        log_debug("inode_bitmap_load: Nepodarilo se alokovat pamet!\n");
+        return FALSE;
+    }
+
+    int64_t read = mount_read_sparse(mount, superblock_ptr->inode_bitmap_start_address, mount->inode_bitmap, size);
+
+    if(read != size){
+        free(mount->inode_bitmap);
+        mount->inode_bitmap = NULL;
+        return FALSE;
+    }
+
+    // Bity za posledním i-uzlem jsou vždy obsazené, hledání je tak nikdy nevrátí
+    if(inodes % 64 != 0){
+        mount->inode_bitmap[mount->inode_bitmap_words - 1] |= ~(((uint64_t)1 << (inodes % 64)) - 1);
+    }
+
+    log_debug("inode_bitmap_load: Nactena bitmapa %d i-uzlu (volnych %d)\n", inodes, superblock_ptr->free_inode_count);
+    return TRUE;
+}
+
+/**
+ * Sestaví bitmapu i-uzlů v paměti jedním průchodem tabulky i-uzlů
+ *
+ * Pro starší formáty bez bitmapy - dopočte i počet volných i-uzlů, další
+ * přidělování i-uzlů pak tabulku nečte
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool inode_bitmap_build(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("inode_bitmap_build: VFS neni pripojen!\n");
+        return FALSE;
+    }
+
+    // Bitmapa už je načtená
+    if(mount->inode_bitmap != NULL){
+        return TRUE;
+    }
+
+    struct inode_table *table = inode_table_load(mount);
+
+    if(table == NULL){
+        return FALSE;
+    }
+
+    int32_t words = (int32_t)(((int64_t)table->count + 63) / 64);
+    uint64_t *bitmap = calloc(words > 0 ? words : 1, sizeof(uint64_t));
+
+    if(bitmap == NULL){
+        log_debug("inode_bitmap_build: Nepodarilo se alokovat pamet!\n");
+        inode_table_free(table);
+        return FALSE;
+    }
+
+    int32_t free_count = 0;
+    int32_t i;
+    for(i = 0; i < table->count; i++){
+        if(table->ids[i] != ID_ITEM_FREE){
+            bitmap[i / 64] |= (uint64_t)1 << (i % 64);
+        } else {
+            free_count++;
+        }
+    }
+
+    // Bity za posledním i-uzlem jsou vždy obsazené
+    if(table->count % 64 != 0){
+        bitmap[words - 1] |= ~(((uint64_t)1 << (table->count % 64)) - 1);
+    }
+
+    mount->superblock_ptr->inode_count = table->count;
+    mount->superblock_ptr->free_inode_count = free_count;
+    mount->inode_bitmap = bitmap;
+    mount->inode_bitmap_words = words;
+    mount->inode_rotor = 0;
+
+    log_debug("inode_bitmap_build: Sestavena bitmapa %d i-uzlu (volnych %d)\n", table->count, free_count);
+    inode_table_free(table);
+    return TRUE;
+}
+
+/**
+ * Najde volný i-uzel v bitmapě
+ *
+ * Hledá od slova, ve kterém byl naposledy nalezen nebo uvolněn volný i-uzel
+ *
+ * @param mount připojený VFS
+ * @return (return < 0 - chyba / není volný i-uzel | return >= 0 - index volného i-uzlu)
+ */
+int32_t inode_bitmap_find_free(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL || mount->inode_bitmap == NULL){
+        log_debug("inode_bitmap_find_free: VFS nema nactenou bitmapu i-uzlu!\n");
+        return -1;
+    }
+
+    // Počet volných i-uzlů je znám ze superbloku - plný VFS se neprohledává
+    if(mount->superblock_ptr->free_inode_count < 1){
+        return -5;
+    }
+
+    int32_t words = mount->inode_bitmap_words;
+    int32_t checked = 0;
+    int32_t word = mount->inode_rotor;
+
+    while(checked < words){
+        if(word >= words){
+            word = 0;
+        }
+
+        // Slovo obsahuje alespoň jeden volný i-uzel
+        if(~mount->inode_bitmap[word] != 0){
+            mount->inode_rotor = word;
+            return word * 64 + bitmap_word_first_free(mount->inode_bitmap[word]);
+        }
+
+        word++;
+        checked++;
+    }
+
+    // Neexistuje volný i-uzel
+    return -5;
+}
+
+/**
+ * Označí i-uzel jako obsazený nebo volný a změnu zapíše do VFS
+ *
+ * Spolu s bitem se upraví i počet volných i-uzlů v superbloku, pokud se
+ * stav i-uzlu nemění, nezapisuje se nic
+ *
+ * @param mount připojený VFS
+ * @param index index i-uzlu
+ * @param used TRUE - i-uzel je obsazený | FALSE - i-uzel je volný
+ * @return výsledek operace
+ */
+bool inode_bitmap_set(struct vfs_mount *mount, int32_t index, bool used){
+    // Kontrola připojení
+    if(mount == NULL || mount->inode_bitmap == NULL){
+        return FALSE;
+    }
+
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+
+    // I-uzly mimo bitmapu (zarovnání tabulky) se nepřidělují
+    if(index < 0 || index >= superblock_ptr->inode_count){
+        return FALSE;
+    }
+
+    int32_t word = index / 64;
+    uint64_t bit = (uint64_t)1 << (index % 64);
+    bool current = (mount->inode_bitmap[word] & bit) != 0 ? TRUE : FALSE;
+
+    if(current == used){
+        return TRUE;
+    }
+
+    if(used == TRUE){
+        mount->inode_bitmap[word] |= bit;
+        superblock_ptr->free_inode_count--;
+    } else {
+        mount->inode_bitmap[word] &= ~bit;
+        superblock_ptr->free_inode_count++;
+
+        // Uvolněný i-uzel před rotorem bude nalezen dříve
+        if(word < mount->inode_rotor){
+            mount->inode_rotor = word;
+        }
+    }
+
+    // Bitmapa sestavená v paměti pro starší formát se nezapisuje
+    if(superblock_version(superblock_ptr) < VFS_VERSION_INODE_BITMAP){
+        return TRUE;
+    }
+
+    // Zápis změněného slova bitmapy a počtu volných i-uzlů
+    int64_t address = superblock_ptr->inode_bitmap_start_address + (int64_t)word * sizeof(uint64_t);
+    if(mount_write(mount, address, &mount->inode_bitmap[word], sizeof(uint64_t)) != sizeof(uint64_t)){
+        log_debug("inode_bitmap_set: Nelze zapsat bitmapu i-uzlu!\n");
+        return FALSE;
+    }
+
+    if(mount_write(mount, offsetof(struct superblock, free_inode_count), &superblock_ptr->free_inode_count, sizeof(int32_t)) != sizeof(int32_t)){
+        log_debug("inode_bitmap_set: Nelze zapsat pocet volnych i-uzlu!\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,64 @@
+#ifndef KIV_ZOS_INODE_BITMAP_H
+#define KIV_ZOS_INODE_BITMAP_H
+
+/*
+ * Bitmapa obsazených i-uzlů (od verze formátu VFS_VERSION_INODE_BITMAP)
+ *
+ * Pro každý i-uzel je uložen 1 bit (1 = obsazený), počet volných i-uzlů
+ * udržuje superblok. Bitmapa se mění výhradně při zápisu i-uzlu, takže
+ * vždy odpovídá tabulce i-uzlů. Nově naformátovaný VFS má bitmapu nulovou.
+ * Starší formáty si ji mohou sestavit v paměti (inode_bitmap_build).
+ */
+
+/*
+ * Nutné hlavičky
+ */
+#include <stdint.h>
+#include "bool.h"
+#include "mount.h"
+
+/**
+ * Načte bitmapu i-uzlů z VFS do paměti
+ *
+ * U starších formátů bez bitmapy zůstane mount->inode_bitmap NULL
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool inode_bitmap_load(struct vfs_mount *mount);
+
+/**
+ * Sestaví bitmapu i-uzlů v paměti jedním průchodem tabulky i-uzlů
+ *
+ * Pro starší formáty bez bitmapy - dopočte i počet volných i-uzlů, další
+ * přidělování i-uzlů pak tabulku nečte
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool inode_bitmap_build(struct vfs_mount *mount);
+
+/**
+ * Najde volný i-uzel v bitmapě
+ *
+ * Hledá od slova, ve kterém byl naposledy nalezen nebo uvolněn volný i-uzel
+ *
+ * @param mount připojený VFS
+ * @return (return < 0 - chyba / není volný i-uzel | return >= 0 - index volného i-uzlu)
+ */
+int32_t inode_bitmap_find_free(struct vfs_mount *mount);
+
+/**
+ * Označí i-uzel jako obsazený nebo volný a změnu zapíše do VFS
+ *
+ * Spolu s bitem se upraví i počet volných i-uzlů v superbloku, pokud se
+ * stav i-uzlu nemění, nezapisuje se nic
+ *
+ * @param mount připojený VFS
+ * @param index index i-uzlu
+ * @param used TRUE - i-uzel je obsazený | FALSE - i-uzel je volný
+ * @return výsledek operace
+ */
+bool inode_bitmap_set(struct vfs_mount *mount, int32_t index, bool used);
+
+#endif //KIV_ZOS_INODE_BITMAP_H
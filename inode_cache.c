@@ -0,0 +1,507 @@
+#include "inode_cache.h"
+#include <string.h>
+#include <stdlib.h>
+#include "debug.h"
+#include "superblock.h"
+#include "mount.h"
+#include "cache.h"
+
+// Nejvyšší počet položek mezipaměti při načtení celé tabulky
+#define INODE_CACHE_MAX_SLOTS (1 << 18)
+// Počet záznamů čtených z tabulky i-uzlů najednou (násobek 64 - slovo bitmapy i-uzlů)
+#define INODE_TABLE_CHUNK 1024
+
+/**
+ * Vrátí počet záznamů tabulky i-uzlů
+ *
+ * @param mount připojený VFS
+ * @return počet záznamů
+ */
+static int32_t inode_table_records(struct vfs_mount *mount){
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+
+    // Za i-uzly popsanými bitmapou je jen zarovnání datové části
+    if(superblock_version(superblock_ptr) >= VFS_VERSION_INODE_BITMAP){
+        return superblock_ptr->inode_count;
+    }
+
+    return (int32_t)((superblock_ptr->data_start_address - superblock_ptr->inode_start_address) / inode_record_size(mount));
+}
+
+/**
+ * Alokuje položky mezipaměti, všechny jsou volné
+ *
+ * @param slots počet položek (mocnina 2)
+ * @return (struct inode_cache * | NULL)
+ */
+static struct inode_cache *inode_cache_create(int32_t slots){
+    struct inode_cache *cache = calloc(1, sizeof(struct inode_cache));
+
+    if(cache == NULL){
+        return NULL;
+    }
+
+    cache->entries = malloc(sizeof(struct inode_cache_entry) * slots);
+
+    if(cache->entries == NULL){
+        free(cache);
+        return NULL;
+    }
+
+    int32_t i;
+    for(i = 0; i < slots; i++){
+        cache->entries[i].index = -1;
+        cache->entries[i].refs = 0;
+        cache->entries[i].dirty = FALSE;
+    }
+
+    cache->slots = slots;
+    return cache;
+}
+
+/**
+ * Vrátí mezipaměť připojeného VFS, při prvním použití ji vytvoří
+ *
+ * @param mount připojený VFS
+ * @return (struct inode_cache * | NULL)
+ */
+static struct inode_cache *inode_cache_of(struct vfs_mount *mount){
+    if(mount->inodes == NULL){
+        mount->inodes = inode_cache_create(INODE_CACHE_SLOTS);
+
+        if(mount->inodes == NULL){
+            log_debug("inode_cache_of: Nepodarilo se alokovat pamet!\n");
+        }
+    }
+
+    return mount->inodes;
+}
+
+/**
+ * Zapíše změněnou položku na disk
+ *
+ * @param mount připojený VFS
+ * @param entry položka mezipaměti
+ * @return výsledek operace
+ */
+static bool inode_cache_write_back(struct vfs_mount *mount, struct inode_cache_entry *entry){
+    if(entry->dirty != TRUE){
+        return TRUE;
+    }
+
+    if(inode_write_record(mount, inode_index_to_adress(mount, entry->index), &entry->inode) != TRUE){
+        log_debug("inode_cache_write_back: I-uzel %d nelze zapsat!\n", entry->index + 1);
+        return FALSE;
+    }
+
+    entry->dirty = FALSE;
+    mount->inodes->dirty_count--;
+    return TRUE;
+}
+
+/**
+ * Vrátí položku mezipaměti pro daný index, při výpadku vytlačí původní
+ * položku a i-uzel načte z VFS
+ *
+ * @param mount připojený VFS
+ * @param index index i-uzlu
+ * @param load načíst i-uzel z VFS (FALSE - položku celou přepíše volající)
+ * @return (položka | NULL - položka je zapůjčená jinému i-uzlu nebo chyba)
+ */
+static struct inode_cache_entry *inode_cache_slot(struct vfs_mount *mount, int32_t index, bool load){
+    if(mount == NULL || index < 0 || index >= inode_table_records(mount)){
+        return NULL;
+    }
+
+    struct inode_cache *cache = inode_cache_of(mount);
+
+    if(cache == NULL){
+        return NULL;
+    }
+
+    struct inode_cache_entry *entry = &cache->entries[index & (cache->slots - 1)];
+
+    if(entry->index == index){
+        return entry;
+    }
+
+    // Vytlačení původní položky - zapůjčená zůstává
+    if(entry->refs > 0 || inode_cache_write_back(mount, entry) != TRUE){
+        return NULL;
+    }
+
+    entry->index = -1;
+
+    if(load == TRUE && inode_read_record(mount, inode_index_to_adress(mount, index), &entry->inode) != TRUE){
+        return NULL;
+    }
+
+    entry->index = index;
+    return entry;
+}
+
+/**
+ * Zkopíruje i-uzel z mezipaměti, při výpadku jej načte z VFS a uloží
+ *
+ * @param mount připojený VFS
+ * @param index index i-uzlu
+ * @param inode_ptr výstup - kopie i-uzlu (i volného)
+ * @return (TRUE - i-uzel zkopírován | FALSE - mezipaměť nelze použít, je třeba číst přímo)
+ */
+bool inode_cache_read(struct vfs_mount *mount, int32_t index, struct inode *inode_ptr){
+    struct inode_cache_entry *entry = inode_cache_slot(mount, index, TRUE);
+
+    if(entry == NULL){
+        return FALSE;
+    }
+
+    memcpy(inode_ptr, &entry->inode, sizeof(struct inode));
+    return TRUE;
+}
+
+/**
+ * Uloží i-uzel do mezipaměti a označí jej jako změněný
+ *
+ * @param mount připojený VFS
+ * @param index index i-uzlu
+ * @param inode_ptr ukládaný i-uzel
+ * @return (TRUE - uloženo | FALSE - mezipaměť nelze použít, je třeba zapsat přímo)
+ */
+bool inode_cache_store(struct vfs_mount *mount, int32_t index, struct inode *inode_ptr){
+    struct inode_cache_entry *entry = inode_cache_slot(mount, index, FALSE);
+
+    if(entry == NULL){
+        return FALSE;
+    }
+
+    // Zapůjčený i-uzel se mění na místě - vypůjčitelé vidí novou podobu
+    if(&entry->inode != inode_ptr){
+        memcpy(&entry->inode, inode_ptr, sizeof(struct inode));
+    }
+
+    if(entry->dirty != TRUE){
+        entry->dirty = TRUE;
+        mount->inodes->dirty_count++;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Zapůjčí i-uzel z mezipaměti pouze pro čtení, nutno vrátit inode_cache_put
+ *
+ * @param mount připojený VFS
+ * @param index index i-uzlu
+ * @return (ukazatel na i-uzel | NULL - i-uzel je volný nebo jej nelze přečíst)
+ */
+struct inode *inode_cache_get(struct vfs_mount *mount, int32_t index){
+    if(mount == NULL){
+        return NULL;
+    }
+
+    struct inode_cache_entry *entry = inode_cache_slot(mount, index, TRUE);
+
+    // Položku obsadil jiný zapůjčený i-uzel - zapůjčí se samostatná kopie
+    if(entry == NULL){
+        struct inode *copy = inode_read_by_index(mount, index);
+        return copy;
+    }
+
+    if(entry->inode.id == ID_ITEM_FREE){
+        return NULL;
+    }
+
+    entry->refs++;
+    mount->inodes->pinned_count++;
+    return &entry->inode;
+}
+
+/**
+ * Vrátí i-uzel zapůjčený funkcí inode_cache_get
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr zapůjčený i-uzel (NULL je ignorován)
+ */
+void inode_cache_put(struct vfs_mount *mount, struct inode *inode_ptr){
+    if(mount == NULL || inode_ptr == NULL){
+        return;
+    }
+
+    struct inode_cache *cache = mount->inodes;
+    struct inode_cache_entry *entry = (struct inode_cache_entry *)inode_ptr;
+
+    // Samostatná kopie mimo mezipaměť
+    if(cache == NULL || entry < cache->entries || entry >= cache->entries + cache->slots){
+        free(inode_ptr);
+        return;
+    }
+
+    if(entry->refs > 0){
+        entry->refs--;
+        cache->pinned_count--;
+    }
+}
+
+/**
+ * Zapíše změněné i-uzly z mezipaměti do VFS
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool inode_cache_flush(struct vfs_mount *mount){
+    if(mount == NULL || mount->inodes == NULL){
+        return TRUE;
+    }
+
+    struct inode_cache *cache = mount->inodes;
+    bool result = TRUE;
+
+    int32_t i;
+    for(i = 0; cache->dirty_count > 0 && i < cache->slots; i++){
+        if(inode_cache_write_back(mount, &cache->entries[i]) != TRUE){
+            result = FALSE;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Přečte úsek tabulky i-uzlů přímo z VFS jedním čtením
+ *
+ * Díry hostitelského souboru a úseky, které bitmapa i-uzlů vede celé jako
+ * volné, se nečtou - v bufferu zůstanou nulové (volné) záznamy
+ *
+ * @param mount připojený VFS
+ * @param first index prvního záznamu (násobek 64)
+ * @param count počet záznamů
+ * @param buffer cíl čtení (alespoň count * inode_record_size byte)
+ * @return výsledek operace
+ */
+static bool inode_table_read_chunk(struct vfs_mount *mount, int32_t first, int32_t count, char *buffer){
+    int64_t record_size = inode_record_size(mount);
+    memset(buffer, 0, count * record_size);
+
+    if(mount->inode_bitmap != NULL){
+        int32_t word;
+        bool used = FALSE;
+
+        for(word = first / 64; word <= (first + count - 1) / 64 && used == FALSE; word++){
+            used = mount->inode_bitmap[word] != 0 ? TRUE : FALSE;
+        }
+
+        if(used == FALSE){
+            return TRUE;
+        }
+    }
+
+    int64_t size = count * record_size;
+    return mount_read_sparse(mount, inode_index_to_adress(mount, first), buffer, size) == size ? TRUE : FALSE;
+}
+
+/**
+ * Připraví tabulku i-uzlů na disku pro čtení po úsecích (zápis odložených změn)
+ *
+ * @param mount připojený VFS
+ * @param records počet záznamů tabulky
+ * @return výsledek operace
+ */
+static bool inode_table_prepare(struct vfs_mount *mount, int32_t records){
+    if(inode_cache_flush(mount) != TRUE){
+        return FALSE;
+    }
+
+    // Čtení přeskakuje díry souboru - stránky tabulky musí být zapsané
+    if(mount->cache != NULL){
+        return cache_flush_range(mount, mount->superblock_ptr->inode_start_address, (size_t)records * inode_record_size(mount));
+    }
+
+    return TRUE;
+}
+
+/**
+ * Zvětší mezipaměť na celou tabulku i-uzlů a načte ji jedním průchodem
+ *
+ * @param mount připojený VFS
+ * @return počet načtených obsazených i-uzlů (return < 0 - chyba)
+ */
+int32_t inode_cache_load_all(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("inode_cache_load_all: VFS neni pripojen!\n");
+        return -1;
+    }
+
+    // Zapůjčené položky nelze přesunout
+    if(mount->inodes != NULL && mount->inodes->pinned_count > 0){
+        log_debug("inode_cache_load_all: Mezipamet obsahuje zapujcene i-uzly!\n");
+        return -2;
+    }
+
+    int32_t records = inode_table_records(mount);
+
+    if(inode_table_prepare(mount, records) != TRUE){
+        return -3;
+    }
+
+    // Velikost - nejbližší mocnina 2, tabulka se tak mapuje bez kolizí
+    int32_t slots = INODE_CACHE_SLOTS;
+    while(slots < records && slots < INODE_CACHE_MAX_SLOTS){
+        slots <<= 1;
+    }
+
+    struct inode_cache *cache = inode_cache_create(slots);
+    int32_t record_size = inode_record_size(mount);
+    char *buffer = malloc((size_t)INODE_TABLE_CHUNK * record_size);
+
+    if(cache == NULL || buffer == NULL){
+        log_debug("inode_cache_load_all: Nepodarilo se alokovat pamet!\n");
+        if(cache != NULL){
+            free(cache->entries);
+            free(cache);
+        }
+        free(buffer);
+        return -4;
+    }
+
+    // Původní mezipaměť je zapsaná, nahradí ji nová
+    inode_cache_free(mount);
+    mount->inodes = cache;
+
+    int32_t limit = records < slots ? records : slots;
+    int32_t used = 0;
+    int32_t first;
+
+    for(first = 0; first < limit; first += INODE_TABLE_CHUNK){
+        int32_t count = limit - first < INODE_TABLE_CHUNK ? limit - first : INODE_TABLE_CHUNK;
+
+        if(inode_table_read_chunk(mount, first, count, buffer) != TRUE){
+            free(buffer);
+            return -5;
+        }
+
+        int32_t i;
+        for(i = 0; i < count; i++){
+            struct inode_cache_entry *entry = &cache->entries[first + i];
+            inode_decode(mount, &entry->inode, buffer + (int64_t)i * record_size);
+            entry->index = first + i;
+
+            if(entry->inode.id != ID_ITEM_FREE){
+                used++;
+            }
+        }
+    }
+
+    free(buffer);
+
+    log_debug("inode_cache_load_all: Nacteno %d z %d i-uzlu (%d obsazenych)\n", limit, records, used);
+    return used;
+}
+
+/**
+ * Zapíše změněné i-uzly a uvolní mezipaměť připojeného VFS
+ *
+ * @param mount připojený VFS
+ */
+void inode_cache_free(struct vfs_mount *mount){
+    if(mount == NULL || mount->inodes == NULL){
+        return;
+    }
+
+    inode_cache_flush(mount);
+
+    free(mount->inodes->entries);
+    free(mount->inodes);
+    mount->inodes = NULL;
+}
+
+/**
+ * Načte celou tabulku i-uzlů po sloupcích (ID, typ, velikost, počet databloků)
+ *
+ * @param mount připojený VFS
+ * @return (struct inode_table * - nutno uvolnit inode_table_free | NULL)
+ */
+struct inode_table *inode_table_load(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("inode_table_load: VFS neni pripojen!\n");
+        return NULL;
+    }
+
+    int32_t records = inode_table_records(mount);
+
+    if(inode_table_prepare(mount, records) != TRUE){
+        return NULL;
+    }
+
+    // Vynulované sloupce - volné záznamy se nevyplňují
+    struct inode_table *table = calloc(1, sizeof(struct inode_table));
+    int32_t record_size = inode_record_size(mount);
+    char *buffer = malloc((size_t)INODE_TABLE_CHUNK * record_size);
+
+    if(table != NULL){
+        table->count = records;
+        table->ids = calloc(records, sizeof(int32_t));
+        table->types = calloc(records, sizeof(int8_t));
+        table->sizes = calloc(records, sizeof(int64_t));
+        table->clusters = calloc(records, sizeof(int32_t));
+    }
+
+    if(table == NULL || buffer == NULL || table->ids == NULL || table->types == NULL || table->sizes == NULL || table->clusters == NULL){
+        log_debug("inode_table_load: Nepodarilo se alokovat pamet!\n");
+        inode_table_free(table);
+        free(buffer);
+        return NULL;
+    }
+
+    int32_t first;
+    for(first = 0; first < records; first += INODE_TABLE_CHUNK){
+        int32_t count = records - first < INODE_TABLE_CHUNK ? records - first : INODE_TABLE_CHUNK;
+
+        if(inode_table_read_chunk(mount, first, count, buffer) != TRUE){
+            inode_table_free(table);
+            free(buffer);
+            return NULL;
+        }
+
+        int32_t i;
+        for(i = 0; i < count; i++){
+            const char *record = buffer + (int64_t)i * record_size;
+            int32_t id = ID_ITEM_FREE;
+
+            // ID je v obou formátech na začátku záznamu - volné záznamy se nepřevádí
+            memcpy(&id, record, sizeof(int32_t));
+            if(id == ID_ITEM_FREE){
+                continue;
+            }
+
+            struct inode inode;
+            inode_decode(mount, &inode, record);
+
+            table->ids[first + i] = inode.id;
+            table->types[first + i] = inode.type;
+            table->sizes[first + i] = inode.file_size;
+            table->clusters[first + i] = inode.allocated_clusters;
+        }
+    }
+
+    free(buffer);
+    return table;
+}
+
+/**
+ * Uvolní tabulku i-uzlů načtenou inode_table_load
+ *
+ * @param table tabulka i-uzlů
+ */
+void inode_table_free(struct inode_table *table){
+    if(table == NULL){
+        return;
+    }
+
+    free(table->ids);
+    free(table->types);
+    free(table->sizes);
+    free(table->clusters);
+    free(table);
+}
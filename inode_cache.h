@@ -0,0 +1,130 @@
+#ifndef KIV_ZOS_INODE_CACHE_H
+#define KIV_ZOS_INODE_CACHE_H
+
+/*
+ * Mezipaměť i-uzlů s odloženým zápisem
+ *
+ * I-uzly jsou uloženy již převedené (struct inode) v položkách s přímým
+ * mapováním podle indexu. Zápis i-uzlu pouze změní položku a označí ji
+ * jako změněnou, na disk se zapíše při vytlačení nebo synchronizaci.
+ * Položku lze zapůjčit (inode_cache_get), zapůjčená položka se nevytlačí.
+ */
+
+/*
+ * Nutné hlavičky
+ */
+#include <stdint.h>
+#include "bool.h"
+#include "inode.h"
+
+/*
+ * Konstanty
+ */
+#define INODE_CACHE_SLOTS 1024          // Výchozí počet položek mezipaměti (mocnina 2)
+
+/*
+ * Struktury
+ */
+struct vfs_mount;
+
+// Jedna položka mezipaměti - i-uzel musí být první (zapůjčený ukazatel = ukazatel na položku)
+struct inode_cache_entry {
+    struct inode inode;                 // Převedený i-uzel (i volný - ID_ITEM_FREE)
+    int32_t index;                      // Index i-uzlu v tabulce (-1 = volná položka)
+    int32_t refs;                       // Počet zapůjčení položky
+    bool dirty;                         // Položka se liší od záznamu na disku
+};
+
+// Mezipaměť i-uzlů s přímým mapováním (index & (slots - 1))
+struct inode_cache {
+    struct inode_cache_entry *entries;  // Položky mezipaměti
+    int32_t slots;                      // Počet položek (mocnina 2)
+    int32_t dirty_count;                // Počet změněných položek
+    int32_t pinned_count;               // Počet zapůjčení všech položek
+};
+
+// Tabulka i-uzlů po sloupcích pro průchody celou tabulkou
+struct inode_table {
+    int32_t count;                      // Počet záznamů tabulky
+    int32_t *ids;                       // ID i-uzlů (ID_ITEM_FREE = volný)
+    int8_t *types;                      // Typy i-uzlů
+    int64_t *sizes;                     // Velikosti souborů v bytech
+    int32_t *clusters;                  // Počty odkazů na databloky (včetně děr)
+};
+
+/**
+ * Zkopíruje i-uzel z mezipaměti, při výpadku jej načte z VFS a uloží
+ *
+ * @param mount připojený VFS
+ * @param index index i-uzlu
+ * @param inode_ptr výstup - kopie i-uzlu (i volného)
+ * @return (TRUE - i-uzel zkopírován | FALSE - mezipaměť nelze použít, je třeba číst přímo)
+ */
+bool inode_cache_read(struct vfs_mount *mount, int32_t index, struct inode *inode_ptr);
+
+/**
+ * Uloží i-uzel do mezipaměti a označí jej jako změněný
+ *
+ * @param mount připojený VFS
+ * @param index index i-uzlu
+ * @param inode_ptr ukládaný i-uzel
+ * @return (TRUE - uloženo | FALSE - mezipaměť nelze použít, je třeba zapsat přímo)
+ */
+bool inode_cache_store(struct vfs_mount *mount, int32_t index, struct inode *inode_ptr);
+
+/**
+ * Zapůjčí i-uzel z mezipaměti pouze pro čtení, nutno vrátit inode_cache_put
+ *
+ * @param mount připojený VFS
+ * @param index index i-uzlu
+ * @return (ukazatel na i-uzel | NULL - i-uzel je volný nebo jej nelze přečíst)
+ */
+struct inode *inode_cache_get(struct vfs_mount *mount, int32_t index);
+
+/**
+ * Vrátí i-uzel zapůjčený funkcí inode_cache_get
+ *
+ * @param mount připojený VFS
+ * @param inode_ptr zapůjčený i-uzel (NULL je ignorován)
+ */
+void inode_cache_put(struct vfs_mount *mount, struct inode *inode_ptr);
+
+/**
+ * Zapíše změněné i-uzly z mezipaměti do VFS
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool inode_cache_flush(struct vfs_mount *mount);
+
+/**
+ * Zvětší mezipaměť na celou tabulku i-uzlů a načte ji jedním průchodem
+ *
+ * @param mount připojený VFS
+ * @return počet načtených obsazených i-uzlů (return < 0 - chyba)
+ */
+int32_t inode_cache_load_all(struct vfs_mount *mount);
+
+/**
+ * Zapíše změněné i-uzly a uvolní mezipaměť připojeného VFS
+ *
+ * @param mount připojený VFS
+ */
+void inode_cache_free(struct vfs_mount *mount);
+
+/**
+ * Načte celou tabulku i-uzlů po sloupcích (ID, typ, velikost, počet databloků)
+ *
+ * @param mount připojený VFS
+ * @return (struct inode_table * - nutno uvolnit inode_table_free | NULL)
+ */
+struct inode_table *inode_table_load(struct vfs_mount *mount);
+
+/**
+ * Uvolní tabulku i-uzlů načtenou inode_table_load
+ *
+ * @param table tabulka i-uzlů
+ */
+void inode_table_free(struct inode_table *table);
+
+#endif //KIV_ZOS_INODE_CACHE_H
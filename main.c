@@ -6,6 +6,8 @@
 #include "allocation.h"
 #include "directory.h"
 #include "vfs_io.h"
+#include "cache.h"
+#include "inode_cache.h"
 
 #include "shell.h"
 #include "parsing.h"
@@ -21,11 +23,45 @@ int main(int argc, char *argv[]) {
 
     // Ověření počtu vstupních parametrů [1] = cesta k VFS
     if(argc < 2){
-        log_fatal("Program spusten bez parametru: pouzijte ./KIV_ZOS <cesta_k_vfs_souboru>!\n");
-        printf("Program spusten bez parametru: pouzijte ./KIV_ZOS <cesta_k_vfs_souboru>!\n");
+        log_fatal("Program spusten bez parametru: pouzijte ./KIV_ZOS <cesta_k_vfs_souboru> [mmap] [cache=<stranky>] [log=<level>] [size=<velikost>] [icache=all]!\n");
+        printf("Program spusten bez parametru: pouzijte ./KIV_ZOS <cesta_k_vfs_souboru> [mmap] [cache=<stranky>] [log=<level>] [size=<velikost>] [icache=all]!\n");
         return -1;
     }
 
+    // Volitelné parametry: způsob přístupu k VFS (mmap), velikost vyrovnávací paměti (cache=<stránky>),
+    // level logování (log=all|trace|debug|info|error|fatal|off), velikost nově vytvořeného VFS (size=<velikost>),
+    // načtení celé tabulky i-uzlů do mezipaměti (icache=all)
+    int8_t backend = MOUNT_BACKEND_FILE;
+    bool inode_preload = FALSE;
+    int32_t cache_pages = CACHE_DEFAULT_PAGES;
+    int64_t size = IMPL_VFS_SIZE;
+    int arg;
+    for(arg = 2; arg < argc; arg++){
+        if(strcicmp(argv[arg], "mmap") == 0){
+            backend = MOUNT_BACKEND_MMAP;
+        } else if(strncmp(argv[arg], "cache=", 6) == 0){
+            cache_pages = atoi(argv[arg] + 6);
+        } else if(strncmp(argv[arg], "log=", 4) == 0 && log_parse_level(argv[arg] + 4) >= 0){
+            log_level = log_parse_level(argv[arg] + 4);
+        } else if(strncmp(argv[arg], "size=", 5) == 0){
+            // Zpracování mění řetězec - hodnota se čte jen jednou
+            int64_t parsed = parse_filesize(argv[arg] + 5);
+            if(parsed < 1){
+                log_fatal("Parametr size= neobsahuje platnou velikost VFS!\n");
+                printf("Parameter size= does not contain a valid VFS size!\n");
+                return -12;
+            }
+            size = parsed;
+        } else if(strcicmp(argv[arg], "icache=all") == 0){
+            inode_preload = TRUE;
+        } else {
+            log_info("Neznamy parametr %s bude ignorovan!\n", argv[arg]);
+        }
+    }
+
+    // Zprávy se dále zapisují do souboru zapisovacím vláknem
+    log_open();
+
     if(file_exist(argv[1]) == FALSE){
         FILE *file = fopen(argv[1], "ab+");
 
@@ -34,21 +70,30 @@ int main(int argc, char *argv[]) {
             return -10;
         }
 
-        int64_t size = IMPL_VFS_SIZE;
-        // Vytvoření implicitního superbloku
+        // Vytvoření implicitního superbloku - řídký soubor, vznikne v konstantním čase
         struct superblock *ptr = superblock_impl_alloc(size);
         // Výpočet hodnot superbloku dle velikosti disku
-        structure_calculate(ptr);
+        if(structure_calculate(ptr, 0) == FALSE){
+            log_fatal("Velikost %ld neni pro VFS platna!\n", (long)size);
+            free(ptr);
+            fclose(file);
+            remove(argv[1]);
+            return -11;
+        }
         // Vytvoření virtuálního FILESYSTEMU
         vfs_create(argv[1], ptr);
+        // Uvolnění zdrojů
+        free(ptr);
         // Vytvoření kořenové složky
-        directory_create(argv[1], "/");
+        struct vfs_mount *mount = mount_open(argv[1], MOUNT_BACKEND_FILE, 0);
+        directory_create(mount, "/");
+        mount_close(mount);
 
         fclose(file);
     }
 
     // Vytvoření kontextu
-    struct shell *sh = shell_create(argv[1]);
+    struct shell *sh = shell_create(argv[1], backend, cache_pages);
 
     // Ověření na vytvoření kontextu
     if(sh == NULL){
@@ -56,18 +101,22 @@ int main(int argc, char *argv[]) {
         return -2;
     }
 
+    // Celá tabulka i-uzlů jedním čtením - další přístupy k i-uzlům disk nečtou
+    if(inode_preload == TRUE && inode_cache_load_all(sh->mount) < 0){
+        log_info("Tabulku i-uzlu se nepodarilo nacist do mezipameti!\n");
+    }
+
     // Spuštění hlavní smyčky
     while(1){
         char *line = malloc(sizeof(char) * 256 + 1);
-        char *path = directory_get_path(sh->vfs_filename, sh->cwd);
 
-        printf("%s > ", path);
+        // Cesta je uložená v kontextu, mění ji pouze cd a format
+        printf("%s > ", sh->cwd_path);
         line = fgets(line, sizeof(char) * 256 + 1, stdin);
 
         // Kontrola ukončení souboru
         if(strcicmp(line, "exit\n") == 0){
             free(line);
-            free(path);
             break;
         }else{
             // Zpracování vstupu
@@ -76,7 +125,6 @@ int main(int argc, char *argv[]) {
 
         // Uvolnění zdrojů
         free(line);
-        free(path);
     }
 
     shell_free(sh);
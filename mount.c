@@ -0,0 +1,1166 @@
+// pread/pwrite jsou rozšíření POSIX, copy_file_range rozšíření GNU
+#ifdef __linux__
+    #define _GNU_SOURCE
+#endif
+
+#include "mount.h"
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include "debug.h"
+#include "parsing.h"
+#include "bitmap.h"
+#include "cache.h"
+#include "dir_index.h"
+#include "dentry.h"
+#include "refcount.h"
+#include "inode_bitmap.h"
+#include "inode_cache.h"
+
+// Podmíněné vkládání hlavičkových souborů
+#ifdef _WIN32
+    #include <io.h>
+    #define MOUNT_OPEN_FLAGS (O_RDWR | O_BINARY)
+#else
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #define MOUNT_OPEN_FLAGS (O_RDWR)
+#endif
+
+// Velikost bufferu pro kopírování mezi VFS a hostitelským souborem bez copy_file_range
+#define MOUNT_COPY_BUFFER (1024 * 1024)
+
+/**
+ * Otevře datový soubor VFS, načte a ověří jeho superblok
+ *
+ * Pokud není mmap na platformě dostupné, použije se MOUNT_BACKEND_FILE
+ *
+ * @param vfs_filename cesta k datovému souboru VFS
+ * @param backend způsob přístupu k datovému souboru (MOUNT_BACKEND_*)
+ * @param cache_pages počet stránek vyrovnávací paměti (0 = bez vyrovnávací paměti, pouze MOUNT_BACKEND_FILE)
+ * @return (struct vfs_mount * | NULL)
+ */
+struct vfs_mount *mount_open(char *vfs_filename, int8_t backend, int32_t cache_pages){
+    // Ověření - NOT NULL
+    if(vfs_filename == NULL){
+        log_debug("mount_open: Parametr vfs_filename nemuze byt NULL!\n");
+        return NULL;
+    }
+
+    // Ověření - délka řetězce
+    if(strlen(vfs_filename) < 1){
+        log_debug("mount_open: Parametr vfs_filename nemuze byt prazdny retezec!\n");
+        return NULL;
+    }
+
+    // Otevření souboru - popisovač zůstává otevřený až do mount_close
+    int fd = open(vfs_filename, MOUNT_OPEN_FLAGS);
+
+    if(fd < 0){
+        log_debug("mount_open: Soubor %s se nepodarilo otevrit!\n", vfs_filename);
+        return NULL;
+    }
+
+    // Alokace struktury připojení
+    struct vfs_mount *mount = malloc(sizeof(struct vfs_mount));
+
+    if(mount == NULL){
+        log_debug("mount_open: Nepodarilo se alokovat pamet!\n");
+        close(fd);
+        return NULL;
+    }
+
+    memset(mount, 0, sizeof(struct vfs_mount));
+    mount->fd = fd;
+    mount->backend = MOUNT_BACKEND_FILE;
+    mount->file_size = lseek(fd, 0, SEEK_END);
+#ifdef __linux__
+    mount->zero_copy = TRUE;
+    mount->punch_hole = TRUE;
+#endif
+
+#ifndef _WIN32
+    // Namapování celého datového souboru do paměti
+    if(backend == MOUNT_BACKEND_MMAP){
+        struct stat st;
+
+        if(fstat(fd, &st) == 0 && st.st_size > 0){
+            void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+            if(map != MAP_FAILED){
+                mount->map = map;
+                mount->map_size = st.st_size;
+                mount->backend = MOUNT_BACKEND_MMAP;
+            } else {
+                log_debug("mount_open: Soubor %s nelze namapovat, pouzit pread/pwrite!\n", vfs_filename);
+            }
+        }
+    }
+#endif
+
+    // Přečtení superbloku - jednou pro celou dobu připojení
+    mount->superblock_ptr = malloc(sizeof(struct superblock));
+    memset(mount->superblock_ptr, 0, sizeof(struct superblock));
+
+    // Superblok starších verzí se převede do aktuální struktury
+    char raw[sizeof(struct superblock)];
+    memset(raw, 0, sizeof(raw));
+    int64_t read = mount_read(mount, 0, raw, sizeof(raw));
+    superblock_decode(mount->superblock_ptr, raw);
+
+    if(read != sizeof(struct superblock) || superblock_check(mount->superblock_ptr) != TRUE){
+        log_debug("mount_open: Superblok v souboru %s neni validni!\n", vfs_filename);
+        mount->vfs_filename = NULL;
+        mount_close(mount);
+        return NULL;
+    }
+
+    mount->vfs_filename = malloc(sizeof(char) * strlen(vfs_filename) + 1);
+    strcpy(mount->vfs_filename, vfs_filename);
+
+    // Rozměry mapování databloků - velikost clusteru je mocnina 2, stačí posuny a masky
+    mount->cluster_shift = two_power_exponent(mount->superblock_ptr->cluster_size);
+    if(superblock_version(mount->superblock_ptr) >= VFS_VERSION_64BIT){
+        mount->pointer_shift = mount->cluster_shift - 2;
+    } else {
+        mount->pointer_shift = MOUNT_LEGACY_POINTER_SHIFT;
+    }
+    mount->pointers_per_block = 1 << mount->pointer_shift;
+
+    // Vyrovnávací paměť se stránkou o velikosti clusteru - mapa ji nepotřebuje
+    if(mount->backend == MOUNT_BACKEND_FILE && cache_pages > 0){
+        mount->cache = cache_create(mount->superblock_ptr->cluster_size, cache_pages);
+    }
+
+    // Načtení bitmapy datových bloků do paměti
+    if(bitmap_load(mount) != TRUE){
+        log_debug("mount_open: Bitmapu v souboru %s nelze nacist!\n", vfs_filename);
+        mount_close(mount);
+        return NULL;
+    }
+
+    // Načtení tabulky sdílení clusterů (pouze novější formát)
+    if(refcount_load(mount) != TRUE){
+        log_debug("mount_open: Tabulku sdileni v souboru %s nelze nacist!\n", vfs_filename);
+        mount_close(mount);
+        return NULL;
+    }
+
+    // Načtení bitmapy i-uzlů (pouze novější formát)
+    if(inode_bitmap_load(mount) != TRUE){
+        log_debug("mount_open: Bitmapu i-uzlu v souboru %s nelze nacist!\n", vfs_filename);
+        mount_close(mount);
+        return NULL;
+    }
+
+    log_debug("mount_open: VFS %s pripojen (fd=%d, backend=%d)\n", vfs_filename, fd, mount->backend);
+    return mount;
+}
+
+/**
+ * Uzavře datový soubor VFS a uvolní strukturu připojení
+ *
+ * @param mount ukazatel na připojený VFS
+ * @return výsledek operace
+ */
+bool mount_close(struct vfs_mount *mount){
+    // Ověření zda je třeba uvolňovat
+    if(mount == NULL){
+        return FALSE;
+    }
+
+    // Zápis změněných dat před odpojením
+    mount_sync(mount);
+
+#ifndef _WIN32
+    if(mount->map != NULL){
+        munmap(mount->map, mount->map_size);
+    }
+#endif
+
+    if(mount->cache != NULL){
+        cache_free(mount->cache);
+    }
+
+    dir_index_free_all(mount);
+    dentry_cache_free(mount);
+    inode_cache_free(mount);
+
+    if(mount->fd >= 0){
+        close(mount->fd);
+    }
+
+    if(mount->superblock_ptr != NULL){
+        free(mount->superblock_ptr);
+    }
+
+    if(mount->bitmap != NULL){
+        free(mount->bitmap);
+    }
+
+    if(mount->refcounts != NULL){
+        free(mount->refcounts);
+    }
+
+    if(mount->inode_bitmap != NULL){
+        free(mount->inode_bitmap);
+    }
+
+    if(mount->uninit != NULL){
+        free(mount->uninit);
+    }
+
+    if(mount->vfs_filename != NULL){
+        free(mount->vfs_filename);
+    }
+
+    free(mount);
+
+    return TRUE;
+}
+
+/**
+ * Zjistí rozsah indexů datových clusterů, do kterých zasahuje oblast VFS
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa počátku oblasti
+ * @param size velikost oblasti v bytech
+ * @param first výstup - první index
+ * @param last výstup - poslední index
+ * @return FALSE, pokud oblast nezasahuje do žádného neinicializovaného clusteru
+ */
+static bool mount_uninit_range(struct vfs_mount *mount, int64_t address, size_t size, int32_t *first, int32_t *last){
+    if(mount->uninit_count < 1 || size < 1){
+        return FALSE;
+    }
+
+    int64_t data_start = mount->superblock_ptr->data_start_address;
+    int64_t end = address + (int64_t)size;
+
+    if(end <= data_start){
+        return FALSE;
+    }
+
+    int64_t from = address < data_start ? data_start : address;
+    int64_t last_index = (end - 1 - data_start) >> mount->cluster_shift;
+
+    *first = (int32_t)((from - data_start) >> mount->cluster_shift);
+    *last = last_index < mount->superblock_ptr->cluster_count ? (int32_t)last_index : mount->superblock_ptr->cluster_count - 1;
+
+    return *first <= *last ? TRUE : FALSE;
+}
+
+/**
+ * Vrátí, zda je cluster neinicializovaný
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param index index datového clusteru
+ * @return hodnota bitu
+ */
+static bool mount_uninit_get(struct vfs_mount *mount, int32_t index){
+    return (bool)((mount->uninit[index >> 6] >> (index & 63)) & 1);
+}
+
+/**
+ * Zruší příznak neinicializovaného clusteru
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param index index datového clusteru
+ */
+static void mount_uninit_clear(struct vfs_mount *mount, int32_t index){
+    if(mount_uninit_get(mount, index) == TRUE){
+        mount->uninit[index >> 6] &= ~((uint64_t)1 << (index & 63));
+        mount->uninit_count--;
+    }
+}
+
+/**
+ * Vrátí, zda je oblast datového souboru dírou hostitelského systému (čte se jako nuly)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa počátku oblasti
+ * @param size velikost oblasti v bytech
+ * @return výsledek
+ */
+static bool mount_host_hole(struct vfs_mount *mount, int64_t address, int64_t size){
+#if defined(SEEK_DATA) && !defined(_WIN32)
+    off_t data = lseek(mount->fd, address, SEEK_DATA);
+
+    if(data < 0){
+        return errno == ENXIO ? TRUE : FALSE;
+    }
+
+    return data >= address + size ? TRUE : FALSE;
+#else
+    return FALSE;
+#endif
+}
+
+/**
+ * Vynuluje neinicializovaný cluster na disku (pokud už není dírou) a zruší jeho příznak
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param index index datového clusteru
+ * @return výsledek operace
+ */
+static bool mount_uninit_materialize(struct vfs_mount *mount, int32_t index){
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int64_t address = mount->superblock_ptr->data_start_address + ((int64_t)index << mount->cluster_shift);
+
+    // Příznak se ruší předem - následující zápis už nulování neřeší
+    mount_uninit_clear(mount, index);
+
+    // Stránka ve vyrovnávací paměti by zastínila díru na disku
+    if((mount->cache == NULL || cache_invalidate(mount, address, cluster_size) == TRUE)
+       && mount->backend == MOUNT_BACKEND_FILE && mount_host_hole(mount, address, cluster_size) == TRUE){
+        return TRUE;
+    }
+
+    char *zero = calloc(1, cluster_size);
+
+    if(zero == NULL){
+        return FALSE;
+    }
+
+    int64_t result = mount_write(mount, address, zero, cluster_size);
+    free(zero);
+
+    log_trace("mount_uninit_materialize: Cluster %d vynulovan na disku\n", index);
+    return result == cluster_size ? TRUE : FALSE;
+}
+
+/**
+ * Před zápisem do oblasti vynuluje neinicializované clustery, které zápis celé nepřepíše,
+ * celé přepsané clustery pouze ztratí příznak
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa počátku zápisu
+ * @param size velikost zápisu v bytech
+ */
+static void mount_uninit_before_write(struct vfs_mount *mount, int64_t address, size_t size){
+    int32_t first = 0;
+    int32_t last = 0;
+
+    if(mount_uninit_range(mount, address, size, &first, &last) != TRUE){
+        return;
+    }
+
+    int64_t data_start = mount->superblock_ptr->data_start_address;
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int32_t index;
+    for(index = first; index <= last; index++){
+        if(mount_uninit_get(mount, index) != TRUE){
+            continue;
+        }
+
+        int64_t cluster_start = data_start + ((int64_t)index << mount->cluster_shift);
+
+        if(cluster_start < address || cluster_start + cluster_size > address + (int64_t)size){
+            mount_uninit_materialize(mount, index);
+        } else {
+            mount_uninit_clear(mount, index);
+        }
+    }
+}
+
+/**
+ * Přečtenou oblast, která zasahuje do neinicializovaných clusterů, v bufferu vynuluje
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa počátku čtení
+ * @param buffer přečtená data
+ * @param size velikost přečtených dat v bytech
+ * @return počet vynulovaných byte
+ */
+static int64_t mount_uninit_overlay(struct vfs_mount *mount, int64_t address, void *buffer, size_t size){
+    int32_t first = 0;
+    int32_t last = 0;
+
+    if(mount_uninit_range(mount, address, size, &first, &last) != TRUE){
+        return 0;
+    }
+
+    int64_t data_start = mount->superblock_ptr->data_start_address;
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int64_t end = address + (int64_t)size;
+    int64_t zeroed = 0;
+    int32_t index;
+    for(index = first; index <= last; index++){
+        if(mount_uninit_get(mount, index) != TRUE){
+            continue;
+        }
+
+        int64_t from = data_start + ((int64_t)index << mount->cluster_shift);
+        int64_t to = from + cluster_size;
+        from = from < address ? address : from;
+        to = to > end ? end : to;
+
+        memset((char *)buffer + (from - address), 0, to - from);
+        zeroed += to - from;
+    }
+
+    return zeroed;
+}
+
+/**
+ * Označí cluster jako neinicializovaný - čte se jako nuly a na disku se vynuluje
+ * až při částečném zápisu (nebo při mount_sync)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param index index datového clusteru
+ * @return výsledek operace
+ */
+bool mount_mark_uninit(struct vfs_mount *mount, int32_t index){
+    if(mount == NULL || index < 0 || index >= mount->superblock_ptr->cluster_count){
+        return FALSE;
+    }
+
+    // Bitmapa příznaků vzniká až s prvním neinicializovaným clusterem
+    if(mount->uninit == NULL){
+        mount->uninit = calloc(mount->bitmap_words, sizeof(uint64_t));
+
+        if(mount->uninit == NULL){
+            return FALSE;
+        }
+    }
+
+    if(mount_uninit_get(mount, index) != TRUE){
+        mount->uninit[index >> 6] |= (uint64_t)1 << (index & 63);
+        mount->uninit_count++;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Vrátí uvolněné clustery hostitelskému systému (díra v datovém souboru VFS)
+ *
+ * Bez podpory fallocate(FALLOC_FL_PUNCH_HOLE) clustery na disku zůstanou beze změny
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param index index prvního datového clusteru
+ * @param count počet clusterů
+ * @return TRUE, pokud je oblast na disku dírou
+ */
+bool mount_punch_clusters(struct vfs_mount *mount, int32_t index, int32_t count){
+    if(mount == NULL || index < 0 || count < 1){
+        return FALSE;
+    }
+
+    // Uvolněný cluster už není třeba nulovat
+    int32_t i;
+    for(i = 0; mount->uninit_count > 0 && i < count; i++){
+        mount_uninit_clear(mount, index + i);
+    }
+
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+    if(mount->punch_hole != TRUE){
+        return FALSE;
+    }
+
+    int64_t address = mount->superblock_ptr->data_start_address + ((int64_t)index << mount->cluster_shift);
+    int64_t size = (int64_t)count << mount->cluster_shift;
+
+    // Stránky vyrovnávací paměti by díru po zápisu zpět opět zaplnily
+    if(cache_invalidate(mount, address, size) != TRUE){
+        return FALSE;
+    }
+
+    if(fallocate(mount->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, address, size) != 0){
+        // Souborový systém díry nepodporuje - nezkoušet znovu
+        if(errno == EOPNOTSUPP || errno == ENOSYS){
+            mount->punch_hole = FALSE;
+        }
+
+        log_debug("mount_punch_clusters: Clustery %d-%d nelze vratit hostitelskemu systemu!\n", index, index + count - 1);
+        return FALSE;
+    }
+
+    log_trace("mount_punch_clusters: Clustery %d-%d vraceny hostitelskemu systemu\n", index, index + count - 1);
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+/**
+ * Přečte data z datového souboru VFS od dané adresy
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer cíl čtení
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet přečtených byte)
+ */
+int64_t mount_read(struct vfs_mount *mount, int64_t address, void *buffer, size_t size){
+    if(mount == NULL || buffer == NULL){
+        return -1;
+    }
+
+    if(address < 0){
+        return -2;
+    }
+
+    // Oblast pouze z neinicializovaných clusterů se čte bez přístupu na disk
+    if(mount->uninit_count > 0 && mount_uninit_overlay(mount, address, buffer, size) == (int64_t)size){
+        return size;
+    }
+
+    int64_t result = 0;
+
+    if(mount->backend == MOUNT_BACKEND_MMAP){
+        // Čtení z mapy - konec mapy odpovídá konci souboru
+        if(address >= mount->map_size){
+            return 0;
+        }
+
+        if(address + (int64_t)size > mount->map_size){
+            size = mount->map_size - address;
+        }
+
+        memcpy(buffer, mount->map + address, size);
+        result = size;
+    } else if(mount->cache != NULL){
+        // Čtení přes vyrovnávací paměť
+        result = cache_read(mount, address, buffer, size);
+    } else {
+        result = mount_raw_read(mount, address, buffer, size);
+    }
+
+    // Neinicializované clustery se čtou jako nuly
+    if(mount->uninit_count > 0 && result > 0){
+        mount_uninit_overlay(mount, address, buffer, result);
+    }
+
+    return result;
+}
+
+/**
+ * Přečte oblast datového souboru VFS do vynulovaného bufferu, díry hostitelského
+ * souboru se přeskočí - čerstvě naformátovaný VFS tak tabulky načte bez čtení disku
+ *
+ * Slouží pro načtení tabulek při připojení (ve vyrovnávací paměti nejsou změněné stránky)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer vynulovaný cíl čtení
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet byte oblasti uvnitř souboru)
+ */
+int64_t mount_read_sparse(struct vfs_mount *mount, int64_t address, void *buffer, size_t size){
+    if(mount == NULL || buffer == NULL){
+        return -1;
+    }
+
+    if(address < 0){
+        return -2;
+    }
+
+    // Oblast za koncem souboru není (zkrácený soubor VFS)
+    int64_t end = address + (int64_t)size;
+    if(end > mount->file_size){
+        end = mount->file_size > address ? mount->file_size : address;
+    }
+
+    int64_t position = address;
+    while(position < end){
+        int64_t data_end = end;
+        int64_t data = mount_fd_next_data(mount->fd, position, end, &data_end);
+
+        if(data >= end){
+            break;
+        }
+
+        int64_t result = mount_read(mount, data, (char *)buffer + (data - address), data_end - data);
+
+        if(result < 0){
+            return result;
+        }
+
+        if(result < data_end - data){
+            return data - address + result;
+        }
+
+        position = data_end;
+    }
+
+    return end - address;
+}
+
+/**
+ * Přečte data přímo z datového souboru VFS (obchází vyrovnávací paměť)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer cíl čtení
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet přečtených byte)
+ */
+int64_t mount_raw_read(struct vfs_mount *mount, int64_t address, void *buffer, size_t size){
+    size_t done = 0;
+    while(done < size){
+    #ifdef _WIN32
+        lseek(mount->fd, address + done, SEEK_SET);
+        int64_t result = read(mount->fd, (char *)buffer + done, size - done);
+    #else
+        int64_t result = pread(mount->fd, (char *)buffer + done, size - done, address + done);
+    #endif
+
+        // Chyba čtení
+        if(result < 0){
+            log_debug("mount_read: Chyba cteni na adrese %ld!\n", (long)(address + done));
+            return -3;
+        }
+
+        // Konec souboru
+        if(result == 0){
+            break;
+        }
+
+        done += result;
+    }
+
+    return done;
+}
+
+/**
+ * Zapíše data do datového souboru VFS na danou adresu
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer zdroj zápisu
+ * @param size počet byte k zápisu
+ * @return (return < 0: chyba | return >= 0: počet zapsaných byte)
+ */
+int64_t mount_write(struct vfs_mount *mount, int64_t address, const void *buffer, size_t size){
+    if(mount == NULL || buffer == NULL){
+        return -1;
+    }
+
+    if(address < 0){
+        return -2;
+    }
+
+    // Neinicializované clustery, které zápis nepřepíše celé, se nejprve vynulují
+    if(mount->uninit_count > 0){
+        mount_uninit_before_write(mount, address, size);
+    }
+
+    // Zápis do mapy - velikost VFS se po vytvoření nemění
+    if(mount->backend == MOUNT_BACKEND_MMAP){
+        if(address + (int64_t)size > mount->map_size){
+            log_debug("mount_write: Zapis za konec mapy na adrese %ld!\n", (long)address);
+            return -3;
+        }
+
+        memcpy(mount->map + address, buffer, size);
+        return size;
+    }
+
+    // Zápis přes vyrovnávací paměť
+    if(mount->cache != NULL){
+        return cache_write(mount, address, buffer, size);
+    }
+
+    return mount_raw_write(mount, address, buffer, size);
+}
+
+/**
+ * Zapíše data přímo do datového souboru VFS (obchází vyrovnávací paměť)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer zdroj zápisu
+ * @param size počet byte k zápisu
+ * @return (return < 0: chyba | return >= 0: počet zapsaných byte)
+ */
+int64_t mount_raw_write(struct vfs_mount *mount, int64_t address, const void *buffer, size_t size){
+    size_t done = 0;
+    while(done < size){
+    #ifdef _WIN32
+        lseek(mount->fd, address + done, SEEK_SET);
+        int64_t result = write(mount->fd, (const char *)buffer + done, size - done);
+    #else
+        int64_t result = pwrite(mount->fd, (const char *)buffer + done, size - done, address + done);
+    #endif
+
+        // Chyba zápisu
+        if(result <= 0){
+            log_debug("mount_write: Chyba zapisu na adrese %ld!\n", (long)(address + done));
+            return -3;
+        }
+
+        done += result;
+    }
+
+    // Zápis za konec souboru soubor zvětší
+    if(address + (int64_t)done > mount->file_size){
+        mount->file_size = address + done;
+    }
+
+    return done;
+}
+
+/**
+ * Vrátí ukazatel přímo do namapovaného datového souboru VFS
+ *
+ * Slouží pro čtení malých struktur bez kopírování, funguje pouze
+ * pro MOUNT_BACKEND_MMAP, jinak vrací NULL a volající musí použít mount_read
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param size velikost požadované oblasti
+ * @return (ukazatel do mapy | NULL)
+ */
+void *mount_ptr(struct vfs_mount *mount, int64_t address, size_t size){
+    if(mount == NULL || mount->backend != MOUNT_BACKEND_MMAP){
+        return NULL;
+    }
+
+    if(address < 0 || address + (int64_t)size > mount->map_size){
+        return NULL;
+    }
+
+    // Neinicializovaný cluster má v mapě neplatná data
+    int32_t first = 0;
+    int32_t last = 0;
+    if(mount_uninit_range(mount, address, size, &first, &last) == TRUE){
+        for(; first <= last; first++){
+            if(mount_uninit_get(mount, first) == TRUE){
+                return NULL;
+            }
+        }
+    }
+
+    return mount->map + address;
+}
+
+#ifdef __linux__
+/**
+ * Přenese data mezi dvěma soubory v jádře (copy_file_range)
+ *
+ * Pokud volání jádro nebo souborový systém nepodporuje, vypne se
+ * mount->zero_copy a volající dokončí přenos přes buffer
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param fd_in zdrojový popisovač
+ * @param offset_in pozice ve zdroji
+ * @param fd_out cílový popisovač
+ * @param offset_out pozice v cíli
+ * @param size počet byte
+ * @return (return < 0: chyba | return >= 0: počet přenesených byte)
+ */
+static int64_t mount_copy_kernel(struct vfs_mount *mount, int fd_in, int64_t offset_in, int fd_out, int64_t offset_out, size_t size){
+    size_t done = 0;
+
+    while(done < size){
+        loff_t in = offset_in + done;
+        loff_t out = offset_out + done;
+        ssize_t result = copy_file_range(fd_in, &in, fd_out, &out, size - done, 0);
+
+        if(result < 0){
+            if(errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EBADF){
+                log_debug("mount_copy_kernel: copy_file_range neni dostupne (errno=%d), pouzit buffer!\n", errno);
+                mount->zero_copy = FALSE;
+                break;
+            }
+
+            log_debug("mount_copy_kernel: Chyba copy_file_range (errno=%d)!\n", errno);
+            return -3;
+        }
+
+        // Konec zdrojového souboru
+        if(result == 0){
+            break;
+        }
+
+        done += result;
+    }
+
+    return done;
+}
+#endif
+
+/**
+ * Zkopíruje data z otevřeného souboru hostitelského systému do VFS
+ *
+ * Na Linuxu se data přenáší v jádře (copy_file_range) bez průchodu
+ * uživatelským prostorem, jinak se kopíruje přes buffer
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param fd popisovač zdrojového souboru
+ * @param fd_offset pozice ve zdrojovém souboru
+ * @param size počet byte ke kopírování
+ * @return (return < 0: chyba | return >= 0: počet zkopírovaných byte)
+ */
+int64_t mount_copy_from_fd(struct vfs_mount *mount, int64_t address, int fd, int64_t fd_offset, size_t size){
+    if(mount == NULL || fd < 0){
+        log_debug("mount_copy_from_fd: Neplatne parametry!\n");
+        return -1;
+    }
+
+    // Neinicializované clustery, které kopie nepřepíše celé, se nejprve vynulují
+    if(mount->uninit_count > 0){
+        mount_uninit_before_write(mount, address, size);
+    }
+
+    // Stránky vyrovnávací paměti v cílové oblasti by po zápisu mimo ni byly zastaralé
+    if(cache_invalidate(mount, address, size) != TRUE){
+        return -2;
+    }
+
+    size_t done = 0;
+
+#ifdef __linux__
+    if(mount->zero_copy == TRUE){
+        int64_t result = mount_copy_kernel(mount, fd, fd_offset, mount->fd, address, size);
+
+        if(result < 0){
+            return result;
+        }
+
+        done = result;
+
+        if(address + (int64_t)done > mount->file_size){
+            mount->file_size = address + done;
+        }
+
+        // Hotovo, nebo konec zdrojového souboru
+        if(done == size || mount->zero_copy == TRUE){
+            return done;
+        }
+    }
+#endif
+
+    // Kopírování přes buffer
+    char *buffer = malloc(MOUNT_COPY_BUFFER);
+
+    if(buffer == NULL){
+        log_debug("mount_copy_from_fd: Nepodarilo se alokovat pamet!\n");
+        return -4;
+    }
+
+    while(done < size){
+        size_t chunk = size - done < MOUNT_COPY_BUFFER ? size - done : MOUNT_COPY_BUFFER;
+    #ifdef _WIN32
+        lseek(fd, fd_offset + done, SEEK_SET);
+        int64_t result = read(fd, buffer, chunk);
+    #else
+        int64_t result = pread(fd, buffer, chunk, fd_offset + done);
+    #endif
+
+        if(result < 0){
+            log_debug("mount_copy_from_fd: Chyba cteni zdrojoveho souboru!\n");
+            free(buffer);
+            return -3;
+        }
+
+        if(result == 0){
+            break;
+        }
+
+        if(mount_write(mount, address + done, buffer, result) != result){
+            free(buffer);
+            return -3;
+        }
+
+        done += result;
+    }
+
+    free(buffer);
+    return done;
+}
+
+/**
+ * Zkopíruje data z VFS do otevřeného souboru hostitelského systému
+ *
+ * Na Linuxu se data přenáší v jádře (copy_file_range) bez průchodu
+ * uživatelským prostorem, jinak se kopíruje přes buffer
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param fd popisovač cílového souboru
+ * @param fd_offset pozice v cílovém souboru
+ * @param size počet byte ke kopírování
+ * @return (return < 0: chyba | return >= 0: počet zkopírovaných byte)
+ */
+int64_t mount_copy_to_fd(struct vfs_mount *mount, int64_t address, int fd, int64_t fd_offset, size_t size){
+    if(mount == NULL || fd < 0){
+        log_debug("mount_copy_to_fd: Neplatne parametry!\n");
+        return -1;
+    }
+
+    // Jádro čte přímo z disku - neinicializované clustery musí být na disku nulové
+    int32_t first = 0;
+    int32_t last = 0;
+    if(mount_uninit_range(mount, address, size, &first, &last) == TRUE){
+        for(; first <= last; first++){
+            if(mount_uninit_get(mount, first) == TRUE){
+                mount_uninit_materialize(mount, first);
+            }
+        }
+    }
+
+    // Změněné stránky vyrovnávací paměti musí být ve VFS dřív, než je jádro přečte
+    if(cache_flush_range(mount, address, size) != TRUE){
+        return -2;
+    }
+
+    size_t done = 0;
+
+#ifdef __linux__
+    if(mount->zero_copy == TRUE){
+        int64_t result = mount_copy_kernel(mount, mount->fd, address, fd, fd_offset, size);
+
+        if(result < 0){
+            return result;
+        }
+
+        done = result;
+
+        if(done == size || mount->zero_copy == TRUE){
+            return done;
+        }
+    }
+#endif
+
+    // Kopírování přes buffer
+    char *buffer = malloc(MOUNT_COPY_BUFFER);
+
+    if(buffer == NULL){
+        log_debug("mount_copy_to_fd: Nepodarilo se alokovat pamet!\n");
+        return -4;
+    }
+
+    while(done < size){
+        size_t chunk = size - done < MOUNT_COPY_BUFFER ? size - done : MOUNT_COPY_BUFFER;
+        int64_t result = mount_read(mount, address + done, buffer, chunk);
+
+        if(result <= 0){
+            break;
+        }
+
+        size_t written = 0;
+        while(written < (size_t)result){
+        #ifdef _WIN32
+            lseek(fd, fd_offset + done + written, SEEK_SET);
+            int64_t count = write(fd, buffer + written, result - written);
+        #else
+            int64_t count = pwrite(fd, buffer + written, result - written, fd_offset + done + written);
+        #endif
+
+            if(count <= 0){
+                log_debug("mount_copy_to_fd: Chyba zapisu do ciloveho souboru!\n");
+                free(buffer);
+                return -3;
+            }
+
+            written += count;
+        }
+
+        done += result;
+    }
+
+    free(buffer);
+    return done;
+}
+
+/**
+ * Najde v souboru hostitelského systému další úsek dat - díry řídkého souboru přeskočí
+ *
+ * Bez podpory SEEK_DATA/SEEK_HOLE se celý rozsah považuje za data
+ *
+ * @param fd popisovač souboru
+ * @param offset pozice, od které se hledá
+ * @param end konec prohledávaného rozsahu
+ * @param data_end výstup - konec nalezeného úseku dat (nejvýše end)
+ * @return začátek úseku dat (end - v rozsahu už žádná data nejsou)
+ */
+int64_t mount_fd_next_data(int fd, int64_t offset, int64_t end, int64_t *data_end){
+    *data_end = end;
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    off_t data = lseek(fd, offset, SEEK_DATA);
+
+    if(data < 0){
+        // Za pozicí už jsou jen díry, jinak se díry nepodporují
+        return errno == ENXIO ? end : offset;
+    }
+
+    if(data >= end){
+        return end;
+    }
+
+    off_t hole = lseek(fd, data, SEEK_HOLE);
+
+    if(hole >= 0 && hole < end){
+        *data_end = hole;
+    }
+
+    return data;
+#else
+    return offset;
+#endif
+}
+
+/**
+ * Zapíše do souboru hostitelského systému nuly (díra souboru VFS)
+ *
+ * Část za koncem souboru se pouze doplní zvětšením souboru, takže
+ * na podporujícím souborovém systému zůstane dírou
+ *
+ * @param fd popisovač cílového souboru
+ * @param fd_offset pozice v cílovém souboru
+ * @param size počet byte
+ * @return výsledek operace
+ */
+bool mount_fd_zero(int fd, int64_t fd_offset, int64_t size){
+    if(fd < 0 || fd_offset < 0 || size < 0){
+        return FALSE;
+    }
+
+    int64_t end = fd_offset + size;
+
+#ifndef _WIN32
+    struct stat info;
+
+    if(fstat(fd, &info) == 0 && end > info.st_size){
+        // Za konec souboru stačí soubor prodloužit
+        int64_t current = info.st_size > fd_offset ? info.st_size : fd_offset;
+
+        if(ftruncate(fd, end) != 0){
+            log_debug("mount_fd_zero: Cilovy soubor nelze prodlouzit!\n");
+            return FALSE;
+        }
+
+        end = current;
+    }
+#endif
+
+    if(end <= fd_offset){
+        return TRUE;
+    }
+
+    char *zero = calloc(1, MOUNT_COPY_BUFFER);
+
+    if(zero == NULL){
+        return FALSE;
+    }
+
+    int64_t done = 0;
+    while(fd_offset + done < end){
+        int64_t chunk = end - fd_offset - done < MOUNT_COPY_BUFFER ? end - fd_offset - done : MOUNT_COPY_BUFFER;
+    #ifdef _WIN32
+        lseek(fd, fd_offset + done, SEEK_SET);
+        int64_t count = write(fd, zero, chunk);
+    #else
+        int64_t count = pwrite(fd, zero, chunk, fd_offset + done);
+    #endif
+
+        if(count <= 0){
+            log_debug("mount_fd_zero: Chyba zapisu do ciloveho souboru!\n");
+            free(zero);
+            return FALSE;
+        }
+
+        done += count;
+    }
+
+    free(zero);
+    return TRUE;
+}
+
+/**
+ * Zajistí zápis změněných dat připojeného VFS na disk
+ * (vyrovnávací paměť, mapa i soubor)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @return výsledek operace
+ */
+bool mount_sync(struct vfs_mount *mount){
+    if(mount == NULL){
+        return FALSE;
+    }
+
+    // Odložené zápisy i-uzlů
+    if(inode_cache_flush(mount) != TRUE){
+        return FALSE;
+    }
+
+    // Neinicializované clustery se evidují pouze v paměti - na disku musí být nulové
+    int32_t word;
+    for(word = 0; mount->uninit_count > 0 && word < mount->bitmap_words; word++){
+        int32_t bit;
+        for(bit = 0; mount->uninit[word] != 0 && bit < 64; bit++){
+            if(((mount->uninit[word] >> bit) & 1) != 0){
+                mount_uninit_materialize(mount, (word << 6) + bit);
+            }
+        }
+    }
+
+#ifndef _WIN32
+    if(mount->backend == MOUNT_BACKEND_MMAP){
+        if(msync(mount->map, mount->map_size, MS_SYNC) != 0){
+            log_debug("mount_sync: Nepodarilo se synchronizovat mapu!\n");
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    // Zápis změněných stránek vyrovnávací paměti
+    if(mount->cache != NULL && cache_flush(mount) != TRUE){
+        return FALSE;
+    }
+
+    if(fsync(mount->fd) != 0){
+        log_debug("mount_sync: Nepodarilo se synchronizovat soubor!\n");
+        return FALSE;
+    }
+#else
+    if(mount->cache != NULL && cache_flush(mount) != TRUE){
+        return FALSE;
+    }
+#endif
+
+    return TRUE;
+}
+
+/**
+ * Zjistí obsazenost připojeného VFS z počtů volných clusterů a i-uzlů v superbloku
+ *
+ * Počty se udržují při každé změně bitmap, dotaz tak bitmapy neprochází.
+ * Jen u formátů bez bitmapy i-uzlů se při prvním dotazu jednou projde
+ * tabulka i-uzlů (inode_bitmap_build).
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param stat výstup - obsazenost VFS
+ * @return výsledek operace
+ */
+bool mount_statfs(struct vfs_mount *mount, struct vfs_statfs *stat){
+    if(mount == NULL || stat == NULL){
+        log_debug("mount_statfs: VFS neni pripojen!\n");
+        return FALSE;
+    }
+
+    // Starší formát - počet volných i-uzlů se dopočte jednou, dále se udržuje
+    if(mount->inode_bitmap == NULL && inode_bitmap_build(mount) != TRUE){
+        log_debug("mount_statfs: Bitmapu i-uzlu nelze sestavit!\n");
+        return FALSE;
+    }
+
+    struct superblock *superblock_ptr = mount->superblock_ptr;
+
+    stat->disk_size = superblock_ptr->disk_size;
+    stat->cluster_size = superblock_ptr->cluster_size;
+    // Poslední cluster se nepřiděluje - nepočítá se ani do celkového počtu
+    stat->cluster_count = superblock_ptr->cluster_count - 1;
+    stat->free_clusters = superblock_ptr->free_cluster_count;
+    stat->inode_count = superblock_ptr->inode_count;
+    stat->free_inodes = superblock_ptr->free_inode_count;
+
+    return TRUE;
+}
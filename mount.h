@@ -0,0 +1,249 @@
+#ifndef KIV_ZOS_MOUNT_H
+#define KIV_ZOS_MOUNT_H
+
+/*
+ * Nutné hlavičky
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "bool.h"
+#include "superblock.h"
+#include "cache.h"
+
+/*
+ * Konstanty
+ */
+#define MOUNT_BACKEND_FILE 0    // Přístup k VFS přes pread/pwrite
+#define MOUNT_BACKEND_MMAP 1    // Přístup k VFS přes namapovanou paměť (mmap)
+#define MOUNT_LEGACY_POINTER_SHIFT 10   // Starší formáty mají v nepřímém bloku pevně 1024 odkazů
+
+/*
+ * Struktury
+ */
+// Obsazenost připojeného VFS (mount_statfs)
+struct vfs_statfs {
+    int64_t disk_size;                  // Celková velikost VFS v bytech
+    int32_t cluster_size;               // Velikost clusteru v bytech
+    int32_t cluster_count;              // Počet přidělitelných datových clusterů
+    int32_t free_clusters;              // Počet volných clusterů
+    int32_t inode_count;                // Počet i-uzlů
+    int32_t free_inodes;                // Počet volných i-uzlů
+};
+
+// Připojený VFS - soubor je otevřen po celou dobu práce a superblok je načten v paměti
+struct vfs_mount {
+    char *vfs_filename;                 // Cesta k datovému souboru VFS
+    int fd;                             // Popisovač otevřeného datového souboru VFS
+    struct superblock *superblock_ptr;  // Superblok přečtený při připojení
+    int32_t cluster_shift;              // log2(cluster_size) - převod pozice na cluster posunem
+    int32_t pointers_per_block;         // Počet odkazů na datablok v jednom nepřímém bloku
+    int32_t pointer_shift;              // log2(pointers_per_block)
+    int8_t backend;                     // Způsob přístupu k datovému souboru (MOUNT_BACKEND_*)
+    char *map;                          // Namapovaný obsah datového souboru (pouze MOUNT_BACKEND_MMAP)
+    int64_t map_size;                   // Velikost namapované oblasti v bytech
+    uint64_t *bitmap;                   // Bitmapa datových bloků načtená v paměti (1 bit na cluster)
+    int32_t bitmap_words;               // Počet 64bitových slov bitmapy
+    int32_t bitmap_rotor;               // Slovo, od kterého začne další hledání volného clusteru
+    uint16_t *refcounts;                // Tabulka sdílení clusterů v paměti (NULL = formát bez tabulky)
+    uint64_t *inode_bitmap;             // Bitmapa obsazených i-uzlů v paměti (NULL = formát bez bitmapy)
+    int32_t inode_bitmap_words;         // Počet 64bitových slov bitmapy i-uzlů
+    int32_t inode_rotor;                // Slovo, od kterého začne další hledání volného i-uzlu
+    int64_t file_size;                  // Aktuální velikost datového souboru v bytech
+    struct vfs_cache *cache;            // Vyrovnávací paměť s odloženým zápisem (NULL = bez ní)
+    struct dir_index **dir_indexes;     // Hashované indexy velkých složek (podle ID i-uzlu)
+    struct dentry_cache *dentries;      // Mezipaměť překladu cest (složka, jméno) -> i-uzel
+    struct inode_cache *inodes;         // Mezipaměť i-uzlů s odloženým zápisem (NULL = dosud nepoužita)
+    bool zero_copy;                     // Kopírování souborů v jádře (copy_file_range) je dostupné
+    bool punch_hole;                    // Uvolněné clustery lze vrátit hostitelskému systému (fallocate)
+    uint64_t *uninit;                   // Neinicializované clustery - čtou se jako nuly (1 bit na cluster, NULL = žádné)
+    int32_t uninit_count;               // Počet neinicializovaných clusterů
+};
+
+/**
+ * Otevře datový soubor VFS, načte a ověří jeho superblok
+ *
+ * Pokud není mmap na platformě dostupné, použije se MOUNT_BACKEND_FILE
+ *
+ * @param vfs_filename cesta k datovému souboru VFS
+ * @param backend způsob přístupu k datovému souboru (MOUNT_BACKEND_*)
+ * @param cache_pages počet stránek vyrovnávací paměti (0 = bez vyrovnávací paměti, pouze MOUNT_BACKEND_FILE)
+ * @return (struct vfs_mount * | NULL)
+ */
+struct vfs_mount *mount_open(char *vfs_filename, int8_t backend, int32_t cache_pages);
+
+/**
+ * Uzavře datový soubor VFS a uvolní strukturu připojení
+ *
+ * @param mount ukazatel na připojený VFS
+ * @return výsledek operace
+ */
+bool mount_close(struct vfs_mount *mount);
+
+/**
+ * Přečte data z datového souboru VFS od dané adresy
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer cíl čtení
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet přečtených byte)
+ */
+int64_t mount_read(struct vfs_mount *mount, int64_t address, void *buffer, size_t size);
+
+/**
+ * Zapíše data do datového souboru VFS na danou adresu
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer zdroj zápisu
+ * @param size počet byte k zápisu
+ * @return (return < 0: chyba | return >= 0: počet zapsaných byte)
+ */
+int64_t mount_write(struct vfs_mount *mount, int64_t address, const void *buffer, size_t size);
+
+/**
+ * Přečte oblast datového souboru VFS do vynulovaného bufferu, díry hostitelského
+ * souboru se přeskočí - čerstvě naformátovaný VFS tak tabulky načte bez čtení disku
+ *
+ * Slouží pro načtení tabulek při připojení (ve vyrovnávací paměti nejsou změněné stránky)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer vynulovaný cíl čtení
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet byte oblasti uvnitř souboru)
+ */
+int64_t mount_read_sparse(struct vfs_mount *mount, int64_t address, void *buffer, size_t size);
+
+/**
+ * Přečte data přímo z datového souboru VFS (obchází vyrovnávací paměť)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer cíl čtení
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet přečtených byte)
+ */
+int64_t mount_raw_read(struct vfs_mount *mount, int64_t address, void *buffer, size_t size);
+
+/**
+ * Zapíše data přímo do datového souboru VFS (obchází vyrovnávací paměť)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param buffer zdroj zápisu
+ * @param size počet byte k zápisu
+ * @return (return < 0: chyba | return >= 0: počet zapsaných byte)
+ */
+int64_t mount_raw_write(struct vfs_mount *mount, int64_t address, const void *buffer, size_t size);
+
+/**
+ * Vrátí ukazatel přímo do namapovaného datového souboru VFS
+ *
+ * Slouží pro čtení malých struktur bez kopírování, funguje pouze
+ * pro MOUNT_BACKEND_MMAP, jinak vrací NULL a volající musí použít mount_read
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param size velikost požadované oblasti
+ * @return (ukazatel do mapy | NULL)
+ */
+void *mount_ptr(struct vfs_mount *mount, int64_t address, size_t size);
+
+/**
+ * Zkopíruje data z otevřeného souboru hostitelského systému do VFS
+ *
+ * Na Linuxu se data přenáší v jádře (copy_file_range) bez průchodu
+ * uživatelským prostorem, jinak se kopíruje přes buffer
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param fd popisovač zdrojového souboru
+ * @param fd_offset pozice ve zdrojovém souboru
+ * @param size počet byte ke kopírování
+ * @return (return < 0: chyba | return >= 0: počet zkopírovaných byte)
+ */
+int64_t mount_copy_from_fd(struct vfs_mount *mount, int64_t address, int fd, int64_t fd_offset, size_t size);
+
+/**
+ * Zkopíruje data z VFS do otevřeného souboru hostitelského systému
+ *
+ * Na Linuxu se data přenáší v jádře (copy_file_range) bez průchodu
+ * uživatelským prostorem, jinak se kopíruje přes buffer
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param address adresa ve VFS
+ * @param fd popisovač cílového souboru
+ * @param fd_offset pozice v cílovém souboru
+ * @param size počet byte ke kopírování
+ * @return (return < 0: chyba | return >= 0: počet zkopírovaných byte)
+ */
+int64_t mount_copy_to_fd(struct vfs_mount *mount, int64_t address, int fd, int64_t fd_offset, size_t size);
+
+/**
+ * Najde v souboru hostitelského systému další úsek dat - díry řídkého souboru přeskočí
+ *
+ * @param fd popisovač souboru
+ * @param offset pozice, od které se hledá
+ * @param end konec prohledávaného rozsahu
+ * @param data_end výstup - konec nalezeného úseku dat (nejvýše end)
+ * @return začátek úseku dat (end - v rozsahu už žádná data nejsou)
+ */
+int64_t mount_fd_next_data(int fd, int64_t offset, int64_t end, int64_t *data_end);
+
+/**
+ * Zapíše do souboru hostitelského systému nuly (díra souboru VFS),
+ * za koncem souboru jej pouze prodlouží
+ *
+ * @param fd popisovač cílového souboru
+ * @param fd_offset pozice v cílovém souboru
+ * @param size počet byte
+ * @return výsledek operace
+ */
+bool mount_fd_zero(int fd, int64_t fd_offset, int64_t size);
+
+/**
+ * Označí cluster jako neinicializovaný - čte se jako nuly a na disku se vynuluje
+ * až při částečném zápisu (nebo při mount_sync)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param index index datového clusteru
+ * @return výsledek operace
+ */
+bool mount_mark_uninit(struct vfs_mount *mount, int32_t index);
+
+/**
+ * Vrátí uvolněné clustery hostitelskému systému (díra v datovém souboru VFS)
+ *
+ * Bez podpory fallocate(FALLOC_FL_PUNCH_HOLE) clustery na disku zůstanou beze změny
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param index index prvního datového clusteru
+ * @param count počet clusterů
+ * @return TRUE, pokud je oblast na disku dírou
+ */
+bool mount_punch_clusters(struct vfs_mount *mount, int32_t index, int32_t count);
+
+/**
+ * Zajistí zápis změněných dat připojeného VFS na disk
+ * (vyrovnávací paměť, mapa i soubor)
+ *
+ * @param mount ukazatel na připojený VFS
+ * @return výsledek operace
+ */
+bool mount_sync(struct vfs_mount *mount);
+
+/**
+ * Zjistí obsazenost připojeného VFS z počtů volných clusterů a i-uzlů v superbloku
+ *
+ * Počty se udržují při každé změně bitmap, dotaz tak bitmapy neprochází.
+ * Jen u formátů bez bitmapy i-uzlů se při prvním dotazu jednou projde
+ * tabulka i-uzlů (inode_bitmap_build).
+ *
+ * @param mount ukazatel na připojený VFS
+ * @param stat výstup - obsazenost VFS
+ * @return výsledek operace
+ */
+bool mount_statfs(struct vfs_mount *mount, struct vfs_statfs *stat);
+
+#endif //KIV_ZOS_MOUNT_H
@@ -31,6 +31,25 @@ bool is_two_power(int32_t number){
     return FALSE;
 }
 
+/**
+ * Vrátí exponent, na který je třeba umocnit číslo 2, abychom dosáhli parametru
+ *
+ * @param number mocnina čísla 2
+ * @return (return < 0 - číslo není mocninou 2 | return >= 0 - exponent)
+ */
+int32_t two_power_exponent(int32_t number){
+    if(number < 1 || (number & (number - 1)) != 0){
+        return -1;
+    }
+
+    int32_t exponent = 0;
+    while((number >> exponent) != 1){
+        exponent++;
+    }
+
+    return exponent;
+}
+
 /**
  * Pokusí se otevřít soubor ke čtení a tím ověří jeho existenci
  *
@@ -214,7 +233,10 @@ char *get_suffix_string_after_last_character(char *string, const char *delimiter
 
     char *buffer2 = malloc(sizeof(char)*strlen(string)+1);
     memset(buffer2, 0, strlen(string)+1);
-    strcpy(buffer2, prev_token_ptr);
+    // Řetězec obsahuje pouze oddělovače (např. "/") - suffix je prázdný
+    if(prev_token_ptr != NULL){
+        strcpy(buffer2, prev_token_ptr);
+    }
     free(buffer);
 
     // Návrat první části
@@ -274,7 +296,10 @@ int64_t parse_filesize(char *txt){
 
     // Kopírování řetězce jednotky do řetězce
     strcpy(unit_str, curr);
-    unit_str[strlen(unit_str)-1] = '\0';
+    // Odstranění konce řádku, pokud je velikost posledním parametrem příkazu
+    while(strlen(unit_str) > 0 && (unit_str[strlen(unit_str)-1] == '\n' || unit_str[strlen(unit_str)-1] == '\r')){
+        unit_str[strlen(unit_str)-1] = '\0';
+    }
     // Úprava původního řetězce před kopírováním velikosti
     txt[size] = '\0';
     // Kopírování řetězce velikosti
@@ -285,13 +310,13 @@ int64_t parse_filesize(char *txt){
 
     char *endptr;
     errno = 0;
-    int64_t result = strtol(size_str, &endptr, 10);
+    int64_t result = strtoll(size_str, &endptr, 10);
     bool failed = FALSE;
     if (endptr == size_str)
     {
         failed = TRUE;
     }
-    if ((result == LONG_MAX || result == LONG_MIN) && errno == ERANGE)
+    if ((result == LLONG_MAX || result == LLONG_MIN) && errno == ERANGE)
     {
        failed = TRUE;
     }
@@ -329,6 +354,12 @@ int64_t parse_filesize(char *txt){
     free(unit_str);
     free(size_str);
 
+    // Výsledek by přetekl 64bitový rozsah
+    if(multiplicator > 0 && base > INT64_MAX / multiplicator){
+        log_debug("parse_filesize: Velikost je mimo povoleny rozsah!\n");
+        return -3;
+    }
+
     // Vrať výsledný počet v byte
     return base * multiplicator;
 }
@@ -421,13 +452,13 @@ char *path_parse_absolute(struct shell *sh, const char *parsing){
         // Zjištění suffix cesty - název složky
         char *dir_name = get_suffix_string_after_last_character(buffer, "/");
         // Otevření rodičovské složky
-        VFS_FILE *vfs_file = vfs_open_recursive(sh->vfs_filename, path_prefix, 0);
+        VFS_FILE *vfs_file = vfs_open_recursive(sh->mount, path_prefix, 0);
 
         if(vfs_file == NULL){
             return NULL;
         }
 
-        char *abs = directory_get_path(sh->vfs_filename, vfs_file->inode_ptr->id);
+        char *abs = directory_get_path(sh->mount, vfs_file->inode_ptr->id);
 
         char *buff = malloc(sizeof(char) * ((strlen(abs) + strlen(dir_name) + 1)));
         memset(buff, 0, sizeof(char) * ((strlen(abs) + strlen(dir_name) + 1)));
@@ -461,11 +492,11 @@ char *path_parse_absolute(struct shell *sh, const char *parsing){
 
             // Není speciální případ
             if(strcmp(part, "..") != 0 && strcmp(part, ".") != 0){
-                struct directory_entry *entry = directory_get_entry(sh_copy->vfs_filename, sh_copy->cwd, part);
+                struct directory_entry *entry = directory_get_entry(sh_copy->mount, sh_copy->cwd, part);
 
                 // Část cesty nenalezena
                 if(entry == NULL){
-                    log_trace("path_parse_absolute: Cast cesty nenalezena: %s z ID=%d\n", sh_copy->cwd, part);
+                    log_trace("path_parse_absolute: Cast cesty nenalezena: %s z ID=%d\n", part, sh_copy->cwd);
                     free(buffer);
                     free(part);
                     free(sh_copy);
@@ -478,7 +509,7 @@ char *path_parse_absolute(struct shell *sh, const char *parsing){
             else{ // Speciální případ, přeskočit .
                 if(strcmp(part, "..") == 0){
                     // Změna CWD kopie kontextu na rodičovskou složku
-                    sh_copy->cwd = directory_get_parent_id(sh_copy->vfs_filename, sh_copy->cwd);
+                    sh_copy->cwd = directory_get_parent_id(sh_copy->mount, sh_copy->cwd);
                 }
             }
 
@@ -487,7 +518,7 @@ char *path_parse_absolute(struct shell *sh, const char *parsing){
         }
 
         // Vrátit absolutní cestu dle inode
-        char *rtn = directory_get_path(sh_copy->vfs_filename, sh_copy->cwd);
+        char *rtn = directory_get_path(sh_copy->mount, sh_copy->cwd);
         free(sh_copy);
         free(buffer);
         return rtn;
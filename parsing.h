@@ -31,6 +31,14 @@
  */
 bool is_two_power(int32_t number);
 
+/**
+ * Vrátí exponent, na který je třeba umocnit číslo 2, abychom dosáhli parametru
+ *
+ * @param number mocnina čísla 2
+ * @return (return < 0 - číslo není mocninou 2 | return >= 0 - exponent)
+ */
+int32_t two_power_exponent(int32_t number);
+
 /**
  * Pokusí se otevřít soubor ke čtení a tím ověří jeho existenci
  *
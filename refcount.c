@@ -0,0 +1,161 @@
+#include "refcount.h"
+#include <string.h>
+#include <stdlib.h>
+#include "debug.h"
+#include "superblock.h"
+
+/**
+ * Zapíše rozsah tabulky sdílení z paměti zpět do VFS
+ *
+ * @param mount připojený VFS
+ * @param index první zapisovaný cluster
+ * @param count počet zapisovaných clusterů
+ * @return výsledek operace
+ */
+static bool refcount_flush_range(struct vfs_mount *mount, int32_t index, int32_t count){
+    int64_t address = mount->superblock_ptr->refcount_start_address + (int64_t)index * sizeof(uint16_t);
+    int64_t size = (int64_t)count * sizeof(uint16_t);
+    int64_t written = mount_write(mount, address, mount->refcounts + index, size);
+
+    return written == size ? TRUE : FALSE;
+}
+
+/**
+ * Načte tabulku sdílení clusterů z VFS do paměti
+ *
+ * U starších formátů bez tabulky zůstane mount->refcounts NULL
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool refcount_load(struct vfs_mount *mount){
+    // Kontrola připojení
+    if(mount == NULL){
+        log_debug("refcount_load: VFS neni pripojen!\n");
+        return FALSE;
+    }
+
+    mount->refcounts = NULL;
+
+    // Starší formát - soubory nelze sdílet
+    int64_t size = superblock_refcount_size(mount->superblock_ptr);
+    if(size < 1){
+        log_debug("refcount_load: Format VFS nema tabulku sdileni clusteru\n");
+        return TRUE;
+    }
+
+    // Díry v souboru VFS jsou nesdílené clustery - čte se pouze zapsaná část tabulky
+    mount->refcounts = calloc(1, size);
+
+    if(mount->refcounts == NULL){
+        log_debug("refcount_load: Nepodarilo se alokovat pamet!\n");
+        return FALSE;
+    }
+
+    int64_t read = mount_read_sparse(mount, mount->superblock_ptr->refcount_start_address, mount->refcounts, size);
+
+    if(read != size){
+        free(mount->refcounts);
+        mount->refcounts = NULL;
+        return FALSE;
+    }
+
+    log_debug("refcount_load: Nactena tabulka sdileni %d clusteru\n", mount->superblock_ptr->cluster_count);
+    return TRUE;
+}
+
+/**
+ * Vrátí počet dalších vlastníků clusteru
+ *
+ * @param mount připojený VFS
+ * @param index index clusteru
+ * @return (0 - cluster není sdílený | return > 0 - počet dalších vlastníků)
+ */
+int32_t refcount_get(struct vfs_mount *mount, int32_t index){
+    if(mount == NULL || mount->refcounts == NULL){
+        return 0;
+    }
+
+    if(index < 0 || index >= mount->superblock_ptr->cluster_count){
+        return 0;
+    }
+
+    return mount->refcounts[index];
+}
+
+/**
+ * Přidá všem zadaným clusterům jednoho dalšího vlastníka
+ *
+ * Pokud by některý cluster překročil REFCOUNT_MAX, nezmění se nic
+ *
+ * @param mount připojený VFS
+ * @param indexes pole indexů clusterů
+ * @param count počet indexů
+ * @return výsledek operace
+ */
+bool refcount_share(struct vfs_mount *mount, int32_t *indexes, int32_t count){
+    // Kontrola připojení a formátu
+    if(mount == NULL || mount->refcounts == NULL){
+        log_debug("refcount_share: VFS nepodporuje sdileni clusteru!\n");
+        return FALSE;
+    }
+
+    if(indexes == NULL || count < 1){
+        return TRUE;
+    }
+
+    int32_t clusters = mount->superblock_ptr->cluster_count;
+    int32_t lowest = clusters;
+    int32_t highest = -1;
+    int32_t i;
+
+    // Ověření všech clusterů před první změnou
+    for(i = 0; i < count; i++){
+        if(indexes[i] < 0 || indexes[i] >= clusters){
+            log_debug("refcount_share: Index %d je mimo povoleny rozsah!\n", indexes[i]);
+            return FALSE;
+        }
+
+        if(mount->refcounts[indexes[i]] == REFCOUNT_MAX){
+            log_debug("refcount_share: Cluster %d uz nelze dale sdilet!\n", indexes[i]);
+            return FALSE;
+        }
+
+        if(indexes[i] < lowest){
+            lowest = indexes[i];
+        }
+        if(indexes[i] > highest){
+            highest = indexes[i];
+        }
+    }
+
+    for(i = 0; i < count; i++){
+        mount->refcounts[indexes[i]]++;
+    }
+
+    // Soubory leží převážně v souvislých úsecích - stačí jeden zápis rozsahu
+    if(refcount_flush_range(mount, lowest, highest - lowest + 1) != TRUE){
+        log_debug("refcount_share: Tabulku sdileni se nepodarilo zapsat do VFS!\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Odebere clusteru jednoho vlastníka, pokud je sdílený
+ *
+ * @param mount připojený VFS
+ * @param index index clusteru
+ * @return (TRUE - cluster byl sdílený a dál jej používá jiný i-uzel | FALSE - cluster lze uvolnit)
+ */
+bool refcount_release(struct vfs_mount *mount, int32_t index){
+    if(refcount_get(mount, index) < 1){
+        return FALSE;
+    }
+
+    mount->refcounts[index]--;
+    refcount_flush_range(mount, index, 1);
+
+    return TRUE;
+}
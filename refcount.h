@@ -0,0 +1,64 @@
+#ifndef KIV_ZOS_REFCOUNT_H
+#define KIV_ZOS_REFCOUNT_H
+
+/*
+ * Tabulka sdílení clusterů (od verze formátu VFS_VERSION_REFCOUNT)
+ *
+ * Pro každý cluster je uložen počet DALŠÍCH i-uzlů, které cluster sdílí
+ * (0 = cluster má jediného vlastníka nebo je volný), běžná alokace tak
+ * tabulku vůbec nemění a nově naformátovaný VFS má tabulku nulovou
+ */
+
+/*
+ * Nutné hlavičky
+ */
+#include <stdint.h>
+#include "bool.h"
+#include "mount.h"
+
+/*
+ * Konstanty
+ */
+#define REFCOUNT_MAX UINT16_MAX     // Maximální počet dalších vlastníků clusteru
+
+/**
+ * Načte tabulku sdílení clusterů z VFS do paměti
+ *
+ * U starších formátů bez tabulky zůstane mount->refcounts NULL
+ *
+ * @param mount připojený VFS
+ * @return výsledek operace
+ */
+bool refcount_load(struct vfs_mount *mount);
+
+/**
+ * Vrátí počet dalších vlastníků clusteru
+ *
+ * @param mount připojený VFS
+ * @param index index clusteru
+ * @return (0 - cluster není sdílený | return > 0 - počet dalších vlastníků)
+ */
+int32_t refcount_get(struct vfs_mount *mount, int32_t index);
+
+/**
+ * Přidá všem zadaným clusterům jednoho dalšího vlastníka
+ *
+ * Pokud by některý cluster překročil REFCOUNT_MAX, nezmění se nic
+ *
+ * @param mount připojený VFS
+ * @param indexes pole indexů clusterů
+ * @param count počet indexů
+ * @return výsledek operace
+ */
+bool refcount_share(struct vfs_mount *mount, int32_t *indexes, int32_t count);
+
+/**
+ * Odebere clusteru jednoho vlastníka, pokud je sdílený
+ *
+ * @param mount připojený VFS
+ * @param index index clusteru
+ * @return (TRUE - cluster byl sdílený a dál jej používá jiný i-uzel | FALSE - cluster lze uvolnit)
+ */
+bool refcount_release(struct vfs_mount *mount, int32_t index);
+
+#endif //KIV_ZOS_REFCOUNT_H
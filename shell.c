@@ -7,6 +7,7 @@
 #include "parsing.h"
 #include "commands.h"
 #include "shell.h"
+#include "directory.h"
 
 
 
@@ -14,10 +15,11 @@
  * Vytvoří strukturu pro kontext terminálu
  *
  * @param vfs_filename
- * @param cwd
+ * @param backend způsob přístupu k VFS (MOUNT_BACKEND_*)
+ * @param cache_pages počet stránek vyrovnávací paměti (0 = vypnuto)
  * @return
  */
-struct shell *shell_create(char *vfs_filename){
+struct shell *shell_create(char *vfs_filename, int8_t backend, int32_t cache_pages){
     // Ověření - NOT NULL
     if (vfs_filename == NULL) {
         log_debug("shell_create: Parametr vfs_filename nemuze byt NULL\n0");
@@ -30,24 +32,16 @@ struct shell *shell_create(char *vfs_filename){
         return NULL;
     }
 
-    // Pokus o přečtení zda existuje superblock
-    struct superblock *superblock_ptr = superblock_from_file(vfs_filename);
+    // Připojení VFS - přečte a ověří superblok
+    struct vfs_mount *mount = mount_open(vfs_filename, backend, cache_pages);
 
-    // Superblock not NULL
-    if(superblock_ptr == NULL){
-        log_debug("shell_create: Nepodarilo se ziskat superblock ze souboru!\n");
-        return NULL;
-    }
-
-    // Ověření konzistence superbloku
-    if(superblock_check(superblock_ptr) != TRUE){
-        log_debug("shell_create: Superblok v souboru %s neni validni!\n", vfs_filename);
-        free(superblock_ptr);
+    if(mount == NULL){
+        log_debug("shell_create: VFS %s se nepodarilo pripojit!\n", vfs_filename);
         return NULL;
     }
 
     // Pouze informační: Ověření existence kořenové složky - ID=1 -> index=0
-    struct inode *inode_ptr = inode_read_by_index(vfs_filename, 0);
+    struct inode *inode_ptr = inode_read_by_index(mount, 0);
     int32_t cwd = 0;
 
     if(inode_ptr == NULL){
@@ -61,11 +55,11 @@ struct shell *shell_create(char *vfs_filename){
     memset(shell_ptr, 0, sizeof(struct shell));
 
     shell_ptr->vfs_filename = malloc(sizeof(char) * strlen(vfs_filename) + 1);
-    shell_ptr->cwd = cwd;
+    shell_ptr->mount = mount;
     strcpy(shell_ptr->vfs_filename, vfs_filename);
+    shell_set_cwd(shell_ptr, cwd, "/");
 
     // Uvolnění zdrojů
-    free(superblock_ptr);
     free(inode_ptr);
 
     return shell_ptr;
@@ -86,12 +80,75 @@ bool shell_free(struct shell *shell_ptr){
         free(shell_ptr->vfs_filename);
     }
 
+    if(shell_ptr->cwd_path != NULL){
+        free(shell_ptr->cwd_path);
+    }
+
+    if(shell_ptr->mount != NULL){
+        mount_close(shell_ptr->mount);
+    }
+
     free(shell_ptr);
 
     return TRUE;
 }
 
 
+/**
+ * Změní aktuální pracovní adresář a jeho uloženou cestu
+ *
+ * @param sh ukazatel na kontext shellu
+ * @param inode_id ID inode nového pracovního adresáře
+ * @param path absolutní cesta adresáře (NULL = dopočítat pomocí directory_get_path)
+ * @return výsledek operace
+ */
+bool shell_set_cwd(struct shell *sh, int32_t inode_id, const char *path){
+    if(sh == NULL){
+        log_debug("shell_set_cwd: Kontext terminalu nemuze byt NULL!\n");
+        return FALSE;
+    }
+
+    char *new_path = NULL;
+
+    if(path != NULL){
+        new_path = malloc(sizeof(char) * strlen(path) + 1);
+        strcpy(new_path, path);
+    } else {
+        new_path = directory_get_path(sh->mount, inode_id);
+    }
+
+    if(new_path == NULL){
+        log_debug("shell_set_cwd: Nelze zjistit cestu slozky ID=%d!\n", inode_id);
+        return FALSE;
+    }
+
+    if(sh->cwd_path != NULL){
+        free(sh->cwd_path);
+    }
+
+    sh->cwd = inode_id;
+    sh->cwd_path = new_path;
+
+    return TRUE;
+}
+
+/**
+ * Vrátí kopii absolutní cesty aktuálního pracovního adresáře
+ *
+ * @param sh ukazatel na kontext shellu
+ * @return (char * - nutno uvolnit | NULL)
+ */
+char *shell_get_cwd_path(struct shell *sh){
+    if(sh == NULL || sh->cwd_path == NULL){
+        return NULL;
+    }
+
+    char *path = malloc(sizeof(char) * strlen(sh->cwd_path) + 1);
+    strcpy(path, sh->cwd_path);
+
+    return path;
+}
+
 /**
  * Zpracuje řetězec obsahující příkaz
  *
@@ -286,6 +343,18 @@ void shell_parse(struct shell *sh, char *command){
         flag_command = TRUE;
     }
 
+    // Příkaz truncate - bez parametrů
+    if(strcicmp(token, "truncate\n") == 0){
+        printf("truncate: Required parameters are missing!\n");
+        flag_command = TRUE;
+    }
+
+    // Příkaz truncate - 2 parametry -> cesta k souboru VFS a nová velikost
+    if(strcicmp(token, "truncate") == 0){
+        cmd_truncate(sh, cmd);
+        flag_command = TRUE;
+    }
+
     // Příkaz slink -> bez parametrů
     if(strcicmp(token, "slink\n") == 0 || strcicmp(token, "lns\n") == 0){
         printf("symlink: Required parameters are missing!\n");
@@ -298,6 +367,18 @@ void shell_parse(struct shell *sh, char *command){
         flag_command = TRUE;
     }
 
+    // Příkaz sync -> zápis vyrovnávací paměti do VFS
+    if(strcicmp(token, "sync\n") == 0 || strcicmp(token, "sync") == 0){
+        cmd_sync(sh);
+        flag_command = TRUE;
+    }
+
+    // Příkaz df / statfs -> obsazenost VFS
+    if(strcicmp(token, "df\n") == 0 || strcicmp(token, "df") == 0 || strcicmp(token, "statfs\n") == 0 || strcicmp(token, "statfs") == 0){
+        cmd_df(sh);
+        flag_command = TRUE;
+    }
+
     // Vždy poslední - vypsat: Neznámý příkaz
     if(flag_command == FALSE){
         printf("Unknown command!\n");
@@ -3,24 +3,30 @@
 
 #include <stdint.h>
 #include "bool.h"
+#include "mount.h"
 
 #define SHELL_DEFAULT_FOLDER 1
 
 struct shell {
     // ID inode aktuálního pracovního adresáře
     int32_t cwd;
+    // Absolutní cesta aktuálního pracovního adresáře (udržuje shell_set_cwd)
+    char *cwd_path;
     // Cesta k VFS souboru
     char *vfs_filename;
+    // Připojený VFS - otevřený po celou dobu běhu shellu
+    struct vfs_mount *mount;
 };
 
 /**
  * Vytvoří strukturu pro kontext terminálu
  *
  * @param vfs_filename
- * @param cwd
+ * @param backend způsob přístupu k VFS (MOUNT_BACKEND_*)
+ * @param cache_pages počet stránek vyrovnávací paměti (0 = vypnuto)
  * @return
  */
-struct shell *shell_create(char *vfs_filename);
+struct shell *shell_create(char *vfs_filename, int8_t backend, int32_t cache_pages);
 
 /**
  * Uvolní alokované zdroje pro strukturu shell
@@ -30,6 +36,24 @@ struct shell *shell_create(char *vfs_filename);
  */
 bool shell_free(struct shell *shell_ptr);
 
+/**
+ * Změní aktuální pracovní adresář a jeho uloženou cestu
+ *
+ * @param sh ukazatel na kontext shellu
+ * @param inode_id ID inode nového pracovního adresáře
+ * @param path absolutní cesta adresáře (NULL = dopočítat pomocí directory_get_path)
+ * @return výsledek operace
+ */
+bool shell_set_cwd(struct shell *sh, int32_t inode_id, const char *path);
+
+/**
+ * Vrátí kopii absolutní cesty aktuálního pracovního adresáře
+ *
+ * @param sh ukazatel na kontext shellu
+ * @return (char * - nutno uvolnit | NULL)
+ */
+char *shell_get_cwd_path(struct shell *sh);
+
 /**
  * Zpracuje řetězec obsahující příkaz
  *
@@ -12,14 +12,60 @@
 #endif
 
 
+/**
+ * Rozmístí superblok, bitmapu, tabulku sdílení a bitmapu i-uzlů pro daný počet clusterů
+ *
+ * @param superblock_ptr ukazatel na superblock (verze a velikost clusteru jsou nastaveny)
+ * @param cluster_count počet clusterů
+ * @param inode_count počet i-uzlů
+ * @return adresa počátku i-uzlů (-1 = počty se nevejdou do 32bitových položek superbloku)
+ */
+static int64_t structure_layout_head(struct superblock *superblock_ptr, int64_t cluster_count, int64_t inode_count){
+    // Počty se do superbloku ukládají jako 32bitové - větší hodnoty se odmítnou, ne oříznou
+    if(cluster_count < 0 || cluster_count > MAX_CLUSTER_COUNT){
+        log_debug("structure_layout_head: Pocet clusteru musi byt v rozsahu 0 - %d!\n", MAX_CLUSTER_COUNT);
+        return -1;
+    }
+
+    if(inode_count < 0 || inode_count > MAX_INODE_COUNT){
+        log_debug("structure_layout_head: Pocet i-uzlu musi byt v rozsahu 0 - %d!\n", MAX_INODE_COUNT);
+        return -1;
+    }
+
+    superblock_ptr->cluster_count = (int32_t)cluster_count;
+    superblock_ptr->inode_count = (int32_t)inode_count;
+    superblock_ptr->bitmap_start_address = sizeof(struct superblock) + 1;
+    superblock_ptr->refcount_start_address = superblock_ptr->bitmap_start_address + superblock_bitmap_size(superblock_ptr) + 1;
+    superblock_ptr->inode_bitmap_start_address = superblock_ptr->refcount_start_address + superblock_refcount_size(superblock_ptr) + 1;
+    superblock_ptr->inode_start_address = superblock_ptr->inode_bitmap_start_address + superblock_inode_bitmap_size(superblock_ptr) + 1;
+
+    return superblock_ptr->inode_start_address;
+}
+
+/**
+ * Zarovná adresu nahoru na násobek velikosti clusteru
+ *
+ * @param address adresa ve VFS
+ * @param cluster_size velikost clusteru (mocnina 2)
+ * @return zarovnaná adresa
+ */
+static int64_t structure_align(int64_t address, int32_t cluster_size){
+    return (address + cluster_size - 1) & ~((int64_t)cluster_size - 1);
+}
+
 /**
  * Na základě celkové velikosti FS vypočítá zbylé parametry VFS
  *
+ * Bez zadaného počtu i-uzlů připadne na hlavičku IMPL_NON_DATA_PERCENTAGE % VFS
+ * a i-uzly vyplní její zbytek. Se zadaným počtem se hlavičce vyhradí právě
+ * potřebné místo a zbytek VFS připadne datovým blokům. Datová část vždy
+ * začíná na násobku velikosti clusteru.
  *
- * @param superblock_ptr
- * @return
+ * @param superblock_ptr ukazatel na superblock
+ * @param inode_count požadovaný počet i-uzlů (0 = podle IMPL_NON_DATA_PERCENTAGE)
+ * @return uspěch operace (0 | 1 )
  */
-bool structure_calculate(struct superblock *superblock_ptr) {
+bool structure_calculate(struct superblock *superblock_ptr, int64_t inode_count) {
 
     // Kontrola ukazatele na strukturu
     if(superblock_ptr == NULL){
@@ -33,7 +79,13 @@ bool structure_calculate(struct superblock *superblock_ptr) {
         return FALSE;
     }
 
-    log_debug("structure_calculate: Velikost celeho VFS -> %d\n", superblock_ptr->disk_size);
+    // Kontrola počtu i-uzlů
+    if(inode_count < 0 || inode_count > MAX_INODE_COUNT){
+        log_debug("structure_calculate: Pocet i-uzlu musi byt v rozsahu 1 - %d!\n", MAX_INODE_COUNT);
+        return FALSE;
+    }
+
+    log_debug("structure_calculate: Velikost celeho VFS -> %ld\n", (long)superblock_ptr->disk_size);
 
     // Pokud máme nastavenou velikost clusteru a daná hodnota je validní, použijeme ji
     int32_t vfs_cluster_size = IMPL_CLUSTER_SIZE;
@@ -48,38 +100,99 @@ bool structure_calculate(struct superblock *superblock_ptr) {
         return FALSE;
     }
 
-    // Výpočet velikosti hlavičky a datové části
-    int32_t vfs_size = superblock_ptr->disk_size;
-    int32_t vfs_head_size = (int32_t)(floor((double)(vfs_size)*((double)(IMPL_NON_DATA_PERCENTAGE)/100)));
-    int32_t vfs_data_size = vfs_size - vfs_head_size;
+    // Kontrola rozsahu velikosti clusteru
+    if(vfs_cluster_size < MIN_CLUSTER_SIZE || vfs_cluster_size > MAX_CLUSTER_SIZE){
+        log_debug("structure_calculate: Velikost clusteru musi byt v rozsahu %d - %d!\n", MIN_CLUSTER_SIZE, MAX_CLUSTER_SIZE);
+        return FALSE;
+    }
+
+    superblock_ptr->version = VFS_VERSION;
+    superblock_ptr->cluster_size = vfs_cluster_size;
 
-    // DEBUG výpisy
-    log_debug("structure_calculate: Velikost hlavicky -> %d\n", vfs_head_size);
-    log_debug("structure_calculate: Velikost datove casti -> %d\n", vfs_data_size);
+    int64_t vfs_size = superblock_ptr->disk_size;
+    int64_t inode_size = sizeof(struct inode_disk);
+    int64_t vfs_cluster_count;
 
-    // Výpočet velikosti clusterů
-    int32_t vfs_cluster_count = (int32_t)(floor((double)(vfs_data_size)/(double)(vfs_cluster_size)));
-    log_debug("structure_calculate: Pocet clusteru -> %d\n", vfs_cluster_count);
+    if(inode_count == 0){
+        // Výpočet velikosti hlavičky a datové části
+        int64_t vfs_head_size = vfs_size * IMPL_NON_DATA_PERCENTAGE / 100;
+        int64_t vfs_data_size = vfs_size - vfs_head_size;
 
-    // Výpočet adres
-    int32_t vfs_bitmap_address = sizeof(struct superblock) + 1;
-    int32_t vfs_inode_address = vfs_bitmap_address + (vfs_cluster_count * sizeof(int8_t)) + 1;
-    int32_t vfs_head_available = vfs_head_size - vfs_inode_address;
-    int32_t vfs_inode_count = (int32_t)(floor((double)(vfs_head_available/(double)(sizeof(struct inode)))));
-    int32_t vfs_data_start = vfs_inode_address + vfs_head_available + 1;
+        // DEBUG výpisy
+        log_debug("structure_calculate: Velikost hlavicky -> %ld\n", (long)vfs_head_size);
+        log_debug("structure_calculate: Velikost datove casti -> %ld\n", (long)vfs_data_size);
 
-    log_debug("structure_calculate: Adresa bitmapy -> %d\n", vfs_bitmap_address);
-    log_debug("structure_calculate: Adresa inode -> %d\n", vfs_inode_address);
-    log_debug("structure_calculate: Adresa pocatku dat ->  %d\n", vfs_data_start);
-    log_debug("structure_calculate: Volne misto pro inode -> %d (byte)\n", vfs_head_available);
-    log_debug("structure_calculate: Pocet inode -> %d\n", vfs_inode_count);
+        // I-uzly vyplní zbytek hlavičky za bitmapou a tabulkou sdílení
+        vfs_cluster_count = vfs_data_size / vfs_cluster_size;
+        if(vfs_cluster_count > MAX_CLUSTER_COUNT){
+            log_debug("structure_calculate: Prilis mnoho clusteru, zvolte vetsi cluster!\n");
+            return FALSE;
+        }
+
+        int64_t vfs_head_address = structure_layout_head(superblock_ptr, vfs_cluster_count, 0);
+        if(vfs_head_address < 0){
+            return FALSE;
+        }
+
+        // Každý i-uzel navíc potřebuje bit bitmapy i-uzlů (a nejvýše jedno slovo zarovnání)
+        int64_t vfs_inode_space = vfs_head_size - vfs_head_address - (int64_t)sizeof(uint64_t);
+        inode_count = vfs_inode_space > 0 ? vfs_inode_space * 8 / (8 * inode_size + 1) : 0;
+        if(inode_count > MAX_INODE_COUNT){
+            inode_count = MAX_INODE_COUNT;
+        }
+    } else {
+        // Každý cluster navíc potřebuje bit bitmapy a položku tabulky sdílení
+        int64_t vfs_inode_bitmap_size = ((inode_count + 63) / 64) * (int64_t)sizeof(uint64_t);
+        int64_t vfs_available = vfs_size - (int64_t)sizeof(struct superblock) - vfs_inode_bitmap_size - inode_count * inode_size - vfs_cluster_size - 4;
+        vfs_cluster_count = vfs_available > 0 ? vfs_available * 8 / (8 * (vfs_cluster_size + (int64_t)sizeof(uint16_t)) + 1) : 0;
+
+        if(vfs_cluster_count > MAX_CLUSTER_COUNT){
+            log_debug("structure_calculate: Prilis mnoho clusteru, zvolte vetsi cluster!\n");
+            return FALSE;
+        }
+    }
+
+    // Hlavička se nevejde do VFS
+    if(inode_count < 2){
+        log_debug("structure_calculate: VFS je prilis maly pro ulozeni i-uzlu!\n");
+        return FALSE;
+    }
+
+    // Datová část začíná za i-uzly na hranici clusteru a musí se vejít do VFS
+    int64_t vfs_data_start = 0;
+    while(vfs_cluster_count > 0){
+        int64_t vfs_inode_address = structure_layout_head(superblock_ptr, vfs_cluster_count, inode_count);
+        if(vfs_inode_address < 0){
+            return FALSE;
+        }
+
+        vfs_data_start = structure_align(vfs_inode_address + inode_count * inode_size, vfs_cluster_size);
+        int64_t vfs_overflow = vfs_data_start + vfs_cluster_count * vfs_cluster_size - vfs_size;
+
+        if(vfs_overflow <= 0){
+            break;
+        }
+
+        vfs_cluster_count -= (vfs_overflow + vfs_cluster_size - 1) / vfs_cluster_size;
+    }
+
+    if(vfs_cluster_count < 1){
+        log_debug("structure_calculate: VFS je prilis maly pro ulozeni databloku!\n");
+        return FALSE;
+    }
 
-    // Zápis vypočtených hodnot do struktury
-    superblock_ptr->cluster_size = vfs_cluster_size;
-    superblock_ptr->cluster_count = vfs_cluster_count;
-    superblock_ptr->bitmap_start_address = vfs_bitmap_address;
-    superblock_ptr->inode_start_address = vfs_inode_address;
     superblock_ptr->data_start_address = vfs_data_start;
+    superblock_ptr->free_inode_count = superblock_ptr->inode_count;
+    // Poslední cluster se nepřiděluje (viz bitmap_find_free_cluster_index)
+    superblock_ptr->free_cluster_count = superblock_ptr->cluster_count - 1;
+
+    log_debug("structure_calculate: Pocet clusteru -> %d\n", superblock_ptr->cluster_count);
+    log_debug("structure_calculate: Adresa bitmapy -> %ld\n", (long)superblock_ptr->bitmap_start_address);
+    log_debug("structure_calculate: Adresa tabulky sdileni -> %ld\n", (long)superblock_ptr->refcount_start_address);
+    log_debug("structure_calculate: Adresa bitmapy inode -> %ld\n", (long)superblock_ptr->inode_bitmap_start_address);
+    log_debug("structure_calculate: Adresa inode -> %ld\n", (long)superblock_ptr->inode_start_address);
+    log_debug("structure_calculate: Adresa pocatku dat ->  %ld\n", (long)superblock_ptr->data_start_address);
+    log_debug("structure_calculate: Pocet inode -> %d\n", superblock_ptr->inode_count);
 
     return TRUE;
 }
@@ -90,11 +203,13 @@ bool structure_calculate(struct superblock *superblock_ptr) {
  * @param vfs_file ukazatel na otevřený soubor
  * @param size cílová velikost systému
  */
-void file_set_size(FILE *vfs_file, int32_t size){
+void file_set_size(FILE *vfs_file, int64_t size){
     #ifdef _WIN32
         int fileno = _fileno(vfs_file);
         HANDLE handle = (HANDLE) _get_osfhandle(fileno);
-        SetFilePointer(handle, size - sizeof(struct superblock), 0, FILE_END);
+        LARGE_INTEGER distance;
+        distance.QuadPart = size - sizeof(struct superblock);
+        SetFilePointerEx(handle, distance, NULL, FILE_END);
         SetEndOfFile(handle);
         CloseHandle(handle);
     #else
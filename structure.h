@@ -18,6 +18,10 @@
  */
 #define IMPL_NON_DATA_PERCENTAGE 4
 #define IMPL_CLUSTER_SIZE 4096
+#define MIN_CLUSTER_SIZE 512        // Nejmenší povolená velikost clusteru
+#define MAX_CLUSTER_SIZE 65536      // Největší povolená velikost clusteru
+#define MAX_INODE_COUNT INT32_MAX   // Nejvyšší počet i-uzlů - ID i-uzlu je 32bitové
+#define MAX_CLUSTER_COUNT (INT32_MAX - 64) // Nejvyšší počet clusterů - bitmapa se zarovnává na 64 bitů
 
 #define VFS_FILE_TYPE 0
 #define VFS_DIRECTORY 1
@@ -35,17 +39,19 @@
  * @param vfs_file ukazatel na otevřený soubor
  * @param size cílová velikost systému
  */
-void file_set_size(FILE *vfs_file, int32_t size);
+void file_set_size(FILE *vfs_file, int64_t size);
 
 
 /**
  * Na základě celkové velikosti FS vypočítá zbylé parametry VFS
  *
+ * Datová část začíná na násobku velikosti clusteru
  *
  * @param superblock_ptr ukazatel na superblock
+ * @param inode_count požadovaný počet i-uzlů (0 = podle IMPL_NON_DATA_PERCENTAGE)
  * @return uspěch operace (0 | 1 )
  */
-bool structure_calculate(struct superblock *superblock_ptr);
+bool structure_calculate(struct superblock *superblock_ptr, int64_t inode_count);
 
 /**
  * Vytvoří soubor s daným názvem, který bude fyzickou reprezentací VFS
@@ -1,6 +1,7 @@
 #include "superblock.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include "parsing.h"
 
 /*
@@ -17,7 +18,7 @@ const char IMPL_VOLUME_DESCRIPTOR[251] = "Semestralni prace KIV/ZOS v akademicke
  * @param disk_size celková velikost VFS
  * @return ukazatel na superblock
  */
-struct superblock* superblock_impl_alloc(int32_t disk_size){
+struct superblock* superblock_impl_alloc(int64_t disk_size){
     struct superblock *ptr = NULL;
     ptr = malloc(sizeof(struct superblock));
 
@@ -28,6 +29,12 @@ struct superblock* superblock_impl_alloc(int32_t disk_size){
 
     ptr->disk_size = disk_size;
     ptr->cluster_size = -1;
+    ptr->version = VFS_VERSION;
+    ptr->refcount_start_address = 0;
+    ptr->inode_bitmap_start_address = 0;
+    ptr->inode_count = 0;
+    ptr->free_inode_count = 0;
+    ptr->free_cluster_count = 0;
     superblock_set_signature(ptr, (char*)IMPL_SIGNATURE);
     superblock_set_volume_descriptor(ptr, (char*)IMPL_VOLUME_DESCRIPTOR);
 
@@ -42,7 +49,7 @@ struct superblock* superblock_impl_alloc(int32_t disk_size){
  * @param volume_descriptor volume_descriptor superbloku
  * @return ukazatel na superblock
  */
-struct superblock* superblock_alloc(int32_t disk_size, int32_t cluster_size, char signature[9], char volume_descriptor[251]) {
+struct superblock* superblock_alloc(int64_t disk_size, int32_t cluster_size, char signature[9], char volume_descriptor[251]) {
     struct superblock *ptr = malloc(sizeof(struct superblock));
 
     if(ptr == NULL){
@@ -52,6 +59,12 @@ struct superblock* superblock_alloc(int32_t disk_size, int32_t cluster_size, cha
 
     ptr->disk_size = disk_size;
     ptr->cluster_size = cluster_size;
+    ptr->version = VFS_VERSION;
+    ptr->refcount_start_address = 0;
+    ptr->inode_bitmap_start_address = 0;
+    ptr->inode_count = 0;
+    ptr->free_inode_count = 0;
+    ptr->free_cluster_count = 0;
     superblock_set_signature(ptr,signature);
     superblock_set_volume_descriptor(ptr, volume_descriptor);
 
@@ -140,14 +153,54 @@ bool superblock_check(struct superblock *ptr){
         return FALSE;
     }
 
-    // Kontrola adresy bitmapy
-    if(ptr->bitmap_start_address < sizeof(struct superblock)){
+    // Kontrola adresy bitmapy - bitmapa leží za superblokem (u verze 1 za kratším superblokem)
+    if(ptr->bitmap_start_address < (int64_t)offsetof(struct superblock_legacy, version)){
         log_debug("superblock_check: Superblock neni validni -> data_start_address\n");
         return FALSE;
     }
 
+    // Kontrola verze formátu
+    if(superblock_version(ptr) > VFS_VERSION){
+        log_debug("superblock_check: Superblock neni validni -> nepodporovana verze %d\n", ptr->version);
+        return FALSE;
+    }
+
+    // Kontrola adresy tabulky sdílení clusterů
+    int64_t header_end = ptr->bitmap_start_address + superblock_bitmap_size(ptr);
+    if(superblock_version(ptr) >= VFS_VERSION_REFCOUNT){
+        if(ptr->refcount_start_address < header_end){
+            log_debug("superblock_check: Superblock neni validni -> refcount_start_address\n");
+            return FALSE;
+        }
+
+        header_end = ptr->refcount_start_address + superblock_refcount_size(ptr);
+    }
+
+    // Kontrola bitmapy i-uzlů a počtu volných i-uzlů
+    if(superblock_version(ptr) >= VFS_VERSION_INODE_BITMAP){
+        if(ptr->inode_bitmap_start_address < header_end || ptr->inode_count < 1){
+            log_debug("superblock_check: Superblock neni validni -> inode_bitmap_start_address\n");
+            return FALSE;
+        }
+
+        if(ptr->free_inode_count < 0 || ptr->free_inode_count > ptr->inode_count){
+            log_debug("superblock_check: Superblock neni validni -> free_inode_count\n");
+            return FALSE;
+        }
+
+        header_end = ptr->inode_bitmap_start_address + superblock_inode_bitmap_size(ptr);
+    }
+
+    // Kontrola počtu volných clusterů
+    if(superblock_version(ptr) >= VFS_VERSION_FREE_COUNT){
+        if(ptr->free_cluster_count < 0 || ptr->free_cluster_count > ptr->cluster_count){
+            log_debug("superblock_check: Superblock neni validni -> free_cluster_count\n");
+            return FALSE;
+        }
+    }
+
     // Kontrola adresy i-uzlů
-    if(ptr->inode_start_address < (ptr->bitmap_start_address + (ptr->cluster_count * sizeof(int8_t)))){
+    if(ptr->inode_start_address < header_end){
         log_debug("superblock_check: Superblock neni validni -> inode_start_address\n");
         return FALSE;
     }
@@ -162,6 +215,124 @@ bool superblock_check(struct superblock *ptr){
     return TRUE;
 }
 
+/**
+ * Převede superblok přečtený z VFS libovolné verze do struktury superblock
+ *
+ * VFS od verze 4 mají na místě disk_size číslo verze - starší VFS tam mají
+ * velikost disku, která je vždy větší než samotný superblok
+ *
+ * @param ptr cílová struktura
+ * @param raw prvních sizeof(struct superblock) byte VFS
+ * @return výsledek operace
+ */
+bool superblock_decode(struct superblock *ptr, const void *raw){
+    if(ptr == NULL || raw == NULL){
+        log_debug("superblock_decode: Ukazatel na strukturu nemuze byt NULL!\n");
+        return FALSE;
+    }
+
+    int32_t marker = 0;
+    memcpy(&marker, (const char *)raw + offsetof(struct superblock, version), sizeof(int32_t));
+
+    // Nový formát - superblok je uložen přímo
+    if(marker >= VFS_VERSION_64BIT && marker < (int32_t)offsetof(struct superblock_legacy, version)){
+        memcpy(ptr, raw, sizeof(struct superblock));
+
+        // Verze 4 - 6 mají superblok kratší - za ním už leží bitmapa datových bloků
+        size_t known = sizeof(struct superblock);
+        if(marker < VFS_VERSION_INODE_BITMAP){
+            known = offsetof(struct superblock, inode_bitmap_start_address);
+        } else if(marker < VFS_VERSION_FREE_COUNT){
+            known = offsetof(struct superblock, free_cluster_count);
+        }
+        memset((char *)ptr + known, 0, sizeof(struct superblock) - known);
+
+        return TRUE;
+    }
+
+    // Starý formát - převod 32bitových položek
+    struct superblock_legacy legacy;
+    memcpy(&legacy, raw, sizeof(struct superblock_legacy));
+
+    memset(ptr, 0, sizeof(struct superblock));
+    memcpy(ptr->signature, legacy.signature, sizeof(ptr->signature));
+    memcpy(ptr->volume_descriptor, legacy.volume_descriptor, sizeof(ptr->volume_descriptor));
+    ptr->disk_size = legacy.disk_size;
+    ptr->cluster_size = legacy.cluster_size;
+    ptr->cluster_count = legacy.cluster_count;
+    ptr->bitmap_start_address = legacy.bitmap_start_address;
+    ptr->inode_start_address = legacy.inode_start_address;
+    ptr->data_start_address = legacy.data_start_address;
+
+    // Verze 1 položku version nemá - bitmapa u ní začíná hned za kratším superblokem
+    if(legacy.bitmap_start_address < (int32_t)(offsetof(struct superblock_legacy, version) + sizeof(int32_t))){
+        ptr->version = VFS_VERSION_LEGACY;
+    } else {
+        ptr->version = legacy.version;
+    }
+
+    if(ptr->version >= VFS_VERSION_REFCOUNT){
+        ptr->refcount_start_address = legacy.refcount_start_address;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Zjistí verzi formátu VFS popsaného superblokem
+ *
+ * @param ptr ukazatel na strukturu superblock
+ * @return verze formátu (VFS_VERSION_*)
+ */
+int32_t superblock_version(struct superblock *ptr){
+    return ptr->version;
+}
+
+/**
+ * Vypočte velikost bitmapy datových bloků v bytech dle verze formátu
+ *
+ * @param ptr ukazatel na strukturu superblock
+ * @return velikost bitmapy v bytech
+ */
+int64_t superblock_bitmap_size(struct superblock *ptr){
+    if(superblock_version(ptr) == VFS_VERSION_LEGACY){
+        return ptr->cluster_count * sizeof(int8_t);
+    }
+
+    // Celá 64bitová slova, aby šla bitmapa číst přímo do pole uint64_t
+    return (((int64_t)ptr->cluster_count + 63) / 64) * sizeof(uint64_t);
+}
+
+/**
+ * Vypočte velikost tabulky sdílení clusterů v bytech dle verze formátu
+ *
+ * @param ptr ukazatel na strukturu superblock
+ * @return velikost tabulky v bytech (0 - formát tabulku nemá)
+ */
+int64_t superblock_refcount_size(struct superblock *ptr){
+    if(superblock_version(ptr) < VFS_VERSION_REFCOUNT){
+        return 0;
+    }
+
+    // Jeden uint16_t na cluster
+    return (int64_t)ptr->cluster_count * sizeof(uint16_t);
+}
+
+/**
+ * Vypočte velikost bitmapy i-uzlů v bytech dle verze formátu
+ *
+ * @param ptr ukazatel na strukturu superblock
+ * @return velikost bitmapy v bytech (0 - formát bitmapu i-uzlů nemá)
+ */
+int64_t superblock_inode_bitmap_size(struct superblock *ptr){
+    if(superblock_version(ptr) < VFS_VERSION_INODE_BITMAP){
+        return 0;
+    }
+
+    // Celá 64bitová slova stejně jako u bitmapy datových bloků
+    return (((int64_t)ptr->inode_count + 63) / 64) * sizeof(uint64_t);
+}
+
 /**
  * Vypíše obsah struktury superblock
  *
@@ -176,12 +347,24 @@ void superblock_print(struct superblock *ptr) {
     log_info("*** SUPERBLOCK\n");
     log_info("Signature: %s\n", ptr->signature);
     log_info("Volume descriptor: %s\n", ptr->volume_descriptor);
-    log_info("Disk size: %d\n", ptr->disk_size);
+    log_info("Disk size: %ld\n", (long)ptr->disk_size);
     log_info("Cluster size: %d\n", ptr->cluster_size);
     log_info("Cluster count: %d\n", ptr->cluster_count);
-    log_info("Bitmap start address: %d\n", ptr->bitmap_start_address);
-    log_info("Inode start address: %d\n", ptr->inode_start_address);
-    log_info("Data start address: %d\n", ptr->data_start_address);
+    log_info("Bitmap start address: %ld\n", (long)ptr->bitmap_start_address);
+    log_info("Inode start address: %ld\n", (long)ptr->inode_start_address);
+    log_info("Data start address: %ld\n", (long)ptr->data_start_address);
+    log_info("Version: %d\n", superblock_version(ptr));
+    if(superblock_version(ptr) >= VFS_VERSION_REFCOUNT){
+        log_info("Refcount start address: %ld\n", (long)ptr->refcount_start_address);
+    }
+    if(superblock_version(ptr) >= VFS_VERSION_INODE_BITMAP){
+        log_info("Inode bitmap start address: %ld\n", (long)ptr->inode_bitmap_start_address);
+        log_info("Inode count: %d\n", ptr->inode_count);
+        log_info("Free inode count: %d\n", ptr->free_inode_count);
+    }
+    if(superblock_version(ptr) >= VFS_VERSION_FREE_COUNT){
+        log_info("Free cluster count: %d\n", ptr->free_cluster_count);
+    }
     log_info("*** SUPERBLOCK END\n");
 }
 
@@ -205,14 +388,17 @@ struct superblock* superblock_from_file(char *filename){
         return NULL;
     }
 
-    struct superblock *ptr = malloc(sizeof(struct superblock));
-    memset(ptr, 0, sizeof(struct superblock));
+    char raw[sizeof(struct superblock)];
+    memset(raw, 0, sizeof(raw));
     fseek(file, 0, SEEK_SET);
-    fread(ptr, sizeof(struct superblock), 1, file);
+    fread(raw, sizeof(raw), 1, file);
 
     // Uzavření souboru
     fclose(file);
 
+    struct superblock *ptr = malloc(sizeof(struct superblock));
+    superblock_decode(ptr, raw);
+
     return ptr;
 }
 
@@ -5,6 +5,7 @@
  * Vyhrazené místo na:
  *      * superblock
  *      * bitmapu datových bloků
+ *      * bitmapu i-uzlů
  *      * i-uzly
  * je 4% z celkové velikosti VFS
  */
@@ -19,12 +20,38 @@
 /*
  * Konstanty
  */
-// None
+#define VFS_VERSION_LEGACY 1            // Bitmapa datových bloků: 1 byte na cluster
+#define VFS_VERSION_PACKED_BITMAP 2     // Bitmapa datových bloků: 1 bit na cluster, zarovnáno na uint64_t
+#define VFS_VERSION_REFCOUNT 3          // Za bitmapou tabulka sdílení clusterů (cp --reflink)
+#define VFS_VERSION_64BIT 4             // 64bitové velikosti a adresy, i-uzly odkazují na čísla clusterů
+#define VFS_VERSION_EXTENTS 5           // Soubory mohou databloky popisovat extenty (INODE_FLAG_EXTENTS)
+#define VFS_VERSION_INODE_BITMAP 6      // Bitmapa obsazených i-uzlů a počet volných i-uzlů v superbloku
+#define VFS_VERSION_FREE_COUNT 7        // Počet volných clusterů v superbloku
+#define VFS_VERSION VFS_VERSION_FREE_COUNT
 
 /*
  * Struktury
  */
+// Superblok v paměti - od verze 4 je ve stejné podobě uložen i ve VFS
 struct superblock {
+    char signature[9];                  // Login autora FS
+    char volume_descriptor[251];        // Popis vygenerovaného FS
+    int32_t version;                    // Verze formátu VFS (VFS_VERSION_*); ve VFS na místě dřívějšího disk_size
+    int32_t cluster_size;               // Velikost clusterů
+    int32_t cluster_count;              // Počet clusterů
+    int64_t disk_size;                  // Celková velikost FS
+    int64_t bitmap_start_address;       // Adresa počátku bitmapy datových bloků
+    int64_t refcount_start_address;     // Adresa počátku tabulky sdílení clusterů (od verze 3)
+    int64_t inode_start_address;        // Adresa počátku i-uzlů
+    int64_t data_start_address;         // Adresa počátku datových bloků
+    int64_t inode_bitmap_start_address; // Adresa počátku bitmapy i-uzlů (od verze 6)
+    int32_t inode_count;                // Počet i-uzlů popsaných bitmapou i-uzlů (od verze 6)
+    int32_t free_inode_count;           // Počet volných i-uzlů (ve VFS od verze 6, u starších dopočten z tabulky i-uzlů)
+    int32_t free_cluster_count;         // Počet volných přidělitelných clusterů (ve VFS od verze 7, u starších dopočten z bitmapy)
+};
+
+// Superblok VFS verzí 1 - 3 (32bitové velikosti a adresy), pouze pro načtení
+struct superblock_legacy {
     char signature[9];                  // Login autora FS
     char volume_descriptor[251];        // Popis vygenerovaného FS
     int32_t disk_size;                  // Celková velikost FS
@@ -33,6 +60,8 @@ struct superblock {
     int32_t bitmap_start_address;       // Adresa počátku bitmapy datových bloků
     int32_t inode_start_address;        // Adresa počátku i-uzlů
     int32_t data_start_address;         // Adresa počátku datových bloků
+    int32_t version;                    // Verze formátu VFS; u verze 1 chybí
+    int32_t refcount_start_address;     // Adresa počátku tabulky sdílení clusterů (od verze 3)
 };
 
 /**
@@ -43,7 +72,7 @@ struct superblock {
  * @param disk_size celková velikost VFS
  * @return ukazatel na superblock
  */
-struct superblock* superblock_impl_alloc(int32_t disk_size);
+struct superblock* superblock_impl_alloc(int64_t disk_size);
 
 /**
  * Kompletně alokuje a vyplní strukturu superblock
@@ -53,7 +82,7 @@ struct superblock* superblock_impl_alloc(int32_t disk_size);
  * @param volume_descriptor volume_descriptor superbloku
  * @return ukazatel na superblock
  */
-struct superblock* superblock_alloc(int32_t disk_size, int32_t cluster_size, char signature[9], char volume_descriptor[251]);
+struct superblock* superblock_alloc(int64_t disk_size, int32_t cluster_size, char signature[9], char volume_descriptor[251]);
 
 /**
  * Nastaví signature struktury superblock na novou hodnotu
@@ -81,6 +110,50 @@ bool superblock_set_volume_descriptor(struct superblock *ptr, char *volume_descr
  */
 bool superblock_check(struct superblock *ptr);
 
+/**
+ * Převede superblok přečtený z VFS libovolné verze do struktury superblock
+ *
+ * VFS od verze 4 mají na místě disk_size číslo verze - starší VFS tam mají
+ * velikost disku, která je vždy větší než samotný superblok
+ *
+ * @param ptr cílová struktura
+ * @param raw prvních sizeof(struct superblock) byte VFS
+ * @return výsledek operace
+ */
+bool superblock_decode(struct superblock *ptr, const void *raw);
+
+/**
+ * Zjistí verzi formátu VFS popsaného superblokem
+ *
+ * @param ptr ukazatel na strukturu superblock
+ * @return verze formátu (VFS_VERSION_*)
+ */
+int32_t superblock_version(struct superblock *ptr);
+
+/**
+ * Vypočte velikost bitmapy datových bloků v bytech dle verze formátu
+ *
+ * @param ptr ukazatel na strukturu superblock
+ * @return velikost bitmapy v bytech
+ */
+int64_t superblock_bitmap_size(struct superblock *ptr);
+
+/**
+ * Vypočte velikost tabulky sdílení clusterů v bytech dle verze formátu
+ *
+ * @param ptr ukazatel na strukturu superblock
+ * @return velikost tabulky v bytech (0 - formát tabulku nemá)
+ */
+int64_t superblock_refcount_size(struct superblock *ptr);
+
+/**
+ * Vypočte velikost bitmapy i-uzlů v bytech dle verze formátu
+ *
+ * @param ptr ukazatel na strukturu superblock
+ * @return velikost bitmapy v bytech (0 - formát bitmapu i-uzlů nemá)
+ */
+int64_t superblock_inode_bitmap_size(struct superblock *ptr);
+
 /**
  * Vypíše obsah struktury superblock
  *
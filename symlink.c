@@ -8,13 +8,13 @@
  * Vytvoří soubor, a uloží do něj cestu na jiný soubor
  * tím vytvoří symlink
  *
- * @param vfs_filename
+ * @param mount připojený VFS
  * @param path
  * @param linked
  * @return
  */
-int32_t symlink_create(char *vfs_filename, char *path, char *linked){
-    int32_t result = file_create(vfs_filename, path);
+int32_t symlink_create(struct vfs_mount *mount, char *path, char *linked){
+    int32_t result = file_create(mount, path);
 
     // Nepovedlo se
     if(result < 1){
@@ -22,7 +22,7 @@ int32_t symlink_create(char *vfs_filename, char *path, char *linked){
     }
 
     // Otevřít soubor
-    VFS_FILE *target = vfs_open(vfs_filename, path);
+    VFS_FILE *target = vfs_open(mount, path);
 
     if(target == NULL){
         printf("PATH NOT FOUND (nepodarilo se vytvorit symlink)\n");
@@ -31,7 +31,7 @@ int32_t symlink_create(char *vfs_filename, char *path, char *linked){
 
     // Změna soubor -> symlink
     target->inode_ptr->type = VFS_SYMLINK;
-    inode_write_to_index(vfs_filename, target->inode_ptr->id - 1, target->inode_ptr);
+    inode_write_to_index(mount, target->inode_ptr->id - 1, target->inode_ptr);
 
     int32_t  written = vfs_write(linked, strlen(linked), 1, target);
 
@@ -52,16 +52,12 @@ int32_t symlink_create(char *vfs_filename, char *path, char *linked){
  *
  * Pokud soubor neni symlink, vrati ukazatel na puvodni soubor
  *
- * @param vfs_filename
+ * @param mount připojený VFS
  * @param symlink
  * @return
  */
-VFS_FILE *symlink_dereference(char *vfs_filename, VFS_FILE *symlink){
-    if(vfs_filename == NULL){
-        return symlink;
-    }
-
-    if(strlen(vfs_filename) < 1){
+VFS_FILE *symlink_dereference(struct vfs_mount *mount, VFS_FILE *symlink){
+    if(mount == NULL){
         return symlink;
     }
 
@@ -83,7 +79,7 @@ VFS_FILE *symlink_dereference(char *vfs_filename, VFS_FILE *symlink){
     vfs_read(path, sizeof(char) * symlink->inode_ptr->file_size, 1, symlink);
 
     // Pokus o otevření cesty ze symlinku
-    VFS_FILE *dereferenced = vfs_open(vfs_filename, path);
+    VFS_FILE *dereferenced = vfs_open(mount, path);
 
     // Pokud se nám nepodařilo otevřít symlinked file vrátíme původní VFS_FILE
     if(dereferenced == NULL){
@@ -4,26 +4,31 @@
 #include <stdint.h>
 #include "vfs_io.h"
 
+/*
+ * Konstanty
+ */
+#define SYMLINK_MAX_DEPTH 8             // Nejvyšší počet dereferencí za sebou (ochrana proti cyklu symlinků)
+
 /**
  * Vytvoří soubor, a uloží do něj cestu na jiný soubor
  * tím vytvoří symlink
  *
- * @param vfs_filename
+ * @param mount připojený VFS
  * @param path
  * @param linked
  * @return
  */
-int32_t symlink_create(char *vfs_filename, char *path, char *linked);
+int32_t symlink_create(struct vfs_mount *mount, char *path, char *linked);
 
 
 /**
  * Otevře soubor, pokud je soubor SYMLINK vrátí cestu na
  * soubor na který ukazuje
  *
- * @param vfs_filename
+ * @param mount připojený VFS
  * @param symlink
  * @return
  */
-VFS_FILE *symlink_dereference(char *vfs_filename, VFS_FILE *symlink);
+VFS_FILE *symlink_dereference(struct vfs_mount *mount, VFS_FILE *symlink);
 
 #endif //KIV_ZOS_SYMLINK_H
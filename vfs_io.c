@@ -1,11 +1,13 @@
 #include "vfs_io.h"
 #include <string.h>
 #include <stdlib.h>
-#include <math.h>
 #include "parsing.h"
 #include "superblock.h"
 #include "bitmap.h"
 #include "directory.h"
+#include "allocation.h"
+#include "refcount.h"
+#include "structure.h"
 
 
 /**
@@ -22,6 +24,9 @@ int32_t vfs_seek(VFS_FILE *vfs_file, int64_t offset, int type) {
         return -1;
     }
 
+    // Odložená data musí být součástí souboru (SEEK_END, kontrola velikosti)
+    vfs_flush(vfs_file);
+
     // Použití dočasné proměnné -> při chybě neměnit vfs_filename->offset
     int64_t temp_offset = vfs_file->offset;
 
@@ -45,10 +50,7 @@ int32_t vfs_seek(VFS_FILE *vfs_file, int64_t offset, int type) {
         return -2;
     }
 
-    // Kontrola hodnoty - nelze ukazovat za konec souboru
-    if (temp_offset > vfs_file->inode_ptr->file_size) {
-        return -3;
-    }
+    // Offset za koncem souboru je povolen - zápis na něj vytvoří díru
 
     // Vše v pořádku, provedeme zápis do VFS_FILE_TYPE
     vfs_file->offset = temp_offset;
@@ -57,6 +59,418 @@ int32_t vfs_seek(VFS_FILE *vfs_file, int64_t offset, int type) {
     return 0;
 }
 
+/**
+ * Vrátí adresu databloku souboru na daném indexu
+ *
+ * Adresy se čtou z mapy databloků uložené ve VFS_FILE, mapa se načte
+ * při prvním použití a po alokaci nových databloků se pouze doplní
+ *
+ * @param vfs_file ukazatel na soubor
+ * @param index index databloku v souboru
+ * @return (return < 0: chyba | 0: díra | return > 0: adresa databloku ve VFS)
+ */
+int64_t vfs_get_datablock_address(VFS_FILE *vfs_file, int32_t index) {
+    // Kontrola ukazatele na strukturu VFS_FILE_TYPE
+    if (vfs_file == NULL || vfs_file->inode_ptr == NULL) {
+        return -1;
+    }
+
+    int32_t allocated = vfs_file->inode_ptr->allocated_clusters;
+
+    if (index < 0) {
+        return -5;
+    }
+
+    // Index za koncem mapy databloků je díra
+    if (index >= allocated) {
+        return 0;
+    }
+
+    // Soubor se od načtení mapy zmenšil - mapa neplatí
+    if (vfs_file->block_map_count > allocated) {
+        vfs_block_map_invalidate(vfs_file);
+    }
+
+    // Doplnění mapy o nově alokované databloky
+    if (vfs_file->block_map_count < allocated) {
+        int64_t *block_map = realloc(vfs_file->block_map, sizeof(int64_t) * allocated);
+
+        if (block_map == NULL) {
+            return inode_get_datablock_index_value(vfs_file->mount, vfs_file->inode_ptr, index);
+        }
+
+        vfs_file->block_map = block_map;
+        inode_load_block_map(vfs_file->mount, vfs_file->inode_ptr, vfs_file->block_map,
+                             vfs_file->block_map_count, allocated);
+        vfs_file->block_map_count = allocated;
+    }
+
+    return vfs_file->block_map[index];
+}
+
+/**
+ * Zneplatní mapu databloků souboru (např. po dealokaci)
+ *
+ * @param vfs_file ukazatel na soubor
+ */
+void vfs_block_map_invalidate(VFS_FILE *vfs_file) {
+    if (vfs_file == NULL) {
+        return;
+    }
+
+    if (vfs_file->block_map != NULL) {
+        free(vfs_file->block_map);
+    }
+
+    vfs_file->block_map = NULL;
+    vfs_file->block_map_count = 0;
+}
+
+/**
+ * Najde úsek souboru od pozice position, který je ve VFS uložen na fyzicky
+ * souvislých datablocích, aby jej šlo přečíst/zapsat jedním voláním
+ *
+ * Souvislé díry tvoří jeden úsek s adresou 0
+ *
+ * @param vfs_file ukazatel na soubor
+ * @param position pozice v souboru (byte)
+ * @param remaining maximální délka úseku (byte)
+ * @param address výstup - adresa počátku úseku ve VFS (0 = díra)
+ * @return (return < 0: chyba | return > 0: délka úseku v byte)
+ */
+static int32_t vfs_contiguous_run(VFS_FILE *vfs_file, int64_t position, int32_t remaining, int64_t *address) {
+    int32_t cluster_size = vfs_file->mount->superblock_ptr->cluster_size;
+    int32_t datablock_index = (int32_t)(position >> vfs_file->mount->cluster_shift);
+    int32_t datablock_offset = (int32_t)(position & (cluster_size - 1));
+    int64_t datablock_address = vfs_get_datablock_address(vfs_file, datablock_index);
+
+    if (datablock_address < 0) {
+        return -1;
+    }
+
+    // Za koncem mapy databloků je už jen díra
+    if (datablock_index >= vfs_file->inode_ptr->allocated_clusters) {
+        *address = 0;
+        return remaining;
+    }
+
+    *address = datablock_address == 0 ? 0 : datablock_address + datablock_offset;
+    int64_t run = cluster_size - datablock_offset;
+
+    // Připojování dalších databloků, dokud na sebe fyzicky navazují (nebo dokud trvá díra)
+    while (run < remaining) {
+        int64_t next_address = vfs_get_datablock_address(vfs_file, datablock_index + 1);
+        int64_t expected = datablock_address == 0 ? 0 : datablock_address + cluster_size;
+
+        if (next_address != expected) {
+            break;
+        }
+
+        datablock_index++;
+        datablock_address = next_address;
+        run += cluster_size;
+    }
+
+    if (run > remaining) {
+        run = remaining;
+    }
+
+    return (int32_t)run;
+}
+
+/**
+ * Rozhodne, zda nový datablok musí být před zápisem vynulován - zápis
+ * jej nepřepíše celý a nepřepsaná část bude součástí souboru
+ *
+ * @param cluster_start pozice databloku v souboru (byte)
+ * @param cluster_size velikost clusteru
+ * @param position pozice počátku zápisu
+ * @param end pozice konce zápisu
+ * @param file_size velikost souboru před zápisem
+ * @return TRUE, pokud se datablok musí vynulovat
+ */
+static bool vfs_needs_clear(int64_t cluster_start, int32_t cluster_size, int64_t position, int64_t end, int64_t file_size) {
+    // Začátek databloku před zápisem
+    if (cluster_start < position) {
+        return TRUE;
+    }
+
+    // Konec databloku za zápisem, ale stále uvnitř souboru
+    return (cluster_start + cluster_size > end && end < file_size) ? TRUE : FALSE;
+}
+
+/**
+ * Před zápisem do úseku souboru nahradí sdílené databloky (cp --reflink) vlastními kopiemi
+ *
+ * Datablok, který zápis celý přepíše, se nekopíruje - pouze se vymění za nový
+ *
+ * @param vfs_file ukazatel na soubor
+ * @param position pozice počátku zápisu v souboru (byte)
+ * @param size délka zápisu (byte)
+ * @return (return < 0: chyba | return >= 0: počet nahrazených databloků)
+ */
+static int32_t vfs_unshare_range(VFS_FILE *vfs_file, int64_t position, int64_t size) {
+    struct vfs_mount *mount = vfs_file->mount;
+
+    // Formát bez tabulky sdílení nemá sdílené databloky
+    if (mount->refcounts == NULL || size < 1) {
+        return 0;
+    }
+
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int32_t first = (int32_t)(position >> mount->cluster_shift);
+    int32_t last = (int32_t)((position + size - 1) >> mount->cluster_shift);
+    char *buffer = NULL;
+    int32_t replaced = 0;
+
+    if (last >= vfs_file->inode_ptr->allocated_clusters) {
+        last = vfs_file->inode_ptr->allocated_clusters - 1;
+    }
+
+    int32_t index;
+    for (index = first; index <= last; index++) {
+        int64_t address = vfs_get_datablock_address(vfs_file, index);
+        int32_t cluster = inode_data_index_from_address(mount, address);
+
+        if (cluster < 0 || refcount_get(mount, cluster) < 1) {
+            continue;
+        }
+
+        int32_t copy_index = bitmap_find_free_cluster_index(mount);
+
+        if (copy_index < 0) {
+            log_debug("vfs_unshare_range: Nedostatek volnych clusteru pro kopii databloku!\n");
+            free(buffer);
+            return -1;
+        }
+
+        int64_t copy_address = bitmap_index_to_cluster_address(mount, copy_index);
+        bitmap_set(mount, copy_index, 1, TRUE);
+
+        // Původní obsah je potřeba, pouze pokud jej zápis nepřepíše celý
+        int64_t cluster_start = (int64_t)index * cluster_size;
+        if (position > cluster_start || position + size < cluster_start + cluster_size) {
+            if (buffer == NULL) {
+                buffer = malloc(cluster_size);
+            }
+
+            mount_read(mount, address, buffer, cluster_size);
+            mount_write(mount, copy_address, buffer, cluster_size);
+        }
+
+        inode_set_datablock_index_value(mount, vfs_file->inode_ptr, index, copy_address);
+        if (vfs_file->block_map != NULL && index < vfs_file->block_map_count) {
+            vfs_file->block_map[index] = copy_address;
+        }
+        refcount_release(mount, cluster);
+        replaced++;
+    }
+
+    if (replaced > 0) {
+        log_trace("vfs_unshare_range: Inode ID=%d ziskal %d vlastnich kopii databloku\n", vfs_file->inode_ptr->id, replaced);
+    }
+
+    free(buffer);
+    return replaced;
+}
+
+/**
+ * Vynuluje úsek souboru <from, to) v přidělených datablocích, díry se nemění
+ *
+ * @param vfs_file ukazatel na soubor
+ * @param from počátek úseku (byte)
+ * @param to konec úseku (byte)
+ * @return (return < 0: chyba | 0: v pořádku)
+ */
+static int32_t vfs_zero_range(VFS_FILE *vfs_file, int64_t from, int64_t to) {
+    struct vfs_mount *mount = vfs_file->mount;
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int64_t mapped_end = (int64_t)vfs_file->inode_ptr->allocated_clusters * cluster_size;
+
+    // Za koncem mapy databloků jsou jen díry
+    if (to > mapped_end) {
+        to = mapped_end;
+    }
+
+    if (from >= to) {
+        return 0;
+    }
+
+    // Sdílené databloky se nulují až ve vlastní kopii
+    if (vfs_unshare_range(vfs_file, from, to - from) < 0) {
+        return -1;
+    }
+
+    char *zero = NULL;
+    int64_t position = from;
+    while (position < to) {
+        int64_t address = 0;
+        int32_t remaining = to - position > INT32_MAX ? INT32_MAX : (int32_t)(to - position);
+        int32_t run = vfs_contiguous_run(vfs_file, position, remaining, &address);
+
+        if (run < 1) {
+            free(zero);
+            return -2;
+        }
+
+        if (address != 0) {
+            if (zero == NULL) {
+                zero = calloc(1, cluster_size);
+            }
+
+            int32_t written = 0;
+            while (zero != NULL && written < run) {
+                int32_t chunk = run - written < cluster_size ? run - written : cluster_size;
+                mount_write(mount, address + written, zero, chunk);
+                written += chunk;
+            }
+        }
+
+        position += run;
+    }
+
+    free(zero);
+    return 0;
+}
+
+/**
+ * Z úseku souboru <from, to) udělá díru - celé databloky se uvolní,
+ * okrajové databloky se pouze vynulují
+ *
+ * @param vfs_file ukazatel na soubor
+ * @param from počátek úseku (byte)
+ * @param to konec úseku (byte)
+ * @return (return < 0: chyba | 0: v pořádku)
+ */
+static int32_t vfs_punch_range(VFS_FILE *vfs_file, int64_t from, int64_t to) {
+    struct vfs_mount *mount = vfs_file->mount;
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+
+    if (from >= to) {
+        return 0;
+    }
+
+    int32_t first = (int32_t)((from + cluster_size - 1) >> mount->cluster_shift);
+    int32_t last = (int32_t)(to >> mount->cluster_shift);
+
+    // Úsek neobsahuje celý datablok
+    if (first >= last) {
+        return vfs_zero_range(vfs_file, from, to);
+    }
+
+    if (vfs_zero_range(vfs_file, from, (int64_t)first * cluster_size) < 0
+        || vfs_zero_range(vfs_file, (int64_t)last * cluster_size, to) < 0) {
+        return -1;
+    }
+
+    if (deallocate_range(mount, vfs_file->inode_ptr, first, last - first) < 0) {
+        log_debug("vfs_punch_range: Databloky %d-%d inode ID=%d nelze uvolnit!\n", first, last - 1, vfs_file->inode_ptr->id);
+        return -2;
+    }
+
+    vfs_block_map_invalidate(vfs_file);
+    return 0;
+}
+
+/**
+ * Připraví databloky pro zápis do úseku souboru - doplní díry a konec mapy
+ * databloků, nově přidělené databloky vynuluje, jen pokud je zápis celé nepřepíše
+ *
+ * Zápis za konec souboru nejprve vynuluje zbytek posledního databloku,
+ * přeskočené celé databloky zůstanou dírami
+ *
+ * @param vfs_file ukazatel na soubor
+ * @param position pozice počátku zápisu (byte)
+ * @param size délka zápisu (byte)
+ * @return (return < 0: chyba | 0: v pořádku)
+ */
+static int32_t vfs_prepare_range(VFS_FILE *vfs_file, int64_t position, int64_t size) {
+    struct vfs_mount *mount = vfs_file->mount;
+    struct inode *inode_ptr = vfs_file->inode_ptr;
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+    int64_t file_size = inode_ptr->file_size;
+    int64_t end = position + size;
+
+    if (size < 1) {
+        return 0;
+    }
+
+    // Obsah mezi koncem souboru a zápisem se musí číst jako nuly
+    if (position > file_size && vfs_zero_range(vfs_file, file_size, position) < 0) {
+        return -1;
+    }
+
+    int32_t first = (int32_t)(position >> mount->cluster_shift);
+    int32_t last = (int32_t)((end - 1) >> mount->cluster_shift);
+
+    // Přeskočené databloky za koncem mapy jsou díry
+    if (first > inode_ptr->allocated_clusters
+        && inode_add_holes(mount, inode_ptr, first - inode_ptr->allocated_clusters) != 0) {
+        log_debug("vfs_prepare_range: Inode ID=%d nelze prodlouzit o diru!\n", inode_ptr->id);
+        return -2;
+    }
+
+    // Doplnění děr uvnitř mapy po souvislých úsecích
+    int32_t mapped_end = last + 1 < inode_ptr->allocated_clusters ? last + 1 : inode_ptr->allocated_clusters;
+    int32_t index = first;
+    while (index < mapped_end) {
+        if (vfs_get_datablock_address(vfs_file, index) != 0) {
+            index++;
+            continue;
+        }
+
+        int32_t hole_end = index + 1;
+        while (hole_end < mapped_end && vfs_get_datablock_address(vfs_file, hole_end) == 0) {
+            hole_end++;
+        }
+
+        int32_t run_start = -1;
+        int32_t run_length = allocate_cluster_run(mount, hole_end - index, &run_start);
+
+        if (run_length < 1) {
+            log_debug("vfs_prepare_range: Nedostatek volnych clusteru pro diru!\n");
+            return -3;
+        }
+
+        int32_t i;
+        for (i = 0; i < run_length; i++) {
+            int64_t address = bitmap_index_to_cluster_address(mount, run_start + i);
+
+            if (inode_set_datablock_index_value(mount, inode_ptr, index + i, address) < 0) {
+                bitmap_set(mount, run_start + i, run_length - i, FALSE);
+                return -4;
+            }
+
+            if (vfs_file->block_map != NULL && index + i < vfs_file->block_map_count) {
+                vfs_file->block_map[index + i] = address;
+            }
+
+            if (vfs_needs_clear((int64_t)(index + i) * cluster_size, cluster_size, position, end, file_size) == TRUE) {
+                allocation_clear_cluster(mount, address);
+            }
+        }
+
+        index += run_length;
+    }
+
+    // Prodloužení mapy databloků
+    int32_t appended = inode_ptr->allocated_clusters;
+    if (last >= appended) {
+        if (allocate_data_blocks(mount, last + 1 - appended, inode_ptr) != 0) {
+            log_debug("vfs_prepare_range: Nepodaril/y se alokovat data blok/y pro zapis!\n");
+            return -5;
+        }
+
+        for (index = appended; index <= last; index++) {
+            if (vfs_needs_clear((int64_t)index * cluster_size, cluster_size, position, end, file_size) == TRUE) {
+                allocation_clear_cluster(mount, vfs_get_datablock_address(vfs_file, index));
+            }
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Přečte daný počet struktur dané velikosti ze souboru vfs_file uloženého ve virtuálním FS
  *
@@ -87,21 +501,16 @@ size_t vfs_read(void *destination, size_t read_item_size, size_t read_item_count
         return -4;
     }
 
-    // Ziskani superbloku
-    struct superblock *superblock_ptr = superblock_from_file(vfs_file->vfs_filename);
-
-    // Kontrola čtení superbloku
-    if (superblock_ptr == NULL) {
-        return -5;
-    }
+    // Čtení musí vidět i odložená data
+    vfs_flush(vfs_file);
 
     // Pocet prectenych byte
     ssize_t rtn = 0;
 
-    int32_t temp_offset = vfs_file->offset;
-    int32_t temp_filesize = vfs_file->inode_ptr->file_size;
-    int32_t temp_total_read_size = read_item_size * read_item_count;
-    int32_t temp_can_read = temp_filesize - temp_offset;
+    int64_t temp_offset = vfs_file->offset;
+    int64_t temp_filesize = vfs_file->inode_ptr->file_size;
+    int64_t temp_total_read_size = (int64_t)read_item_size * read_item_count;
+    int64_t temp_can_read = temp_filesize - temp_offset;
 
     //Pokud je třeba číst víc než můžeme, přečteme pouze to co můžeme
     if (temp_total_read_size > temp_can_read) {
@@ -110,495 +519,615 @@ size_t vfs_read(void *destination, size_t read_item_size, size_t read_item_count
 
     // Zastavíme funkci pokud jsme za koncem souboru
     if (temp_total_read_size < 1) {
-        free(superblock_ptr);
         log_trace("vfs_read: Povolena velikost cteni je mensi nez 1 byte (pravdepodobne chybny offset)!\n");
         return -6;
     }
 
-    // Výpočet v případě čtení vícera databloků
-    int32_t skipped_datablocks = temp_offset / superblock_ptr->cluster_size;
-    int32_t first_datablock_offset = temp_offset - (skipped_datablocks * superblock_ptr->cluster_size);
-    int32_t first_datablock_can_read = superblock_ptr->cluster_size - first_datablock_offset;
-
     // Logging
-    log_trace("vfs_read: Offset -> %d, Size -> %d, Total Read -> %d, Can read -> %d\n", temp_offset, temp_filesize,
-              temp_total_read_size, temp_can_read);
-    log_trace("vfs_read: skipped_datablock -> %d\n", skipped_datablocks);
-    log_trace("vfs_read: first_datablock_offset -> %d\n", first_datablock_offset);
-    log_trace("vfs_read: first_datablock_can_read -> %d\n", first_datablock_can_read);
+    log_trace("vfs_read: Offset -> %ld, Size -> %ld, Total Read -> %ld, Can read -> %ld\n", (long)temp_offset, (long)temp_filesize,
+              (long)temp_total_read_size, (long)temp_can_read);
+
+    // Čtení po fyzicky souvislých úsecích přímo do cílové paměti
+    char *read_pointer = destination;
+    int64_t read_remaining = temp_total_read_size;
+    while (read_remaining > 0) {
+        int64_t run_address = 0;
+        int32_t run = vfs_contiguous_run(vfs_file, vfs_file->offset, read_remaining > INT32_MAX ? INT32_MAX : (int32_t)read_remaining, &run_address);
+
+        if (run < 1) {
+            log_debug("vfs_read: Nelze ziskat adresu databloku pro offset %ld!\n", (long)vfs_file->offset);
+            break;
+        }
 
-    // Otevření vfs souboru pro čtení
-    FILE *file = fopen(vfs_file->vfs_filename, "r+b");
+        // Díra se čte jako nuly bez přístupu do VFS
+        int64_t result = run;
+        if (run_address == 0) {
+            memset(read_pointer, 0, run);
+        } else {
+            result = mount_read(vfs_file->mount, run_address, read_pointer, run);
+        }
 
-    if (file == NULL) {
-        free(superblock_ptr);
-        return -7;
-    }
-
-    // Všechna data můžeme přečíst z prvního data bloku
-    if (temp_total_read_size <= first_datablock_can_read) {
-        log_trace("vfs_read: Can read all data from first datablock\n");
-
-        // Z kterého databloku budeme číst
-        int32_t datablock_address = inode_get_datablock_index_value(vfs_file->vfs_filename, vfs_file->inode_ptr,
-                                                                    skipped_datablocks);
-        // Přičteme offset k adrese
-        int32_t datablock_direct_adress = datablock_address + first_datablock_offset;
-
-        // Nastavíme adresu čtení z vfs souboru
-        fseek(file, datablock_direct_adress, SEEK_SET);
-        // Přečteme data
-        rtn += fread(destination, read_item_size, read_item_count, file);
-        // Logging
-        log_trace("vfs_read: Celkem precteno %d byte z 1 databloku.\n", (read_item_count * read_item_size));
-        // Posun offsetu o přečtená data
-        vfs_seek(vfs_file, temp_total_read_size, SEEK_CUR);
+        if (result < 1) {
+            break;
+        }
 
-    } else {
-        // Výpočet kolik byte zbývá přečíst po 1. databloku
-        int32_t remaining_read = temp_total_read_size - first_datablock_can_read;
-        // Kolik celých databloků můžeme přečíst
-        int32_t datablocks_count_read = remaining_read / superblock_ptr->cluster_size;
-        // Last datablock read
-        int32_t last_datablock_remaining = remaining_read - (superblock_ptr->cluster_size * datablocks_count_read);
-
-        // Logging
-        log_trace("vfs_read: Remaining data after first datablock -> %d\n", remaining_read);
-        log_trace("vfs_read: Whole remaining datablocks -> %d\n", datablocks_count_read);
-        log_trace("vfs_read: Last datablock bytes -> %d\n", last_datablock_remaining);
-
-        // Alokace paměti pro čtení
-        char *buffer = malloc(sizeof(char) * temp_total_read_size);
-        // Nulování buffer paměti
-        memset(buffer, 0, sizeof(char) * temp_total_read_size);
-        // Vytvoření iteračního ukazatele
-        char *buffer_seek = buffer;
-        // Zbývající počet byte ke čtení
-        int32_t read_remaining = temp_total_read_size;
-
-        // Čtení dat z prvního databloku
-        int32_t first_datablock_address = inode_get_datablock_index_value(vfs_file->vfs_filename, vfs_file->inode_ptr,
-                                                                          skipped_datablocks);
-        // Přičteme offset k adrese
-        int32_t datablock_direct_adress = first_datablock_address + first_datablock_offset;
-        // Nastavení offsetu
-        fseek(file, datablock_direct_adress, SEEK_SET);
-        // Přečtení prvního databloku
-        rtn += fread(buffer_seek, sizeof(char), first_datablock_can_read, file);
-        buffer_seek += first_datablock_can_read;
-        read_remaining -= first_datablock_can_read;
-
-        log_trace("vfs_read: Remaining after first data block was read: %d\n", read_remaining);
-
-        int32_t curr_datablock_index = skipped_datablocks + 1;
-        // Čtení celých databloků pokud je potřeba
-        while (read_remaining >= superblock_ptr->cluster_size) {
-            // Získání adresy dalšího bloku
-            int32_t curr_datablock_address = inode_get_datablock_index_value(vfs_file->vfs_filename, vfs_file->inode_ptr,
-                                                                             curr_datablock_index);
-
-            // Nastavení offsetu
-            fseek(file, curr_datablock_address, SEEK_SET);
-            // Přečtení celého data bloku
-            rtn += fread(buffer_seek, sizeof(char), superblock_ptr->cluster_size, file);
-
-            // Posun na další data blok
-            read_remaining -= superblock_ptr->cluster_size;
-            buffer_seek += superblock_ptr->cluster_size;
-            log_trace("vfs_read: Precteni databloku na indexu %d, zbyvajici pocet byte: %d\n", curr_datablock_index,
-                      read_remaining);
-            curr_datablock_index += 1;
-
-        }
-
-        // Přečtení posledního data bloku pokud je nutné
-        if (read_remaining > 0 && read_remaining < superblock_ptr->cluster_size) {
-            // Získání adresy posledního data bloku
-            int32_t curr_datablock_address = inode_get_datablock_index_value(vfs_file->vfs_filename, vfs_file->inode_ptr,
-                                                                             curr_datablock_index);
-
-            // Nastavení offsetu
-            fseek(file, curr_datablock_address, SEEK_SET);
-            // Přečtení zbylých dat
-            rtn += fread(buffer_seek, sizeof(char), read_remaining, file);
-
-            // Posun na konec kvůli ověřování
-            buffer_seek += read_remaining;
-            read_remaining -= read_remaining;
-            curr_datablock_index += 1;
-        }
-
-        // Celkové přečtení
-        int32_t successfull_read = buffer_seek - buffer;
-        log_trace("vfs_read: Celkem přečteno %d byte\n", successfull_read);
-
-        // Přesun dat z bufferu do destination
-        memcpy(destination, buffer, successfull_read);
+        log_trace("vfs_read: Precteno %d byte z adresy %ld\n", (int32_t)result, (long)run_address);
 
         // Posun offsetu o přečtená data
-        vfs_seek(vfs_file, successfull_read, SEEK_CUR);
-
-        // Uvolnění zdrojů
-        free(buffer);
-
+        rtn += result;
+        read_pointer += result;
+        read_remaining -= result;
+        vfs_seek(vfs_file, result, SEEK_CUR);
     }
 
-    // Uvolnění zdrojů
-    fclose(file);
-    free(superblock_ptr);
+    log_trace("vfs_read: Celkem precteno %d byte\n", (int32_t)rtn);
+
     return rtn;
 }
 
 /**
- * Zapíše do souboru vfs_file (do virtuálního FS) danou velikost dat s daným opakováním
+ * Zapíše do souboru vfs_file (od jeho offsetu) data ze souboru hostitelského systému,
+ * data se přenáší po fyzicky souvislých úsecích bez kopírování přes uživatelský prostor
+ *
+ * Díry zdrojového souboru se nepřenáší - v souboru VFS z nich jsou opět díry
  *
- * @param source ukazatel odkud se data budou číst
- * @param write_item_size velikost zapisovaných dat
- * @param write_item_count počet opakování při zápisu
  * @param vfs_file ukazatel na soubor ve VFS
- * @return počet zapsaných byte
+ * @param fd popisovač zdrojového souboru
+ * @param fd_offset pozice ve zdrojovém souboru
+ * @param size počet byte k zápisu
+ * @return (return < 0: chyba | return >= 0: počet zapsaných byte)
  */
-size_t vfs_write(void *source, size_t write_item_size, size_t write_item_count, VFS_FILE *vfs_file) {
+int64_t vfs_write_from_fd(VFS_FILE *vfs_file, int fd, int64_t fd_offset, int64_t size) {
     // Kontrola ukazatele na strukturu VFS_FILE_TYPE
-    if (vfs_file == NULL) {
+    if (vfs_file == NULL || vfs_file->mount == NULL || vfs_file->inode_ptr == NULL) {
         return -1;
     }
 
-    // Kontrola obsahu vfs_file
-    if(vfs_file->vfs_filename == NULL || strlen(vfs_file->vfs_filename) < 1){
+    if (fd < 0 || size < 0) {
         return -2;
     }
 
-    // Kontrola obsahu vfs_file 2
-    if(vfs_file->inode_ptr == NULL){
-        return -2;
+    if (vfs_flush(vfs_file) < 0) {
+        return -10;
     }
 
-    // Kontrola ukazatele na místo v paměti pro uložení výsledku
-    if (source == NULL) {
+    // Soubor bude končit za zapsanými daty, nebo zůstane původní velikost
+    int64_t end = vfs_file->offset + size;
+    if (end > inode_max_file_size(vfs_file->mount, vfs_file->inode_ptr)) {
+        log_debug("vfs_write_from_fd: Soubor by prekrocil maximalni velikost!\n");
         return -3;
     }
 
-    // Velikost čtení nemůže být menší jak 1
-    if (write_item_size < 1) {
-        return -4;
+    // Přenos po datových úsecích zdrojového souboru
+    int64_t done = 0;
+    bool source_end = FALSE;
+    while (done < size && source_end == FALSE) {
+        int64_t data_end = 0;
+        int64_t data = mount_fd_next_data(fd, fd_offset + done, fd_offset + size, &data_end);
+
+        // Díra ve zdroji - přepisovaná data souboru se uvolní
+        if (data > fd_offset + done) {
+            int64_t hole = data - (fd_offset + done);
+            int64_t hole_end = vfs_file->offset + hole;
+            int64_t file_size = vfs_file->inode_ptr->file_size;
+
+            if (vfs_file->offset < file_size
+                && vfs_punch_range(vfs_file, vfs_file->offset, hole_end < file_size ? hole_end : file_size) < 0) {
+                break;
+            }
+
+            done += hole;
+            vfs_file->offset = hole_end;
+            continue;
+        }
+
+        int64_t segment = data_end - (fd_offset + done);
+
+        if (vfs_prepare_range(vfs_file, vfs_file->offset, segment) < 0) {
+            log_debug("vfs_write_from_fd: Nepodaril/y se alokovat data blok/y pro zapis!\n");
+            if (done == 0) {
+                return -10;
+            }
+            break;
+        }
+
+        // Sdílené databloky dostanou před zápisem vlastní kopii
+        if (vfs_unshare_range(vfs_file, vfs_file->offset, segment) < 0) {
+            if (done == 0) {
+                return -11;
+            }
+            break;
+        }
+
+        // Přenos po fyzicky souvislých úsecích
+        int64_t copied = 0;
+        while (copied < segment) {
+            int64_t run_address = 0;
+            int32_t remaining = segment - copied > INT32_MAX ? INT32_MAX : (int32_t)(segment - copied);
+            int32_t run = vfs_contiguous_run(vfs_file, vfs_file->offset, remaining, &run_address);
+
+            if (run < 1 || run_address == 0) {
+                log_debug("vfs_write_from_fd: Nelze ziskat adresu databloku pro offset %ld!\n", (long)vfs_file->offset);
+                source_end = TRUE;
+                break;
+            }
+
+            int64_t result = mount_copy_from_fd(vfs_file->mount, run_address, fd, fd_offset + done, run);
+
+            if (result < 0) {
+                log_debug("vfs_write_from_fd: Zapis na adresu %ld selhal!\n", (long)run_address);
+                source_end = TRUE;
+                break;
+            }
+
+            copied += result;
+            done += result;
+            vfs_file->offset += result;
+
+            // Konec zdrojového souboru
+            if (result < run) {
+                source_end = TRUE;
+                break;
+            }
+        }
+
+        if (vfs_file->offset > vfs_file->inode_ptr->file_size) {
+            vfs_file->inode_ptr->file_size = vfs_file->offset;
+        }
     }
 
-    // Počet čtení nemůže být menší jak 1
-    if (write_item_count < 1) {
-        return -5;
+    // Díra na konci zdroje soubor pouze prodlouží
+    if (vfs_file->offset > vfs_file->inode_ptr->file_size) {
+        vfs_zero_range(vfs_file, vfs_file->inode_ptr->file_size, vfs_file->offset);
+        vfs_file->inode_ptr->file_size = vfs_file->offset;
     }
 
-    // Ziskani superbloku
-    struct superblock *superblock_ptr = superblock_from_file(vfs_file->vfs_filename);
+    // Aktualizace inode ve VFS
+    inode_write_to_index(vfs_file->mount, vfs_file->inode_ptr->id - 1, vfs_file->inode_ptr);
 
-    // Kontrola čtení superbloku
-    if (superblock_ptr == NULL) {
-        return -6;
+    log_trace("vfs_write_from_fd: Celkem zapsano %ld byte\n", (long)done);
+
+    return done;
+}
+
+/**
+ * Přečte ze souboru vfs_file (od jeho offsetu) data do souboru hostitelského systému,
+ * data se přenáší po fyzicky souvislých úsecích bez kopírování přes uživatelský prostor
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @param fd popisovač cílového souboru
+ * @param fd_offset pozice v cílovém souboru
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet přečtených byte)
+ */
+int64_t vfs_read_to_fd(VFS_FILE *vfs_file, int fd, int64_t fd_offset, int64_t size) {
+    // Kontrola ukazatele na strukturu VFS_FILE_TYPE
+    if (vfs_file == NULL || vfs_file->mount == NULL || vfs_file->inode_ptr == NULL) {
+        return -1;
+    }
+
+    if (fd < 0 || size < 0) {
+        return -2;
+    }
+
+    vfs_flush(vfs_file);
+
+    // Čte se nejvýše do konce souboru
+    int64_t can_read = vfs_file->inode_ptr->file_size - vfs_file->offset;
+    if (size > can_read) {
+        size = can_read > 0 ? can_read : 0;
+    }
+
+    int64_t done = 0;
+    while (done < size) {
+        int64_t run_address = 0;
+        int32_t remaining = size - done > INT32_MAX ? INT32_MAX : (int32_t)(size - done);
+        int32_t run = vfs_contiguous_run(vfs_file, vfs_file->offset, remaining, &run_address);
+
+        if (run < 1) {
+            log_debug("vfs_read_to_fd: Nelze ziskat adresu databloku pro offset %ld!\n", (long)vfs_file->offset);
+            break;
+        }
+
+        // Díra - v cílovém souboru za jeho koncem zůstane také dírou
+        int64_t result = run;
+        if (run_address == 0) {
+            if (mount_fd_zero(fd, fd_offset + done, run) != TRUE) {
+                break;
+            }
+        } else {
+            result = mount_copy_to_fd(vfs_file->mount, run_address, fd, fd_offset + done, run);
+        }
+
+        if (result < 1) {
+            break;
+        }
+
+        done += result;
+        vfs_file->offset += result;
+
+        if (result < run) {
+            break;
+        }
     }
 
-    int32_t cluster_size = superblock_ptr->cluster_size;
+    log_trace("vfs_read_to_fd: Celkem precteno %ld byte\n", (long)done);
+
+    return done;
+}
 
-    int32_t temp_offset = vfs_file->offset;
-    int32_t temp_filesize = vfs_file->inode_ptr->file_size;
-    int32_t temp_total_write_size = write_item_size * write_item_count;
+/**
+ * Zapíše data od offsetu souboru přímo do VFS, chybějící databloky přidělí najednou
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @param source ukazatel odkud se data budou číst
+ * @param size počet byte k zápisu
+ * @return (return < 0: chyba | return >= 0: počet skutečně zapsaných byte)
+ */
+static int64_t vfs_write_direct(VFS_FILE *vfs_file, char *source, int64_t size) {
+    int64_t temp_offset = vfs_file->offset;
+    int64_t temp_filesize = vfs_file->inode_ptr->file_size;
+    int64_t temp_total_write_size = size;
 
     // Kontrola přepisu existujících dat
-    int32_t temp_rewritten = temp_offset - temp_filesize;
+    int64_t temp_rewritten = temp_offset - temp_filesize;
 
     // Informační ověření zda přepisuji již zapsaná data
     if (temp_rewritten < 0) {
-        log_debug("vfs_write: Prepisuji %d existujich byte pro soubor s inode ID=%d\n", -1 * temp_rewritten,
+        log_debug("vfs_write: Prepisuji %ld existujich byte pro soubor s inode ID=%d\n", (long)(-1 * temp_rewritten),
                   vfs_file->inode_ptr->id);
     }
 
-    // Kolik databloků bude potřeba po zápisu
-    int32_t file_size = vfs_file->inode_ptr->file_size;
-    int32_t data_block_needed = (int32_t)ceil(
-            (double) (file_size + temp_total_write_size) / (double) (superblock_ptr->cluster_size));
+    // Přidělení databloků pro zapisovaný úsek (díry, konec mapy)
+    if (vfs_prepare_range(vfs_file, temp_offset, temp_total_write_size) < 0) {
+        log_debug("vfs_write: Nepodaril/y se alokovat data blok/y pro zapis!\n");
+        return -10;
+    }
 
-    // Alokujeme dokud můžeme
-    int32_t allocation_result = 0;
-    while (vfs_file->inode_ptr->allocated_clusters < data_block_needed && allocation_result == 0) {
-        // Zjištění volného data bloku a jeho adresy
-        int32_t free_index = bitmap_find_free_cluster_index(vfs_file->vfs_filename);
-        int32_t free_address = bitmap_index_to_cluster_address(vfs_file->vfs_filename, free_index);
+    // Sdílené databloky dostanou před zápisem vlastní kopii
+    if (vfs_unshare_range(vfs_file, temp_offset, temp_total_write_size) < 0) {
+        log_debug("vfs_write: Sdilene databloky nelze zkopirovat!\n");
+        return -11;
+    }
 
-        // Označení indexu jako použitý
-        bitmap_set(vfs_file->vfs_filename ,free_index, 1, TRUE);
+    // Zápis po fyzicky souvislých úsecích přímo ze zdrojové paměti
+    char *write_pointer = source;
+    int64_t write_remaining = temp_total_write_size;
+    while (write_remaining > 0) {
+        int64_t run_address = 0;
+        int32_t run = vfs_contiguous_run(vfs_file, vfs_file->offset, write_remaining > INT32_MAX ? INT32_MAX : (int32_t)write_remaining, &run_address);
 
-        // Pokus o alokaci - 0 = OK
-        allocation_result = inode_add_data_address(vfs_file->vfs_filename, vfs_file->inode_ptr, free_address);
+        if (run < 1 || run_address == 0) {
+            log_debug("vfs_write: Nelze ziskat adresu databloku pro offset %ld!\n", (long)vfs_file->offset);
+            break;
+        }
 
-        // Alokace nevyšla
-        if (allocation_result != 0) {
-            log_debug("vfs_write: Nepodaril/y se alokovat data blok/y pro zapis!\n");
-            // Označení failed bitmap indexu jako nevyužitý
-            bitmap_set(vfs_file->vfs_filename, free_index, 1, FALSE);
-            free(superblock_ptr);
-            return -10;
+        if (mount_write(vfs_file->mount, run_address, write_pointer, run) != run) {
+            log_debug("vfs_write: Zapis na adresu %ld selhal!\n", (long)run_address);
+            break;
         }
+
+        log_trace("vfs_write: Zapsano %d byte na adresu %ld\n", run, (long)run_address);
+
+        write_pointer += run;
+        write_remaining -= run;
+        vfs_file->offset += run;
     }
 
+    // Vypočet velikosti zapsaných dat
+    int64_t data_written = write_pointer - source;
+    int64_t data_append = vfs_file->offset - temp_filesize;
+    // Logging
+    log_trace("vfs_write: Celkem zapsano %ld byte (soubor zvetsen o %ld byte)\n", (long)data_written,
+              (long)(data_append > 0 ? data_append : 0));
 
-    // Výpočet v případě zápisu na více databloků
-    int32_t skipped_datablocks = temp_offset / cluster_size;
+    // Zvětšení velikosti souboru (zápis za konec souboru mohl vytvořit díru)
+    if (data_append > 0) {
+        vfs_file->inode_ptr->file_size = vfs_file->offset;
+    }
+    // Aktualizace inode ve VFS
+    inode_write_to_index(vfs_file->mount, vfs_file->inode_ptr->id - 1, vfs_file->inode_ptr);
+
+    return data_written;
+}
 
-    // Nelze přeskočit víc databloků než je alokováno - zápis do nenaalokovaného místa
-    if (skipped_datablocks > vfs_file->inode_ptr->allocated_clusters) {
-        log_debug("vfs_write: Nelze zapisovat do nenaalokovaneho mista!\n");
-        return -7;
+/**
+ * Zapíše odložená data souboru do VFS - databloky se přidělí najednou
+ * pro celou výslednou velikost souboru
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @return (return < 0: chyba | 0: v pořádku)
+ */
+int32_t vfs_flush(VFS_FILE *vfs_file) {
+    // Kontrola ukazatele na strukturu VFS_FILE_TYPE
+    if (vfs_file == NULL) {
+        return -1;
     }
 
-    int32_t first_datablock_offset = temp_offset - (skipped_datablocks * cluster_size);
-    int32_t first_datablock_can_write = cluster_size- first_datablock_offset;
+    if (vfs_file->delayed_size < 1) {
+        return 0;
+    }
 
-    log_debug("vfs_write: First datablock offset -> %d\n", first_datablock_offset);
-    log_debug("vfs_write: First datablock can write ->%d\n", first_datablock_can_write);
+    int64_t offset = vfs_file->offset;
+    int32_t size = vfs_file->delayed_size;
 
-    // Otevření souboru pro zápis
-    FILE *file = fopen(vfs_file->vfs_filename, "r+b");
+    // Zápis na původní konec souboru, offset se poté vrátí
+    vfs_file->offset = vfs_file->delayed_offset;
 
-    // Ověření otevření souboru
-    if (file == NULL) {
-        free(superblock_ptr);
-        return -8;
-    }
-
-    // Iterační ukazatel pro zápis
-    void *write_pointer = source;
-
-    // Lze zapisovat do 1 data bloku?
-    if (temp_total_write_size <= first_datablock_can_write) {
-        log_trace("vfs_write: Lze zapisovat vsechna data do prvniho databloku.\n");
-
-        // Do kterého databloku budeme zapisovat
-        int32_t datablock_address = inode_get_datablock_index_value(vfs_file->vfs_filename, vfs_file->inode_ptr,
-                                                                    skipped_datablocks);
-        // Přičteme offset k adrese
-        int32_t datablock_direct_adress = datablock_address + first_datablock_offset;
-
-        // Nastavíme adresu čtení z vfs souboru
-        fseek(file, datablock_direct_adress, SEEK_SET);
-        // Přečteme data
-        fwrite(write_pointer, write_item_size, write_item_count, file);
-        // Posun ukazatele
-        write_pointer += write_item_size * write_item_count;
-        // Vypočet velikosti zapsaných dat
-        int32_t data_written = (write_pointer - source);
-        int32_t data_append = data_written - (-1 * temp_rewritten);
-        // Logging
-        log_trace("vfs_write: Celkem zapsano %d byte (soubor zvetsen o %d byte)\n", data_written, data_append);
-
-        // Zvětšení velikosti souboru
-        if(data_append > 0){
-            vfs_file->inode_ptr->file_size += data_append;
-        }
-        // Aktualizace inode ve VFS
-        inode_write_to_index(vfs_file->vfs_filename, vfs_file->inode_ptr->id - 1, vfs_file->inode_ptr);
-        // Posun offsetu
-        vfs_seek(vfs_file, data_written, SEEK_CUR);
-    } else {
-        // Kolik musíme zapsat po 1. databloku
-        int32_t remaining_write = temp_total_write_size - first_datablock_can_write;
-        // Kolik celých databloků musíme zapsat
-        int32_t datablock_count_write = remaining_write / superblock_ptr->cluster_size;
-        // Velikost zapisu do posledniho databloku
-        int32_t last_datablock_remaining = remaining_write - (datablock_count_write * superblock_ptr->cluster_size);
+    int64_t written = vfs_write_direct(vfs_file, vfs_file->delayed, size);
 
-        // Logging
-        log_trace("vfs_write: Remaining data after first datablock -> %d\n", remaining_write);
-        log_trace("vfs_write: Whole remaining datablocks write -> %d\n", datablock_count_write);
-        log_trace("vfs_write: Last datablock bytes -> %d\n", last_datablock_remaining);
+    vfs_file->offset = offset;
 
-        int32_t curr_remaining = temp_total_write_size;
-        void *curr_write_pointer = source;
+    // Z bufferu se odeberou pouze zapsaná data, zbytek zůstává odložen
+    if (written > 0) {
+        memmove(vfs_file->delayed, vfs_file->delayed + written, size - written);
+        vfs_file->delayed_offset += written;
+        vfs_file->delayed_size -= (int32_t)written;
+    }
 
-        // Zápis dat do prvního databloku
-        int32_t first_datablock_address = inode_get_datablock_index_value(vfs_file->vfs_filename, vfs_file->inode_ptr,
-                                                                          skipped_datablocks);
-        // Přičteme offset k adrese
-        int32_t datablock_direct_adress = first_datablock_address + first_datablock_offset;
-        // Nastavení offsetu
-        fseek(file, datablock_direct_adress, SEEK_SET);
-        // Zápis do prvního databloku
-        fwrite(curr_write_pointer, first_datablock_can_write, 1, file);
-        // Posun ukazatele, odečtení "zbytku"
-        curr_write_pointer += first_datablock_can_write;
-        curr_remaining -= first_datablock_can_write;
+    if (written < size) {
+        log_debug("vfs_flush: Z odlozenych dat (%d byte) inode ID=%d zapsano pouze %ld byte!\n", size,
+                  vfs_file->inode_ptr->id, (long)(written > 0 ? written : 0));
+        return written < 0 ? (int32_t)written : -13;
+    }
 
-        log_trace("vfs_write: Remaining after first data block was written: %d\n", curr_remaining);
+    log_trace("vfs_flush: Zapsano %d odlozenych byte inode ID=%d\n", size, vfs_file->inode_ptr->id);
+    return 0;
+}
 
-        // Zápis celých databloků
-        int32_t curr_datablock_index = skipped_datablocks + 1;
-        while (curr_remaining >= superblock_ptr->cluster_size) {
-            // Získání adresy dalšího bloku
-            int32_t curr_datablock_address = inode_get_datablock_index_value(vfs_file->vfs_filename, vfs_file->inode_ptr,
-                                                                             curr_datablock_index);
+/**
+ * Předem přidělí souboru databloky pro zadanou velikost jedním voláním alokátoru,
+ * velikost souboru se nemění
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @param size očekávaná velikost souboru v byte
+ * @return (return < 0: chyba | 0: v pořádku | return > 0: počet nepřidělených databloků)
+ */
+int32_t vfs_preallocate(VFS_FILE *vfs_file, int64_t size) {
+    // Kontrola ukazatele na strukturu VFS_FILE_TYPE
+    if (vfs_file == NULL || vfs_file->mount == NULL || vfs_file->inode_ptr == NULL) {
+        return -1;
+    }
 
-            // Nastavení adresy
-            fseek(file, curr_datablock_address, SEEK_SET);
-            // Zapis celýho databloku
-            fwrite(curr_write_pointer, cluster_size, 1, file);
+    if (size < 0 || size > inode_max_file_size(vfs_file->mount, vfs_file->inode_ptr)) {
+        log_debug("vfs_preallocate: Soubor by prekrocil maximalni velikost!\n");
+        return -3;
+    }
 
-            // Posun na další datablok
-            curr_remaining -= cluster_size;
-            curr_write_pointer += superblock_ptr->cluster_size;
-            curr_datablock_index += 1;
-            log_trace("vfs_write: Zapis do databloku na indexu %d, zbyvajici pocet byte k zapsani %d\n",
-                      curr_datablock_index, curr_remaining);
-        }
+    int32_t cluster_size = vfs_file->mount->superblock_ptr->cluster_size;
+    int32_t data_block_needed = (int32_t)((size + cluster_size - 1) >> vfs_file->mount->cluster_shift);
+    int32_t missing = data_block_needed - vfs_file->inode_ptr->allocated_clusters;
 
-        // Zapis posledního data bloku
-        if (curr_remaining > 0 && curr_remaining < cluster_size) {
-            // Získání adresy posledního data bloku
-            int32_t curr_datablock_address = inode_get_datablock_index_value(vfs_file->vfs_filename, vfs_file->inode_ptr,
-                                                                             curr_datablock_index);
+    if (missing < 1) {
+        return 0;
+    }
 
-            // Nastavení offsetu
-            fseek(file, curr_datablock_address, SEEK_SET);
-            // Zapis zbylych dat
-            fwrite(curr_write_pointer, curr_remaining, 1, file);
+    // Celá velikost jedním požadavkem - alokátor hledá jediný dostatečně dlouhý úsek
+    int32_t result = allocate_data_blocks(vfs_file->mount, missing, vfs_file->inode_ptr);
 
-            // Posun na konec kvůli ověřování
-            curr_write_pointer += curr_remaining;
-            curr_remaining -= curr_remaining;
-            curr_datablock_index += 1;
-        }
+    log_trace("vfs_preallocate: Inode ID=%d predem pridelen/o %d/%d databloku\n", vfs_file->inode_ptr->id,
+              result >= 0 ? missing - result : 0, missing);
 
-        // Vypočet velikosti zapsaných dat
-        int32_t data_written = curr_write_pointer - source;
-        int32_t data_append = data_written - (-1 * temp_rewritten);
-        // Logging
-        log_trace("vfs_write: Celkem zapsano %d byte (soubor zvetsen o %d byte)\n", data_written, data_append);
+    return result;
+}
 
-        // Zvětšení velikosti souboru
-        if(data_append > 0){
-            vfs_file->inode_ptr->file_size += data_append;
-        }
-        // Aktualizace inode ve VFS
-        inode_write_to_index(vfs_file->vfs_filename, vfs_file->inode_ptr->id - 1, vfs_file->inode_ptr);
+/**
+ * Nastaví velikost souboru - zkrácení uvolní databloky za novým koncem,
+ * prodloužení přidá na konec díru (čte se jako nuly), nastavení stejné
+ * velikosti uvolní předem vyhrazené databloky za koncem souboru
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @param size nová velikost souboru v byte
+ * @return (return < 0: chyba | 0: v pořádku)
+ */
+int32_t vfs_truncate(VFS_FILE *vfs_file, int64_t size) {
+    // Kontrola ukazatele na strukturu VFS_FILE_TYPE
+    if (vfs_file == NULL || vfs_file->mount == NULL || vfs_file->inode_ptr == NULL) {
+        return -1;
+    }
 
-        // Posun offsetu
-        vfs_seek(vfs_file, data_written, SEEK_CUR);
+    if (size < 0 || size > inode_max_file_size(vfs_file->mount, vfs_file->inode_ptr)) {
+        log_debug("vfs_truncate: Neplatna velikost souboru %ld!\n", (long)size);
+        return -3;
     }
 
+    if (vfs_flush(vfs_file) < 0) {
+        return -10;
+    }
 
+    struct vfs_mount *mount = vfs_file->mount;
+    struct inode *inode_ptr = vfs_file->inode_ptr;
+    int32_t cluster_size = mount->superblock_ptr->cluster_size;
+
+    if (size == 0) {
+        // Prázdný soubor nepotřebuje ani bloky ukazatelů
+        deallocate(mount, inode_ptr);
+        inode_reset_mapping(inode_ptr);
+        vfs_block_map_invalidate(vfs_file);
+    } else if (size <= inode_ptr->file_size) {
+        // Uvolnění celých databloků za novým koncem (i předem vyhrazených), zbytek posledního se nechá
+        int32_t keep = (int32_t)((size + cluster_size - 1) >> mount->cluster_shift);
+
+        if (keep < inode_ptr->allocated_clusters
+            && deallocate_range(mount, inode_ptr, keep, inode_ptr->allocated_clusters - keep) < 0) {
+            return -4;
+        }
 
-    free(superblock_ptr);
-    fclose(file);
+        vfs_block_map_invalidate(vfs_file);
+    } else if (vfs_zero_range(vfs_file, inode_ptr->file_size, size) < 0) {
+        // Data za původním koncem souboru musí být nuly
+        return -5;
+    }
 
+    inode_ptr->file_size = size;
+    inode_write_to_index(mount, inode_ptr->id - 1, inode_ptr);
 
+    log_trace("vfs_truncate: Inode ID=%d ma novou velikost %ld byte\n", inode_ptr->id, (long)size);
     return 0;
 }
 
 /**
- * Vytvoří kontext pro práci souboru - vždycky lze provádět čtení i zápis zároveň
+ * Zapíše do souboru vfs_file (do virtuálního FS) danou velikost dat s daným opakováním
  *
- * @param vfs_file cesta k souboru vfs.dat (apod.)
- * @param vfs_path cesta souboru uvnitř virtuálního filesystému.
- * @return (VFS_FILE* | NULL)
+ * Malé zápisy na konec běžného souboru se odkládají (viz VFS_DELAYED_SIZE) a databloky
+ * se jim přidělí až ve vfs_flush, kdy alokátor zná výslednou velikost souboru
+ *
+ * @param source ukazatel odkud se data budou číst
+ * @param write_item_size velikost zapisovaných dat
+ * @param write_item_count počet opakování při zápisu
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @return počet zapsaných byte
  */
-VFS_FILE *vfs_open(char *vfs_file, char *vfs_path) {
-    // Kontrola délky názvu souboru
-    if (strlen(vfs_file) < 1) {
-        log_debug("vfs_open_inode: Cesta k souboru VFS nemuze byt prazdnym retezcem!\n");
-        return NULL;
+size_t vfs_write(void *source, size_t write_item_size, size_t write_item_count, VFS_FILE *vfs_file) {
+    // Kontrola ukazatele na strukturu VFS_FILE_TYPE
+    if (vfs_file == NULL) {
+        return -1;
     }
 
-    // Ověření existence souboru
-    if (file_exist(vfs_file) != TRUE) {
-        log_debug("vfs_open_inode: Soubor VFS %s neexistuje!\n", vfs_file);
-        return NULL;
+    // Kontrola obsahu vfs_file
+    if(vfs_file->mount == NULL){
+        return -2;
     }
 
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(vfs_file);
+    // Kontrola obsahu vfs_file 2
+    if(vfs_file->inode_ptr == NULL){
+        return -2;
+    }
 
-    // Ověření ziskání superbloku
-    if (superblock_ptr == NULL) {
-        log_debug("vfs_open_inode: Nepodarilo se precist superblock z VFS!\n");
-        return NULL;
+    // Kontrola ukazatele na místo v paměti pro uložení výsledku
+    if (source == NULL) {
+        return -3;
     }
 
-    VFS_FILE *vfs_file_open = malloc(sizeof(struct VFS_FILE));
-    memset(vfs_file_open, 0, sizeof(struct VFS_FILE));
+    // Velikost čtení nemůže být menší jak 1
+    if (write_item_size < 1) {
+        return -4;
+    }
 
-    if (vfs_file_open == NULL) {
-        free(superblock_ptr);
-        log_debug("vfs_open_inode: Nepodarilo se alokovat pamet pro strukturu VFS_FILE_TYPE!\n");
-        return NULL;
+    // Počet čtení nemůže být menší jak 1
+    if (write_item_count < 1) {
+        return -5;
     }
 
-    // Otevření root složky
-    if (strcmp(vfs_path, "/") == 0) {
-        VFS_FILE *vfs_opened_inode = vfs_open_inode(vfs_file, 1);
-        free(superblock_ptr);
-        vfs_close(vfs_file_open);
-        return vfs_opened_inode;
-    } else {
-        VFS_FILE *vfs_recursive = vfs_open_recursive(vfs_file, vfs_path,  0);
-        vfs_close(vfs_file_open);
-        free(superblock_ptr);
-        return vfs_recursive;
+    int64_t temp_total_write_size = (int64_t)write_item_size * write_item_count;
+
+    // Soubor by po zápisu přesáhl velikost, kterou formát VFS dokáže uložit
+    if (vfs_file->offset + temp_total_write_size > inode_max_file_size(vfs_file->mount, vfs_file->inode_ptr)) {
+        log_debug("vfs_write: Soubor by prekrocil maximalni velikost!\n");
+        return -12;
     }
 
+    // Malý zápis na konec běžného souboru - pouze do paměti
+    int64_t delayed_end = vfs_file->delayed_size > 0 ? vfs_file->delayed_offset + vfs_file->delayed_size : vfs_file->inode_ptr->file_size;
+    if (vfs_file->inode_ptr->type == VFS_FILE_TYPE && vfs_file->offset == delayed_end && temp_total_write_size < VFS_DELAYED_SIZE) {
+        // Plný buffer se nejprve zapíše
+        if (vfs_file->delayed_size + temp_total_write_size > VFS_DELAYED_SIZE && vfs_flush(vfs_file) < 0) {
+            return -10;
+        }
+
+        if (vfs_file->delayed == NULL) {
+            vfs_file->delayed = malloc(VFS_DELAYED_SIZE);
+        }
+
+        if (vfs_file->delayed != NULL) {
+            if (vfs_file->delayed_size == 0) {
+                vfs_file->delayed_offset = vfs_file->offset;
+            }
+
+            memcpy(vfs_file->delayed + vfs_file->delayed_size, source, temp_total_write_size);
+            vfs_file->delayed_size += (int32_t)temp_total_write_size;
+            vfs_file->offset += temp_total_write_size;
+
+            return 0;
+        }
+    }
+
+    // Ostatní zápisy musí navazovat na odložená data
+    if (vfs_flush(vfs_file) < 0) {
+        return -10;
+    }
+
+    int64_t written = vfs_write_direct(vfs_file, source, temp_total_write_size);
+
+    if (written < 0) {
+        return written;
+    }
+
+    // Zapsána jen část dat (např. selhal zápis do VFS)
+    if (written < temp_total_write_size) {
+        return -13;
+    }
 
+    return 0;
 }
 
 /**
  * Vytvoří kontext pro práci souboru - vždycky lze provádět čtení i zápis zároveň
  *
- * @param vfs_file cesta k souboru vfs.dat (apod.)
- * @param vfs_path ID inode k otevření
- * @return
+ * @param mount připojený VFS
+ * @param vfs_path cesta souboru uvnitř virtuálního filesystému.
+ * @return (VFS_FILE* | NULL)
  */
-VFS_FILE *vfs_open_inode(char *vfs_file, int32_t inode_id) {
-    // Kontrola délky názvu souboru
-    if (strlen(vfs_file) < 1) {
-        log_debug("vfs_open_inode: Cesta k souboru VFS nemuze byt prazdnym retezcem!\n");
+VFS_FILE *vfs_open(struct vfs_mount *mount, char *vfs_path) {
+    // Kontrola připojení
+    if (mount == NULL) {
+        log_debug("vfs_open: VFS neni pripojen!\n");
         return NULL;
     }
 
-    // Ověření existence souboru
-    if (file_exist(vfs_file) != TRUE) {
-        log_debug("vfs_open_inode: Soubor VFS %s neexistuje!\n", vfs_file);
+    // Kontrola cesty
+    if (vfs_path == NULL) {
+        log_debug("vfs_open: Cesta nemuze byt NULL!\n");
         return NULL;
     }
 
-    // Získání superbloku ze souboru
-    struct superblock *superblock_ptr = superblock_from_file(vfs_file);
+    // Otevření root složky
+    if (strcmp(vfs_path, "/") == 0) {
+        return vfs_open_inode(mount, 1);
+    } else {
+        return vfs_open_recursive(mount, vfs_path,  0);
+    }
+
+
+}
 
-    // Ověření ziskání superbloku
-    if (superblock_ptr == NULL) {
-        log_debug("vfs_open_inode: Nepodarilo se precist superblock z VFS!\n");
+/**
+ * Vytvoří kontext pro práci souboru - vždycky lze provádět čtení i zápis zároveň
+ *
+ * @param mount připojený VFS
+ * @param vfs_path ID inode k otevření
+ * @return
+ */
+VFS_FILE *vfs_open_inode(struct vfs_mount *mount, int32_t inode_id) {
+    // Kontrola připojení
+    if (mount == NULL) {
+        log_debug("vfs_open_inode: VFS neni pripojen!\n");
         return NULL;
     }
 
     VFS_FILE *vfs_file_open = malloc(sizeof(struct VFS_FILE));
 
     if (vfs_file_open == NULL) {
-        free(superblock_ptr);
         log_debug("vfs_open_inode: Nepodarilo se alokovat pamet pro strukturu VFS_FILE_TYPE!\n");
         return NULL;
     }
 
-    struct inode *inode_ptr = inode_read_by_index(vfs_file, inode_id - 1);
+    struct inode *inode_ptr = inode_read_by_index(mount, inode_id - 1);
 
     if (inode_ptr == NULL) {
         free(vfs_file_open);
-        free(superblock_ptr);
         log_debug("vfs_open_inode: Nelze precist inode s ID=%d - dana ID neexistuje!\n", inode_id);
         return NULL;
     }
 
     vfs_file_open->inode_ptr = inode_ptr;
     vfs_file_open->offset = 0;
-    vfs_file_open->vfs_filename = malloc(sizeof(char) * strlen(vfs_file) + 1);
-    strcpy(vfs_file_open->vfs_filename, vfs_file);
-
-    // Uvolnění zdrojů
-    free(superblock_ptr);
+    vfs_file_open->mount = mount;
+    vfs_file_open->block_map = NULL;
+    vfs_file_open->block_map_count = 0;
+    vfs_file_open->delayed = NULL;
+    vfs_file_open->delayed_offset = 0;
+    vfs_file_open->delayed_size = 0;
 
     // Návrat VFS_FILE_TYPE
     return vfs_file_open;
@@ -608,7 +1137,7 @@ VFS_FILE *vfs_open_inode(char *vfs_file, int32_t inode_id) {
  * Zavře virtuální soubor a uvolní pamět
  *
  * @param file virtuální soubor k zavření
- * @return indikace výsledku
+ * @return indikace výsledku (FALSE i když nelze zapsat odložená data, soubor se přesto zavře)
  */
 bool vfs_close(VFS_FILE *file) {
     // Ověření zda je třeba uvolňovat
@@ -616,17 +1145,23 @@ bool vfs_close(VFS_FILE *file) {
         return FALSE;
     }
 
+    // Odložená data se zapíší před zavřením
+    bool result = TRUE;
     if(file->inode_ptr != NULL){
+        if(vfs_flush(file) < 0){
+            log_debug("vfs_close: Odlozena data inode ID=%d nebyla zapsana!\n", file->inode_ptr->id);
+            result = FALSE;
+        }
+
         free(file->inode_ptr);
     }
 
-    if(file->vfs_filename != NULL){
-        free(file->vfs_filename);
-    }
+    vfs_block_map_invalidate(file);
+    free(file->delayed);
 
     free(file);
 
-    return TRUE;
+    return result;
 }
 
 /**
@@ -634,21 +1169,15 @@ bool vfs_close(VFS_FILE *file) {
  * v případě nalezení souboru v dané cestě vrátí ukazatel na strukturu VFS_FILE,
  * v případě nenalezení vrátí NULL
  *
- * @param vfs_filename cesta k virtuálnímu FS
+ * @param mount připojený VFS
  * @param path cesta uvnitř virtuálního FS
  * @param current_inode_id ID aktuální inode
  * @return (VFS_FILE * | NULL)
  */
-VFS_FILE *vfs_open_recursive(char *vfs_filename, char *path, int32_t current_inode_id){
-    // Kontrola délky názvu souboru
-    if (strlen(vfs_filename) < 1) {
-        log_debug("vfs_open_recursive: Cesta k souboru VFS nemuze byt prazdnym retezcem!\n");
-        return NULL;
-    }
-
-    // Ověření existence souboru
-    if (file_exist(vfs_filename) != TRUE) {
-        log_debug("vfs_open_recursive: Soubor VFS %s neexistuje!\n", vfs_filename);
+VFS_FILE *vfs_open_recursive(struct vfs_mount *mount, char *path, int32_t current_inode_id){
+    // Kontrola připojení
+    if (mount == NULL) {
+        log_debug("vfs_open_recursive: VFS neni pripojen!\n");
         return NULL;
     }
 
@@ -656,36 +1185,27 @@ VFS_FILE *vfs_open_recursive(char *vfs_filename, char *path, int32_t current_ino
     if(current_inode_id == 0 && (starts_with("/", path) || strcmp("", path) == 0)){
         // Nastaveni INODE na root
         current_inode_id = 1;
-        // Ořez o první znak
-        path = path + 1;
+        // Ořez o první znak (prázdná cesta znamená přímo root)
+        if(*path == '/'){
+            path = path + 1;
+        }
 
         log_debug("vfs_open_recursive: Vyuzit predpoklad ID=0 && prefix je / -> root\n");
     }
 
-    struct inode *inode_ptr = inode_read_by_index(vfs_filename, current_inode_id - 1);
-
-    // Ověření získání struktury inode
-    if(inode_ptr == NULL){
-        log_debug("vfs_open_recursive: Nelze ziskat inode s ID=%d\n", current_inode_id);
-        return NULL;
-    }
-
-
     // Pokud je cesta prázdná, pokusíme se o otevření souboru s poslední  inode ID
+    // (existenci mezilehlých složek ověřuje directory_has_entry nebo mezipaměť dentry)
     if(strlen(path) < 1 || (strcmp(path, "/") == 0 && current_inode_id != 0)){
-        VFS_FILE *vfs_file = vfs_open_inode(vfs_filename, current_inode_id);
-        free(inode_ptr);
-        return vfs_file;
+        return vfs_open_inode(mount, current_inode_id);
     } else {
         // Pokračujeme rekurzivně, vždy odřízneme řetězec do oddělovacího znaku
         char *part = get_prefix_string_until_first_character(path, "/");
 
         // Pokud je aktuální INODE složka, procházíme všechny directory_entry
-        int32_t entry_find_result = directory_has_entry(vfs_filename, current_inode_id, part);
+        int32_t entry_find_result = directory_has_entry(mount, current_inode_id, part);
 
         // Pokud jsme nenašli záznam, smůla
         if(entry_find_result < 1) {
-            free(inode_ptr);
             free(part);
             return NULL;
         }
@@ -699,11 +1219,10 @@ VFS_FILE *vfs_open_recursive(char *vfs_filename, char *path, int32_t current_ino
         }
 
         // Uvolnění zdrojů
-        free(inode_ptr);
         free(part);
 
         // Rekurzivní průchod zbytkem cesty
-        return vfs_open_recursive(vfs_filename, path, entry_find_result);
+        return vfs_open_recursive(mount, path, entry_find_result);
     }
 
 
@@ -3,19 +3,30 @@
 
 #include "bool.h"
 #include "inode.h"
+#include "mount.h"
 #include <stdio.h>
 
+// Největší objem malých zápisů na konec souboru, kterým se odkládá přidělení databloků
+#define VFS_DELAYED_SIZE (256 * 1024)
+
 // Struktura pro uložení kontextu při práci se souborem uvnitř inode
 typedef struct VFS_FILE {
-    char *vfs_filename;                 // Ukazatel na řetězec s cestou k datovému souboru VFS
+    struct vfs_mount *mount;        // Připojený VFS, ve kterém soubor leží (VFS_FILE jej nevlastní)
     struct inode *inode_ptr;        // Ukazatel na inode, se kterou pracujeme
     int64_t offset;                 // Počet bytů od začátku souboru odkud čteme
+    int64_t *block_map;             // Načtené adresy databloků souboru (index -> adresa), NULL = nenačteno
+    int32_t block_map_count;        // Počet platných položek v block_map
+    char *delayed;                  // Odložená data připojená na konec souboru, NULL = nealokováno
+    int64_t delayed_offset;         // Pozice odložených dat v souboru (původní velikost souboru)
+    int32_t delayed_size;           // Počet odložených byte
 } VFS_FILE;
 
 
 /**
  * Nastaví offset pro strukturu VFS_FILE
  *
+ * Offset může ukazovat i za konec souboru, zápis na něj vytvoří díru
+ *
  * @param vfs_file ukazatel na strukturu VFS_FILE
  * @param offset vstupní hodnota nastavení
  * @param type typ nastavení (typy dodržují SEEK_* v stdio.h)
@@ -23,6 +34,25 @@ typedef struct VFS_FILE {
  */
 int32_t vfs_seek(VFS_FILE *vfs_file, int64_t offset, int type);
 
+/**
+ * Vrátí adresu databloku souboru na daném indexu
+ *
+ * Adresy se čtou z mapy databloků uložené ve VFS_FILE, mapa se načte
+ * při prvním použití a po alokaci nových databloků se pouze doplní
+ *
+ * @param vfs_file ukazatel na soubor
+ * @param index index databloku v souboru
+ * @return (return < 0: chyba | 0: díra | return > 0: adresa databloku ve VFS)
+ */
+int64_t vfs_get_datablock_address(VFS_FILE *vfs_file, int32_t index);
+
+/**
+ * Zneplatní mapu databloků souboru (např. po dealokaci)
+ *
+ * @param vfs_file ukazatel na soubor
+ */
+void vfs_block_map_invalidate(VFS_FILE *vfs_file);
+
 /**
  * Přečte daný počet struktur dané velikosti ze souboru vfs_file uloženého ve virtuálním FS
  *
@@ -45,29 +75,83 @@ size_t vfs_read(void *destination, size_t read_item_size, size_t read_item_count
  */
 size_t vfs_write(void *source, size_t write_item_size, size_t write_item_count, VFS_FILE *vfs_file);
 
+/**
+ * Zapíše odložená data souboru do VFS - databloky se přidělí najednou
+ * pro celou výslednou velikost souboru
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @return (return < 0: chyba | 0: v pořádku)
+ */
+int32_t vfs_flush(VFS_FILE *vfs_file);
+
+/**
+ * Předem přidělí souboru databloky pro zadanou velikost jedním voláním alokátoru,
+ * velikost souboru se nemění
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @param size očekávaná velikost souboru v byte
+ * @return (return < 0: chyba | 0: v pořádku | return > 0: počet nepřidělených databloků)
+ */
+int32_t vfs_preallocate(VFS_FILE *vfs_file, int64_t size);
+
+/**
+ * Nastaví velikost souboru - zkrácení uvolní databloky za novým koncem,
+ * prodloužení přidá na konec díru (čte se jako nuly), nastavení stejné
+ * velikosti uvolní předem vyhrazené databloky za koncem souboru
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @param size nová velikost souboru v byte
+ * @return (return < 0: chyba | 0: v pořádku)
+ */
+int32_t vfs_truncate(VFS_FILE *vfs_file, int64_t size);
+
+/**
+ * Zapíše do souboru vfs_file (od jeho offsetu) data ze souboru hostitelského systému,
+ * data se přenáší po fyzicky souvislých úsecích bez kopírování přes uživatelský prostor
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @param fd popisovač zdrojového souboru
+ * @param fd_offset pozice ve zdrojovém souboru
+ * @param size počet byte k zápisu
+ * @return (return < 0: chyba | return >= 0: počet zapsaných byte)
+ */
+int64_t vfs_write_from_fd(VFS_FILE *vfs_file, int fd, int64_t fd_offset, int64_t size);
+
+/**
+ * Přečte ze souboru vfs_file (od jeho offsetu) data do souboru hostitelského systému,
+ * data se přenáší po fyzicky souvislých úsecích bez kopírování přes uživatelský prostor
+ *
+ * @param vfs_file ukazatel na soubor ve VFS
+ * @param fd popisovač cílového souboru
+ * @param fd_offset pozice v cílovém souboru
+ * @param size počet byte ke čtení
+ * @return (return < 0: chyba | return >= 0: počet přečtených byte)
+ */
+int64_t vfs_read_to_fd(VFS_FILE *vfs_file, int fd, int64_t fd_offset, int64_t size);
+
 /**
  * Vytvoří kontext pro práci souboru - vždycky lze provádět čtení i zápis zároveň
  *
- * @param vfs_file cesta k souboru vfs.dat (apod.)
+ * @param mount připojený VFS
  * @param vfs_path cesta souboru uvnitř virtuálního filesystému.
  * @return (VFS_FILE* | NULL)
  */
-VFS_FILE *vfs_open(char *vfs_file, char *vfs_path);
+VFS_FILE *vfs_open(struct vfs_mount *mount, char *vfs_path);
 
 /**
  * Vytvoří kontext pro práci souboru - vždycky lze provádět čtení i zápis zároveň
  *
- * @param vfs_file cesta k souboru vfs.dat (apod.)
+ * @param mount připojený VFS
  * @param vfs_path ID inode k otevření
  * @return
  */
-VFS_FILE *vfs_open_inode(char *vfs_file, int32_t inode_id);
+VFS_FILE *vfs_open_inode(struct vfs_mount *mount, int32_t inode_id);
 
 /**
  * Zavře virtuální soubor a uvolní pamět
  *
  * @param file virtuální soubor k zavření
- * @return indikace výsledku
+ * @return indikace výsledku (FALSE i když nelze zapsat odložená data, soubor se přesto zavře)
  */
 bool vfs_close(VFS_FILE *file);
 
@@ -76,11 +160,11 @@ bool vfs_close(VFS_FILE *file);
  * v případě nalezení souboru v dané cestě vrátí ukazatel na strukturu VFS_FILE,
  * v případě nenalezení vrátí NULL
  *
- * @param vfs_filename cesta k virtuálnímu FS
+ * @param mount připojený VFS
  * @param path cesta uvnitř virtuálního FS
  * @param current_inode_id ID aktuální inode
  * @return (VFS_FILE * | NULL)
  */
-VFS_FILE *vfs_open_recursive(char *vfs_filename, char *path, int32_t current_inode_id);
+VFS_FILE *vfs_open_recursive(struct vfs_mount *mount, char *path, int32_t current_inode_id);
 
 #endif //KIV_ZOS_VFS_IO_H